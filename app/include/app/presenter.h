@@ -37,6 +37,7 @@ class Presenter : public QObject {
 public:
   explicit Presenter(std::shared_ptr<stv::core::IScheduler> scheduler,
                      std::shared_ptr<stv::core::ILogger> logger,
+                     stv::core::WorkflowAdmissionPolicy admission = {},
                      QObject *parent = nullptr);
 
   // ---- Properties ----
@@ -50,10 +51,16 @@ public:
   Q_INVOKABLE void startGeneration(const QString &storyText,
                                    const QString &style, int sceneCount);
   Q_INVOKABLE void cancelGeneration();
+  /// Re-run only the unfinished tasks of the last failed or canceled workflow
+  Q_INVOKABLE void resumeGeneration();
 
   // ---- Configuration ----
   /// Set the stage factory for the workflow engine (should be called before startGeneration)
   void set_stage_factory(stv::core::WorkflowEngine::StageFactory factory);
+  /// Replace the built-in workflow DAG with a compiled template (M4)
+  void set_workflow_plan(std::shared_ptr<const stv::core::WorkflowPlan> plan);
+  /// Persist workflow progress so failed runs can be resumed (M4)
+  void set_checkpoint_store(std::shared_ptr<stv::core::IWorkflowCheckpointStore> store);
 
 signals:
   void busyChanged();
@@ -39,6 +39,22 @@ Page {
                     font.pixelSize: 12
                 }
             }
+
+            Button {
+                text: "Resume"
+                visible: !presenter.busy && presenter.outputPath === "" && presenter.logText !== ""
+                onClicked: presenter.resumeGeneration()
+
+                background: Rectangle {
+                    color: hovered ? "#5aaeff" : "#4a9eff"
+                    radius: 6
+                }
+                contentItem: Text {
+                    text: parent.text
+                    color: "#ffffff"
+                    font.pixelSize: 12
+                }
+            }
         }
 
         Text {
@@ -5,11 +5,19 @@
 #include "app/presenter.h"
 #include "app/project_presenter.h"
 #include "app/storyboard_presenter.h"
+#include "core/cpu_topology.h"
 #include "core/logger.h"
+#include "core/runtime_estimator.h"
 #include "core/scheduler.h"
+#include "core/stage_memo.h"
+#include "core/workflow_checkpoint.h"
+#include "core/workflow_template.h"
+#include "infra/artifact_cache.h"
 #include "infra/curl_http_client.h"
 #include "infra/http_client.h"
 #include "infra/logger.h"
+#include "infra/path_service.h"
+#include "infra/resource_discovery.h"
 #include "infra/stage_factory.h"
 
 #include <QCoreApplication>
@@ -18,22 +26,12 @@
 #include <QQmlContext>
 #include <QQuickStyle>
 
-#include <algorithm>
 #include <cstdlib>
 #include <memory>
 #include <string>
-#include <thread>
 
 namespace {
 
-int auto_worker_count() {
-  const auto hw = static_cast<int>(std::thread::hardware_concurrency());
-  if (hw <= 0) {
-    return 4;
-  }
-  return std::clamp(hw - 1, 2, 8);
-}
-
 int parse_env_int(const char *name, int fallback, bool allow_zero,
                   const std::shared_ptr<stv::core::ILogger> &logger) {
   const char *raw = std::getenv(name);
@@ -59,13 +57,45 @@ int parse_env_int(const char *name, int fallback, bool allow_zero,
 stv::core::SchedulerConfig build_scheduler_config(
     const std::shared_ptr<stv::core::ILogger> &logger) {
   stv::core::SchedulerConfig cfg;
-  cfg.worker_count = auto_worker_count();
-  cfg.resource_budget.cpu_slots_hard = cfg.worker_count;
-  cfg.resource_budget.ram_soft_mb = 2048;
-  cfg.resource_budget.vram_soft_mb = 7680;
+  // Container-aware defaults: cgroup v2 cpu.max/memory.max + cpuset.
+  auto cgroup = std::make_shared<stv::infra::CgroupMonitor>();
+  const auto limits = cgroup->read_limits();
+  stv::infra::apply_discovered_budget(
+      limits, static_cast<int>(stv::core::allowed_cpus().size()), cfg);
+  if (logger) {
+    logger->info("startup", "app", "resource_discovered",
+                 "cgroup=" + cgroup->cgroup_dir() +
+                     " cpu_quota=" +
+                     (limits.cpu_quota_cores.has_value()
+                          ? std::to_string(*limits.cpu_quota_cores)
+                          : std::string("max")) +
+                     " memory_max_mb=" +
+                     (limits.memory_max_mb.has_value()
+                          ? std::to_string(*limits.memory_max_mb)
+                          : std::string("max")) +
+                     " workers=" + std::to_string(cfg.worker_count) +
+                     " ram_soft_mb=" +
+                     std::to_string(cfg.resource_budget.ram_soft_mb));
+  }
+  if (parse_env_int("STV_SCHED_ADMISSION", 1, true, logger) != 0) {
+    cfg.admission.monitor = cgroup;
+  }
+
+  // Learned runtime/demand model, persisted across runs in the cache dir.
+  auto estimator = std::make_shared<stv::core::RuntimeEstimator>(
+      stv::infra::PathService::create()->cache_dir() + "/runtime_model.tsv");
+  auto loaded = estimator->load();
+  if (loaded.is_err() && logger) {
+    logger->warn("startup", "app", "runtime_model_load_failed",
+                 loaded.error().internal_message);
+  }
+  cfg.estimation.estimator = std::move(estimator);
   cfg.aging_policy.interval_ms = 500;
   cfg.aging_policy.boost_per_interval = 1;
   cfg.pause_policy.checkpoint_timeout_ms = 1500;
+  cfg.retry.default_policy.max_attempts = 2;
+  cfg.retry.default_policy.initial_backoff_ms = 1000;
+  cfg.retry.default_policy.max_backoff_ms = 15000;
 
   cfg.worker_count = parse_env_int("STV_SCHED_WORKERS", cfg.worker_count, false,
                                    logger);
@@ -83,10 +113,56 @@ stv::core::SchedulerConfig build_scheduler_config(
   cfg.pause_policy.checkpoint_timeout_ms = parse_env_int(
       "STV_SCHED_PAUSE_TIMEOUT_MS", cfg.pause_policy.checkpoint_timeout_ms,
       false, logger);
+  cfg.retry.default_policy.max_attempts = parse_env_int(
+      "STV_SCHED_RETRY_MAX_ATTEMPTS", cfg.retry.default_policy.max_attempts,
+      false, logger);
+  cfg.retry.default_policy.initial_backoff_ms = parse_env_int(
+      "STV_SCHED_RETRY_BACKOFF_MS", cfg.retry.default_policy.initial_backoff_ms,
+      true, logger);
+  cfg.affinity.enabled =
+      parse_env_int("STV_SCHED_CPU_AFFINITY", 0, true, logger) != 0;
+  if (const char *cpu_set = std::getenv("STV_SCHED_CPU_SET")) {
+    cfg.affinity.cpu_set = stv::core::parse_cpu_list(cpu_set);
+  }
+
+  cfg.batching.enabled = parse_env_int("STV_SCHED_BATCH", 0, true, logger) != 0;
+  cfg.batching.max_batch_size =
+      parse_env_int("STV_SCHED_BATCH_MAX", cfg.batching.max_batch_size, false, logger);
+  cfg.batching.max_linger_ms =
+      parse_env_int("STV_SCHED_BATCH_LINGER_MS", cfg.batching.max_linger_ms, true, logger);
+
+  // QoS 预留：交互预览与批量渲染共用调度器时，为交互类保留 CPU 槽位
+  cfg.qos.enabled = parse_env_int("STV_SCHED_QOS", 1, true, logger) != 0;
+
+  if (parse_env_int("STV_SCHED_MEMO", 1, true, logger) != 0) {
+    cfg.memoization.memo = std::make_shared<stv::core::InMemoryStageMemo>(
+        static_cast<size_t>(parse_env_int("STV_SCHED_MEMO_ENTRIES", 4096, false, logger)));
+  }
 
   return cfg;
 }
 
+stv::core::WorkflowAdmissionPolicy
+build_admission_policy(const std::shared_ptr<stv::core::ILogger> &logger) {
+  stv::core::WorkflowAdmissionPolicy policy;
+  policy.max_active_workflows =
+      parse_env_int("STV_MAX_ACTIVE_WORKFLOWS", 0, true, logger);
+  policy.max_active_tasks = parse_env_int("STV_MAX_ACTIVE_TASKS", 0, true, logger);
+  policy.max_pending =
+      parse_env_int("STV_WORKFLOW_QUEUE", policy.max_pending, true, logger);
+  if (const char *on_full = std::getenv("STV_WORKFLOW_ON_FULL")) {
+    if (std::string(on_full) == "block") {
+      policy.on_full = stv::core::WorkflowAdmissionPolicy::OnFull::Block;
+    } else if (std::string(on_full) != "reject" && logger) {
+      logger->warn("startup", "app", "invalid_env",
+                   "STV_WORKFLOW_ON_FULL must be reject|block, using reject");
+    }
+  }
+  policy.block_timeout_ms =
+      parse_env_int("STV_WORKFLOW_BLOCK_TIMEOUT_MS", 0, true, logger);
+  return policy;
+}
+
 } // namespace
 
 namespace stv::infra {
@@ -125,7 +201,32 @@ int main(int argc, char *argv[]) {
       std::shared_ptr<stv::core::IScheduler>(scheduler.release());
 
   // Create HTTP client with retry policy (infra)
-  auto curl_client = std::make_shared<stv::infra::CurlHttpClient>();
+  // easy handle 池：并发请求各借一个 handle，共享 DNS/连接/TLS 缓存
+  stv::infra::CurlPoolOptions pool_options;
+  pool_options.max_handles =
+      parse_env_int("STV_HTTP_POOL_SIZE", pool_options.max_handles, false, logger_ptr);
+  pool_options.max_per_host =
+      parse_env_int("STV_HTTP_MAX_PER_HOST", pool_options.max_per_host, true, logger_ptr);
+  pool_options.max_wait = std::chrono::milliseconds(
+      parse_env_int("STV_HTTP_POOL_WAIT_MS", 0, true, logger_ptr));
+  // 连接复用：本地服务端支持 h2c 时设 STV_HTTP_VERSION=h2c，并发 stage 请求
+  // 多路复用同一条连接
+  const char *http_version_env = std::getenv("STV_HTTP_VERSION");
+  if (http_version_env && http_version_env[0] != 0 &&
+      !stv::infra::parse_http_version(http_version_env,
+                                      pool_options.http_version) &&
+      logger_ptr) {
+    logger_ptr->warn("startup", "app", "http_version_invalid",
+                     std::string("Unknown STV_HTTP_VERSION value, fallback to 2: ") +
+                         http_version_env);
+  }
+  pool_options.tcp_keepalive = std::chrono::seconds(parse_env_int(
+      "STV_HTTP_KEEPALIVE_S", static_cast<int>(pool_options.tcp_keepalive.count()),
+      true, logger_ptr));
+  pool_options.max_idle = std::chrono::seconds(parse_env_int(
+      "STV_HTTP_MAX_IDLE_S", static_cast<int>(pool_options.max_idle.count()), true,
+      logger_ptr));
+  auto curl_client = std::make_shared<stv::infra::CurlHttpClient>(pool_options);
   stv::infra::RetryPolicy retry_policy;
   retry_policy.max_retries = 2;
   retry_policy.initial_backoff = std::chrono::milliseconds(500);
@@ -142,13 +243,50 @@ int main(int argc, char *argv[]) {
   auto stage_factory_obj =
       std::make_shared<stv::infra::StageFactory>(http_client, api_base_url);
 
-  auto *presenter = new stv::app::Presenter(scheduler_ptr, logger_ptr);
+  stage_factory_obj->set_streaming_compose(
+      parse_env_int("STV_STREAMING_COMPOSE", 1, true, logger_ptr) != 0);
+
+  const int artifact_cache_mb =
+      parse_env_int("STV_ARTIFACT_CACHE_MB", 2048, true, logger_ptr);
+  if (artifact_cache_mb > 0) {
+    auto artifact_cache = stv::infra::ArtifactCache::open(
+        stv::infra::PathService::create()->cache_dir() + "/artifacts",
+        static_cast<uint64_t>(artifact_cache_mb) * 1024 * 1024);
+    if (artifact_cache.is_ok()) {
+      stage_factory_obj->set_artifact_cache(artifact_cache.value());
+    } else {
+      logger_ptr->warn("startup", "app", "artifact_cache_disabled",
+                       artifact_cache.error().internal_message);
+    }
+  }
+
+  auto *presenter = new stv::app::Presenter(scheduler_ptr, logger_ptr,
+                                           build_admission_policy(logger_ptr));
 
   // Set stage factory to workflow engine
   presenter->set_stage_factory([stage_factory_obj](stv::core::TaskType type) {
     return stage_factory_obj->create_stage(type);
   });
 
+  // Workflow checkpoints (M4): failed or interrupted runs can be resumed.
+  if (parse_env_int("STV_WORKFLOW_CHECKPOINTS", 1, true, logger_ptr) != 0) {
+    presenter->set_checkpoint_store(
+        std::make_shared<stv::core::FileWorkflowCheckpointStore>(
+            stv::infra::PathService::create()->cache_dir() + "/workflows"));
+  }
+
+  // Optional declarative workflow template (M4); compiled once here.
+  if (const char *template_path = std::getenv("STV_WORKFLOW_TEMPLATE");
+      template_path && *template_path) {
+    auto plan = stv::core::load_workflow_template(template_path);
+    if (plan.is_ok()) {
+      presenter->set_workflow_plan(plan.value());
+    } else {
+      logger_ptr->warn("startup", "app", "workflow_template_ignored",
+                       plan.error().internal_message);
+    }
+  }
+
   auto *auth_presenter = new stv::app::AuthPresenter();
   auto *project_presenter = new stv::app::ProjectPresenter();
   auto *storyboard_presenter = new stv::app::StoryboardPresenter();
@@ -11,10 +11,12 @@ namespace stv::app {
 
 Presenter::Presenter(std::shared_ptr<stv::core::IScheduler> scheduler,
                      std::shared_ptr<stv::core::ILogger> logger,
+                     stv::core::WorkflowAdmissionPolicy admission,
                      QObject *parent)
     : QObject(parent), scheduler_(std::move(scheduler)),
       logger_(std::move(logger)) {
-  engine_ = std::make_shared<stv::core::WorkflowEngine>(scheduler_, logger_);
+  engine_ = std::make_shared<stv::core::WorkflowEngine>(scheduler_, logger_,
+                                                        admission);
 
   engine_->on_completion([this](const std::string & /*trace_id*/, bool success,
                                 const std::string &output_path) {
@@ -89,8 +91,9 @@ void Presenter::startGeneration(const QString &storyText, const QString &style,
   appendLog("Style: " + style);
   appendLog("Scenes: " + QString::number(sceneCount));
 
-  auto start_result = engine_->start_workflow(storyText.toStdString(),
-                                              style.toStdString(), sceneCount);
+  auto start_result = engine_->start_workflow(
+      storyText.toStdString(), style.toStdString(), sceneCount,
+      stv::core::WorkflowClass::Interactive);
   if (start_result.is_err()) {
     const auto &err = start_result.error();
     setBusy(false);
@@ -112,6 +115,38 @@ void Presenter::set_stage_factory(stv::core::WorkflowEngine::StageFactory factor
   engine_->set_stage_factory(std::move(factory));
 }
 
+void Presenter::set_workflow_plan(std::shared_ptr<const stv::core::WorkflowPlan> plan) {
+  engine_->set_workflow_plan(std::move(plan));
+}
+
+void Presenter::set_checkpoint_store(
+    std::shared_ptr<stv::core::IWorkflowCheckpointStore> store) {
+  engine_->set_checkpoint_store(std::move(store));
+}
+
+void Presenter::resumeGeneration() {
+  if (busy_ || current_trace_id_.isEmpty()) {
+    appendLog("Nothing to resume.");
+    return;
+  }
+
+  auto resume_result = engine_->resume_workflow(
+      current_trace_id_.toStdString(), stv::core::WorkflowClass::Interactive);
+  if (resume_result.is_err()) {
+    const auto &err = resume_result.error();
+    appendLog(QString("Failed to resume workflow: %1")
+                  .arg(QString::fromStdString(err.user_message.empty()
+                                                  ? err.internal_message
+                                                  : err.user_message)));
+    return;
+  }
+
+  setBusy(true);
+  setStatusText("Resuming generation...");
+  appendLog("=== Resuming workflow " + current_trace_id_ + " ===");
+  tick_timer_->start();
+}
+
 void Presenter::cancelGeneration() {
   if (!busy_ || current_trace_id_.isEmpty()) {
     return;
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "core/logger.h"
+#include "core/orchestrator.h"
+#include "core/result.h"
+#include "core/scheduler.h"
+#include "core/task_error.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace stv::batch {
+
+/// One story request from a JSONL line (M4).
+/// Story text comes from "story_text", "story" or "body", in that order, so
+/// backlog-style files ({"request_id", "title", "body"}) replay as-is.
+struct BatchRequest {
+  std::string request_id;
+  std::string story_text;
+  std::string style;
+  int scene_count = 0; // 0 = BatchOptions::default_scene_count
+  core::WorkflowClass workflow_class = core::WorkflowClass::Batch;
+};
+
+/// Parse one JSONL line (a flat JSON object). `line_number` only labels
+/// errors and the fallback request_id.
+core::Result<BatchRequest, core::TaskError>
+parse_request_line(const std::string &line, int line_number);
+
+/// Read every non-blank line of a JSONL file.
+core::Result<std::vector<BatchRequest>, core::TaskError>
+load_requests(const std::string &path);
+
+struct BatchOptions {
+  int concurrency = 4;     // Admitted workflows at once
+  int queue_depth = 0;     // Pending workflows; 0 = same as concurrency
+  int default_scene_count = 4;
+  std::string default_style = "cinematic";
+  int tick_interval_ms = 20; // Scheduler tick (retries, pause timeouts)
+};
+
+/// Outcome of one request. Times are milliseconds from start_workflow();
+/// queue_ms ends at the workflow's first task event.
+struct BatchResult {
+  std::string request_id;
+  std::string trace_id;
+  bool success = false;
+  std::string output_path;
+  std::string error; // Start failure (rejected, invalid request) or empty
+  int64_t queue_ms = -1;
+  int64_t latency_ms = -1;
+};
+
+struct LatencySummary {
+  int64_t p50 = 0;
+  int64_t p95 = 0;
+  int64_t p99 = 0;
+  int64_t max = 0;
+  double mean = 0.0;
+};
+
+struct BatchReport {
+  int requests = 0;
+  int succeeded = 0;
+  int failed = 0;
+  int64_t wall_ms = 0;
+  double workflows_per_minute = 0.0;
+  LatencySummary latency_ms;
+  LatencySummary queue_ms;
+  core::WorkflowAdmissionMetrics admission;
+  core::SchedulerMetrics scheduler;
+};
+
+/// Replays requests through a WorkflowEngine whose admission control bounds
+/// concurrency. A feeder thread calls start_workflow() (blocking while the
+/// queue is full) so the calling thread keeps ticking the scheduler.
+/// The engine registers with the scheduler for good, so the scheduler must
+/// not deliver events after the runner is destroyed.
+class BatchRunner {
+public:
+  BatchRunner(std::shared_ptr<core::IScheduler> scheduler,
+              std::shared_ptr<core::ILogger> logger, BatchOptions options);
+  ~BatchRunner();
+
+  BatchRunner(const BatchRunner &) = delete;
+  BatchRunner &operator=(const BatchRunner &) = delete;
+
+  /// Default: mock stages.
+  void set_stage_factory(core::WorkflowEngine::StageFactory factory);
+
+  /// Default: the built-in story-to-video template.
+  void set_workflow_plan(std::shared_ptr<const core::WorkflowPlan> plan);
+
+  /// Runs every request to completion; results keep the input order.
+  std::vector<BatchResult> run(const std::vector<BatchRequest> &requests);
+
+  /// Report for the last run().
+  [[nodiscard]] const BatchReport &report() const { return report_; }
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  /// Per-trace timestamps. A fast workflow can finish before its
+  /// start_workflow() returns, so entries are keyed by trace_id, not index.
+  struct Tracking {
+    Clock::time_point first_event{};
+    Clock::time_point finished_at{};
+    bool has_event = false;
+    bool finished = false;
+    bool success = false;
+    std::string output_path;
+  };
+
+  std::shared_ptr<core::IScheduler> scheduler_;
+  BatchOptions options_;
+  // Registered with the scheduler for the runner's lifetime; run() returns
+  // only after every workflow it started has completed.
+  std::unique_ptr<core::WorkflowEngine> engine_;
+  BatchReport report_;
+
+  std::mutex mutex_;
+  std::condition_variable finished_cv_;
+  std::unordered_map<std::string, Tracking> tracking_;
+  int finished_count_ = 0;
+};
+
+/// Nearest-rank percentiles over `samples` (negative values are skipped).
+LatencySummary summarize_latencies(std::vector<int64_t> samples);
+
+/// One JSON object per result, in order.
+void write_results_jsonl(std::ostream &out, const std::vector<BatchResult> &results);
+
+/// Aggregate report as one JSON object.
+void write_report_json(std::ostream &out, const BatchReport &report);
+
+} // namespace stv::batch
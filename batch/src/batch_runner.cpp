@@ -0,0 +1,525 @@
+#include "batch/batch_runner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+namespace stv::batch {
+
+namespace {
+
+core::TaskError invalid_request(int line_number, const std::string &why) {
+  return core::TaskError(core::ErrorCategory::Pipeline, 4001, false,
+                         "Invalid batch request",
+                         "line " + std::to_string(line_number) + ": " + why,
+                         {{"line", std::to_string(line_number)}});
+}
+
+void append_utf8(std::string &out, uint32_t cp) {
+  if (cp < 0x80) {
+    out += static_cast<char>(cp);
+  } else if (cp < 0x800) {
+    out += static_cast<char>(0xC0 | (cp >> 6));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  } else if (cp < 0x10000) {
+    out += static_cast<char>(0xE0 | (cp >> 12));
+    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  } else {
+    out += static_cast<char>(0xF0 | (cp >> 18));
+    out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  }
+}
+
+/// Minimal reader for one flat JSON object: string values are unescaped,
+/// numbers/literals are kept as text, nested values are skipped.
+class FlatJsonReader {
+public:
+  explicit FlatJsonReader(const std::string &text) : s_(text) {}
+
+  bool parse(std::unordered_map<std::string, std::string> &fields, std::string &error) {
+    skip_ws();
+    if (!consume('{')) {
+      error = "expected '{'";
+      return false;
+    }
+    skip_ws();
+    if (consume('}')) {
+      return trailing_ok(error);
+    }
+    while (true) {
+      skip_ws();
+      std::string key;
+      if (!read_string(key)) {
+        error = "expected string key at offset " + std::to_string(pos_);
+        return false;
+      }
+      skip_ws();
+      if (!consume(':')) {
+        error = "expected ':' after \"" + key + "\"";
+        return false;
+      }
+      skip_ws();
+      std::string value;
+      if (peek() == '"') {
+        if (!read_string(value)) {
+          error = "unterminated string for \"" + key + "\"";
+          return false;
+        }
+        fields[key] = std::move(value);
+      } else if (peek() == '{' || peek() == '[') {
+        if (!skip_nested()) {
+          error = "unterminated value for \"" + key + "\"";
+          return false;
+        }
+      } else {
+        const size_t start = pos_;
+        while (pos_ < s_.size() && s_[pos_] != ',' && s_[pos_] != '}' &&
+               !std::isspace(static_cast<unsigned char>(s_[pos_]))) {
+          ++pos_;
+        }
+        fields[key] = s_.substr(start, pos_ - start);
+      }
+      skip_ws();
+      if (consume(',')) {
+        continue;
+      }
+      if (consume('}')) {
+        return trailing_ok(error);
+      }
+      error = "expected ',' or '}' at offset " + std::to_string(pos_);
+      return false;
+    }
+  }
+
+private:
+  const std::string &s_;
+  size_t pos_ = 0;
+
+  char peek() const { return pos_ < s_.size() ? s_[pos_] : '\0'; }
+  bool consume(char c) {
+    if (peek() != c) {
+      return false;
+    }
+    ++pos_;
+    return true;
+  }
+  void skip_ws() {
+    while (pos_ < s_.size() && std::isspace(static_cast<unsigned char>(s_[pos_]))) {
+      ++pos_;
+    }
+  }
+  bool trailing_ok(std::string &error) {
+    skip_ws();
+    if (pos_ != s_.size()) {
+      error = "trailing characters after object";
+      return false;
+    }
+    return true;
+  }
+
+  bool read_hex4(uint32_t &out) {
+    if (pos_ + 4 > s_.size()) {
+      return false;
+    }
+    out = 0;
+    for (int i = 0; i < 4; ++i) {
+      const char c = s_[pos_++];
+      out <<= 4;
+      if (c >= '0' && c <= '9') {
+        out |= static_cast<uint32_t>(c - '0');
+      } else if (c >= 'a' && c <= 'f') {
+        out |= static_cast<uint32_t>(c - 'a' + 10);
+      } else if (c >= 'A' && c <= 'F') {
+        out |= static_cast<uint32_t>(c - 'A' + 10);
+      } else {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool read_string(std::string &out) {
+    if (!consume('"')) {
+      return false;
+    }
+    while (pos_ < s_.size()) {
+      const char c = s_[pos_++];
+      if (c == '"') {
+        return true;
+      }
+      if (c != '\\') {
+        out += c;
+        continue;
+      }
+      if (pos_ >= s_.size()) {
+        return false;
+      }
+      const char esc = s_[pos_++];
+      switch (esc) {
+      case 'n': out += '\n'; break;
+      case 't': out += '\t'; break;
+      case 'r': out += '\r'; break;
+      case 'b': out += '\b'; break;
+      case 'f': out += '\f'; break;
+      case 'u': {
+        uint32_t cp = 0;
+        if (!read_hex4(cp)) {
+          return false;
+        }
+        // Surrogate pair → one code point.
+        if (cp >= 0xD800 && cp <= 0xDBFF && s_.compare(pos_, 2, "\\u") == 0) {
+          pos_ += 2;
+          uint32_t low = 0;
+          if (!read_hex4(low)) {
+            return false;
+          }
+          cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+        }
+        append_utf8(out, cp);
+        break;
+      }
+      default: out += esc; break; // \" \\ \/
+      }
+    }
+    return false;
+  }
+
+  bool skip_nested() {
+    int depth = 0;
+    while (pos_ < s_.size()) {
+      const char c = peek();
+      if (c == '"') {
+        std::string ignored;
+        if (!read_string(ignored)) {
+          return false;
+        }
+        continue;
+      }
+      ++pos_;
+      if (c == '{' || c == '[') {
+        ++depth;
+      } else if (c == '}' || c == ']') {
+        if (--depth == 0) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+};
+
+std::string json_escape(const std::string &value) {
+  std::string out;
+  out.reserve(value.size() + 2);
+  for (const char c : value) {
+    switch (c) {
+    case '"': out += "\\\""; break;
+    case '\\': out += "\\\\"; break;
+    case '\n': out += "\\n"; break;
+    case '\r': out += "\\r"; break;
+    case '\t': out += "\\t"; break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        char buf[8];
+        std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+        out += buf;
+      } else {
+        out += c;
+      }
+    }
+  }
+  return out;
+}
+
+void write_summary(std::ostream &out, const LatencySummary &s) {
+  out << "{\"p50\":" << s.p50 << ",\"p95\":" << s.p95 << ",\"p99\":" << s.p99
+      << ",\"max\":" << s.max << ",\"mean\":" << std::fixed << std::setprecision(1)
+      << s.mean << "}";
+}
+
+int64_t elapsed_ms(std::chrono::steady_clock::time_point from,
+                   std::chrono::steady_clock::time_point to) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(to - from).count();
+}
+
+} // namespace
+
+core::Result<BatchRequest, core::TaskError>
+parse_request_line(const std::string &line, int line_number) {
+  std::unordered_map<std::string, std::string> fields;
+  std::string error;
+  if (!FlatJsonReader(line).parse(fields, error)) {
+    return core::Result<BatchRequest, core::TaskError>::Err(
+        invalid_request(line_number, error));
+  }
+
+  BatchRequest request;
+  auto field = [&](const char *key) -> const std::string * {
+    auto it = fields.find(key);
+    return it == fields.end() ? nullptr : &it->second;
+  };
+  request.request_id =
+      field("request_id") ? *field("request_id") : "line-" + std::to_string(line_number);
+  for (const char *key : {"story_text", "story", "body"}) {
+    if (const auto *text = field(key); text && !text->empty()) {
+      request.story_text = *text;
+      break;
+    }
+  }
+  if (request.story_text.empty()) {
+    return core::Result<BatchRequest, core::TaskError>::Err(
+        invalid_request(line_number, "missing story_text/story/body"));
+  }
+  if (const auto *style = field("style")) {
+    request.style = *style;
+  }
+  if (const auto *scenes = field("scene_count")) {
+    char *end = nullptr;
+    const long value = std::strtol(scenes->c_str(), &end, 10);
+    if (!end || *end != 0 || value <= 0 || value > 64) {
+      return core::Result<BatchRequest, core::TaskError>::Err(
+          invalid_request(line_number, "scene_count must be 1..64"));
+    }
+    request.scene_count = static_cast<int>(value);
+  }
+  if (const auto *klass = field("class")) {
+    if (*klass == "interactive") {
+      request.workflow_class = core::WorkflowClass::Interactive;
+    } else if (*klass == "standard") {
+      request.workflow_class = core::WorkflowClass::Standard;
+    } else if (*klass != "batch") {
+      return core::Result<BatchRequest, core::TaskError>::Err(
+          invalid_request(line_number, "class must be interactive|standard|batch"));
+    }
+  }
+  return core::Result<BatchRequest, core::TaskError>::Ok(std::move(request));
+}
+
+core::Result<std::vector<BatchRequest>, core::TaskError>
+load_requests(const std::string &path) {
+  std::ifstream in(path);
+  if (!in) {
+    return core::Result<std::vector<BatchRequest>, core::TaskError>::Err(
+        core::TaskError(core::ErrorCategory::Internal, 4002, false,
+                        "Cannot open request file", "open failed: " + path,
+                        {{"path", path}}));
+  }
+  std::vector<BatchRequest> requests;
+  std::string line;
+  int line_number = 0;
+  while (std::getline(in, line)) {
+    ++line_number;
+    if (line.find_first_not_of(" \t\r") == std::string::npos) {
+      continue;
+    }
+    auto parsed = parse_request_line(line, line_number);
+    if (parsed.is_err()) {
+      return core::Result<std::vector<BatchRequest>, core::TaskError>::Err(parsed.error());
+    }
+    requests.push_back(std::move(parsed.value()));
+  }
+  return core::Result<std::vector<BatchRequest>, core::TaskError>::Ok(std::move(requests));
+}
+
+BatchRunner::BatchRunner(std::shared_ptr<core::IScheduler> scheduler,
+                         std::shared_ptr<core::ILogger> logger, BatchOptions options)
+    : scheduler_(std::move(scheduler)), options_(std::move(options)) {
+  options_.concurrency = std::max(1, options_.concurrency);
+  core::WorkflowAdmissionPolicy admission;
+  admission.max_active_workflows = options_.concurrency;
+  admission.max_pending =
+      options_.queue_depth > 0 ? options_.queue_depth : options_.concurrency;
+  admission.on_full = core::WorkflowAdmissionPolicy::OnFull::Block;
+  engine_ = std::make_unique<core::WorkflowEngine>(scheduler_, std::move(logger), admission);
+
+  engine_->on_progress([this](const std::string &trace_id, const std::string &,
+                              core::TaskState, float) {
+    const auto now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &entry = tracking_[trace_id];
+    if (!entry.has_event) {
+      entry.has_event = true;
+      entry.first_event = now;
+    }
+  });
+  engine_->on_completion([this](const std::string &trace_id, bool success,
+                                const std::string &output_path) {
+    const auto now = Clock::now();
+    // Notified under the lock: run() may return (and the runner be destroyed)
+    // as soon as the last completion is counted.
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &entry = tracking_[trace_id];
+    entry.finished = true;
+    entry.finished_at = now;
+    entry.success = success;
+    entry.output_path = output_path;
+    ++finished_count_;
+    finished_cv_.notify_all();
+  });
+}
+
+BatchRunner::~BatchRunner() = default;
+
+void BatchRunner::set_stage_factory(core::WorkflowEngine::StageFactory factory) {
+  engine_->set_stage_factory(std::move(factory));
+}
+
+void BatchRunner::set_workflow_plan(std::shared_ptr<const core::WorkflowPlan> plan) {
+  engine_->set_workflow_plan(std::move(plan));
+}
+
+std::vector<BatchResult> BatchRunner::run(const std::vector<BatchRequest> &requests) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tracking_.clear();
+    finished_count_ = 0;
+  }
+  std::vector<BatchResult> results(requests.size());
+  std::vector<Clock::time_point> started_at(requests.size());
+  std::atomic<int> started_ok{0};
+  std::atomic<bool> feeding{true};
+  const auto run_start = Clock::now();
+
+  // start_workflow() blocks while the admission queue is full; the feeder
+  // absorbs that so this thread keeps ticking (retry promotion, pause
+  // timeouts) for the workflows already running.
+  std::thread feeder([&] {
+    for (size_t i = 0; i < requests.size(); ++i) {
+      const auto &request = requests[i];
+      results[i].request_id = request.request_id;
+      started_at[i] = Clock::now();
+      auto started = engine_->start_workflow(
+          request.story_text,
+          request.style.empty() ? options_.default_style : request.style,
+          request.scene_count > 0 ? request.scene_count : options_.default_scene_count,
+          request.workflow_class);
+      if (started.is_err()) {
+        const auto &err = started.error();
+        results[i].error = err.internal_message.empty() ? err.user_message
+                                                        : err.internal_message;
+        continue;
+      }
+      results[i].trace_id = started.value();
+      started_ok.fetch_add(1);
+    }
+    feeding = false;
+    finished_cv_.notify_all();
+  });
+
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (feeding.load() || finished_count_ < started_ok.load()) {
+      lock.unlock();
+      scheduler_->tick();
+      lock.lock();
+      finished_cv_.wait_for(lock, std::chrono::milliseconds(options_.tick_interval_ms));
+    }
+  }
+  feeder.join();
+  const auto run_end = Clock::now();
+
+  std::vector<int64_t> latencies;
+  std::vector<int64_t> queue_waits;
+  report_ = BatchReport{};
+  report_.requests = static_cast<int>(requests.size());
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < results.size(); ++i) {
+      auto &result = results[i];
+      auto it = result.trace_id.empty() ? tracking_.end() : tracking_.find(result.trace_id);
+      if (it != tracking_.end() && it->second.finished) {
+        const auto &entry = it->second;
+        result.success = entry.success;
+        result.output_path = entry.output_path;
+        result.latency_ms = elapsed_ms(started_at[i], entry.finished_at);
+        result.queue_ms = entry.has_event ? elapsed_ms(started_at[i], entry.first_event)
+                                          : result.latency_ms;
+        latencies.push_back(result.latency_ms);
+        queue_waits.push_back(result.queue_ms);
+      }
+      (result.success ? report_.succeeded : report_.failed) += 1;
+    }
+  }
+  report_.wall_ms = elapsed_ms(run_start, run_end);
+  report_.workflows_per_minute =
+      report_.wall_ms > 0 ? report_.succeeded * 60000.0 / static_cast<double>(report_.wall_ms)
+                          : 0.0;
+  report_.latency_ms = summarize_latencies(std::move(latencies));
+  report_.queue_ms = summarize_latencies(std::move(queue_waits));
+  report_.admission = engine_->admission_metrics();
+  report_.scheduler = scheduler_->metrics();
+  return results;
+}
+
+LatencySummary summarize_latencies(std::vector<int64_t> samples) {
+  samples.erase(std::remove_if(samples.begin(), samples.end(),
+                               [](int64_t v) { return v < 0; }),
+                samples.end());
+  LatencySummary summary;
+  if (samples.empty()) {
+    return summary;
+  }
+  std::sort(samples.begin(), samples.end());
+  auto rank = [&](double q) {
+    const auto n = static_cast<double>(samples.size());
+    const auto index = static_cast<size_t>(std::max(1.0, std::ceil(q * n))) - 1;
+    return samples[std::min(index, samples.size() - 1)];
+  };
+  summary.p50 = rank(0.50);
+  summary.p95 = rank(0.95);
+  summary.p99 = rank(0.99);
+  summary.max = samples.back();
+  int64_t total = 0;
+  for (const auto v : samples) {
+    total += v;
+  }
+  summary.mean = static_cast<double>(total) / static_cast<double>(samples.size());
+  return summary;
+}
+
+void write_results_jsonl(std::ostream &out, const std::vector<BatchResult> &results) {
+  for (const auto &r : results) {
+    out << "{\"request_id\":\"" << json_escape(r.request_id) << "\""
+        << ",\"trace_id\":\"" << json_escape(r.trace_id) << "\""
+        << ",\"success\":" << (r.success ? "true" : "false")
+        << ",\"output_path\":\"" << json_escape(r.output_path) << "\""
+        << ",\"error\":\"" << json_escape(r.error) << "\""
+        << ",\"queue_ms\":" << r.queue_ms << ",\"latency_ms\":" << r.latency_ms
+        << "}\n";
+  }
+}
+
+void write_report_json(std::ostream &out, const BatchReport &report) {
+  const auto &a = report.admission;
+  const auto &s = report.scheduler;
+  out << "{\"requests\":" << report.requests << ",\"succeeded\":" << report.succeeded
+      << ",\"failed\":" << report.failed << ",\"wall_ms\":" << report.wall_ms
+      << ",\"workflows_per_minute\":" << std::fixed << std::setprecision(2)
+      << report.workflows_per_minute << ",\"latency_ms\":";
+  write_summary(out, report.latency_ms);
+  out << ",\"queue_ms\":";
+  write_summary(out, report.queue_ms);
+  out << ",\"admission\":{\"admitted\":" << a.admitted << ",\"queued\":" << a.queued
+      << ",\"rejected\":" << a.rejected << ",\"queue_wait_ms_total\":"
+      << a.queue_wait_ms_total << ",\"queue_wait_ms_max\":" << a.queue_wait_ms_max << "}"
+      << ",\"scheduler\":{\"tasks_submitted\":" << s.tasks_submitted
+      << ",\"attempts_started\":" << s.attempts_started
+      << ",\"tasks_succeeded\":" << s.tasks_succeeded
+      << ",\"tasks_failed\":" << s.tasks_failed
+      << ",\"retries_scheduled\":" << s.retries_scheduled
+      << ",\"memo_hits\":" << s.memo_hits
+      << ",\"batched_tasks\":" << s.batched_tasks << "}}\n";
+}
+
+} // namespace stv::batch
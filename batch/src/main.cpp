@@ -0,0 +1,252 @@
+// stv_batch — headless replay of story requests through WorkflowEngine (M4).
+//
+//   stv_batch --input requests.jsonl [--mode mock|server] [--concurrency N]
+//             [--results batch_results.jsonl] [--report batch_report.json]
+//
+// Each input line is a JSON object with a story ("story_text", "story" or
+// "body") and optional "request_id", "style", "scene_count" and "class".
+
+#include "batch/batch_runner.h"
+#include "core/logger.h"
+#include "core/scheduler.h"
+#include "core/stage_memo.h"
+#include "core/workflow_template.h"
+#include "infra/curl_http_client.h"
+#include "infra/http_client.h"
+#include "infra/stage_factory.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace stv::infra {
+std::unique_ptr<stv::core::ILogger> create_console_logger();
+} // namespace stv::infra
+
+namespace {
+
+struct CliOptions {
+  std::string input;
+  std::string results = "batch_results.jsonl";
+  std::string report = "batch_report.json";
+  std::string mode = "mock";
+  std::string api_base_url;
+  std::string workflow_template;
+  int workers = 0;
+  int cpu_slots = 0;
+  bool memo = true;
+  bool qos = false;
+  bool streaming_compose = true;
+  stv::infra::HttpVersionPolicy http_version = stv::infra::HttpVersionPolicy::Http2;
+  bool verbose = false;
+  stv::batch::BatchOptions batch;
+};
+
+void print_usage() {
+  std::fprintf(stderr,
+               "usage: stv_batch --input FILE [options]\n"
+               "  --mode mock|server        mock stages (default) or HTTP stages\n"
+               "  --api-base-url URL        server mode endpoint "
+               "(default $STV_API_BASE_URL or http://127.0.0.1:8765)\n"
+               "  --concurrency N           workflows admitted at once (default 4)\n"
+               "  --queue N                 pending workflows before blocking "
+               "(default = concurrency)\n"
+               "  --scenes N                scene count when a request has none "
+               "(default 4)\n"
+               "  --style NAME              style when a request has none\n"
+               "  --template FILE           workflow template (default built-in)\n"
+               "  --workers N               scheduler workers (default auto)\n"
+               "  --cpu-slots N             scheduler CPU slots (default = workers)\n"
+               "  --memo 0|1                stage memoization (default 1)\n"
+               "  --qos 0|1                 reserve CPU slots per request class "
+               "(default 0)\n"
+               "  --streaming-compose 0|1   server mode compose session (default 1)\n"
+               "  --http-version 1.1|2|h2c  server mode protocol; h2c multiplexes "
+               "plain http (default 2)\n"
+               "  --results FILE            per-workflow JSONL "
+               "(default batch_results.jsonl)\n"
+               "  --report FILE             aggregate JSON (default batch_report.json)\n"
+               "  --verbose                 log every task event\n");
+}
+
+bool parse_int(const char *raw, int &out, bool allow_zero) {
+  char *end = nullptr;
+  const long value = std::strtol(raw, &end, 10);
+  if (!end || *end != 0 || value < 0 || (!allow_zero && value == 0)) {
+    return false;
+  }
+  out = static_cast<int>(value);
+  return true;
+}
+
+bool parse_args(int argc, char *argv[], CliOptions &opts) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--verbose") {
+      opts.verbose = true;
+      continue;
+    }
+    if (arg == "--help" || arg == "-h" || i + 1 >= argc) {
+      return false;
+    }
+    const char *value = argv[++i];
+    int flag = 0;
+    bool ok = true;
+    if (arg == "--input") {
+      opts.input = value;
+    } else if (arg == "--results") {
+      opts.results = value;
+    } else if (arg == "--report") {
+      opts.report = value;
+    } else if (arg == "--mode") {
+      opts.mode = value;
+      ok = opts.mode == "mock" || opts.mode == "server";
+    } else if (arg == "--api-base-url") {
+      opts.api_base_url = value;
+    } else if (arg == "--concurrency") {
+      ok = parse_int(value, opts.batch.concurrency, false);
+    } else if (arg == "--queue") {
+      ok = parse_int(value, opts.batch.queue_depth, true);
+    } else if (arg == "--scenes") {
+      ok = parse_int(value, opts.batch.default_scene_count, false);
+    } else if (arg == "--style") {
+      opts.batch.default_style = value;
+    } else if (arg == "--template") {
+      opts.workflow_template = value;
+    } else if (arg == "--workers") {
+      ok = parse_int(value, opts.workers, true);
+    } else if (arg == "--cpu-slots") {
+      ok = parse_int(value, opts.cpu_slots, true);
+    } else if (arg == "--memo") {
+      ok = parse_int(value, flag, true);
+      opts.memo = flag != 0;
+    } else if (arg == "--qos") {
+      ok = parse_int(value, flag, true);
+      opts.qos = flag != 0;
+    } else if (arg == "--streaming-compose") {
+      ok = parse_int(value, flag, true);
+      opts.streaming_compose = flag != 0;
+    } else if (arg == "--http-version") {
+      ok = stv::infra::parse_http_version(value, opts.http_version);
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      std::fprintf(stderr, "invalid argument: %s %s\n", arg.c_str(), value);
+      return false;
+    }
+  }
+  return !opts.input.empty();
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  CliOptions opts;
+  if (!parse_args(argc, argv, opts)) {
+    print_usage();
+    return 2;
+  }
+
+  auto requests = stv::batch::load_requests(opts.input);
+  if (requests.is_err()) {
+    std::fprintf(stderr, "stv_batch: %s\n", requests.error().internal_message.c_str());
+    return 1;
+  }
+  std::shared_ptr<const stv::core::WorkflowPlan> plan = stv::core::default_workflow_plan();
+  if (!opts.workflow_template.empty()) {
+    auto compiled = stv::core::load_workflow_template(opts.workflow_template);
+    if (compiled.is_err()) {
+      std::fprintf(stderr, "stv_batch: %s\n", compiled.error().internal_message.c_str());
+      return 1;
+    }
+    plan = compiled.value();
+  }
+
+  // Per-task logs drown the report at volume; only --verbose enables them.
+  std::shared_ptr<stv::core::ILogger> logger;
+  if (opts.verbose) {
+    logger = std::shared_ptr<stv::core::ILogger>(stv::infra::create_console_logger().release());
+  }
+
+  stv::core::SchedulerConfig config;
+  config.worker_count = opts.workers;
+  config.resource_budget.cpu_slots_hard = opts.cpu_slots;
+  config.retry.default_policy.max_attempts = 2;
+  config.retry.default_policy.initial_backoff_ms = 1000;
+  config.retry.default_policy.max_backoff_ms = 15000;
+  config.qos.enabled = opts.qos;
+  if (opts.memo) {
+    config.memoization.memo = std::make_shared<stv::core::InMemoryStageMemo>();
+  }
+  auto scheduler = std::shared_ptr<stv::core::IScheduler>(
+      stv::core::create_thread_pool_scheduler(config, logger).release());
+
+  stv::batch::BatchRunner runner(scheduler, logger, opts.batch);
+  runner.set_workflow_plan(plan);
+  std::shared_ptr<stv::infra::CurlHttpClient> curl_client;
+  if (opts.mode == "server") {
+    if (opts.api_base_url.empty()) {
+      const char *env = std::getenv("STV_API_BASE_URL");
+      opts.api_base_url = env ? env : "http://127.0.0.1:8765";
+    }
+    stv::infra::RetryPolicy retry_policy;
+    retry_policy.max_retries = 2;
+    retry_policy.initial_backoff = std::chrono::milliseconds(500);
+    retry_policy.max_backoff = std::chrono::milliseconds(5000);
+    // One pooled handle per worker at least, so HTTP stages never queue
+    // behind each other on the client side.
+    stv::infra::CurlPoolOptions pool_options;
+    pool_options.max_handles = std::max(pool_options.max_handles, opts.workers);
+    pool_options.http_version = opts.http_version;
+    curl_client = std::make_shared<stv::infra::CurlHttpClient>(pool_options);
+    auto http_client =
+        std::make_shared<stv::infra::RetryableHttpClient>(curl_client, retry_policy, logger);
+    auto factory = std::make_shared<stv::infra::StageFactory>(http_client, opts.api_base_url);
+    factory->set_streaming_compose(opts.streaming_compose);
+    runner.set_stage_factory(
+        [factory](stv::core::TaskType type) { return factory->create_stage(type); });
+  }
+
+  std::fprintf(stderr, "stv_batch: %zu requests, mode=%s, concurrency=%d\n",
+               requests.value().size(), opts.mode.c_str(), opts.batch.concurrency);
+  const auto results = runner.run(requests.value());
+  const auto &report = runner.report();
+
+  std::ofstream results_out(opts.results);
+  stv::batch::write_results_jsonl(results_out, results);
+  std::ofstream report_out(opts.report);
+  stv::batch::write_report_json(report_out, report);
+  if (!results_out || !report_out) {
+    std::fprintf(stderr, "stv_batch: failed to write %s or %s\n", opts.results.c_str(),
+                 opts.report.c_str());
+    return 1;
+  }
+
+  std::printf("requests=%d succeeded=%d failed=%d wall_ms=%lld throughput=%.2f/min\n"
+              "latency_ms p50=%lld p95=%lld p99=%lld max=%lld\n"
+              "queue_ms   p50=%lld p95=%lld p99=%lld max=%lld\n",
+              report.requests, report.succeeded, report.failed,
+              static_cast<long long>(report.wall_ms), report.workflows_per_minute,
+              static_cast<long long>(report.latency_ms.p50),
+              static_cast<long long>(report.latency_ms.p95),
+              static_cast<long long>(report.latency_ms.p99),
+              static_cast<long long>(report.latency_ms.max),
+              static_cast<long long>(report.queue_ms.p50),
+              static_cast<long long>(report.queue_ms.p95),
+              static_cast<long long>(report.queue_ms.p99),
+              static_cast<long long>(report.queue_ms.max));
+  if (curl_client) {
+    const auto http = curl_client->pool_stats();
+    std::printf("http       connections new=%llu reused=%llu reuse_rate=%.2f h2=%llu\n",
+                static_cast<unsigned long long>(http.connections_new),
+                static_cast<unsigned long long>(http.connections_reused), http.reuse_rate(),
+                static_cast<unsigned long long>(http.http2_transfers));
+  }
+  return report.failed == 0 ? 0 : 3;
+}
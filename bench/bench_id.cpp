@@ -0,0 +1,100 @@
+// ID generation benchmark (M4): the previous stringstream UUIDv4 generator
+// against new_id() (binary), format_id() into a stack buffer, and
+// new_id_string(). Reports ns per id on one thread and aggregate throughput
+// with several threads.
+//
+// Usage: bench_id [count] [threads]
+
+#include "core/id.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace stv::core;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// The generator WorkflowEngine used before new_id(), kept for comparison.
+std::string legacy_uuid() {
+  thread_local std::mt19937 gen(std::random_device{}());
+  std::uniform_int_distribution<uint32_t> dis;
+
+  std::stringstream ss;
+  ss << std::hex;
+  ss << ((dis(gen) & 0xFFFF0000) | 0x0000FFFF);
+  ss << "-";
+  ss << (dis(gen) & 0xFFFF);
+  ss << "-4";
+  ss << (dis(gen) & 0x0FFF);
+  ss << "-";
+  ss << ((dis(gen) & 0x3FFF) | 0x8000);
+  ss << "-";
+  ss << (dis(gen) & 0xFFFF);
+  ss << (dis(gen) & 0xFFFF);
+  ss << (dis(gen) & 0xFFFF);
+  return ss.str();
+}
+
+// Defeats dead-code elimination of the generated ids.
+std::atomic<uint64_t> g_sink{0};
+
+template <typename Fn> double ns_per_id(int count, Fn &&fn) {
+  uint64_t sink = 0;
+  const auto start = Clock::now();
+  for (int i = 0; i < count; ++i) {
+    sink += fn();
+  }
+  const double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+  g_sink += sink;
+  return ns / count;
+}
+
+template <typename Fn> double ids_per_second(int threads, int count, Fn fn) {
+  std::vector<std::thread> pool;
+  const auto start = Clock::now();
+  for (int t = 0; t < threads; ++t) {
+    pool.emplace_back([count, &fn] { ns_per_id(count, fn); });
+  }
+  for (auto &thread : pool) {
+    thread.join();
+  }
+  const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  return threads * static_cast<double>(count) / seconds;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const int count = argc > 1 ? std::atoi(argv[1]) : 1000000;
+  const int threads = argc > 2 ? std::atoi(argv[2]) : 8;
+
+  auto legacy = [] { return static_cast<uint64_t>(legacy_uuid().size()); };
+  auto binary = [] { return new_id().lo; };
+  auto buffer = [] {
+    char text[kIdStringLength + 1];
+    format_id(new_id(), text);
+    return static_cast<uint64_t>(text[35]);
+  };
+  auto string = [] { return static_cast<uint64_t>(new_id_string()[35]); };
+
+  std::printf("count=%d threads=%d\n", count, threads);
+  std::printf("%-24s %10s %16s\n", "generator", "ns/id", "ids/s (threads)");
+  std::printf("%-24s %10.1f %16.3g\n", "legacy stringstream", ns_per_id(count, legacy),
+              ids_per_second(threads, count, legacy));
+  std::printf("%-24s %10.1f %16.3g\n", "new_id (binary)", ns_per_id(count, binary),
+              ids_per_second(threads, count, binary));
+  std::printf("%-24s %10.1f %16.3g\n", "new_id + format_id", ns_per_id(count, buffer),
+              ids_per_second(threads, count, buffer));
+  std::printf("%-24s %10.1f %16.3g\n", "new_id_string", ns_per_id(count, string),
+              ids_per_second(threads, count, string));
+  return 0;
+}
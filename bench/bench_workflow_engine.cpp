@@ -0,0 +1,113 @@
+// WorkflowEngine event-path benchmark (M4): cost of one scheduler state event
+// as the number of concurrently active workflows grows. With the task index
+// the per-event cost should stay flat from 10 to 1000 workflows.
+//
+// Usage: bench_workflow_engine [max_workflows] [scenes] [rounds]
+
+#include "core/orchestrator.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace stv::core;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// Accepts every task and lets the benchmark drive state callbacks directly,
+/// so only WorkflowEngine bookkeeping is measured.
+class DirectScheduler : public IScheduler {
+public:
+  Result<void, TaskError> submit(TaskDescriptor task,
+                                 std::shared_ptr<IStage>) override {
+    task_ids.push_back(task.task_id);
+    return Result<void, TaskError>::Ok();
+  }
+  Result<void, TaskError> cancel(const std::string &) override {
+    return Result<void, TaskError>::Ok();
+  }
+  Result<void, TaskError> pause(const std::string &) override {
+    return Result<void, TaskError>::Ok();
+  }
+  Result<void, TaskError> resume(const std::string &) override {
+    return Result<void, TaskError>::Ok();
+  }
+  void on_state_change(StateCallback cb) override { callbacks.push_back(std::move(cb)); }
+  void tick() override {}
+  [[nodiscard]] bool has_pending_tasks() const override { return false; }
+
+  void emit(const std::string &task_id, TaskState state, float progress) {
+    for (auto &cb : callbacks) {
+      cb(task_id, state, progress);
+    }
+  }
+
+  std::vector<std::string> task_ids;
+  std::vector<StateCallback> callbacks;
+};
+
+struct Sample {
+  double progress_ns = 0; // Per non-terminal event
+  double terminal_ns = 0; // Per terminal event, including retirement
+  int completions = 0;
+};
+
+Sample run(int workflows, int scenes, int rounds) {
+  auto scheduler = std::make_shared<DirectScheduler>();
+  WorkflowEngine engine(scheduler, nullptr);
+  int completions = 0;
+  engine.on_completion([&](const std::string &, bool, const std::string &) { ++completions; });
+  engine.on_progress([](const std::string &, const std::string &, TaskState, float) {});
+
+  for (int i = 0; i < workflows; ++i) {
+    if (engine.start_workflow("story", "style", scenes).is_err()) {
+      std::fprintf(stderr, "start_workflow failed\n");
+      std::exit(1);
+    }
+  }
+  const auto &ids = scheduler->task_ids;
+
+  const auto progress_start = Clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    for (const auto &id : ids) {
+      scheduler->emit(id, TaskState::Running, 0.5f);
+    }
+  }
+  const auto progress_elapsed = Clock::now() - progress_start;
+
+  const auto terminal_start = Clock::now();
+  for (const auto &id : ids) {
+    scheduler->emit(id, TaskState::Succeeded, 1.0f);
+  }
+  const auto terminal_elapsed = Clock::now() - terminal_start;
+
+  Sample s;
+  s.progress_ns = std::chrono::duration<double, std::nano>(progress_elapsed).count() /
+                  static_cast<double>(ids.size() * static_cast<size_t>(rounds));
+  s.terminal_ns = std::chrono::duration<double, std::nano>(terminal_elapsed).count() /
+                  static_cast<double>(ids.size());
+  s.completions = completions;
+  return s;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const int max_workflows = argc > 1 ? std::atoi(argv[1]) : 1000;
+  const int scenes = argc > 2 ? std::atoi(argv[2]) : 4;
+  const int rounds = argc > 3 ? std::atoi(argv[3]) : 20;
+
+  std::printf("%10s %16s %16s %12s\n", "workflows", "progress ns/ev", "terminal ns/ev",
+              "completed");
+  for (int n = 10; n <= max_workflows; n *= 10) {
+    const auto s = run(n, scenes, rounds);
+    std::printf("%10d %16.1f %16.1f %12d\n", n, s.progress_ns, s.terminal_ns, s.completions);
+  }
+  return 0;
+}
@@ -0,0 +1,93 @@
+// Workflow start benchmark (M4): compiling a template happens once; each
+// start only stamps out tasks from the immutable plan. Reports the cost of
+// instantiate() alone and of a full start_workflow() against a scheduler that
+// accepts every task.
+//
+// Usage: bench_workflow_template [scenes] [rounds]
+
+#include "core/orchestrator.h"
+#include "core/workflow_template.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+using namespace stv::core;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+class NullScheduler : public IScheduler {
+public:
+  Result<void, TaskError> submit(TaskDescriptor, std::shared_ptr<IStage>) override {
+    return Result<void, TaskError>::Ok();
+  }
+  Result<void, TaskError> cancel(const std::string &) override {
+    return Result<void, TaskError>::Ok();
+  }
+  Result<void, TaskError> pause(const std::string &) override {
+    return Result<void, TaskError>::Ok();
+  }
+  Result<void, TaskError> resume(const std::string &) override {
+    return Result<void, TaskError>::Ok();
+  }
+  void on_state_change(StateCallback) override {}
+  void tick() override {}
+  [[nodiscard]] bool has_pending_tasks() const override { return false; }
+};
+
+/// Stage objects are shared so the factory does not dominate the timing.
+class NoopStage : public IStage {
+public:
+  std::string name() const override { return "Noop"; }
+  Result<void, TaskError> execute(StageContext &) override {
+    return Result<void, TaskError>::Ok();
+  }
+};
+
+double micros_since(Clock::time_point start, int rounds) {
+  return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / rounds;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const int scenes = argc > 1 ? std::atoi(argv[1]) : 500;
+  const int rounds = argc > 2 ? std::atoi(argv[2]) : 50;
+
+  auto start = Clock::now();
+  std::shared_ptr<const WorkflowPlan> plan;
+  for (int r = 0; r < rounds; ++r) {
+    plan = compile_workflow_template(default_workflow_template()).value();
+  }
+  const double compile_us = micros_since(start, rounds);
+
+  const std::unordered_map<std::string, std::any> inputs{{"story_text", std::string("story")}};
+  size_t tasks = 0;
+  start = Clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    tasks = plan->instantiate("0190f3a2-7c4e-7000-8000-000000000000", scenes, inputs).size();
+  }
+  const double instantiate_us = micros_since(start, rounds);
+
+  WorkflowEngine engine(std::make_shared<NullScheduler>(), nullptr);
+  auto stage = std::make_shared<NoopStage>();
+  engine.set_stage_factory([stage](TaskType) { return stage; });
+  start = Clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    if (engine.start_workflow("story", "style", scenes).is_err()) {
+      std::fprintf(stderr, "start_workflow failed\n");
+      return 1;
+    }
+  }
+  const double start_us = micros_since(start, rounds);
+
+  std::printf("scenes=%d tasks=%zu\n", scenes, tasks);
+  std::printf("%-22s %10.1f us\n", "compile (once)", compile_us);
+  std::printf("%-22s %10.1f us\n", "instantiate", instantiate_us);
+  std::printf("%-22s %10.1f us\n", "start_workflow", start_us);
+  return 0;
+}
@@ -3,17 +3,55 @@
 #include <atomic>
 #include <functional>
 #include <memory>
-#include <mutex>
-#include <vector>
 
 namespace stv::core {
 
+namespace detail {
+struct CancelCallbackNode;
+struct CancelRegistry;
+} // namespace detail
+
+/// Handle returned by CancelToken::on_cancel().
+///
+/// Destroying the handle (or calling reset()) deregisters the callback. If the
+/// callback is already running on another thread, deregistration waits for it
+/// to return, so captured state may be released right after reset().
+class CancelRegistration {
+public:
+  CancelRegistration() = default;
+  ~CancelRegistration();
+
+  CancelRegistration(CancelRegistration &&other) noexcept;
+  CancelRegistration &operator=(CancelRegistration &&other) noexcept;
+  CancelRegistration(const CancelRegistration &) = delete;
+  CancelRegistration &operator=(const CancelRegistration &) = delete;
+
+  /// Deregister now. Idempotent.
+  void reset() noexcept;
+
+  /// True while the callback is registered and has not fired.
+  [[nodiscard]] bool active() const noexcept;
+
+private:
+  friend class CancelToken;
+  CancelRegistration(std::shared_ptr<detail::CancelRegistry> registry,
+                     detail::CancelCallbackNode *node) noexcept;
+
+  std::shared_ptr<detail::CancelRegistry> registry_;
+  detail::CancelCallbackNode *node_ = nullptr;
+};
+
 /// Thread-safe cancellation token.
 ///
 /// Design: single-writer (whoever calls request_cancel()) / multi-reader
 /// (stages check is_canceled()). Uses atomic<bool> with acquire/release
 /// semantics — no mutex needed for the flag itself.
 ///
+/// Tokens form a tree (M4): canceling a token cancels every live child
+/// created with create_child(), while a child can be canceled on its own.
+/// WorkflowEngine gives each task a child of the workflow token, so the
+/// scheduler can cancel one execution without touching its siblings.
+///
 /// Usage in pipeline stages:
 ///   void execute(StageContext& ctx) {
 ///       for (int i = 0; i < N; ++i) {
@@ -23,7 +61,11 @@ namespace stv::core {
 ///   }
 class CancelToken {
 public:
-  CancelToken() = default;
+  CancelToken();
+  ~CancelToken();
+
+  CancelToken(const CancelToken &) = delete;
+  CancelToken &operator=(const CancelToken &) = delete;
 
   /// Request cancellation. Thread-safe, idempotent.
   void request_cancel() noexcept;
@@ -36,17 +78,27 @@ public:
   void throw_if_canceled() const;
 
   /// Register a callback to be invoked when cancellation is requested.
-  /// Callbacks are invoked synchronously from request_cancel().
+  /// Callbacks are invoked synchronously from request_cancel(), in
+  /// registration order. If the token is already canceled the callback runs
+  /// immediately and an inactive handle is returned.
+  ///
+  /// Registration is lock-free. The callback stays registered only while the
+  /// returned handle is alive; deregistered entries are pruned lazily, so
+  /// long-lived tokens do not accumulate callbacks.
   using Callback = std::function<void()>;
-  void on_cancel(Callback cb);
+  [[nodiscard]] CancelRegistration on_cancel(Callback cb);
+
+  /// Create a child token: canceled when this token is canceled, but
+  /// cancelable independently. The link is dropped when the child dies.
+  [[nodiscard]] std::shared_ptr<CancelToken> create_child();
 
   /// Create a shared CancelToken.
   static std::shared_ptr<CancelToken> create();
 
 private:
   std::atomic<bool> canceled_{false};
-  std::mutex cb_mutex_;
-  std::vector<Callback> callbacks_;
+  std::shared_ptr<detail::CancelRegistry> registry_;
+  CancelRegistration parent_link_; // Set for tokens made by create_child()
 };
 
 } // namespace stv::core
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace stv::core {
+
+/// One NUMA node and the logical CPUs it owns (restricted to CPUs this
+/// process may run on).
+struct NumaNode {
+  int id = 0;
+  std::vector<int> cpus;
+};
+
+/// CPU placement view used by the scheduler to pin workers (M4).
+///
+/// detect() honors the process affinity mask and the cgroup v2 cpuset
+/// (`cpuset.cpus.effective`), so inside a container only the granted CPUs are
+/// reported. On platforms without topology support it returns a single node
+/// with CPUs [0, hardware_concurrency).
+struct CpuTopology {
+  std::vector<NumaNode> nodes;
+
+  static CpuTopology detect();
+
+  /// All CPUs across nodes, ascending.
+  [[nodiscard]] std::vector<int> all_cpus() const;
+
+  /// NUMA node owning `cpu`, or -1 if unknown.
+  [[nodiscard]] int node_of(int cpu) const;
+
+  /// Copy restricted to `cpu_set` (empty set = no restriction). Nodes left
+  /// without CPUs are dropped.
+  [[nodiscard]] CpuTopology restricted_to(const std::vector<int> &cpu_set) const;
+};
+
+/// Parse a Linux cpulist string ("0-3,8,10-11") into sorted unique CPU ids.
+/// Malformed ranges are skipped.
+std::vector<int> parse_cpu_list(const std::string &text);
+
+/// CPUs the calling process may run on (affinity mask ∩ cgroup cpuset).
+std::vector<int> allowed_cpus();
+
+/// Pin the calling thread to `cpus`. Returns false when unsupported or when
+/// the OS rejects the mask; callers treat pinning as best-effort.
+bool pin_current_thread(const std::vector<int> &cpus);
+
+/// CPU the calling thread is currently running on, or -1 if unknown.
+int current_cpu();
+
+} // namespace stv::core
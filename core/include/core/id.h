@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace stv::core {
+
+/// 128-bit time-ordered identifier, laid out as a UUIDv7 (RFC 9562) (M4).
+///
+///   hi: 48-bit Unix time in ms | version 7 | 12-bit per-thread sequence
+///   lo: variant 0b10 | 62 random bits
+///
+/// Compact form for maps and wire formats; to_string() gives the canonical
+/// 36-char text used for trace ids and request ids.
+struct Id128 {
+  uint64_t hi = 0;
+  uint64_t lo = 0;
+
+  [[nodiscard]] bool is_nil() const { return hi == 0 && lo == 0; }
+  [[nodiscard]] uint64_t unix_ms() const { return hi >> 16; }
+
+  friend bool operator==(const Id128 &a, const Id128 &b) {
+    return a.hi == b.hi && a.lo == b.lo;
+  }
+  friend bool operator!=(const Id128 &a, const Id128 &b) { return !(a == b); }
+  friend bool operator<(const Id128 &a, const Id128 &b) {
+    return a.hi != b.hi ? a.hi < b.hi : a.lo < b.lo;
+  }
+};
+
+struct Id128Hash {
+  size_t operator()(const Id128 &id) const {
+    return std::hash<uint64_t>{}(id.hi ^ (id.lo * 0x9e3779b97f4a7c15ULL));
+  }
+};
+
+/// Length of the canonical text form, without the terminating NUL.
+inline constexpr size_t kIdStringLength = 36;
+
+/// New UUIDv7. Lock-free: random state and the sequence live per thread.
+/// Ids from one thread are strictly increasing; ids from different threads
+/// are ordered by millisecond.
+Id128 new_id();
+
+/// Write the canonical lowercase form into `out` (kIdStringLength + 1 bytes,
+/// NUL-terminated). No allocation.
+void format_id(const Id128 &id, char *out);
+
+std::string to_string(const Id128 &id);
+
+/// Parse the canonical form (either case). Returns false on malformed text.
+bool parse_id(std::string_view text, Id128 &out);
+
+/// new_id() in canonical text form.
+std::string new_id_string();
+
+} // namespace stv::core
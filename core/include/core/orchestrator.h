@@ -6,15 +6,59 @@
 #include "core/scheduler.h"
 #include "core/task.h"
 #include "core/task_error.h"
+#include "core/workflow_checkpoint.h"
+#include "core/workflow_template.h"
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace stv {
 namespace core {
 
+/// Admission class of a workflow (M4). The pending queue releases higher
+/// classes first and is FIFO within a class; every task of the workflow
+/// carries the class as its TaskDescriptor::qos.
+using WorkflowClass = QosClass;
+
+/// Workflow-level admission control (M4). Caps of 0 mean unlimited; with both
+/// caps at 0 every workflow is admitted immediately.
+/// A workflow that does not fit waits in a bounded pending queue. When that
+/// queue is full, start_workflow() rejects (Resource error, retryable) or
+/// blocks the caller until a slot frees. A workflow is always admitted when
+/// nothing else is active, even if it alone exceeds max_active_tasks.
+struct WorkflowAdmissionPolicy {
+  enum class OnFull { Reject, Block };
+
+  int max_active_workflows = 0;
+  int max_active_tasks = 0; // Non-terminal tasks over admitted workflows
+  int max_pending = 64;     // Pending queue bound, all classes together
+  OnFull on_full = OnFull::Reject;
+  int block_timeout_ms = 0; // Block mode: 0 = wait without limit
+};
+
+/// Admission counters and gauges (M4). Queue wait is measured from
+/// start_workflow() to submission, including time blocked in Block mode.
+struct WorkflowAdmissionMetrics {
+  uint64_t admitted = 0;
+  uint64_t queued = 0;   // Workflows that had to wait in the queue
+  uint64_t rejected = 0; // Queue full (Reject) or block timeout
+  int active_workflows = 0;
+  int active_tasks = 0;
+  std::array<int, 3> pending{}; // Per WorkflowClass
+  uint64_t queue_wait_ms_total = 0;
+  uint64_t queue_wait_ms_max = 0;
+};
+
 /// WorkflowEngine — orchestrates the creation and submission of a linked
 /// task chain for a single story-to-video workflow.
 ///
@@ -26,10 +70,16 @@ namespace core {
 ///   5. Listen for state changes and propagate to the presenter
 ///
 /// Does NOT execute tasks — that's the scheduler's job.
+///
+/// Thread safety (M4): start_workflow / cancel_workflow may be called from any
+/// thread while scheduler workers deliver state changes. Workflow and task
+/// lookups are sharded by key; completion counters are atomics; callbacks are
+/// invoked without any engine lock held, so they may call back into the engine.
 class WorkflowEngine {
 public:
   WorkflowEngine(std::shared_ptr<IScheduler> scheduler,
-                 std::shared_ptr<ILogger> logger);
+                 std::shared_ptr<ILogger> logger,
+                 WorkflowAdmissionPolicy admission = {});
 
   /// Workflow completion callback.
   /// Parameters: trace_id, success, output_path (empty on failure)
@@ -50,41 +100,132 @@ public:
   void on_progress(ProgressCallback cb);
 
   /// Start a new workflow.
-  /// Creates: Storyboard → ImageGen×N → Compose task chain.
-  /// Returns the trace_id for this workflow.
+  /// Stamps out the workflow plan's DAG (by default Storyboard →
+  /// {ImageGen_i → VideoClip_i, TTS_i} → Compose_i per scene → Concat).
+  /// Returns the trace_id for this workflow. Under admission limits the
+  /// workflow may still be pending; its tasks are submitted once admitted.
   Result<std::string, TaskError>
   start_workflow(const std::string &story_text, const std::string &style,
-                 int scene_count = 4);
+                 int scene_count = 4,
+                 WorkflowClass workflow_class = WorkflowClass::Standard);
 
-  /// Cancel an entire workflow by trace_id.
+  /// Cancel an entire workflow by trace_id. A pending workflow leaves the
+  /// queue and completes with success=false.
   Result<void, TaskError> cancel_workflow(const std::string &trace_id);
 
+  /// Resume a failed, canceled or interrupted workflow from its checkpoint
+  /// (M4). Only unfinished tasks are resubmitted, with ids suffixed
+  /// ".r<generation>"; outputs of succeeded tasks are merged into their
+  /// successors' inputs in place of the dependency. Completion is reported
+  /// through on_completion() under the same trace_id.
+  Result<void, TaskError>
+  resume_workflow(const std::string &trace_id,
+                  WorkflowClass workflow_class = WorkflowClass::Standard);
+
+  /// Snapshot of admission counters and gauges.
+  [[nodiscard]] WorkflowAdmissionMetrics admission_metrics() const;
+
   /// Register a stage factory for a given task type.
   /// Allows swapping mock stages for real implementations.
   using StageFactory = std::function<std::shared_ptr<IStage>(TaskType)>;
   void set_stage_factory(StageFactory factory);
 
+  /// Replace the DAG shape (M4). Applies to workflows started afterwards;
+  /// the default is default_workflow_plan().
+  void set_workflow_plan(std::shared_ptr<const WorkflowPlan> plan);
+
+  /// Persist every workflow started afterwards (M4): the DAG when it is
+  /// admitted, then each task's outputs as it succeeds. A manifest is deleted
+  /// when its workflow succeeds and kept otherwise. Null disables.
+  void set_checkpoint_store(std::shared_ptr<IWorkflowCheckpointStore> store);
+
 private:
   std::shared_ptr<IScheduler> scheduler_;
   std::shared_ptr<ILogger> logger_;
-  CompletionCallback completion_cb_;
-  ProgressCallback progress_cb_;
-  StageFactory stage_factory_;
+  // Swapped atomically (std::atomic_load/store) so readers never lock.
+  std::shared_ptr<const CompletionCallback> completion_cb_;
+  std::shared_ptr<const ProgressCallback> progress_cb_;
+  std::shared_ptr<const StageFactory> stage_factory_;
+  std::shared_ptr<const WorkflowPlan> plan_;
+  std::shared_ptr<IWorkflowCheckpointStore> checkpoint_store_;
 
   /// Track tasks per workflow for cancellation and completion detection.
+  /// A workflow is retired once every task reached a terminal state.
+  /// Every field but the atomics is fixed before the workflow becomes
+  /// visible to other threads.
   struct WorkflowState {
     std::string trace_id;
     std::vector<std::string> task_ids;
-    int completed = 0;
-    int total = 0;
-    bool failed = false;
+    std::shared_ptr<CancelToken> cancel_token; // Parent of all task tokens
+    std::shared_ptr<IWorkflowCheckpointStore> checkpoint; // Null = not persisted
+    bool resumed = false;
+    /// Resumed runs only: submitted task id → manifest task id.
+    std::unordered_map<std::string, std::string> manifest_ids;
+    /// Submitted id of the task whose "video_path" output is the workflow's
+    /// result (the last task nothing depends on). Empty when a resumed run
+    /// already has it from the manifest.
+    std::string sink_task_id;
+    /// Written by the sink's Succeeded event before it is counted, read by
+    /// retire_workflow() after the last count.
     std::string output_path;
+    int total = 0;
+    std::atomic<int> completed{0}; // Succeeded tasks
+    std::atomic<int> terminal{0};  // Succeeded + Failed + Canceled tasks
+    std::atomic<bool> failed{false};
+  };
+
+  /// One lock domain. Workflows shard by trace_id, tasks by task_id.
+  struct Shard {
+    std::mutex mutex;
+    /// Active workflows by trace_id.
+    std::unordered_map<std::string, std::shared_ptr<WorkflowState>> workflows;
+    /// task_id → owning workflow; entries drop when the task turns terminal.
+    std::unordered_map<std::string, std::shared_ptr<WorkflowState>> tasks;
+  };
+  static constexpr size_t kShardCount = 16;
+  std::array<Shard, kShardCount> shards_;
+
+  using TaskChain = std::vector<std::pair<TaskDescriptor, std::shared_ptr<IStage>>>;
+
+  /// A built but not yet submitted workflow.
+  struct PendingWorkflow {
+    std::shared_ptr<WorkflowState> wf;
+    TaskChain chain;
+    std::chrono::steady_clock::time_point arrived_at;
+    std::shared_ptr<const WorkflowManifest> manifest; // Resume: manifest to rewrite
   };
-  std::vector<WorkflowState> active_workflows_;
 
-  void handle_state_change(const std::string &task_id, TaskState state,
-                           float progress);
-  std::string generate_uuid();
+  /// Admission state. Increments of the active gauges and all queue changes
+  /// happen under admission_mutex_; task completions decrement the gauges
+  /// lock-free and only lock when a workflow is pending or a caller blocks.
+  const WorkflowAdmissionPolicy admission_;
+  mutable std::mutex admission_mutex_;
+  std::condition_variable admission_cv_;
+  std::array<std::deque<PendingWorkflow>, 3> pending_; // By WorkflowClass
+  std::atomic<int> pending_count_{0};
+  std::atomic<int> blocked_callers_{0};
+  std::atomic<int> active_workflows_{0};
+  std::atomic<int> active_tasks_{0};
+  WorkflowAdmissionMetrics admission_stats_; // Counters only
+
+  Result<void, TaskError> enqueue_workflow(PendingWorkflow pending,
+                                          WorkflowClass workflow_class);
+  bool is_pending(const std::string &trace_id) const;
+  bool can_admit_locked(int task_count) const;
+  void admit_locked(PendingWorkflow &pending, std::vector<PendingWorkflow> &admitted);
+  void drain_pending_locked(std::vector<PendingWorkflow> &admitted);
+  void begin_checkpoint(PendingWorkflow &pending);
+  Result<void, TaskError> launch_workflow(PendingWorkflow &pending);
+  void launch_admitted(std::vector<PendingWorkflow> &admitted);
+  void release_admission(int workflows, int tasks);
+
+  Shard &shard_for(const std::string &key);
+  void register_workflow(const std::shared_ptr<WorkflowState> &wf);
+  void unregister_workflow(const std::shared_ptr<WorkflowState> &wf);
+  std::shared_ptr<WorkflowState> find_workflow(const std::string &trace_id);
+
+  void handle_task_event(const TaskEvent &event);
+  void retire_workflow(const std::shared_ptr<WorkflowState> &wf);
 };
 
 } // namespace core
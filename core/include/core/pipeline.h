@@ -9,6 +9,7 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace stv::core {
 
@@ -27,6 +28,12 @@ struct StageContext {
   /// Progress callback [0.0, 1.0]. Called by stage to report progress.
   std::function<void(float)> on_progress;
 
+  /// Optional self-reported usage for the runtime estimator (M4); -1 = not
+  /// reported. Unreported dimensions are never learned, so the task keeps
+  /// its submitted RAM/VRAM demand.
+  int reported_peak_rss_mb = -1;
+  int reported_vram_mb = -1;
+
   /// Convenience: get typed input or return default.
   template <typename T>
   T get_input(const std::string &key, T default_val = T{}) const {
@@ -60,6 +67,50 @@ public:
   /// Must check cancel_token at regular intervals.
   /// Returns Err on failure or cancellation.
   virtual Result<void, TaskError> execute(StageContext &ctx) = 0;
+
+  /// Opt-in (M4): run on the NUMA node that produced this task's inputs when
+  /// the scheduler has affinity enabled. Worth it for memory-heavy stages.
+  [[nodiscard]] virtual bool prefers_input_locality() const { return false; }
+
+  /// Memoization (M4): bump whenever the stage's outputs for the same inputs
+  /// would change (new model, prompt template, encoder settings). Empty =
+  /// never memoize, for stages with side effects or non-deterministic output.
+  [[nodiscard]] virtual std::string version() const { return {}; }
+
+  /// Inputs the outputs actually depend on. Empty = all of ctx.inputs.
+  /// Per-scene stages narrow this to their own scene so editing one scene
+  /// does not invalidate the others.
+  [[nodiscard]] virtual std::vector<std::string>
+  memo_inputs(const StageContext &ctx) const {
+    (void)ctx;
+    return {};
+  }
+
+  /// Whether outputs recorded by an earlier run (memo hit, checkpoint) can
+  /// stand in for executing again, e.g. the files they name still exist. A
+  /// false answer re-executes the stage.
+  [[nodiscard]] virtual bool
+  outputs_reusable(const std::unordered_map<std::string, std::any> &outputs) const {
+    (void)outputs;
+    return true;
+  }
+};
+
+/// Batching protocol (M4). With SchedulerConfig::batching enabled, Ready tasks
+/// whose stages report the same non-empty batch_key() are handed to a single
+/// execute_batch() call on one worker. Each member keeps its own StageContext
+/// (inputs, outputs, cancel token, progress), so canceling one member must
+/// only fail that member.
+class IBatchableStage : public IStage {
+public:
+  /// Tasks with equal keys are interchangeable for one batched call
+  /// (e.g. same endpoint, size, steps, style). Empty = do not batch.
+  [[nodiscard]] virtual std::string batch_key(const StageContext &ctx) const = 0;
+
+  /// Execute all members together. Returns exactly one result per member,
+  /// in member order.
+  virtual std::vector<Result<void, TaskError>>
+  execute_batch(const std::vector<StageContext *> &members) = 0;
 };
 
 } // namespace stv::core
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "core/result.h"
+#include "core/task.h"
+#include "core/task_error.h"
+
+#include <any>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace stv::core {
+
+/// One finished attempt, as measured by the scheduler (M4).
+/// Resources are only known when the stage reports them; -1 = not measured.
+struct RuntimeObservation {
+  double runtime_ms = 0.0;
+  int peak_rss_mb = -1; // StageContext::reported_peak_rss_mb
+  int vram_mb = -1;     // StageContext::reported_vram_mb
+};
+
+/// Model output for one key. Quantiles come from a bounded window of recent
+/// observations; the EWMA tracks drift. Resource quantiles only cover the
+/// window's measured samples (0 when there are none).
+struct RuntimeEstimate {
+  int samples = 0; // Total observations recorded (not just the window)
+  double runtime_ms_ewma = 0.0;
+  double runtime_ms_p50 = 0.0;
+  double runtime_ms_p90 = 0.0;
+  int rss_samples = 0; // Window samples with a measured peak RSS
+  int rss_mb_p90 = 0;
+  int vram_samples = 0; // Window samples with a measured VRAM
+  int vram_mb_p90 = 0;
+};
+
+/// Learned per-(TaskType, stage, key inputs) runtime and resource model (M4).
+///
+/// Keys combine the task type, the stage name and a canonical rendering of
+/// selected static inputs (width/height/steps by default), so a 1024² render
+/// and a 512² render are modeled separately. Thread-safe. Persisted as a
+/// tab-separated text file, written atomically via rename.
+class RuntimeEstimator {
+public:
+  explicit RuntimeEstimator(std::string persist_path = {}, double alpha = 0.2,
+                            size_t window = 64);
+  ~RuntimeEstimator();
+
+  RuntimeEstimator(const RuntimeEstimator &) = delete;
+  RuntimeEstimator &operator=(const RuntimeEstimator &) = delete;
+
+  /// Inputs whose values distinguish cost classes. Int/float/double/bool/
+  /// string values are rendered; other types are ignored.
+  void set_feature_keys(std::vector<std::string> keys);
+
+  [[nodiscard]] std::string
+  make_key(TaskType type, const std::string &stage_name,
+           const std::unordered_map<std::string, std::any> &inputs) const;
+
+  void record(const std::string &key, const RuntimeObservation &observation);
+  [[nodiscard]] std::optional<RuntimeEstimate>
+  estimate(const std::string &key) const;
+
+  /// Load a previously saved model (replaces in-memory state). A missing
+  /// file is not an error.
+  Result<void, TaskError> load();
+  /// Write the model to persist_path (no-op without a path).
+  Result<void, TaskError> save() const;
+
+private:
+  struct Entry {
+    int samples = 0;
+    double runtime_ms_ewma = 0.0;
+    std::deque<RuntimeObservation> window;
+  };
+
+  std::string persist_path_;
+  double alpha_;
+  size_t window_;
+
+  mutable std::mutex mutex_;
+  std::vector<std::string> feature_keys_;
+  std::unordered_map<std::string, Entry> entries_;
+  mutable bool dirty_ = false;
+};
+
+} // namespace stv::core
@@ -1,13 +1,21 @@
 #pragma once
 
+#include "core/cpu_topology.h"
 #include "core/pipeline.h"
 #include "core/result.h"
+#include "core/runtime_estimator.h"
+#include "core/stage_memo.h"
 #include "core/task.h"
 #include "core/task_error.h"
 
+#include <array>
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace stv::core {
 
@@ -32,12 +40,162 @@ struct PausePolicy {
   int checkpoint_timeout_ms = 1500;
 };
 
+/// Automatic retry configuration (M4).
+/// Resolution order: TaskDescriptor::retry_policy → per_type → default_policy.
+struct RetryConfig {
+  TaskRetryPolicy default_policy{};
+  std::unordered_map<TaskType, TaskRetryPolicy> per_type;
+};
+
+/// Speculative (hedged) execution for straggler tasks (M4). Opt-in.
+/// When a running attempt exceeds its TaskType's runtime quantile, a duplicate
+/// execution is launched; the first to finish wins and the loser is canceled.
+/// Stages of hedged types must tolerate concurrent duplicate execute() calls.
+struct HedgePolicy {
+  bool enabled = false;
+  double runtime_quantile = 0.95;   // Straggler threshold (p95 by default)
+  int min_samples = 20;             // Successful runs per TaskType before hedging
+  double max_duplicate_ratio = 0.1; // Cap: duplicates launched / attempts started
+  std::vector<TaskType> task_types{TaskType::ImageGen}; // Empty = all types
+};
+
+/// Worker CPU placement (M4). Opt-in; pinning is best-effort.
+/// With numa_grouping, workers are spread round-robin over NUMA nodes and each
+/// is pinned to its node's CPUs; otherwise each worker is pinned to one CPU.
+/// Tasks whose stage prefers_input_locality() wait up to locality_wait_ms for
+/// a worker on the node that produced most of their inputs.
+struct AffinityPolicy {
+  bool enabled = false;
+  std::vector<int> cpu_set; // Empty = all CPUs allowed (cgroup cpuset aware)
+  bool numa_grouping = true;
+  int locality_wait_ms = 5;
+  std::optional<CpuTopology> topology; // Override detection (tests, embedding)
+};
+
+/// Host/container pressure snapshot (M4). PSI values are "some avg10"
+/// percentages in [0, 100]; negative memory_available_mb means unknown.
+struct ResourcePressure {
+  double cpu_some_avg10 = 0.0;
+  double memory_some_avg10 = 0.0;
+  int64_t memory_available_mb = -1;
+};
+
+/// Source of runtime pressure samples. Implemented in infra (cgroup v2 PSI);
+/// sample() is called from a scheduler-owned thread, never under its lock.
+class IPressureMonitor {
+public:
+  virtual ~IPressureMonitor() = default;
+  virtual ResourcePressure sample() = 0;
+};
+
+/// Pressure-driven admission (M4). Disabled when monitor is null.
+/// Each sample above a threshold halves the admitted CPU slots (min 1); each
+/// calm sample gives one slot back, up to cpu_slots_hard. Tasks with a RAM
+/// demand additionally need memory_available_mb - headroom to cover it.
+/// Like the soft gates, a task is always admitted when nothing is running.
+struct AdmissionPolicy {
+  std::shared_ptr<IPressureMonitor> monitor;
+  int sample_interval_ms = 1000;
+  double cpu_pressure_high = 50.0;
+  double memory_pressure_high = 10.0;
+  int memory_headroom_mb = 256;
+};
+
+/// Cross-task batching for IBatchableStage (M4). Opt-in.
+/// A batchable Ready task waits up to max_linger_ms for peers with the same
+/// batch key unless max_batch_size peers are already Ready. Followers ride on
+/// the leader's worker and CPU slot; their RAM/VRAM is still reserved.
+struct BatchPolicy {
+  bool enabled = false;
+  int max_batch_size = 4;
+  int max_linger_ms = 50;
+};
+
+/// Learned demand estimation (M4). Disabled when estimator is null.
+/// Every successful attempt is recorded. Once a key has min_samples
+/// observations, submit() fills estimated_runtime_ms and (unless
+/// pin_resource_demand) resource_demand.ram_mb/vram_mb from the p90 model
+/// scaled by demand_headroom. A resource is only learned from attempts that
+/// reported it. Dispatch breaks priority ties by estimated runtime.
+struct EstimatorPolicy {
+  std::shared_ptr<RuntimeEstimator> estimator;
+  int min_samples = 5;
+  double demand_headroom = 1.25;
+};
+
+/// Content-addressed stage memoization (M4). Disabled when memo is null.
+/// Before executing a task whose stage has a version(), the scheduler looks
+/// up stage_memo_key(); a hit succeeds the task instantly with the stored
+/// outputs, and every real success is stored. A hit the stage rejects via
+/// IStage::outputs_reusable() (its files were evicted) executes normally.
+/// Hits skip the runtime estimator and hedging samples.
+struct MemoPolicy {
+  std::shared_ptr<IStageMemo> memo;
+};
+
+/// Reserved CPU capacity per QosClass (M4). Opt-in; shares are indexed by
+/// QosClass and taken of cpu_slots_hard (rounded down).
+/// While a class has Ready work, other classes may not dip into the unused
+/// part of its min_cpu_share. Idle reservations are borrowed freely, but a
+/// class never holds more than max_cpu_share: without preemption, that
+/// ceiling is what keeps slots free for interactive work arriving behind a
+/// batch backlog. Tasks of a class below its reservation dispatch first.
+struct QosPolicy {
+  bool enabled = false;
+  std::array<double, kQosClassCount> min_cpu_share{0.25, 0.25, 0.0};
+  std::array<double, kQosClassCount> max_cpu_share{1.0, 1.0, 0.75};
+};
+
 /// Scheduler runtime configuration (M3).
 struct SchedulerConfig {
   int worker_count = 0; // 0 = auto: clamp((hw_threads - 1), 2, 8)
   ResourceBudget resource_budget{};
   AgingPolicy aging_policy{};
   PausePolicy pause_policy{};
+  RetryConfig retry{};
+  HedgePolicy hedging{};
+  AffinityPolicy affinity{};
+  AdmissionPolicy admission{};
+  EstimatorPolicy estimation{};
+  BatchPolicy batching{};
+  MemoPolicy memoization{};
+  QosPolicy qos{};
+};
+
+/// Rich task state notification (M4).
+/// Superset of the StateCallback parameters; carries attempt and error so
+/// observers can tell a retry re-queue apart from a fresh submission.
+struct TaskEvent {
+  std::string task_id;
+  std::string trace_id;
+  TaskState state = TaskState::Queued;
+  float progress = 0.0f;
+  int attempt = 0; // Attempts started so far (0 = never dispatched)
+  std::optional<TaskError> error;
+  std::shared_ptr<const StageOutputs> outputs; // Succeeded events only
+};
+
+/// Cumulative scheduler counters (M4).
+struct SchedulerMetrics {
+  uint64_t tasks_submitted = 0;
+  uint64_t attempts_started = 0;
+  uint64_t tasks_succeeded = 0;
+  uint64_t tasks_failed = 0;
+  uint64_t tasks_canceled = 0;
+  uint64_t retries_scheduled = 0;
+  uint64_t retries_exhausted = 0; // Retryable failures with no attempts left
+  int retry_waiting = 0;          // Tasks currently backing off (gauge)
+  uint64_t hedges_launched = 0;   // Speculative duplicates started
+  uint64_t hedge_wins = 0;        // Duplicates that finished before the primary
+  uint64_t locality_remote_dispatches = 0; // Locality-seeking tasks run off-node
+  int admission_cpu_slots = 0;            // CPU slots currently admitted (gauge)
+  uint64_t admission_throttles = 0;       // Samples that shrank admission
+  uint64_t batches_dispatched = 0;        // execute_batch() calls
+  uint64_t batched_tasks = 0;             // Attempts run inside a batch
+  uint64_t memo_hits = 0;                 // Tasks satisfied from the memo
+  uint64_t memo_stores = 0;               // Successful outputs memoized
+  std::array<uint64_t, kQosClassCount> qos_dispatches{}; // Attempts started per class
+  std::array<int, kQosClassCount> qos_cpu_slots{};       // CPU slots in use per class (gauge)
 };
 
 /// Scheduler interface — manages task lifecycle and dispatch.
@@ -70,6 +228,17 @@ public:
   /// Resume a paused task.
   virtual Result<void, TaskError> resume(const std::string &task_id) = 0;
 
+  /// Change a task's base priority (M4). Schedulers with priority
+  /// inheritance propagate the new effective priority to unfinished
+  /// dependencies.
+  virtual Result<void, TaskError> set_priority(const std::string &task_id,
+                                               int priority) {
+    (void)task_id;
+    (void)priority;
+    return Result<void, TaskError>::Err(
+        TaskError::Internal("set_priority is not supported by this scheduler"));
+  }
+
   /// Callback type for state change notifications.
   /// Parameters: task_id, new state, progress [0,1]
   using StateCallback = std::function<void(
@@ -79,12 +248,38 @@ public:
   /// The callback is invoked from the scheduler's execution context.
   virtual void on_state_change(StateCallback cb) = 0;
 
+  /// Callback type for rich task events (attempt count, error, trace_id).
+  using TaskEventCallback = std::function<void(const TaskEvent &event)>;
+
+  /// Register a callback for rich task events. The default adapts plain
+  /// state changes (no trace_id, attempt, error or outputs) for schedulers
+  /// that do not track them.
+  virtual void on_task_event(TaskEventCallback cb) {
+    on_state_change([cb = std::move(cb)](const std::string &task_id,
+                                         TaskState state, float progress) {
+      TaskEvent event;
+      event.task_id = task_id;
+      event.state = state;
+      event.progress = progress;
+      cb(event);
+    });
+  }
+
+  /// Snapshot of cumulative scheduler counters.
+  [[nodiscard]] virtual SchedulerMetrics metrics() const { return {}; }
+
   /// Process pending tasks. Call from event loop or timer.
   /// For SimpleScheduler: executes one ready task per call.
   virtual void tick() = 0;
 
   /// Check if there are any non-terminal tasks.
   [[nodiscard]] virtual bool has_pending_tasks() const = 0;
+
+  /// Release the bookkeeping of a trace's terminal tasks (M4), e.g. once its
+  /// workflow retired, so long-running schedulers do not grow without bound.
+  /// Forgotten ids can no longer be dependencies or be canceled. Unfinished
+  /// tasks are kept. The default keeps everything.
+  virtual void forget(const std::string &trace_id) { (void)trace_id; }
 };
 
 /// M1 scheduler: single-threaded tick-based fallback implementation.
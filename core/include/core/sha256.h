@@ -0,0 +1,35 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace stv::core {
+
+/// Incremental SHA-256 (FIPS 180-4). Used for content-addressed keys (M4);
+/// core has no crypto dependency, so this is a small self-contained version.
+class Sha256 {
+public:
+  Sha256();
+
+  void update(const void *data, size_t size);
+  void update(const std::string &data) { update(data.data(), data.size()); }
+
+  /// Finish and return the digest as 64 lowercase hex chars. The object must
+  /// not be updated afterwards.
+  std::string hex_digest();
+
+private:
+  void transform(const uint8_t *block);
+
+  std::array<uint32_t, 8> state_;
+  std::array<uint8_t, 64> buffer_{};
+  size_t buffer_size_ = 0;
+  uint64_t total_bytes_ = 0;
+};
+
+/// SHA-256 of `data` as lowercase hex.
+std::string sha256_hex(const std::string &data);
+
+} // namespace stv::core
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "core/pipeline.h"
+
+#include <any>
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace stv::core {
+
+/// Outputs of one successful stage execution, as published to successors.
+using StageOutputs = std::unordered_map<std::string, std::any>;
+
+/// Content-addressed store of stage outputs (M4).
+///
+/// Keys come from stage_memo_key(): a digest of the stage name, its version
+/// and its (canonicalized) inputs. Because successors receive their
+/// predecessors' outputs as inputs, a hit on an unchanged task reproduces
+/// exactly the inputs its successors saw last time, so re-rendering a
+/// workflow after editing one scene only re-executes that scene's chain.
+/// Implementations must be thread-safe; the scheduler calls them from worker
+/// threads without holding its lock.
+class IStageMemo {
+public:
+  virtual ~IStageMemo() = default;
+
+  [[nodiscard]] virtual std::optional<StageOutputs>
+  lookup(const std::string &key) = 0;
+  virtual void store(const std::string &key, const StageOutputs &outputs) = 0;
+};
+
+/// Process-local memo bounded by entry count, evicting least recently used.
+class InMemoryStageMemo : public IStageMemo {
+public:
+  explicit InMemoryStageMemo(size_t capacity = 4096);
+
+  [[nodiscard]] std::optional<StageOutputs>
+  lookup(const std::string &key) override;
+  void store(const std::string &key, const StageOutputs &outputs) override;
+
+  [[nodiscard]] size_t size() const;
+
+private:
+  using LruList = std::list<std::string>;
+  struct Entry {
+    StageOutputs outputs;
+    LruList::iterator lru_pos;
+  };
+
+  size_t capacity_;
+  mutable std::mutex mutex_;
+  LruList lru_; // Front = most recently used
+  std::unordered_map<std::string, Entry> entries_;
+};
+
+/// Memo key for running `stage` on `ctx.inputs`, or empty when the execution
+/// must not be memoized: the stage has no version(), or a hashed input holds
+/// a type without a canonical encoding (string, bool, int, int64, float,
+/// double and vectors of string/int are supported).
+[[nodiscard]] std::string stage_memo_key(const IStage &stage,
+                                         const StageContext &ctx);
+
+} // namespace stv::core
@@ -4,10 +4,13 @@
 #include "core/result.h"
 #include "core/task_error.h"
 
+#include <any>
 #include <chrono>
+#include <cstddef>
 #include <memory>
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace stv::core {
@@ -38,11 +41,25 @@ enum class TaskType {
   ImageGen,   // Text-to-image generation
   VideoClip,  // Image-to-video conversion
   TTS,        // Text-to-speech synthesis
-  Compose     // FFmpeg final composition
+  Compose,    // FFmpeg composition (per-scene segment: clip + narration)
+  Concat      // Join scene segments into the final video
 };
 
 const char *to_string(TaskType type);
 
+/// Inverse of to_string(TaskType). Returns false for unknown names.
+bool parse_task_type(const std::string &text, TaskType &out);
+
+// ---- QoS Class (M4) ----
+
+/// Service class of a task, inherited from its workflow. Orders workflow
+/// admission and, with QosPolicy enabled, partitions scheduler CPU slots.
+enum class QosClass { Interactive = 0, Standard = 1, Batch = 2 };
+
+inline constexpr size_t kQosClassCount = 3;
+
+const char *to_string(QosClass qos);
+
 // ---- Task Resource Demand (M3) ----
 
 struct ResourceDemand {
@@ -51,6 +68,17 @@ struct ResourceDemand {
   int vram_mb = 0;
 };
 
+// ---- Task Retry Policy (M4) ----
+
+/// Scheduler-enforced automatic retry. Only errors flagged `retryable` are
+/// retried; the task waits out its backoff in Queued without holding a worker.
+struct TaskRetryPolicy {
+  int max_attempts = 1; // Total attempts including the first (1 = no retry)
+  int initial_backoff_ms = 500;
+  double backoff_multiplier = 2.0;
+  int max_backoff_ms = 10000;
+};
+
 // ---- Task Descriptor ----
 
 /// Core data structure representing a single task in the system.
@@ -61,8 +89,20 @@ struct TaskDescriptor {
   TaskType type;
   TaskState state = TaskState::Queued;
   int priority = 0;
+  QosClass qos = QosClass::Standard;
   float progress = 0.0f; // [0.0, 1.0]
   ResourceDemand resource_demand{};
+  bool pin_resource_demand = false; // true = never overwritten by the estimator
+  std::optional<double> estimated_runtime_ms; // Filled at submit; breaks dispatch ties (M4)
+
+  // Static stage inputs (M4), e.g. width/height/steps. Merged into
+  // StageContext::inputs ahead of dependency outputs and used as estimator
+  // features; on key collision the static value wins.
+  std::unordered_map<std::string, std::any> inputs;
+
+  // Retry bookkeeping (M4)
+  std::optional<TaskRetryPolicy> retry_policy; // Overrides scheduler defaults
+  int attempt = 0; // Execution attempts started so far
 
   // Dependency management
   std::vector<std::string> deps; // Prerequisite task IDs
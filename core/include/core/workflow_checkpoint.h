@@ -0,0 +1,97 @@
+#pragma once
+
+#include "core/result.h"
+#include "core/stage_memo.h"
+#include "core/task.h"
+#include "core/task_error.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace stv::core {
+
+/// Persisted state of one workflow (M4): the instantiated DAG plus the
+/// outputs of every task that succeeded. Enough to resubmit only the
+/// unfinished tasks after a failure, a cancel or a restart.
+struct WorkflowManifest {
+  struct Task {
+    std::string task_id; // Id from the first run; resumed runs add ".r<n>"
+    TaskType type = TaskType::Storyboard;
+    int priority = 0;
+    ResourceDemand resource_demand{};
+    bool pin_resource_demand = false;
+    std::vector<std::string> deps;
+    StageOutputs inputs; // Static inputs
+    bool succeeded = false;
+    StageOutputs outputs; // Valid when succeeded
+  };
+
+  std::string trace_id;
+  int generation = 0; // Times the workflow has been resumed
+  std::vector<Task> tasks;
+};
+
+/// Durable home of workflow manifests (M4).
+///
+/// begin() writes the DAG once per run; record() then appends one completed
+/// task at a time, so a checkpoint costs O(that task's outputs), not
+/// O(workflow). record() is called from scheduler worker threads and must
+/// be thread-safe.
+class IWorkflowCheckpointStore {
+public:
+  virtual ~IWorkflowCheckpointStore() = default;
+
+  /// Write the whole manifest, replacing any earlier one for its trace, and
+  /// open it for record().
+  virtual Result<void, TaskError> begin(const WorkflowManifest &manifest) = 0;
+
+  /// Append one succeeded task. Returns false when nothing was persisted
+  /// (unknown trace, I/O error, or an output type without an encoding);
+  /// the task then simply re-runs on resume.
+  virtual bool record(const std::string &trace_id, const std::string &task_id,
+                      const StageOutputs &outputs) = 0;
+
+  /// Close the manifest. keep=false deletes it (the workflow succeeded or
+  /// was never visible); keep=true leaves it for resume.
+  virtual void finish(const std::string &trace_id, bool keep) = 0;
+
+  [[nodiscard]] virtual Result<WorkflowManifest, TaskError>
+  load(const std::string &trace_id) = 0;
+
+  /// Trace ids with a stored manifest.
+  [[nodiscard]] virtual std::vector<std::string> list() = 0;
+};
+
+/// One append-only text file per workflow, `<dir>/<trace_id>.manifest`.
+/// begin() writes via a temp file and rename; each record() is one line,
+/// written and flushed, so a crash or quit loses at most the line being
+/// written (a torn last line is ignored on load). Output values use the
+/// types stage_memo_key() supports: string, bool, int, int64, float,
+/// double and vectors of string/int.
+class FileWorkflowCheckpointStore : public IWorkflowCheckpointStore {
+public:
+  explicit FileWorkflowCheckpointStore(std::string directory);
+  ~FileWorkflowCheckpointStore() override;
+
+  Result<void, TaskError> begin(const WorkflowManifest &manifest) override;
+  bool record(const std::string &trace_id, const std::string &task_id,
+              const StageOutputs &outputs) override;
+  void finish(const std::string &trace_id, bool keep) override;
+  [[nodiscard]] Result<WorkflowManifest, TaskError>
+  load(const std::string &trace_id) override;
+  [[nodiscard]] std::vector<std::string> list() override;
+
+private:
+  struct Journal;
+
+  std::string path_for(const std::string &trace_id) const;
+
+  std::string directory_;
+  std::mutex mutex_;
+  std::unordered_map<std::string, std::shared_ptr<Journal>> open_;
+};
+
+} // namespace stv::core
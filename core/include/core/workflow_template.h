@@ -0,0 +1,97 @@
+#pragma once
+
+#include "core/result.h"
+#include "core/task.h"
+#include "core/task_error.h"
+
+#include <any>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace stv::core {
+
+/// Compiled, immutable workflow DAG (M4).
+///
+/// Built once from a declarative template by compile_workflow_template();
+/// instantiate() then only stamps out TaskDescriptors, with no parsing or
+/// validation per workflow.
+///
+/// Template format: one directive per line, `#` starts a comment.
+///
+///   workflow story_to_video
+///   stage storyboard Storyboard priority=100 workflow_inputs
+///   stage image ImageGen per_scene after=storyboard priority=50 scene_bias=10
+///   stage concat Concat after=image priority=10
+///
+/// Stage options:
+///   per_scene        one task per scene (gets input "scene_index")
+///   after=a,b        dependencies, by stage name, in this order
+///   priority=N       base priority
+///   scene_bias=N     per-scene only: scene i gets +max(0, N - i)
+///   cpu_slots=N ram_mb=N vram_mb=N   resource demand (TaskDescriptor defaults)
+///   pin_demand       the runtime estimator never overrides the demand
+///   workflow_inputs  receives story_text / style / scene_count
+///
+/// Dependency fan-out/fan-in follows the stage kinds: a per-scene stage
+/// depends on the same scene of a per-scene dependency; a once stage after a
+/// per-scene stage depends on every scene of it. A per-scene stage may not
+/// depend on such a fan-in stage.
+class WorkflowPlan {
+public:
+  enum class Group : uint8_t { Head, Scene, Tail };
+
+  struct Stage {
+    std::string name;
+    TaskType type = TaskType::Storyboard;
+    bool per_scene = false;
+    int priority = 0;
+    int scene_bias = 0;
+    ResourceDemand demand{};
+    bool pin_demand = false;
+    bool workflow_inputs = false;
+    std::vector<uint32_t> deps; // Stage indices
+    Group group = Group::Head;
+    uint32_t slot = 0; // Position within its group (emission order)
+  };
+
+  [[nodiscard]] const std::string &name() const { return name_; }
+  [[nodiscard]] const std::vector<Stage> &stages() const { return stages_; }
+
+  [[nodiscard]] size_t task_count(int scene_count) const {
+    return head_.size() + scene_.size() * static_cast<size_t>(scene_count) + tail_.size();
+  }
+
+  /// Stamp out the tasks of one workflow: head stages, then each scene's
+  /// stages, then fan-in stages. Task ids are `<trace_id>.<ordinal>`.
+  [[nodiscard]] std::vector<TaskDescriptor>
+  instantiate(const std::string &trace_id, int scene_count,
+              const std::unordered_map<std::string, std::any> &workflow_inputs) const;
+
+private:
+  friend Result<std::shared_ptr<const WorkflowPlan>, TaskError>
+  compile_workflow_template(const std::string &text);
+
+  size_t task_index(const Stage &stage, int scene, int scene_count) const;
+
+  std::string name_;
+  std::vector<Stage> stages_;
+  std::vector<uint32_t> head_, scene_, tail_; // Stage indices, topological
+};
+
+/// Parse and validate a template. Errors name the offending line.
+Result<std::shared_ptr<const WorkflowPlan>, TaskError>
+compile_workflow_template(const std::string &text);
+
+/// Read and compile a template file.
+Result<std::shared_ptr<const WorkflowPlan>, TaskError>
+load_workflow_template(const std::string &path);
+
+/// Built-in story-to-video DAG:
+///   Storyboard → per scene {ImageGen → VideoClip, TTS} → Compose → Concat
+const std::string &default_workflow_template();
+std::shared_ptr<const WorkflowPlan> default_workflow_plan();
+
+} // namespace stv::core
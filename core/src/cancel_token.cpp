@@ -2,24 +2,256 @@
 #include "core/task_error.h"
 
 #include <stdexcept>
+#include <thread>
 
 namespace stv::core {
 
+namespace detail {
+
+namespace {
+
+enum CallbackState : int { kArmed, kRunning, kDone, kRemoved };
+
+// Prune once this many deregistered nodes sit in the list and they make up
+// at least half of it.
+constexpr int kPruneThreshold = 16;
+
+} // namespace
+
+/// One registered callback. Owned jointly by the registry list and the
+/// CancelRegistration handle; freed when both let go.
+struct CancelCallbackNode {
+  CancelToken::Callback cb;
+  std::atomic<int> state{kArmed};
+  std::atomic<int> refs{2};
+  std::atomic<std::thread::id> runner{};
+  CancelCallbackNode *next = nullptr;
+};
+
+/// Lock-free LIFO of callbacks (Treiber stack). request_cancel() swaps the
+/// head for kClosed, so later registrations see the token as canceled and
+/// run inline.
+struct CancelRegistry {
+  std::atomic<CancelCallbackNode *> head{nullptr};
+  std::atomic<int> listed{0};  // Nodes currently in the list
+  std::atomic<int> removed{0}; // Listed nodes already deregistered
+  std::atomic<bool> pruning{false};
+  // Armed nodes a pruner held while the list was closed; request_cancel()
+  // takes them once pruning clears.
+  std::atomic<CancelCallbackNode *> orphans{nullptr};
+
+  static CancelCallbackNode *closed() {
+    static CancelCallbackNode marker;
+    return &marker;
+  }
+
+  ~CancelRegistry() {
+    auto *node = head.load(std::memory_order_acquire);
+    if (node == closed()) {
+      return;
+    }
+    while (node) {
+      auto *next = node->next;
+      release(node);
+      node = next;
+    }
+  }
+
+  static void release(CancelCallbackNode *node) {
+    if (node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete node;
+    }
+  }
+
+  static void fire(CancelCallbackNode *node) {
+    int expected = kArmed;
+    if (!node->state.compare_exchange_strong(expected, kRunning,
+                                             std::memory_order_acq_rel)) {
+      return;
+    }
+    node->runner.store(std::this_thread::get_id(), std::memory_order_release);
+    try {
+      node->cb();
+    } catch (...) { /* swallow — cancel must not throw */
+    }
+    node->state.store(kDone, std::memory_order_release);
+  }
+
+  /// Fire a detached chain in registration order, dropping the list's refs.
+  void fire_chain(CancelCallbackNode *chain) {
+    CancelCallbackNode *ordered = nullptr;
+    while (chain) {
+      auto *next = chain->next;
+      chain->next = ordered;
+      ordered = chain;
+      chain = next;
+    }
+    while (ordered) {
+      auto *next = ordered->next;
+      fire(ordered);
+      listed.fetch_sub(1, std::memory_order_relaxed);
+      release(ordered);
+      ordered = next;
+    }
+  }
+
+  /// Push unless closed. Returns false when the token was canceled.
+  bool push(CancelCallbackNode *node) {
+    auto *expected = head.load(std::memory_order_acquire);
+    do {
+      if (expected == closed()) {
+        return false;
+      }
+      node->next = expected;
+    } while (!head.compare_exchange_weak(expected, node, std::memory_order_acq_rel,
+                                         std::memory_order_acquire));
+    listed.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  /// Detach the whole list, drop deregistered nodes, splice the rest back.
+  /// Only one pruner runs at a time. If a cancel closes the list meanwhile,
+  /// the pruner hands what it holds to orphans, and request_cancel() fires
+  /// it: callbacks still run before request_cancel() returns.
+  void maybe_prune() {
+    const int dead = removed.load(std::memory_order_relaxed);
+    if (dead < kPruneThreshold || dead * 2 < listed.load(std::memory_order_relaxed)) {
+      return;
+    }
+    if (pruning.exchange(true, std::memory_order_acquire)) {
+      return;
+    }
+
+    auto *chain = head.load(std::memory_order_acquire);
+    while (chain && chain != closed() &&
+           !head.compare_exchange_weak(chain, nullptr, std::memory_order_acq_rel,
+                                       std::memory_order_acquire)) {
+    }
+    if (!chain || chain == closed()) {
+      pruning.store(false, std::memory_order_release);
+      return;
+    }
+
+    CancelCallbackNode *kept = nullptr;
+    CancelCallbackNode *kept_tail = nullptr;
+    CancelCallbackNode *dead_nodes = nullptr;
+    while (chain) {
+      auto *next = chain->next;
+      if (chain->state.load(std::memory_order_acquire) == kArmed) {
+        chain->next = nullptr;
+        if (kept_tail) {
+          kept_tail->next = chain;
+        } else {
+          kept = chain;
+        }
+        kept_tail = chain;
+      } else {
+        listed.fetch_sub(1, std::memory_order_relaxed);
+        removed.fetch_sub(1, std::memory_order_relaxed);
+        chain->next = dead_nodes;
+        dead_nodes = chain;
+      }
+      chain = next;
+    }
+
+    if (kept) {
+      auto *expected = head.load(std::memory_order_acquire);
+      while (true) {
+        if (expected == closed()) {
+          kept_tail->next = nullptr; // A failed splice may have linked it
+          orphans.store(kept, std::memory_order_relaxed);
+          break;
+        }
+        kept_tail->next = expected;
+        if (head.compare_exchange_weak(expected, kept, std::memory_order_acq_rel,
+                                       std::memory_order_acquire)) {
+          break;
+        }
+      }
+    }
+    pruning.store(false, std::memory_order_release);
+
+    // Released only now: a dropped callback's captures may cancel this token,
+    // and request_cancel() waits for pruning to clear.
+    while (dead_nodes) {
+      auto *next = dead_nodes->next;
+      release(dead_nodes);
+      dead_nodes = next;
+    }
+  }
+};
+
+} // namespace detail
+
+// ========== CancelRegistration ==========
+
+CancelRegistration::CancelRegistration(std::shared_ptr<detail::CancelRegistry> registry,
+                                       detail::CancelCallbackNode *node) noexcept
+    : registry_(std::move(registry)), node_(node) {}
+
+CancelRegistration::~CancelRegistration() { reset(); }
+
+CancelRegistration::CancelRegistration(CancelRegistration &&other) noexcept
+    : registry_(std::move(other.registry_)), node_(other.node_) {
+  other.node_ = nullptr;
+}
+
+CancelRegistration &CancelRegistration::operator=(CancelRegistration &&other) noexcept {
+  if (this != &other) {
+    reset();
+    registry_ = std::move(other.registry_);
+    node_ = other.node_;
+    other.node_ = nullptr;
+  }
+  return *this;
+}
+
+void CancelRegistration::reset() noexcept {
+  if (!node_) {
+    return;
+  }
+  int expected = detail::kArmed;
+  if (node_->state.compare_exchange_strong(expected, detail::kRemoved,
+                                           std::memory_order_acq_rel)) {
+    registry_->removed.fetch_add(1, std::memory_order_relaxed);
+  } else if (expected == detail::kRunning &&
+             node_->runner.load(std::memory_order_acquire) !=
+                 std::this_thread::get_id()) {
+    while (node_->state.load(std::memory_order_acquire) == detail::kRunning) {
+      std::this_thread::yield();
+    }
+  }
+  detail::CancelRegistry::release(node_);
+  node_ = nullptr;
+  registry_.reset();
+}
+
+bool CancelRegistration::active() const noexcept {
+  return node_ && node_->state.load(std::memory_order_acquire) == detail::kArmed;
+}
+
+// ========== CancelToken ==========
+
+CancelToken::CancelToken() : registry_(std::make_shared<detail::CancelRegistry>()) {}
+
+CancelToken::~CancelToken() = default;
+
 void CancelToken::request_cancel() noexcept {
   bool expected = false;
   if (canceled_.compare_exchange_strong(expected, true,
                                         std::memory_order_release,
                                         std::memory_order_relaxed)) {
-    // First cancellation — invoke callbacks
-    std::lock_guard<std::mutex> lock(cb_mutex_);
-    for (auto &cb : callbacks_) {
-      if (cb) {
-        try {
-          cb();
-        } catch (...) { /* swallow — cancel must not throw */
-        }
-      }
+    // First cancellation — close the list and invoke callbacks
+    auto *chain = registry_->head.exchange(detail::CancelRegistry::closed(),
+                                           std::memory_order_acq_rel);
+    // A pruner may hold part of the list detached; wait for it to hand that
+    // back. Those nodes were registered before everything in chain.
+    while (registry_->pruning.load(std::memory_order_acquire)) {
+      std::this_thread::yield();
     }
+    registry_->fire_chain(
+        registry_->orphans.exchange(nullptr, std::memory_order_acquire));
+    registry_->fire_chain(chain);
   }
 }
 
@@ -33,15 +265,38 @@ void CancelToken::throw_if_canceled() const {
   }
 }
 
-void CancelToken::on_cancel(Callback cb) {
+CancelRegistration CancelToken::on_cancel(Callback cb) {
+  if (!cb) {
+    return {};
+  }
   if (is_canceled()) {
     // Already canceled — invoke immediately
-    if (cb)
-      cb();
-    return;
+    cb();
+    return {};
   }
-  std::lock_guard<std::mutex> lock(cb_mutex_);
-  callbacks_.push_back(std::move(cb));
+
+  auto *node = new detail::CancelCallbackNode();
+  node->cb = std::move(cb);
+  if (!registry_->push(node)) {
+    // Canceled between the check and the push
+    auto inline_cb = std::move(node->cb);
+    delete node;
+    inline_cb();
+    return {};
+  }
+  registry_->maybe_prune();
+  return CancelRegistration(registry_, node);
+}
+
+std::shared_ptr<CancelToken> CancelToken::create_child() {
+  auto child = create();
+  std::weak_ptr<CancelToken> weak_child = child;
+  child->parent_link_ = on_cancel([weak_child]() {
+    if (auto c = weak_child.lock()) {
+      c->request_cancel();
+    }
+  });
+  return child;
 }
 
 std::shared_ptr<CancelToken> CancelToken::create() {
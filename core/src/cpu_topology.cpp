@@ -0,0 +1,206 @@
+#include "core/cpu_topology.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <thread>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace stv::core {
+
+namespace {
+
+std::string read_first_line(const std::string &path) {
+  std::ifstream in(path);
+  std::string line;
+  if (in) {
+    std::getline(in, line);
+  }
+  return line;
+}
+
+std::vector<int> intersect(const std::vector<int> &a, const std::vector<int> &b) {
+  std::vector<int> out;
+  std::set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                        std::back_inserter(out));
+  return out;
+}
+
+std::vector<int> fallback_cpus() {
+  const auto hw = static_cast<int>(std::thread::hardware_concurrency());
+  std::vector<int> cpus;
+  for (int i = 0; i < std::max(1, hw); ++i) {
+    cpus.push_back(i);
+  }
+  return cpus;
+}
+
+} // namespace
+
+std::vector<int> parse_cpu_list(const std::string &text) {
+  std::vector<int> cpus;
+  std::stringstream ss(text);
+  std::string part;
+  while (std::getline(ss, part, ',')) {
+    part.erase(std::remove_if(part.begin(), part.end(),
+                              [](unsigned char c) { return std::isspace(c); }),
+               part.end());
+    if (part.empty()) {
+      continue;
+    }
+    try {
+      const auto dash = part.find('-');
+      if (dash == std::string::npos) {
+        cpus.push_back(std::stoi(part));
+        continue;
+      }
+      const int lo = std::stoi(part.substr(0, dash));
+      const int hi = std::stoi(part.substr(dash + 1));
+      for (int cpu = lo; cpu <= hi; ++cpu) {
+        cpus.push_back(cpu);
+      }
+    } catch (const std::exception &) {
+      // Skip malformed range.
+    }
+  }
+  std::sort(cpus.begin(), cpus.end());
+  cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+  return cpus;
+}
+
+std::vector<int> allowed_cpus() {
+#ifdef __linux__
+  std::vector<int> cpus;
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &mask)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+  if (cpus.empty()) {
+    cpus = fallback_cpus();
+  }
+
+  // The kernel already folds the cgroup cpuset into the affinity mask; the
+  // explicit intersection guards against masks set before a cgroup move.
+  const auto cpuset =
+      parse_cpu_list(read_first_line("/sys/fs/cgroup/cpuset.cpus.effective"));
+  if (!cpuset.empty()) {
+    auto restricted = intersect(cpus, cpuset);
+    if (!restricted.empty()) {
+      cpus = std::move(restricted);
+    }
+  }
+  return cpus;
+#else
+  return fallback_cpus();
+#endif
+}
+
+CpuTopology CpuTopology::detect() {
+  CpuTopology topology;
+  const auto allowed = allowed_cpus();
+
+#ifdef __linux__
+  if (DIR *dir = opendir("/sys/devices/system/node")) {
+    while (dirent *entry = readdir(dir)) {
+      const std::string name = entry->d_name;
+      if (name.rfind("node", 0) != 0 || name.size() <= 4 ||
+          !std::all_of(name.begin() + 4, name.end(),
+                       [](unsigned char c) { return std::isdigit(c); })) {
+        continue;
+      }
+      NumaNode node;
+      node.id = std::stoi(name.substr(4));
+      node.cpus = intersect(
+          parse_cpu_list(read_first_line("/sys/devices/system/node/" + name +
+                                         "/cpulist")),
+          allowed);
+      if (!node.cpus.empty()) {
+        topology.nodes.push_back(std::move(node));
+      }
+    }
+    closedir(dir);
+  }
+  std::sort(topology.nodes.begin(), topology.nodes.end(),
+            [](const NumaNode &a, const NumaNode &b) { return a.id < b.id; });
+#endif
+
+  if (topology.nodes.empty()) {
+    topology.nodes.push_back(NumaNode{0, allowed});
+  }
+  return topology;
+}
+
+std::vector<int> CpuTopology::all_cpus() const {
+  std::vector<int> cpus;
+  for (const auto &node : nodes) {
+    cpus.insert(cpus.end(), node.cpus.begin(), node.cpus.end());
+  }
+  std::sort(cpus.begin(), cpus.end());
+  return cpus;
+}
+
+int CpuTopology::node_of(int cpu) const {
+  for (const auto &node : nodes) {
+    if (std::binary_search(node.cpus.begin(), node.cpus.end(), cpu)) {
+      return node.id;
+    }
+  }
+  return -1;
+}
+
+CpuTopology CpuTopology::restricted_to(const std::vector<int> &cpu_set) const {
+  if (cpu_set.empty()) {
+    return *this;
+  }
+  auto wanted = cpu_set;
+  std::sort(wanted.begin(), wanted.end());
+  CpuTopology out;
+  for (const auto &node : nodes) {
+    auto cpus = intersect(node.cpus, wanted);
+    if (!cpus.empty()) {
+      out.nodes.push_back(NumaNode{node.id, std::move(cpus)});
+    }
+  }
+  return out;
+}
+
+bool pin_current_thread(const std::vector<int> &cpus) {
+#ifdef __linux__
+  if (cpus.empty()) {
+    return false;
+  }
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  for (int cpu : cpus) {
+    if (cpu >= 0 && cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &mask);
+    }
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask) == 0;
+#else
+  (void)cpus;
+  return false;
+#endif
+}
+
+int current_cpu() {
+#ifdef __linux__
+  return sched_getcpu();
+#else
+  return -1;
+#endif
+}
+
+} // namespace stv::core
@@ -0,0 +1,156 @@
+#include "core/id.h"
+
+#include <chrono>
+#include <random>
+#include <thread>
+
+namespace stv::core {
+
+namespace {
+
+uint64_t splitmix64(uint64_t &state) {
+  uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+constexpr uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+/// Per-thread generator state: xoshiro256** plus the UUIDv7 sequence.
+/// Nothing is shared between threads, so new_id() takes no lock.
+struct IdState {
+  uint64_t s[4];
+  uint64_t last_ms = 0;
+  uint32_t seq = 0;
+
+  IdState() {
+    std::random_device device;
+    uint64_t seed = (static_cast<uint64_t>(device()) << 32) ^ device();
+    // random_device may be deterministic on some platforms; mix in the
+    // thread and the clock so threads never share a stream.
+    seed ^= std::hash<std::thread::id>{}(std::this_thread::get_id());
+    seed ^= static_cast<uint64_t>(
+        std::chrono::steady_clock::now().time_since_epoch().count());
+    for (auto &word : s) {
+      word = splitmix64(seed);
+    }
+  }
+
+  uint64_t next() {
+    const uint64_t result = rotl(s[1] * 5, 7) * 9;
+    const uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+  }
+};
+
+IdState &thread_state() {
+  thread_local IdState state;
+  return state;
+}
+
+constexpr char kHex[] = "0123456789abcdef";
+
+int hex_value(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+/// Low `digits` nibbles of `value`, most significant first.
+void write_hex(char *out, uint64_t value, int digits) {
+  for (int i = digits - 1; i >= 0; --i) {
+    out[i] = kHex[value & 0xF];
+    value >>= 4;
+  }
+}
+
+bool is_dash_position(size_t i) { return i == 8 || i == 13 || i == 18 || i == 23; }
+
+} // namespace
+
+Id128 new_id() {
+  auto &state = thread_state();
+  const auto now_ms = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count());
+
+  // RFC 9562 method 1: a 12-bit counter in rand_a, seeded randomly (top bit
+  // clear, for headroom) each new millisecond. If the clock stalls or steps
+  // back, or the counter overflows, the timestamp advances instead, so ids
+  // from one thread stay strictly increasing.
+  if (now_ms > state.last_ms) {
+    state.last_ms = now_ms;
+    state.seq = static_cast<uint32_t>(state.next() & 0x7FF);
+  } else if (++state.seq > 0xFFF) {
+    ++state.last_ms;
+    state.seq = static_cast<uint32_t>(state.next() & 0x7FF);
+  }
+
+  Id128 id;
+  id.hi = ((state.last_ms & 0xFFFFFFFFFFFFULL) << 16) | 0x7000 | state.seq;
+  id.lo = (state.next() & 0x3FFFFFFFFFFFFFFFULL) | 0x8000000000000000ULL;
+  return id;
+}
+
+void format_id(const Id128 &id, char *out) {
+  write_hex(out, id.hi >> 32, 8);
+  out[8] = '-';
+  write_hex(out + 9, id.hi >> 16, 4);
+  out[13] = '-';
+  write_hex(out + 14, id.hi, 4);
+  out[18] = '-';
+  write_hex(out + 19, id.lo >> 48, 4);
+  out[23] = '-';
+  write_hex(out + 24, id.lo, 12);
+  out[kIdStringLength] = '\0';
+}
+
+std::string to_string(const Id128 &id) {
+  char buffer[kIdStringLength + 1];
+  format_id(id, buffer);
+  return std::string(buffer, kIdStringLength);
+}
+
+bool parse_id(std::string_view text, Id128 &out) {
+  if (text.size() != kIdStringLength) {
+    return false;
+  }
+  Id128 id;
+  int nibble = 0;
+  for (size_t i = 0; i < text.size(); ++i) {
+    if (is_dash_position(i)) {
+      if (text[i] != '-') {
+        return false;
+      }
+      continue;
+    }
+    const int value = hex_value(text[i]);
+    if (value < 0) {
+      return false;
+    }
+    auto &word = nibble < 16 ? id.hi : id.lo;
+    word = (word << 4) | static_cast<uint64_t>(value);
+    ++nibble;
+  }
+  out = id;
+  return true;
+}
+
+std::string new_id_string() { return to_string(new_id()); }
+
+} // namespace stv::core
@@ -1,44 +1,90 @@
 #include "core/orchestrator.h"
+#include "core/id.h"
 
 #include <algorithm>
-#include <random>
-#include <sstream>
+#include <unordered_set>
 
 namespace stv::core {
 
 // Forward declaration of mock stage factory
 std::shared_ptr<IStage> create_mock_stage(TaskType type);
 
+namespace {
+
+/// The workflow's result comes from the last task nothing depends on.
+template <typename Tasks, typename IdOf, typename DepsOf>
+std::string find_sink(const Tasks &tasks, IdOf id_of, DepsOf deps_of) {
+  std::unordered_set<std::string> depended_on;
+  for (const auto &task : tasks) {
+    for (const auto &dep : deps_of(task)) {
+      depended_on.insert(dep);
+    }
+  }
+  for (auto it = tasks.rbegin(); it != tasks.rend(); ++it) {
+    if (depended_on.count(id_of(*it)) == 0) {
+      return id_of(*it);
+    }
+  }
+  return {};
+}
+
+std::string video_path_of(const StageOutputs &outputs) {
+  auto it = outputs.find("video_path");
+  if (it == outputs.end()) {
+    return {};
+  }
+  const auto *path = std::any_cast<std::string>(&it->second);
+  return path ? *path : std::string{};
+}
+
+} // namespace
+
 WorkflowEngine::WorkflowEngine(std::shared_ptr<IScheduler> scheduler,
-                               std::shared_ptr<ILogger> logger)
+                               std::shared_ptr<ILogger> logger,
+                               WorkflowAdmissionPolicy admission)
     : scheduler_(std::move(scheduler)), logger_(std::move(logger)),
-      stage_factory_(create_mock_stage) // Default: use mock stages
+      stage_factory_(std::make_shared<const StageFactory>(
+          create_mock_stage)), // Default: use mock stages
+      plan_(default_workflow_plan()),
+      admission_(admission)
 {
-  // Register for scheduler state changes
-  scheduler_->on_state_change(
-      [this](const std::string &task_id, TaskState state, float progress) {
-        handle_state_change(task_id, state, progress);
-      });
+  // Rich events carry the outputs of succeeded tasks for checkpointing;
+  // schedulers without them adapt plain state changes.
+  scheduler_->on_task_event([this](const TaskEvent &event) { handle_task_event(event); });
 }
 
 void WorkflowEngine::on_completion(CompletionCallback cb) {
-  completion_cb_ = std::move(cb);
+  std::atomic_store(&completion_cb_,
+                    std::make_shared<const CompletionCallback>(std::move(cb)));
 }
 
 void WorkflowEngine::on_progress(ProgressCallback cb) {
-  progress_cb_ = std::move(cb);
+  std::atomic_store(&progress_cb_,
+                    std::make_shared<const ProgressCallback>(std::move(cb)));
 }
 
 void WorkflowEngine::set_stage_factory(StageFactory factory) {
-  stage_factory_ = std::move(factory);
+  std::atomic_store(&stage_factory_,
+                    std::make_shared<const StageFactory>(std::move(factory)));
 }
 
-Result<std::string, TaskError>
-WorkflowEngine::start_workflow(const std::string & /*story_text*/,
-                               const std::string &style, int scene_count) {
-  std::string trace_id = generate_uuid();
+void WorkflowEngine::set_workflow_plan(std::shared_ptr<const WorkflowPlan> plan) {
+  std::atomic_store(&plan_, std::move(plan));
+}
+
+void WorkflowEngine::set_checkpoint_store(std::shared_ptr<IWorkflowCheckpointStore> store) {
+  std::atomic_store(&checkpoint_store_, std::move(store));
+}
 
-  if (!stage_factory_) {
+Result<std::string, TaskError>
+WorkflowEngine::start_workflow(const std::string &story_text,
+                               const std::string &style, int scene_count,
+                               WorkflowClass workflow_class) {
+  const auto arrived_at = std::chrono::steady_clock::now();
+  std::string trace_id = new_id_string();
+
+  const auto stage_factory = std::atomic_load(&stage_factory_);
+  if (!stage_factory || !*stage_factory) {
     return Result<std::string, TaskError>::Err(
         TaskError::Internal("Stage factory is not configured"));
   }
@@ -48,120 +94,341 @@ WorkflowEngine::start_workflow(const std::string & /*story_text*/,
         TaskError::Internal("scene_count must be > 0"));
   }
 
+  const auto plan = std::atomic_load(&plan_);
+  if (!plan) {
+    return Result<std::string, TaskError>::Err(
+        TaskError::Internal("Workflow plan is not configured"));
+  }
+
   if (logger_) {
     logger_->info(trace_id, "orchestrator", "workflow_start",
                   "Starting workflow: scenes=" + std::to_string(scene_count) +
                       " style=" + style);
   }
 
-  // Shared cancel token for the entire workflow
+  // Workflow-level token; every task gets its own child so one task (or one
+  // hedged execution) can be canceled without tearing down the workflow.
   auto workflow_cancel = CancelToken::create();
 
-  WorkflowState wf;
-  wf.trace_id = trace_id;
-  wf.total = 0;
+  // ---- Stamp out the DAG from the compiled plan ----
+  // The default plan is Storyboard → per scene {ImageGen → VideoClip, TTS}
+  // → Compose (segment) → Concat. Scenes are independent after the
+  // storyboard, so early segments finish while later scenes still render.
+  const std::unordered_map<std::string, std::any> workflow_inputs{
+      {"story_text", story_text}, {"style", style}, {"scene_count", scene_count}};
+  auto tasks = plan->instantiate(trace_id, scene_count, workflow_inputs);
+  TaskChain chain;
+  chain.reserve(tasks.size());
+  for (auto &task : tasks) {
+    task.cancel_token = workflow_cancel->create_child();
+    auto stage = (*stage_factory)(task.type);
+    chain.emplace_back(std::move(task), std::move(stage));
+  }
 
-  auto rollback_submitted = [&wf, this]() {
-    for (const auto &task_id : wf.task_ids) {
-      (void)scheduler_->cancel(task_id); // Best-effort rollback
+  // The task list is fixed from here on, so other threads only read it.
+  auto wf = std::make_shared<WorkflowState>();
+  wf->trace_id = trace_id;
+  wf->cancel_token = workflow_cancel;
+  wf->total = static_cast<int>(chain.size());
+  for (const auto &entry : chain) {
+    wf->task_ids.push_back(entry.first.task_id);
+  }
+  wf->sink_task_id = find_sink(
+      chain, [](const auto &entry) { return entry.first.task_id; },
+      [](const auto &entry) { return entry.first.deps; });
+
+  auto enqueued = enqueue_workflow(
+      PendingWorkflow{wf, std::move(chain), arrived_at, nullptr}, workflow_class);
+  if (enqueued.is_err()) {
+    return Result<std::string, TaskError>::Err(enqueued.error());
+  }
+
+  if (logger_) {
+    logger_->info(trace_id, "orchestrator", "workflow_created",
+                  "Tasks created: " + std::to_string(wf->total) + " (template=" +
+                      plan->name() + ", scenes=" + std::to_string(scene_count) + ")");
+  }
+
+  return Result<std::string, TaskError>::Ok(std::move(trace_id));
+}
+
+Result<void, TaskError>
+WorkflowEngine::enqueue_workflow(PendingWorkflow pending, WorkflowClass workflow_class) {
+  const auto wf = pending.wf;
+  for (auto &entry : pending.chain) {
+    entry.first.qos = workflow_class;
+  }
+  // Admitted workflows (ours and any that were waiting behind capacity we
+  // did not take) are submitted after the lock is released.
+  std::vector<PendingWorkflow> admitted;
+  bool queued = false;
+  {
+    std::unique_lock<std::mutex> lock(admission_mutex_);
+    auto has_room = [&] {
+      return pending_count_.load() < admission_.max_pending ||
+             (pending_count_.load() == 0 && can_admit_locked(wf->total));
+    };
+    if (!has_room()) {
+      bool room = false;
+      if (admission_.on_full == WorkflowAdmissionPolicy::OnFull::Block) {
+        blocked_callers_.fetch_add(1);
+        if (admission_.block_timeout_ms > 0) {
+          room = admission_cv_.wait_for(
+              lock, std::chrono::milliseconds(admission_.block_timeout_ms), has_room);
+        } else {
+          admission_cv_.wait(lock, has_room);
+          room = true;
+        }
+        blocked_callers_.fetch_sub(1);
+      }
+      if (!room) {
+        ++admission_stats_.rejected;
+        lock.unlock();
+        if (logger_) {
+          logger_->warn(wf->trace_id, "orchestrator", "workflow_rejected",
+                        "Admission queue full: pending=" +
+                            std::to_string(pending_count_.load()));
+        }
+        return Result<void, TaskError>::Err(TaskError(
+            ErrorCategory::Resource, 3002, true, "Too many workflows in progress",
+            "workflow admission queue is full", {
+                {"max_pending", std::to_string(admission_.max_pending)},
+                {"active_workflows", std::to_string(active_workflows_.load())},
+            }));
+      }
+    }
+    auto &queue = pending_[static_cast<size_t>(workflow_class)];
+    queue.push_back(std::move(pending));
+    pending_count_.fetch_add(1);
+    drain_pending_locked(admitted);
+    queued = std::any_of(queue.begin(), queue.end(),
+                         [&](const PendingWorkflow &p) { return p.wf == wf; });
+    if (queued) {
+      ++admission_stats_.queued;
     }
-  };
+  }
+
+  if (queued && logger_) {
+    logger_->info(wf->trace_id, "orchestrator", "workflow_queued",
+                  "Waiting for admission: active_workflows=" +
+                      std::to_string(active_workflows_.load()) +
+                      " active_tasks=" + std::to_string(active_tasks_.load()));
+  }
 
-  auto submit_task = [this, &rollback_submitted, &trace_id](
-                         TaskDescriptor task, std::shared_ptr<IStage> stage)
-      -> Result<void, TaskError> {
-    auto submit_result = scheduler_->submit(std::move(task), std::move(stage));
+  // Our own submit failure is returned to the caller instead of a
+  // completion callback.
+  auto own = std::find_if(admitted.begin(), admitted.end(),
+                          [&](const PendingWorkflow &p) { return p.wf == wf; });
+  Result<void, TaskError> own_launch = Result<void, TaskError>::Ok();
+  if (own != admitted.end()) {
+    own_launch = launch_workflow(*own);
+    admitted.erase(own);
+  }
+  launch_admitted(admitted);
+  return own_launch;
+}
+
+bool WorkflowEngine::is_pending(const std::string &trace_id) const {
+  std::lock_guard<std::mutex> lock(admission_mutex_);
+  return std::any_of(pending_.begin(), pending_.end(), [&](const auto &queue) {
+    return std::any_of(queue.begin(), queue.end(), [&](const PendingWorkflow &p) {
+      return p.wf->trace_id == trace_id;
+    });
+  });
+}
+
+bool WorkflowEngine::can_admit_locked(int task_count) const {
+  const int active_workflows = active_workflows_.load();
+  if (active_workflows == 0) {
+    return true; // Never starve a workflow larger than the task cap
+  }
+  if (admission_.max_active_workflows > 0 &&
+      active_workflows >= admission_.max_active_workflows) {
+    return false;
+  }
+  return admission_.max_active_tasks <= 0 ||
+         active_tasks_.load() + task_count <= admission_.max_active_tasks;
+}
+
+void WorkflowEngine::admit_locked(PendingWorkflow &pending,
+                                  std::vector<PendingWorkflow> &admitted) {
+  active_workflows_.fetch_add(1);
+  active_tasks_.fetch_add(pending.wf->total);
+  pending_count_.fetch_sub(1);
+
+  const auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - pending.arrived_at);
+  const auto waited_ms = static_cast<uint64_t>(std::max<int64_t>(0, waited.count()));
+  ++admission_stats_.admitted;
+  admission_stats_.queue_wait_ms_total += waited_ms;
+  admission_stats_.queue_wait_ms_max =
+      std::max(admission_stats_.queue_wait_ms_max, waited_ms);
+  admitted.push_back(std::move(pending));
+}
+
+void WorkflowEngine::drain_pending_locked(std::vector<PendingWorkflow> &admitted) {
+  // Strict class order, FIFO within a class: the head of the highest
+  // non-empty class must fit before anything behind it is considered, so a
+  // large workflow cannot be starved by a stream of small ones.
+  const size_t before = admitted.size();
+  for (auto &queue : pending_) {
+    while (!queue.empty() && can_admit_locked(queue.front().wf->total)) {
+      admit_locked(queue.front(), admitted);
+      queue.pop_front();
+    }
+    if (!queue.empty()) {
+      break;
+    }
+  }
+  if (admitted.size() != before) {
+    admission_cv_.notify_all();
+  }
+}
+
+void WorkflowEngine::begin_checkpoint(PendingWorkflow &pending) {
+  auto store = std::atomic_load(&checkpoint_store_);
+  if (!store) {
+    return;
+  }
+  const auto &wf = pending.wf;
+  WorkflowManifest built;
+  const WorkflowManifest *manifest = pending.manifest.get();
+  if (!manifest) {
+    built.trace_id = wf->trace_id;
+    built.tasks.reserve(pending.chain.size());
+    for (const auto &[task, stage] : pending.chain) {
+      WorkflowManifest::Task entry;
+      entry.task_id = task.task_id;
+      entry.type = task.type;
+      entry.priority = task.priority;
+      entry.resource_demand = task.resource_demand;
+      entry.pin_resource_demand = task.pin_resource_demand;
+      entry.deps = task.deps;
+      entry.inputs = task.inputs;
+      built.tasks.push_back(std::move(entry));
+    }
+    manifest = &built;
+  }
+  auto begun = store->begin(*manifest);
+  if (begun.is_ok()) {
+    wf->checkpoint = std::move(store);
+  } else if (logger_) {
+    // Checkpointing is best-effort; the workflow runs without it.
+    logger_->warn(wf->trace_id, "orchestrator", "checkpoint_disabled",
+                  begun.error().internal_message);
+  }
+}
+
+Result<void, TaskError> WorkflowEngine::launch_workflow(PendingWorkflow &pending) {
+  // The manifest is on disk before any task can succeed, and registration
+  // precedes the first submit: a fast task may finish (and report) on a
+  // worker thread before the loop below is done.
+  const auto &wf = pending.wf;
+  begin_checkpoint(pending);
+  register_workflow(wf);
+
+  auto &chain = pending.chain;
+  for (size_t i = 0; i < chain.size(); ++i) {
+    auto submit_result =
+        scheduler_->submit(std::move(chain[i].first), std::move(chain[i].second));
     if (submit_result.is_err()) {
       if (logger_) {
-        logger_->error(trace_id, "orchestrator", "submit_failed",
+        logger_->error(wf->trace_id, "orchestrator", "submit_failed",
                        submit_result.error().internal_message);
       }
-      rollback_submitted();
+      unregister_workflow(wf);
+      for (size_t j = 0; j <= i; ++j) {
+        (void)scheduler_->cancel(wf->task_ids[j]); // Best-effort rollback
+      }
+      // Close the count so late events neither retire the workflow nor
+      // release its tasks a second time.
+      const int seen = wf->terminal.exchange(wf->total, std::memory_order_acq_rel);
+      release_admission(1, wf->total - std::min(seen, wf->total));
+      if (wf->checkpoint) {
+        // A fresh workflow was never visible; a resumed one keeps its progress.
+        wf->checkpoint->finish(wf->trace_id, wf->resumed);
+      }
       return Result<void, TaskError>::Err(submit_result.error());
     }
-    return Result<void, TaskError>::Ok();
-  };
-
-  // ---- Task 1: Storyboard Generation ----
-  TaskDescriptor storyboard_task;
-  storyboard_task.task_id = generate_uuid();
-  storyboard_task.trace_id = trace_id;
-  storyboard_task.type = TaskType::Storyboard;
-  storyboard_task.priority = 100; // Highest priority
-  storyboard_task.cancel_token = workflow_cancel;
-  // No deps — starts immediately
-  wf.task_ids.push_back(storyboard_task.task_id);
-  wf.total++;
-
-  auto storyboard_stage = stage_factory_(TaskType::Storyboard);
-  auto storyboard_submit =
-      submit_task(std::move(storyboard_task), storyboard_stage);
-  if (storyboard_submit.is_err()) {
-    return Result<std::string, TaskError>::Err(storyboard_submit.error());
-  }
-
-  // ---- Tasks 2..N+1: Image Generation (one per scene) ----
-  std::vector<std::string> image_task_ids;
-  for (int i = 0; i < scene_count; ++i) {
-    TaskDescriptor img_task;
-    img_task.task_id = generate_uuid();
-    img_task.trace_id = trace_id;
-    img_task.type = TaskType::ImageGen;
-    img_task.priority = 50;
-    img_task.cancel_token = workflow_cancel;
-    img_task.deps = {wf.task_ids[0]}; // Depends on storyboard
-
-    image_task_ids.push_back(img_task.task_id);
-    wf.task_ids.push_back(img_task.task_id);
-    wf.total++;
-
-    auto img_stage = stage_factory_(TaskType::ImageGen);
-    auto img_submit = submit_task(std::move(img_task), img_stage);
-    if (img_submit.is_err()) {
-      return Result<std::string, TaskError>::Err(img_submit.error());
-    }
-  }
-
-  // ---- Task N+2: Compose (depends on all image tasks) ----
-  TaskDescriptor compose_task;
-  compose_task.task_id = generate_uuid();
-  compose_task.trace_id = trace_id;
-  compose_task.type = TaskType::Compose;
-  compose_task.priority = 10;
-  compose_task.cancel_token = workflow_cancel;
-  compose_task.deps = image_task_ids; // Depends on all images
-
-  wf.task_ids.push_back(compose_task.task_id);
-  wf.total++;
-
-  auto compose_stage = stage_factory_(TaskType::Compose);
-  auto compose_submit = submit_task(std::move(compose_task), compose_stage);
-  if (compose_submit.is_err()) {
-    return Result<std::string, TaskError>::Err(compose_submit.error());
-  }
-
-  const int total_tasks = wf.total;
-  active_workflows_.push_back(std::move(wf));
+  }
+  chain.clear();
+  return Result<void, TaskError>::Ok();
+}
 
-  if (logger_) {
-    logger_->info(trace_id, "orchestrator", "workflow_created",
-                  "Tasks created: " + std::to_string(total_tasks) +
-                      " (1 storyboard + " + std::to_string(scene_count) +
-                      " images + 1 compose)");
+void WorkflowEngine::launch_admitted(std::vector<PendingWorkflow> &admitted) {
+  for (auto &pending : admitted) {
+    if (launch_workflow(pending).is_err()) {
+      if (auto completion_cb = std::atomic_load(&completion_cb_);
+          completion_cb && *completion_cb) {
+        (*completion_cb)(pending.wf->trace_id, false, "");
+      }
+    }
   }
+}
 
-  return Result<std::string, TaskError>::Ok(std::move(trace_id));
+void WorkflowEngine::release_admission(int workflows, int tasks) {
+  active_tasks_.fetch_sub(tasks);
+  active_workflows_.fetch_sub(workflows);
+  // Pairs with the seq_cst increments done under the lock: either a waiter
+  // is visible here, or it sees the freed capacity before it sleeps.
+  if (pending_count_.load() == 0 && blocked_callers_.load() == 0) {
+    return;
+  }
+  std::vector<PendingWorkflow> admitted;
+  {
+    std::lock_guard<std::mutex> lock(admission_mutex_);
+    drain_pending_locked(admitted);
+    admission_cv_.notify_all(); // Block mode with an empty queue
+  }
+  launch_admitted(admitted);
+}
+
+WorkflowAdmissionMetrics WorkflowEngine::admission_metrics() const {
+  std::lock_guard<std::mutex> lock(admission_mutex_);
+  WorkflowAdmissionMetrics metrics = admission_stats_;
+  metrics.active_workflows = active_workflows_.load();
+  metrics.active_tasks = active_tasks_.load();
+  for (size_t i = 0; i < pending_.size(); ++i) {
+    metrics.pending[i] = static_cast<int>(pending_[i].size());
+  }
+  return metrics;
 }
 
+
 Result<void, TaskError>
 WorkflowEngine::cancel_workflow(const std::string &trace_id) {
-  auto it = std::find_if(
-      active_workflows_.begin(), active_workflows_.end(),
-      [&trace_id](const WorkflowState &wf) { return wf.trace_id == trace_id; });
-
-  if (it == active_workflows_.end()) {
-    return Result<void, TaskError>::Err(
-        TaskError::Internal("Workflow not found: " + trace_id));
+  auto wf = find_workflow(trace_id);
+  if (!wf) {
+    // Still waiting for admission: nothing was submitted, just drop it.
+    bool dropped = false;
+    {
+      std::lock_guard<std::mutex> lock(admission_mutex_);
+      for (auto &queue : pending_) {
+        auto it = std::find_if(queue.begin(), queue.end(), [&](const PendingWorkflow &p) {
+          return p.wf->trace_id == trace_id;
+        });
+        if (it != queue.end()) {
+          queue.erase(it);
+          pending_count_.fetch_sub(1);
+          admission_cv_.notify_all();
+          dropped = true;
+          break;
+        }
+      }
+    }
+    if (!dropped) {
+      return Result<void, TaskError>::Err(
+          TaskError::Internal("Workflow not found: " + trace_id));
+    }
+    if (logger_) {
+      logger_->info(trace_id, "orchestrator", "workflow_cancel",
+                    "Canceled while pending admission");
+    }
+    if (auto completion_cb = std::atomic_load(&completion_cb_);
+        completion_cb && *completion_cb) {
+      (*completion_cb)(trace_id, false, "");
+    }
+    return Result<void, TaskError>::Ok();
   }
 
   if (logger_) {
@@ -169,79 +436,268 @@ WorkflowEngine::cancel_workflow(const std::string &trace_id) {
                   "Canceling workflow");
   }
 
-  for (const auto &task_id : it->task_ids) {
+  // Signal every running stage at once, then settle task states. Runs without
+  // engine locks: scheduler->cancel() re-enters handle_task_event.
+  wf->cancel_token->request_cancel();
+  for (const auto &task_id : wf->task_ids) {
     scheduler_->cancel(task_id); // Best-effort cancel
   }
 
   return Result<void, TaskError>::Ok();
 }
 
-void WorkflowEngine::handle_state_change(const std::string &task_id,
-                                         TaskState state, float progress) {
-  // Find which workflow this task belongs to
-  for (auto &wf : active_workflows_) {
-    auto task_it = std::find(wf.task_ids.begin(), wf.task_ids.end(), task_id);
-    if (task_it == wf.task_ids.end())
-      continue;
+Result<void, TaskError>
+WorkflowEngine::resume_workflow(const std::string &trace_id, WorkflowClass workflow_class) {
+  const auto arrived_at = std::chrono::steady_clock::now();
+  auto store = std::atomic_load(&checkpoint_store_);
+  if (!store) {
+    return Result<void, TaskError>::Err(
+        TaskError::Internal("Workflow checkpointing is not configured"));
+  }
+  if (find_workflow(trace_id) || is_pending(trace_id)) {
+    return Result<void, TaskError>::Err(
+        TaskError::Internal("Workflow is still running: " + trace_id));
+  }
+  const auto stage_factory = std::atomic_load(&stage_factory_);
+  if (!stage_factory || !*stage_factory) {
+    return Result<void, TaskError>::Err(
+        TaskError::Internal("Stage factory is not configured"));
+  }
 
-    // Forward per-task progress
-    if (progress_cb_) {
-      progress_cb_(wf.trace_id, task_id, state, progress);
+  auto loaded = store->load(trace_id);
+  if (loaded.is_err()) {
+    return Result<void, TaskError>::Err(loaded.error());
+  }
+  auto manifest = std::make_shared<WorkflowManifest>(std::move(loaded.value()));
+  manifest->generation += 1;
+  // The scheduler may still hold finished task ids, so each run submits
+  // fresh ones.
+  const std::string suffix = ".r" + std::to_string(manifest->generation);
+
+  // Recorded outputs may name files evicted since (artifact cache): those
+  // tasks run again instead of handing missing files to their successors.
+  int stale = 0;
+  for (auto &entry : manifest->tasks) {
+    if (entry.succeeded && !(*stage_factory)(entry.type)->outputs_reusable(entry.outputs)) {
+      entry.succeeded = false;
+      entry.outputs.clear();
+      ++stale;
     }
+  }
+  if (stale > 0 && logger_) {
+    logger_->warn(trace_id, "orchestrator", "checkpoint_outputs_stale",
+                  std::to_string(stale) + " finished tasks lost their outputs and will re-run");
+  }
 
-    if (logger_) {
-      logger_->info(wf.trace_id, "orchestrator", "task_state_changed",
-                    "task_id=" + task_id + " state=" + to_string(state) +
-                        " progress=" + std::to_string(progress));
+  std::unordered_map<std::string, size_t> index;
+  for (size_t i = 0; i < manifest->tasks.size(); ++i) {
+    index.emplace(manifest->tasks[i].task_id, i);
+  }
+
+  auto workflow_cancel = CancelToken::create();
+  auto wf = std::make_shared<WorkflowState>();
+  wf->trace_id = trace_id;
+  wf->cancel_token = workflow_cancel;
+  wf->resumed = true;
+  const std::string sink_id = find_sink(
+      manifest->tasks, [](const auto &entry) { return entry.task_id; },
+      [](const auto &entry) { return entry.deps; });
+
+  // Manifest order is the submission order of the first run, so every
+  // unfinished dependency is submitted before its dependents.
+  TaskChain chain;
+  for (const auto &entry : manifest->tasks) {
+    if (entry.succeeded) {
+      if (entry.task_id == sink_id) {
+        wf->output_path = video_path_of(entry.outputs); // Finished before
+      }
+      continue;
+    }
+    if (entry.task_id == sink_id) {
+      wf->sink_task_id = entry.task_id + suffix;
     }
+    TaskDescriptor task;
+    task.task_id = entry.task_id + suffix;
+    task.trace_id = trace_id;
+    task.type = entry.type;
+    task.priority = entry.priority;
+    task.resource_demand = entry.resource_demand;
+    task.pin_resource_demand = entry.pin_resource_demand;
+    for (const auto &dep : entry.deps) {
+      auto dep_it = index.find(dep);
+      if (dep_it == index.end()) {
+        return Result<void, TaskError>::Err(
+            TaskError::Internal("Checkpoint of " + trace_id + " has unknown dependency " + dep));
+      }
+      const auto &dep_entry = manifest->tasks[dep_it->second];
+      if (dep_entry.succeeded) {
+        // Satisfied: its outputs become inputs, as the scheduler would merge them.
+        for (const auto &[key, value] : dep_entry.outputs) {
+          task.inputs[key] = value;
+        }
+      } else {
+        task.deps.push_back(dep + suffix);
+      }
+    }
+    for (const auto &[key, value] : entry.inputs) {
+      task.inputs[key] = value; // Static inputs win, as at run time
+    }
+    task.cancel_token = workflow_cancel->create_child();
+    wf->manifest_ids.emplace(task.task_id, entry.task_id);
+    wf->task_ids.push_back(task.task_id);
+    auto stage = (*stage_factory)(task.type);
+    chain.emplace_back(std::move(task), std::move(stage));
+  }
+  wf->total = static_cast<int>(chain.size());
 
-    if (state == TaskState::Succeeded) {
-      wf.completed++;
-    } else if (state == TaskState::Failed || state == TaskState::Canceled) {
-      wf.failed = true;
+  if (logger_) {
+    logger_->info(trace_id, "orchestrator", "workflow_resume",
+                  "Resuming: " + std::to_string(wf->total) + " of " +
+                      std::to_string(manifest->tasks.size()) + " tasks left (generation " +
+                      std::to_string(manifest->generation) + ")");
+  }
+  if (chain.empty()) {
+    // Everything succeeded before the interruption; only the report is left.
+    wf->checkpoint = std::move(store);
+    retire_workflow(wf);
+    return Result<void, TaskError>::Ok();
+  }
+  return enqueue_workflow(
+      PendingWorkflow{wf, std::move(chain), arrived_at, std::move(manifest)}, workflow_class);
+}
+
+WorkflowEngine::Shard &WorkflowEngine::shard_for(const std::string &key) {
+  return shards_[std::hash<std::string>{}(key) % kShardCount];
+}
+
+void WorkflowEngine::register_workflow(const std::shared_ptr<WorkflowState> &wf) {
+  for (const auto &task_id : wf->task_ids) {
+    auto &shard = shard_for(task_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.tasks.emplace(task_id, wf);
+  }
+  auto &shard = shard_for(wf->trace_id);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  shard.workflows.emplace(wf->trace_id, wf);
+}
+
+void WorkflowEngine::unregister_workflow(const std::shared_ptr<WorkflowState> &wf) {
+  {
+    auto &shard = shard_for(wf->trace_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.workflows.erase(wf->trace_id);
+  }
+  for (const auto &task_id : wf->task_ids) {
+    auto &shard = shard_for(task_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.tasks.erase(task_id);
+  }
+}
+
+std::shared_ptr<WorkflowEngine::WorkflowState>
+WorkflowEngine::find_workflow(const std::string &trace_id) {
+  auto &shard = shard_for(trace_id);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.workflows.find(trace_id);
+  return it == shard.workflows.end() ? nullptr : it->second;
+}
+
+void WorkflowEngine::handle_task_event(const TaskEvent &event) {
+  const std::string &task_id = event.task_id;
+  const TaskState state = event.state;
+  const float progress = event.progress;
+  // O(1) lookup of the owning workflow. A terminal state removes the entry
+  // under the shard lock, so each task is counted exactly once.
+  std::shared_ptr<WorkflowState> wf;
+  {
+    auto &shard = shard_for(task_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto task_it = shard.tasks.find(task_id);
+    if (task_it == shard.tasks.end()) {
+      return;
     }
+    wf = task_it->second;
+    if (is_terminal(state)) {
+      shard.tasks.erase(task_it);
+    }
+  }
 
-    // Check workflow completion
-    if (wf.completed == wf.total) {
-      // All tasks succeeded
-      wf.output_path = "/tmp/stv_mock/final_output.mp4";
-      if (completion_cb_) {
-        completion_cb_(wf.trace_id, true, wf.output_path);
-      }
-      if (logger_) {
-        logger_->info(wf.trace_id, "orchestrator", "workflow_completed",
-                      "All tasks succeeded. Output: " + wf.output_path);
+  // Forward per-task progress
+  if (auto progress_cb = std::atomic_load(&progress_cb_); progress_cb && *progress_cb) {
+    (*progress_cb)(wf->trace_id, task_id, state, progress);
+  }
+
+  if (logger_) {
+    logger_->info(wf->trace_id, "orchestrator", "task_state_changed",
+                  "task_id=" + task_id + " state=" + to_string(state) +
+                      " progress=" + std::to_string(progress));
+  }
+
+  if (!is_terminal(state)) {
+    return;
+  }
+
+  if (state == TaskState::Succeeded) {
+    // Checkpoint before counting, so it lands before the workflow retires.
+    if (wf->checkpoint && event.outputs) {
+      const auto id_it = wf->manifest_ids.find(task_id);
+      const std::string &manifest_id =
+          id_it == wf->manifest_ids.end() ? task_id : id_it->second;
+      if (!wf->checkpoint->record(wf->trace_id, manifest_id, *event.outputs) && logger_) {
+        logger_->warn(wf->trace_id, "orchestrator", "checkpoint_skipped",
+                      "task_id=" + task_id + " will re-run on resume");
       }
-    } else if (wf.failed && !is_terminal(state)) {
-      // A task failed — workflow is done
-    } else if (wf.failed && is_terminal(state)) {
-      // All tasks terminal — workflow failed
-      // For now, let the next tick handle cleanup
-    }
-
-    return; // Found the workflow
-  }
-}
-
-std::string WorkflowEngine::generate_uuid() {
-  static std::random_device rd;
-  static std::mt19937 gen(rd());
-  static std::uniform_int_distribution<uint32_t> dis;
-
-  std::stringstream ss;
-  ss << std::hex;
-  ss << ((dis(gen) & 0xFFFF0000) | 0x0000FFFF);
-  ss << "-";
-  ss << (dis(gen) & 0xFFFF);
-  ss << "-4"; // Version 4
-  ss << (dis(gen) & 0x0FFF);
-  ss << "-";
-  ss << ((dis(gen) & 0x3FFF) | 0x8000);
-  ss << "-";
-  ss << (dis(gen) & 0xFFFF);
-  ss << (dis(gen) & 0xFFFF);
-  ss << (dis(gen) & 0xFFFF);
-  return ss.str();
+    }
+    if (task_id == wf->sink_task_id && event.outputs) {
+      wf->output_path = video_path_of(*event.outputs);
+    }
+    wf->completed.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    wf->failed.store(true, std::memory_order_relaxed);
+  }
+  // acq_rel: the thread that counts the last task sees every other update.
+  const int previous = wf->terminal.fetch_add(1, std::memory_order_acq_rel);
+  if (previous >= wf->total) {
+    return; // Submission failed and already released this workflow
+  }
+  const bool last = previous + 1 == wf->total;
+  // Capacity goes back before the completion callback runs, so a callback
+  // that starts the next workflow is not held up by this one.
+  release_admission(last ? 1 : 0, 1);
+  if (last) {
+    retire_workflow(wf);
+  }
+}
+
+void WorkflowEngine::retire_workflow(const std::shared_ptr<WorkflowState> &wf) {
+  {
+    auto &shard = shard_for(wf->trace_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.workflows.erase(wf->trace_id);
+  }
+
+  const bool success = !wf->failed.load(std::memory_order_relaxed) &&
+                       wf->completed.load(std::memory_order_relaxed) == wf->total;
+  const std::string output_path = success ? wf->output_path : "";
+  if (wf->checkpoint) {
+    wf->checkpoint->finish(wf->trace_id, !success); // Keep for resume_workflow()
+  }
+  scheduler_->forget(wf->trace_id); // Frees the finished tasks
+  if (logger_) {
+    if (success) {
+      logger_->info(wf->trace_id, "orchestrator", "workflow_completed",
+                    "All tasks succeeded. Output: " + output_path);
+    } else {
+      logger_->warn(wf->trace_id, "orchestrator", "workflow_failed",
+                    "Workflow finished with " +
+                        std::to_string(wf->total - wf->completed.load()) +
+                        " failed or canceled tasks");
+    }
+  }
+  if (auto completion_cb = std::atomic_load(&completion_cb_);
+      completion_cb && *completion_cb) {
+    (*completion_cb)(wf->trace_id, success, output_path);
+  }
 }
 
 } // namespace stv::core
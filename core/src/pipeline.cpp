@@ -1,12 +1,39 @@
 #include "core/pipeline.h"
+#include "core/sha256.h"
 #include "core/task.h"
 
 #include <chrono>
+#include <sstream>
 #include <thread>
 #include <vector>
 
 namespace stv::core {
 
+namespace {
+
+/// Short content digest, so mock artifact paths change exactly when the
+/// inputs they were "rendered" from change (keeps memoized chains honest).
+std::string content_tag(const std::string &content) {
+  return sha256_hex(content).substr(0, 8);
+}
+
+/// Per-scene storyboard key, e.g. scene_prompt_2.
+std::string scene_key(const std::string &base, const StageContext &ctx) {
+  return base + "_" + std::to_string(ctx.get_input<int>("scene_index", 0));
+}
+
+/// Direct input `key`, falling back to the storyboard's per-scene value.
+std::string input_or_scene(const StageContext &ctx, const std::string &key,
+                           const std::string &scene_base) {
+  auto value = ctx.get_input<std::string>(key, "");
+  if (value.empty()) {
+    value = ctx.get_input<std::string>(scene_key(scene_base, ctx), "");
+  }
+  return value;
+}
+
+} // namespace
+
 // ============================================================
 // Mock Pipeline Stages (M1)
 // These simulate real work with sleep + progress updates.
@@ -14,9 +41,11 @@ namespace stv::core {
 // ============================================================
 
 /// Mock storyboard generation: takes story_text, outputs scene list.
+/// Line i of story_text becomes scene i (prompt and narration).
 class MockStoryboardStage : public IStage {
 public:
   std::string name() const override { return "MockStoryboard"; }
+  std::string version() const override { return "1"; }
 
   Result<void, TaskError> execute(StageContext &ctx) override {
     // Simulate LLM processing (500ms with progress)
@@ -33,9 +62,21 @@ public:
 
     // Produce mock scene prompts
     int scene_count = ctx.get_input<int>("scene_count", 4);
+    std::vector<std::string> lines;
+    std::istringstream story(ctx.get_input<std::string>("story_text", ""));
+    for (std::string line; std::getline(story, line);) {
+      if (!line.empty()) {
+        lines.push_back(line);
+      }
+    }
     std::vector<std::string> scenes;
     for (int i = 0; i < scene_count; ++i) {
-      scenes.push_back("mock_scene_prompt_" + std::to_string(i + 1));
+      const auto index = static_cast<size_t>(i);
+      scenes.push_back(index < lines.size()
+                           ? lines[index]
+                           : "mock_scene_prompt_" + std::to_string(i + 1));
+      ctx.set_output("scene_prompt_" + std::to_string(i), scenes.back());
+      ctx.set_output("scene_narration_" + std::to_string(i), scenes.back());
     }
     ctx.set_output("scenes", scenes);
     ctx.set_output("storyboard_json", std::string("{\"scenes\": [\"mock\"]}"));
@@ -48,6 +89,12 @@ public:
 class MockImageGenStage : public IStage {
 public:
   std::string name() const override { return "MockImageGen"; }
+  std::string version() const override { return "1"; }
+
+  std::vector<std::string> memo_inputs(const StageContext &ctx) const override {
+    return {"prompt", scene_key("scene_prompt", ctx), "scene_index", "width",
+            "height", "num_inference_steps"};
+  }
 
   Result<void, TaskError> execute(StageContext &ctx) override {
     // Simulate SD inference (300ms)
@@ -64,17 +111,84 @@ public:
 
     int scene_index = ctx.get_input<int>("scene_index", 0);
     std::string mock_path =
-        "/tmp/stv_mock/frame_" + std::to_string(scene_index) + ".png";
+        "/tmp/stv_mock/frame_" + std::to_string(scene_index) + "_" +
+        content_tag(input_or_scene(ctx, "prompt", "scene_prompt")) + ".png";
     ctx.set_output("image_path", mock_path);
 
     return Result<void, TaskError>::Ok();
   }
 };
 
-/// Mock video composition: simulates FFmpeg assembly.
+/// Mock narration: one audio track per scene.
+class MockTtsStage : public IStage {
+public:
+  std::string name() const override { return "MockTts"; }
+  std::string version() const override { return "1"; }
+
+  std::vector<std::string> memo_inputs(const StageContext &ctx) const override {
+    return {"text", scene_key("scene_narration", ctx), "scene_index"};
+  }
+
+  Result<void, TaskError> execute(StageContext &ctx) override {
+    // Simulate speech synthesis (200ms)
+    const int steps = 2;
+    for (int i = 0; i < steps; ++i) {
+      if (ctx.cancel_token && ctx.cancel_token->is_canceled()) {
+        return Result<void, TaskError>::Err(TaskError::Canceled());
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      if (ctx.on_progress) {
+        ctx.on_progress(static_cast<float>(i + 1) / steps);
+      }
+    }
+
+    int scene_index = ctx.get_input<int>("scene_index", 0);
+    ctx.set_output("audio_path",
+                   "/tmp/stv_mock/narration_" + std::to_string(scene_index) +
+                       "_" +
+                       content_tag(input_or_scene(ctx, "text", "scene_narration")) +
+                       ".wav");
+    ctx.set_output("duration_seconds", 4.0f);
+
+    return Result<void, TaskError>::Ok();
+  }
+};
+
+/// Mock image-to-video: turns a scene still into a short clip.
+class MockVideoClipStage : public IStage {
+public:
+  std::string name() const override { return "MockVideoClip"; }
+  std::string version() const override { return "1"; }
+
+  Result<void, TaskError> execute(StageContext &ctx) override {
+    // Simulate clip rendering (200ms)
+    const int steps = 2;
+    for (int i = 0; i < steps; ++i) {
+      if (ctx.cancel_token && ctx.cancel_token->is_canceled()) {
+        return Result<void, TaskError>::Err(TaskError::Canceled());
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      if (ctx.on_progress) {
+        ctx.on_progress(static_cast<float>(i + 1) / steps);
+      }
+    }
+
+    int scene_index = ctx.get_input<int>("scene_index", 0);
+    ctx.set_output("clip_path",
+                   "/tmp/stv_mock/clip_" + std::to_string(scene_index) + "_" +
+                       content_tag(ctx.get_input<std::string>("image_path", "")) +
+                       ".mp4");
+
+    return Result<void, TaskError>::Ok();
+  }
+};
+
+/// Mock video composition: simulates FFmpeg assembly. With a scene_index
+/// input it composes one scene segment, otherwise the final video.
 class MockComposeStage : public IStage {
 public:
   std::string name() const override { return "MockCompose"; }
+  std::string version() const override { return "1"; }
 
   Result<void, TaskError> execute(StageContext &ctx) override {
     // Simulate FFmpeg composition (500ms)
@@ -89,8 +203,20 @@ public:
       }
     }
 
+    if (ctx.inputs.count("scene_index") > 0) {
+      const int scene_index = ctx.get_input<int>("scene_index", 0);
+      const auto tag =
+          content_tag(ctx.get_input<std::string>("clip_path", "") + "|" +
+                      ctx.get_input<std::string>("audio_path", ""));
+      ctx.set_output("segment_path_" + std::to_string(scene_index),
+                     "/tmp/stv_mock/segment_" + std::to_string(scene_index) +
+                         "_" + tag + ".mp4");
+      return Result<void, TaskError>::Ok();
+    }
+
     std::string output_path = "/tmp/stv_mock/final_output.mp4";
     ctx.set_output("output_path", output_path);
+    ctx.set_output("video_path", output_path); // Same key as the real stages
 
     return Result<void, TaskError>::Ok();
   }
@@ -105,12 +231,12 @@ std::shared_ptr<IStage> create_mock_stage(TaskType type) {
   case TaskType::ImageGen:
     return std::make_shared<MockImageGenStage>();
   case TaskType::Compose:
+  case TaskType::Concat:
     return std::make_shared<MockComposeStage>();
   case TaskType::TTS:
-    // M1: TTS not implemented, use a pass-through
-    return std::make_shared<MockStoryboardStage>();
+    return std::make_shared<MockTtsStage>();
   case TaskType::VideoClip:
-    return std::make_shared<MockImageGenStage>();
+    return std::make_shared<MockVideoClipStage>();
   }
   return std::make_shared<MockStoryboardStage>();
 }
@@ -0,0 +1,255 @@
+#include "core/runtime_estimator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+namespace stv::core {
+
+namespace {
+
+std::optional<std::string> render_feature(const std::any &value) {
+  if (const auto *v = std::any_cast<int>(&value)) {
+    return std::to_string(*v);
+  }
+  if (const auto *v = std::any_cast<float>(&value)) {
+    return std::to_string(*v);
+  }
+  if (const auto *v = std::any_cast<double>(&value)) {
+    return std::to_string(*v);
+  }
+  if (const auto *v = std::any_cast<bool>(&value)) {
+    return *v ? "1" : "0";
+  }
+  if (const auto *v = std::any_cast<std::string>(&value)) {
+    return *v;
+  }
+  return std::nullopt;
+}
+
+/// q-quantile of proj over the window, skipping unmeasured (negative)
+/// values. Sets `count` to the number of values used.
+template <typename T, typename Proj>
+T quantile(const std::deque<RuntimeObservation> &window, double q, Proj proj,
+           int *count = nullptr) {
+  std::vector<T> values;
+  values.reserve(window.size());
+  for (const auto &obs : window) {
+    const T value = proj(obs);
+    if (value >= T{}) {
+      values.push_back(value);
+    }
+  }
+  if (count) {
+    *count = static_cast<int>(values.size());
+  }
+  if (values.empty()) {
+    return T{};
+  }
+  const auto rank = static_cast<size_t>(
+      std::ceil(q * static_cast<double>(values.size())));
+  const auto index = std::min(values.size() - 1, rank == 0 ? 0 : rank - 1);
+  std::nth_element(values.begin(),
+                   values.begin() + static_cast<std::ptrdiff_t>(index),
+                   values.end());
+  return values[index];
+}
+
+// Keys are written verbatim in a TSV column.
+std::string sanitize(std::string text) {
+  std::replace_if(
+      text.begin(), text.end(),
+      [](char c) { return c == '\t' || c == '\n' || c == '\r'; }, ' ');
+  return text;
+}
+
+} // namespace
+
+RuntimeEstimator::RuntimeEstimator(std::string persist_path, double alpha,
+                                   size_t window)
+    : persist_path_(std::move(persist_path)),
+      alpha_(std::clamp(alpha, 0.01, 1.0)), window_(std::max<size_t>(1, window)),
+      feature_keys_{"width", "height", "num_inference_steps"} {}
+
+RuntimeEstimator::~RuntimeEstimator() {
+  if (dirty_) {
+    (void)save(); // Best-effort flush
+  }
+}
+
+void RuntimeEstimator::set_feature_keys(std::vector<std::string> keys) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  feature_keys_ = std::move(keys);
+}
+
+std::string RuntimeEstimator::make_key(
+    TaskType type, const std::string &stage_name,
+    const std::unordered_map<std::string, std::any> &inputs) const {
+  std::string key = std::string(to_string(type)) + "|" + stage_name + "|";
+  std::lock_guard<std::mutex> lock(mutex_);
+  bool first = true;
+  for (const auto &feature : feature_keys_) {
+    auto it = inputs.find(feature);
+    if (it == inputs.end()) {
+      continue;
+    }
+    if (auto rendered = render_feature(it->second)) {
+      key += (first ? "" : ",") + feature + "=" + *rendered;
+      first = false;
+    }
+  }
+  return sanitize(std::move(key));
+}
+
+void RuntimeEstimator::record(const std::string &key,
+                              const RuntimeObservation &observation) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto &entry = entries_[key];
+  entry.runtime_ms_ewma =
+      entry.samples == 0
+          ? observation.runtime_ms
+          : alpha_ * observation.runtime_ms + (1.0 - alpha_) * entry.runtime_ms_ewma;
+  entry.samples++;
+  entry.window.push_back(observation);
+  while (entry.window.size() > window_) {
+    entry.window.pop_front();
+  }
+  dirty_ = true;
+}
+
+std::optional<RuntimeEstimate>
+RuntimeEstimator::estimate(const std::string &key) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  if (it == entries_.end() || it->second.window.empty()) {
+    return std::nullopt;
+  }
+  const auto &entry = it->second;
+  RuntimeEstimate out;
+  out.samples = entry.samples;
+  out.runtime_ms_ewma = entry.runtime_ms_ewma;
+  out.runtime_ms_p50 = quantile<double>(
+      entry.window, 0.5, [](const RuntimeObservation &o) { return o.runtime_ms; });
+  out.runtime_ms_p90 = quantile<double>(
+      entry.window, 0.9, [](const RuntimeObservation &o) { return o.runtime_ms; });
+  out.rss_mb_p90 = quantile<int>(
+      entry.window, 0.9, [](const RuntimeObservation &o) { return o.peak_rss_mb; },
+      &out.rss_samples);
+  out.vram_mb_p90 = quantile<int>(
+      entry.window, 0.9, [](const RuntimeObservation &o) { return o.vram_mb; },
+      &out.vram_samples);
+  return out;
+}
+
+// File format: a version line, then one key per line, tab-separated:
+//   key  samples  runtime_ms_ewma  runtime_ms,rss_mb,vram_mb;...
+// Unversioned files predate unmeasured (-1) resources: their RSS was process
+// growth and their VRAM 0 when unreported, so only runtimes are kept.
+constexpr char kModelHeader[] = "#stv-runtime-model v2";
+
+Result<void, TaskError> RuntimeEstimator::load() {
+  if (persist_path_.empty()) {
+    return Result<void, TaskError>::Ok();
+  }
+  std::ifstream in(persist_path_);
+  if (!in) {
+    return Result<void, TaskError>::Ok();
+  }
+
+  std::unordered_map<std::string, Entry> loaded;
+  std::string line;
+  bool versioned = false;
+  while (std::getline(in, line)) {
+    if (line == kModelHeader) {
+      versioned = true;
+      continue;
+    }
+    std::istringstream row(line);
+    std::string key;
+    std::string samples;
+    std::string ewma;
+    std::string window;
+    if (!std::getline(row, key, '\t') || !std::getline(row, samples, '\t') ||
+        !std::getline(row, ewma, '\t')) {
+      continue;
+    }
+    std::getline(row, window);
+    try {
+      Entry entry;
+      entry.samples = std::stoi(samples);
+      entry.runtime_ms_ewma = std::stod(ewma);
+      std::istringstream obs_stream(window);
+      std::string obs;
+      while (std::getline(obs_stream, obs, ';')) {
+        RuntimeObservation o;
+        if (std::sscanf(obs.c_str(), "%lf,%d,%d", &o.runtime_ms, &o.peak_rss_mb,
+                        &o.vram_mb) == 3) {
+          if (!versioned) {
+            o.peak_rss_mb = -1;
+            o.vram_mb = -1;
+          }
+          entry.window.push_back(o);
+        }
+      }
+      while (entry.window.size() > window_) {
+        entry.window.pop_front();
+      }
+      loaded[key] = std::move(entry);
+    } catch (const std::exception &) {
+      // Skip corrupt row; the model relearns it.
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_ = std::move(loaded);
+  dirty_ = false;
+  return Result<void, TaskError>::Ok();
+}
+
+Result<void, TaskError> RuntimeEstimator::save() const {
+  if (persist_path_.empty()) {
+    return Result<void, TaskError>::Ok();
+  }
+  std::ostringstream out;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    out << kModelHeader << '\n';
+    for (const auto &[key, entry] : entries_) {
+      out << key << '\t' << entry.samples << '\t' << entry.runtime_ms_ewma << '\t';
+      bool first = true;
+      for (const auto &o : entry.window) {
+        out << (first ? "" : ";") << o.runtime_ms << ',' << o.peak_rss_mb << ','
+            << o.vram_mb;
+        first = false;
+      }
+      out << '\n';
+    }
+    dirty_ = false;
+  }
+
+  std::error_code ec;
+  const std::filesystem::path path(persist_path_);
+  if (path.has_parent_path()) {
+    std::filesystem::create_directories(path.parent_path(), ec);
+  }
+  const std::string tmp = persist_path_ + ".tmp";
+  {
+    std::ofstream file(tmp, std::ios::trunc);
+    if (!file || !(file << out.str()) || !file.flush()) {
+      return Result<void, TaskError>::Err(
+          TaskError::Internal("Failed to write runtime model: " + tmp));
+    }
+  }
+  std::filesystem::rename(tmp, path, ec);
+  if (ec) {
+    return Result<void, TaskError>::Err(TaskError::Internal(
+        "Failed to persist runtime model: " + ec.message()));
+  }
+  return Result<void, TaskError>::Ok();
+}
+
+} // namespace stv::core
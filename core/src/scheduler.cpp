@@ -113,6 +113,11 @@ public:
     callbacks_.push_back(std::move(cb));
   }
 
+  void on_task_event(TaskEventCallback cb) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_event_callbacks_.push_back(std::move(cb));
+  }
+
   void tick() override {
     std::unique_lock<std::mutex> lock(mutex_);
 
@@ -150,6 +155,7 @@ public:
 
     // Transition to Running
     best->task.transition_to(TaskState::Running);
+    best->attempts++;
     const std::string task_id = best->task.task_id;
     notify(task_id, TaskState::Running, 0.0f);
 
@@ -172,8 +178,8 @@ public:
     if (best->task.deps.size() > 0) {
       for (const auto &dep_id : best->task.deps) {
         auto dep_it = find_entry(dep_id);
-        if (dep_it != entries_.end()) {
-          for (const auto &[key, val] : dep_it->last_outputs) {
+        if (dep_it != entries_.end() && dep_it->last_outputs) {
+          for (const auto &[key, val] : *dep_it->last_outputs) {
             ctx.inputs[key] = val;
           }
         }
@@ -194,7 +200,8 @@ public:
     if (result.is_ok()) {
       it->task.transition_to(TaskState::Succeeded);
       it->task.set_progress(1.0f);
-      it->last_outputs = ctx.outputs; // Save outputs for dependents
+      // Save outputs for dependents and the Succeeded event
+      it->last_outputs = std::make_shared<const StageOutputs>(std::move(ctx.outputs));
       notify(task_id, TaskState::Succeeded, 1.0f);
     } else {
       const auto &err = result.error();
@@ -220,12 +227,14 @@ private:
   struct Entry {
     TaskDescriptor task;
     std::shared_ptr<IStage> stage;
-    std::unordered_map<std::string, std::any> last_outputs;
+    std::shared_ptr<const StageOutputs> last_outputs;
+    int attempts = 0;
   };
 
   mutable std::mutex mutex_;
   std::vector<Entry> entries_;
   std::vector<StateCallback> callbacks_;
+  std::vector<TaskEventCallback> task_event_callbacks_;
 
   std::vector<Entry>::iterator find_entry(const std::string &task_id) {
     return std::find_if(
@@ -238,6 +247,27 @@ private:
       if (cb)
         cb(task_id, state, progress);
     }
+    if (task_event_callbacks_.empty()) {
+      return;
+    }
+
+    TaskEvent event;
+    event.task_id = task_id;
+    event.state = state;
+    event.progress = progress;
+    auto it = find_entry(task_id);
+    if (it != entries_.end()) {
+      event.trace_id = it->task.trace_id;
+      event.attempt = it->attempts;
+      event.error = it->task.error;
+      if (state == TaskState::Succeeded) {
+        event.outputs = it->last_outputs;
+      }
+    }
+    for (auto &cb : task_event_callbacks_) {
+      if (cb)
+        cb(event);
+    }
   }
 };
 
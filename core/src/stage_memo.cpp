@@ -0,0 +1,132 @@
+#include "core/stage_memo.h"
+#include "core/sha256.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace stv::core {
+
+// ========== InMemoryStageMemo ==========
+
+InMemoryStageMemo::InMemoryStageMemo(size_t capacity)
+    : capacity_(std::max<size_t>(1, capacity)) {}
+
+std::optional<StageOutputs> InMemoryStageMemo::lookup(const std::string &key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    return std::nullopt;
+  }
+  lru_.splice(lru_.begin(), lru_, it->second.lru_pos);
+  return it->second.outputs;
+}
+
+void InMemoryStageMemo::store(const std::string &key,
+                              const StageOutputs &outputs) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    it->second.outputs = outputs;
+    lru_.splice(lru_.begin(), lru_, it->second.lru_pos);
+    return;
+  }
+  while (entries_.size() >= capacity_ && !lru_.empty()) {
+    entries_.erase(lru_.back());
+    lru_.pop_back();
+  }
+  lru_.push_front(key);
+  entries_.emplace(key, Entry{outputs, lru_.begin()});
+}
+
+size_t InMemoryStageMemo::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+// ========== Key derivation ==========
+
+namespace {
+
+/// Length-prefixed field, so "ab"+"c" and "a"+"bc" hash differently.
+void hash_field(Sha256 &hasher, const std::string &field) {
+  const uint64_t size = field.size();
+  hasher.update(&size, sizeof(size));
+  hasher.update(field);
+}
+
+template <typename T> std::string raw_bytes(const T &value) {
+  std::string out(sizeof(T), '\0');
+  std::memcpy(out.data(), &value, sizeof(T));
+  return out;
+}
+
+/// Type tag + value bytes; false for types without a canonical encoding.
+bool encode_value(const std::any &value, std::string &out) {
+  if (const auto *s = std::any_cast<std::string>(&value)) {
+    out = "s" + *s;
+  } else if (const auto *i = std::any_cast<int>(&value)) {
+    out = "i" + raw_bytes(static_cast<int64_t>(*i));
+  } else if (const auto *l = std::any_cast<int64_t>(&value)) {
+    out = "i" + raw_bytes(*l);
+  } else if (const auto *b = std::any_cast<bool>(&value)) {
+    out = *b ? "b1" : "b0";
+  } else if (const auto *f = std::any_cast<float>(&value)) {
+    out = "d" + raw_bytes(static_cast<double>(*f));
+  } else if (const auto *d = std::any_cast<double>(&value)) {
+    out = "d" + raw_bytes(*d);
+  } else if (const auto *vs = std::any_cast<std::vector<std::string>>(&value)) {
+    out = "vs" + raw_bytes(static_cast<uint64_t>(vs->size()));
+    for (const auto &item : *vs) {
+      out += raw_bytes(static_cast<uint64_t>(item.size())) + item;
+    }
+  } else if (const auto *vi = std::any_cast<std::vector<int>>(&value)) {
+    out = "vi" + raw_bytes(static_cast<uint64_t>(vi->size()));
+    for (int item : *vi) {
+      out += raw_bytes(static_cast<int64_t>(item));
+    }
+  } else {
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+std::string stage_memo_key(const IStage &stage, const StageContext &ctx) {
+  const std::string version = stage.version();
+  if (version.empty()) {
+    return {};
+  }
+
+  std::vector<std::string> keys = stage.memo_inputs(ctx);
+  if (keys.empty()) {
+    keys.reserve(ctx.inputs.size());
+    for (const auto &[key, _] : ctx.inputs) {
+      keys.push_back(key);
+    }
+  }
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+  Sha256 hasher;
+  hash_field(hasher, stage.name());
+  hash_field(hasher, version);
+  std::string encoded;
+  for (const auto &key : keys) {
+    hash_field(hasher, key);
+    auto it = ctx.inputs.find(key);
+    if (it == ctx.inputs.end()) {
+      hash_field(hasher, "-"); // Declared but absent
+      continue;
+    }
+    if (!encode_value(it->second, encoded)) {
+      return {};
+    }
+    hash_field(hasher, encoded);
+  }
+  return hasher.hex_digest();
+}
+
+} // namespace stv::core
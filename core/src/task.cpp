@@ -47,6 +47,31 @@ const char *to_string(TaskType type) {
     return "TTS";
   case TaskType::Compose:
     return "Compose";
+  case TaskType::Concat:
+    return "Concat";
+  }
+  return "Unknown";
+}
+
+bool parse_task_type(const std::string &text, TaskType &out) {
+  for (auto type : {TaskType::Storyboard, TaskType::ImageGen, TaskType::VideoClip,
+                    TaskType::TTS, TaskType::Compose, TaskType::Concat}) {
+    if (text == to_string(type)) {
+      out = type;
+      return true;
+    }
+  }
+  return false;
+}
+
+const char *to_string(QosClass qos) {
+  switch (qos) {
+  case QosClass::Interactive:
+    return "Interactive";
+  case QosClass::Standard:
+    return "Standard";
+  case QosClass::Batch:
+    return "Batch";
   }
   return "Unknown";
 }
@@ -1,12 +1,15 @@
 #include "core/scheduler.h"
 
+#include "core/cpu_topology.h"
 #include "core/logger.h"
 
 #include <algorithm>
 #include <chrono>
 #include <condition_variable>
 #include <cstdint>
+#include <cmath>
 #include <limits>
+#include <map>
 #include <mutex>
 #include <optional>
 #include <thread>
@@ -29,12 +32,53 @@ int clamp_auto_workers() {
   return std::clamp(hw - 1, 2, 8);
 }
 
-struct StateEvent {
-  std::string task_id;
-  TaskState state;
-  float progress;
+TaskEvent make_event(const TaskDescriptor &task, TaskState state,
+                     float progress) {
+  TaskEvent event;
+  event.task_id = task.task_id;
+  event.trace_id = task.trace_id;
+  event.state = state;
+  event.progress = progress;
+  event.attempt = task.attempt;
+  event.error = task.error;
+  return event;
+}
+
+/// CPU placement of one worker thread. Empty cpus = unpinned.
+struct WorkerPlacement {
+  int numa_node = -1;
+  std::vector<int> cpus;
 };
 
+/// Map workers onto the (restricted) topology: round-robin over NUMA nodes
+/// with node-wide masks, or one CPU per worker without grouping.
+std::vector<WorkerPlacement> plan_worker_placement(const SchedulerConfig &config) {
+  std::vector<WorkerPlacement> plan(static_cast<size_t>(config.worker_count));
+  if (!config.affinity.enabled) {
+    return plan;
+  }
+  const auto topology =
+      config.affinity.topology.value_or(CpuTopology::detect())
+          .restricted_to(config.affinity.cpu_set);
+  if (topology.nodes.empty()) {
+    return plan;
+  }
+
+  const auto cpus = topology.all_cpus();
+  for (size_t i = 0; i < plan.size(); ++i) {
+    if (config.affinity.numa_grouping) {
+      const auto &node = topology.nodes[i % topology.nodes.size()];
+      plan[i].numa_node = node.id;
+      plan[i].cpus = node.cpus;
+    } else {
+      const int cpu = cpus[i % cpus.size()];
+      plan[i].numa_node = topology.node_of(cpu);
+      plan[i].cpus = {cpu};
+    }
+  }
+  return plan;
+}
+
 struct ResourceUsage {
   int cpu_slots = 0;
   int ram_mb = 0;
@@ -44,10 +88,22 @@ struct ResourceUsage {
 class ThreadPoolScheduler final : public IScheduler {
 public:
   ThreadPoolScheduler(SchedulerConfig config, std::shared_ptr<ILogger> logger)
-      : config_(normalize_config(std::move(config))), logger_(std::move(logger)) {
+      : config_(normalize_config(std::move(config))), logger_(std::move(logger)),
+        placement_(plan_worker_placement(config_)) {
+    std::unordered_set<int> worker_nodes;
+    for (const auto &p : placement_) {
+      worker_nodes.insert(p.numa_node);
+    }
+    locality_enabled_ = config_.affinity.enabled && worker_nodes.size() > 1;
+    admission_cpu_slots_ = config_.resource_budget.cpu_slots_hard;
+    plan_qos_slots();
+
     workers_.reserve(static_cast<size_t>(config_.worker_count));
     for (int i = 0; i < config_.worker_count; ++i) {
-      workers_.emplace_back([this]() { worker_loop(); });
+      workers_.emplace_back([this, i]() { worker_loop(i); });
+    }
+    if (config_.admission.monitor) {
+      sampler_ = std::thread([this]() { sampler_loop(); });
     }
   }
 
@@ -62,11 +118,14 @@ public:
         w.join();
       }
     }
+    if (sampler_.joinable()) {
+      sampler_.join();
+    }
   }
 
   Result<void, TaskError> submit(TaskDescriptor task,
                                  std::shared_ptr<IStage> stage) override {
-    std::vector<StateEvent> events;
+    std::vector<TaskEvent> events;
     {
       std::lock_guard<std::mutex> lock(mutex_);
       if (!stage) {
@@ -81,6 +140,12 @@ public:
         return Result<void, TaskError>::Err(
             TaskError::Internal("Duplicate task_id: " + task.task_id));
       }
+      std::string estimate_key;
+      if (config_.estimation.estimator) {
+        estimate_key = config_.estimation.estimator->make_key(
+            task.type, stage->name(), task.inputs);
+        apply_estimate(task, estimate_key);
+      }
       if (task.resource_demand.cpu_slots <= 0) {
         task.resource_demand.cpu_slots = 1;
       }
@@ -110,6 +175,8 @@ public:
       Node node;
       node.task = std::move(task);
       node.stage = std::move(stage);
+      node.estimate_key = std::move(estimate_key);
+      node.batchable = dynamic_cast<IBatchableStage *>(node.stage.get());
       node.unmet_deps = 0;
 
       bool dependency_blocked = false;
@@ -147,8 +214,7 @@ public:
             });
         auto canceled = node.task.transition_to(TaskState::Canceled);
         if (canceled.is_ok()) {
-          events.push_back({node.task.task_id, TaskState::Canceled,
-                            node.task.progress});
+          events.push_back(make_event(node.task, TaskState::Canceled, node.task.progress));
         }
       } else if (node.unmet_deps == 0) {
         auto ready = node.task.transition_to(TaskState::Ready);
@@ -156,11 +222,19 @@ public:
           return Result<void, TaskError>::Err(ready.error());
         }
         node.ready_since = Clock::now();
-        ready_set_.insert(node.task.task_id);
-        events.push_back({node.task.task_id, TaskState::Ready, node.task.progress});
+        add_ready_locked(node);
+        events.push_back(make_event(node.task, TaskState::Ready, node.task.progress));
       }
 
-      nodes_.emplace(node.task.task_id, std::move(node));
+      const std::string task_id = node.task.task_id;
+      node.effective_priority = node.task.priority;
+      if (!is_terminal(node.task.state)) {
+        unfinished_tasks_++;
+      }
+      trace_tasks_[node.task.trace_id].push_back(task_id);
+      nodes_.emplace(task_id, std::move(node));
+      refresh_priority_locked(task_id);
+      metrics_.tasks_submitted++;
     }
 
     dispatch_events(events);
@@ -168,8 +242,24 @@ public:
     return Result<void, TaskError>::Ok();
   }
 
+  Result<void, TaskError> set_priority(const std::string &task_id,
+                                       int priority) override {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = nodes_.find(task_id);
+      if (it == nodes_.end()) {
+        return Result<void, TaskError>::Err(
+            TaskError::Internal("Task not found: " + task_id));
+      }
+      it->second.task.priority = priority;
+      refresh_priority_locked(task_id);
+    }
+    cv_.notify_all();
+    return Result<void, TaskError>::Ok();
+  }
+
   Result<void, TaskError> cancel(const std::string &task_id) override {
-    std::vector<StateEvent> events;
+    std::vector<TaskEvent> events;
     {
       std::lock_guard<std::mutex> lock(mutex_);
       auto it = nodes_.find(task_id);
@@ -191,22 +281,27 @@ public:
       }
 
       if (node.task.state == TaskState::Ready) {
-        ready_set_.erase(task_id);
+        remove_ready_locked(node);
       }
 
       node.pause_requested = false;
       node.pause_deadline.reset();
+      if (node.retry_at.has_value()) {
+        node.retry_at.reset();
+        retry_waiting_--;
+        node.task.error.reset(); // Drop the retried error; this is a cancel
+      }
 
       bool should_propagate = false;
       if (!is_terminal(node.task.state)) {
-        auto to_canceled = node.task.transition_to(TaskState::Canceled);
+        auto to_canceled = transition_locked(node, TaskState::Canceled);
         if (to_canceled.is_err()) {
           return to_canceled;
         }
         if (!node.task.error.has_value()) {
           node.task.error = TaskError::Canceled();
         }
-        events.push_back({task_id, TaskState::Canceled, node.task.progress});
+        events.push_back(make_event(node.task, TaskState::Canceled, node.task.progress));
         should_propagate = true;
       }
 
@@ -221,7 +316,7 @@ public:
   }
 
   Result<void, TaskError> pause(const std::string &task_id) override {
-    std::vector<StateEvent> events;
+    std::vector<TaskEvent> events;
     bool timed_out = false;
 
     {
@@ -239,15 +334,25 @@ public:
 
       if (node.task.state == TaskState::Queued || node.task.state == TaskState::Ready) {
         if (node.task.state == TaskState::Ready) {
-          ready_set_.erase(task_id);
+          remove_ready_locked(node);
         }
-        auto paused = node.task.transition_to(TaskState::Paused);
+        auto paused = transition_locked(node, TaskState::Paused);
         if (paused.is_err()) {
           return paused;
         }
-        events.push_back({task_id, TaskState::Paused, node.task.progress});
+        events.push_back(make_event(node.task, TaskState::Paused, node.task.progress));
       } else if (node.task.state == TaskState::Running) {
+        if (node.batched) {
+          return Result<void, TaskError>::Err(TaskError::Internal(
+              "Task is running inside a batch and cannot pause; cancel it instead"));
+        }
         node.pause_requested = true;
+        // Pausing keeps only the primary; a speculative racer is dropped.
+        for (auto &[execution_id, token] : node.executions) {
+          if (execution_id != node.primary_execution && token) {
+            token->request_cancel();
+          }
+        }
         const auto timeout = std::max(1, config_.pause_policy.checkpoint_timeout_ms);
         node.pause_deadline = Clock::now() + std::chrono::milliseconds(timeout);
 
@@ -289,7 +394,7 @@ public:
   }
 
   Result<void, TaskError> resume(const std::string &task_id) override {
-    std::vector<StateEvent> events;
+    std::vector<TaskEvent> events;
     {
       std::lock_guard<std::mutex> lock(mutex_);
       auto it = nodes_.find(task_id);
@@ -305,7 +410,7 @@ public:
       }
 
       const TaskState target = node.task.paused_from.value_or(TaskState::Running);
-      auto resumed = node.task.transition_to(target);
+      auto resumed = transition_locked(node, target);
       if (resumed.is_err()) {
         return resumed;
       }
@@ -314,10 +419,14 @@ public:
       node.pause_deadline.reset();
       if (target == TaskState::Ready) {
         node.ready_since = Clock::now();
-        ready_set_.insert(task_id);
+        add_ready_locked(node);
+      } else if (target == TaskState::Queued && node.retry_at.has_value()) {
+        // Paused during retry backoff: re-arm the timer; promotion happens
+        // on the next worker wakeup if the deadline already passed.
+        retry_queue_.emplace(*node.retry_at, task_id);
       }
 
-      events.push_back({task_id, target, node.task.progress});
+      events.push_back(make_event(node.task, target, node.task.progress));
     }
 
     dispatch_events(events);
@@ -330,11 +439,27 @@ public:
     callbacks_.push_back(std::move(cb));
   }
 
+  void on_task_event(TaskEventCallback cb) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_event_callbacks_.push_back(std::move(cb));
+  }
+
+  [[nodiscard]] SchedulerMetrics metrics() const override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    SchedulerMetrics snapshot = metrics_;
+    snapshot.admission_cpu_slots = admission_cpu_slots_;
+    snapshot.qos_cpu_slots = qos_cpu_in_use_;
+    snapshot.retry_waiting = static_cast<int>(retry_waiting_);
+    return snapshot;
+  }
+
   void tick() override {
     std::vector<std::string> timed_out_ids;
+    std::vector<TaskEvent> retry_events;
     {
       std::lock_guard<std::mutex> lock(mutex_);
       const auto now = Clock::now();
+      promote_due_retries_locked(now, retry_events);
       for (auto &[task_id, node] : nodes_) {
         if (node.task.state == TaskState::Running && node.pause_requested &&
             node.pause_deadline.has_value() && now >= *node.pause_deadline) {
@@ -343,6 +468,7 @@ public:
       }
     }
 
+    dispatch_events(retry_events);
     for (const auto &task_id : timed_out_ids) {
       auto result = cancel(task_id);
       (void)result;
@@ -353,24 +479,68 @@ public:
 
   [[nodiscard]] bool has_pending_tasks() const override {
     std::lock_guard<std::mutex> lock(mutex_);
-    for (const auto &[_, node] : nodes_) {
+    return unfinished_tasks_ > 0;
+  }
+
+  void forget(const std::string &trace_id) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto trace_it = trace_tasks_.find(trace_id);
+    if (trace_it == trace_tasks_.end()) {
+      return;
+    }
+    std::vector<std::string> unfinished;
+    for (const auto &task_id : trace_it->second) {
+      auto it = nodes_.find(task_id);
+      if (it == nodes_.end()) {
+        continue;
+      }
+      Node &node = it->second;
       if (!is_terminal(node.task.state)) {
-        return true;
+        unfinished.push_back(task_id); // A later forget() prunes it
+      } else if (!node.executions.empty()) {
+        node.forgotten = true; // Hedge loser still unwinding; see finalize
+      } else {
+        erase_node_locked(task_id);
       }
     }
-    return false;
+    if (unfinished.empty()) {
+      trace_tasks_.erase(trace_it);
+    } else {
+      trace_it->second = std::move(unfinished);
+    }
   }
 
 private:
   struct Node {
     TaskDescriptor task;
     std::shared_ptr<IStage> stage;
-    std::unordered_map<std::string, std::any> last_outputs;
+    std::shared_ptr<const StageOutputs> last_outputs; // Set on success
     size_t unmet_deps = 0;
     TimePoint ready_since = Clock::now();
     bool running = false;
     bool pause_requested = false;
     std::optional<TimePoint> pause_deadline;
+    std::optional<TimePoint> retry_at; // Set while backing off before a retry
+    int numa_node = -1; // Node whose worker produced last_outputs
+    std::string estimate_key; // RuntimeEstimator key (estimator enabled)
+
+    // Batching (M4): set at submit when the stage implements IBatchableStage.
+    IBatchableStage *batchable = nullptr;
+    mutable std::optional<std::string> batch_key; // Computed once Ready
+    bool batched = false; // Current attempt runs inside a batch
+
+    // Priority inheritance (M4): effective = max(own, inherited). inherited
+    // holds each unfinished successor's effective priority.
+    int effective_priority = 0;
+    std::unordered_map<std::string, int> inherited;
+
+    // Live executions of the current attempt (execution id → cancel token).
+    std::unordered_map<int, std::shared_ptr<CancelToken>> executions;
+    int next_execution_id = 0;
+    int primary_execution = 0;
+    TimePoint attempt_started_at{};
+    bool hedged = false; // Duplicate already launched for this attempt
+    bool forgotten = false; // forget() ran; erase once executions drain
   };
 
   struct Candidate {
@@ -378,6 +548,10 @@ private:
     long long effective_priority = std::numeric_limits<long long>::min();
     TimePoint ready_since{};
     bool soft_fit = true;
+    int preferred_node = -1;
+    bool reserved = false; // QoS: class is below its reserved slots
+    // Learned p90 runtime; unknown sorts after any estimate
+    double expected_runtime_ms = std::numeric_limits<double>::infinity();
   };
 
   static SchedulerConfig normalize_config(SchedulerConfig config) {
@@ -401,91 +575,788 @@ private:
     if (config.pause_policy.checkpoint_timeout_ms <= 0) {
       config.pause_policy.checkpoint_timeout_ms = 1500;
     }
+    config.batching.max_batch_size = std::max(1, config.batching.max_batch_size);
+    config.batching.max_linger_ms = std::max(0, config.batching.max_linger_ms);
+    config.estimation.min_samples = std::max(1, config.estimation.min_samples);
+    if (!(config.estimation.demand_headroom >= 1.0)) {
+      config.estimation.demand_headroom = 1.0;
+    }
+    config.admission.sample_interval_ms =
+        std::max(10, config.admission.sample_interval_ms);
+    config.admission.memory_headroom_mb =
+        std::max(0, config.admission.memory_headroom_mb);
+    config.affinity.locality_wait_ms =
+        std::max(0, config.affinity.locality_wait_ms);
+    config.hedging.runtime_quantile =
+        std::clamp(config.hedging.runtime_quantile, 0.5, 1.0);
+    config.hedging.min_samples = std::max(1, config.hedging.min_samples);
+    config.hedging.max_duplicate_ratio =
+        std::max(0.0, config.hedging.max_duplicate_ratio);
+    normalize_retry_policy(config.retry.default_policy);
+    for (auto &[_, policy] : config.retry.per_type) {
+      normalize_retry_policy(policy);
+    }
+    for (size_t c = 0; c < kQosClassCount; ++c) {
+      auto &min_share = config.qos.min_cpu_share[c];
+      auto &max_share = config.qos.max_cpu_share[c];
+      min_share = std::isfinite(min_share) ? std::clamp(min_share, 0.0, 1.0) : 0.0;
+      max_share = std::isfinite(max_share) ? std::clamp(max_share, 0.0, 1.0) : 1.0;
+      max_share = std::max(min_share, max_share);
+    }
     return config;
   }
 
-  void worker_loop() {
+  /// Turn QoS shares into slot counts. Reservations are trimmed from the
+  /// lowest class up until they fit cpu_slots_hard, so every guarantee can be
+  /// honoured at once; ceilings are at least one slot.
+  void plan_qos_slots() {
+    const int cap = config_.resource_budget.cpu_slots_hard;
+    int reserved_total = 0;
+    for (size_t c = 0; c < kQosClassCount; ++c) {
+      qos_reserved_slots_[c] =
+          static_cast<int>(std::floor(config_.qos.min_cpu_share[c] * cap));
+      qos_max_slots_[c] = std::max(
+          1, static_cast<int>(std::floor(config_.qos.max_cpu_share[c] * cap)));
+      reserved_total += qos_reserved_slots_[c];
+    }
+    for (size_t c = kQosClassCount; c-- > 0 && reserved_total > cap;) {
+      const int trim = std::min(qos_reserved_slots_[c], reserved_total - cap);
+      qos_reserved_slots_[c] -= trim;
+      reserved_total -= trim;
+    }
+    for (size_t c = 0; c < kQosClassCount; ++c) {
+      qos_max_slots_[c] = std::max(qos_max_slots_[c], qos_reserved_slots_[c]);
+    }
+  }
+
+  static void normalize_retry_policy(TaskRetryPolicy &policy) {
+    policy.max_attempts = std::max(1, policy.max_attempts);
+    policy.initial_backoff_ms = std::max(0, policy.initial_backoff_ms);
+    policy.max_backoff_ms =
+        std::max(policy.initial_backoff_ms, policy.max_backoff_ms);
+    if (!(policy.backoff_multiplier >= 1.0)) {
+      policy.backoff_multiplier = 1.0;
+    }
+  }
+
+  [[nodiscard]] TaskRetryPolicy
+  resolve_retry_policy(const TaskDescriptor &task) const {
+    if (task.retry_policy.has_value()) {
+      auto policy = *task.retry_policy;
+      normalize_retry_policy(policy);
+      return policy;
+    }
+    auto it = config_.retry.per_type.find(task.type);
+    if (it != config_.retry.per_type.end()) {
+      return it->second;
+    }
+    return config_.retry.default_policy;
+  }
+
+  static std::chrono::milliseconds retry_backoff(const TaskRetryPolicy &policy,
+                                                 int attempt) {
+    const double scaled =
+        static_cast<double>(policy.initial_backoff_ms) *
+        std::pow(policy.backoff_multiplier, std::max(0, attempt - 1));
+    const double capped =
+        std::min(scaled, static_cast<double>(policy.max_backoff_ms));
+    return std::chrono::milliseconds(static_cast<long long>(capped));
+  }
+
+  /// One stage execution handed from the locked dispatch section to a worker.
+  /// A task normally has a single execution per attempt; a hedged attempt has
+  /// a primary plus one speculative duplicate racing it.
+  struct Execution {
+    std::string task_id;
+    int execution_id = 0;
+    bool speculative = false;
+    int numa_node = -1; // Node of the worker running this execution
+    ResourceDemand reserved{}; // Released when this execution finalizes
+    QosClass qos = QosClass::Standard; // Class `reserved` is accounted under
+    TimePoint started_at{};
+    std::shared_ptr<IStage> stage;
+    StageContext ctx;
+    std::string memo_key; // Empty = not memoizable (or memo disabled)
+    bool memo_hit = false; // Outputs came from the memo, stage not executed
+  };
+
+  void worker_loop(int worker_index) {
+    const auto &placement = placement_[static_cast<size_t>(worker_index)];
+    if (!placement.cpus.empty() && !pin_current_thread(placement.cpus) &&
+        logger_) {
+      logger_->warn("", "scheduler", "worker_pin_failed",
+                    "worker=" + std::to_string(worker_index) +
+                        " numa_node=" + std::to_string(placement.numa_node));
+    }
+    const int worker_node = locality_enabled_ ? placement.numa_node : -1;
+
     while (true) {
-      std::string task_id;
-      std::shared_ptr<IStage> stage;
-      StageContext ctx;
-      std::vector<StateEvent> run_events;
+      Execution exec;
+      std::vector<Execution> followers; // Batch members riding on exec
+      std::vector<TaskEvent> run_events;
       bool should_execute = false;
 
       {
         std::unique_lock<std::mutex> lock(mutex_);
-        cv_.wait(lock, [this]() {
-          return stopping_ || has_runnable_task_locked();
-        });
+        wait_for_work_locked(lock, run_events, worker_node);
 
         if (stopping_) {
           return;
         }
 
-        const auto candidate = pick_candidate_locked(/*allow_escape=*/true);
-        if (!candidate.has_value()) {
-          continue;
+        const auto candidate =
+            pick_candidate_locked(/*allow_escape=*/true, worker_node);
+        auto node_it = candidate.has_value() ? nodes_.find(candidate->task_id)
+                                             : nodes_.end();
+        if (node_it != nodes_.end()) {
+          Node &node = node_it->second;
+          remove_ready_locked(node);
+
+          if (begin_attempt_locked(node, run_events)) {
+            if (worker_node >= 0 && candidate->preferred_node >= 0 &&
+                candidate->preferred_node != worker_node) {
+              metrics_.locality_remote_dispatches++;
+            }
+            exec = start_execution_locked(node, /*speculative=*/false);
+            run_events.push_back(make_event(node.task, TaskState::Running, node.task.progress));
+            should_execute = true;
+            if (config_.batching.enabled && node.batchable) {
+              followers = gather_batch_locked(node, run_events);
+            }
+          }
+        } else if (auto hedge_id = pick_hedge_locked(Clock::now())) {
+          Node &node = nodes_.at(*hedge_id);
+          node.hedged = true;
+          metrics_.hedges_launched++;
+          exec = start_execution_locked(node, /*speculative=*/true);
+          should_execute = true;
+          if (logger_) {
+            logger_->info(node.task.trace_id, "scheduler", "task_hedge_launched",
+                          "task_id=" + node.task.task_id +
+                              " attempt=" + std::to_string(node.task.attempt));
+          }
         }
+      }
 
-        task_id = candidate->task_id;
-        auto node_it = nodes_.find(task_id);
-        if (node_it == nodes_.end()) {
+      dispatch_events(run_events);
+      if (!should_execute) {
+        cv_.notify_all();
+        continue;
+      }
+
+      exec.numa_node = placement.numa_node;
+      if (followers.empty()) {
+        if (lookup_memo(exec)) {
+          finalize_execution(exec, Result<void, TaskError>::Ok());
           continue;
         }
+        auto result = exec.stage->execute(exec.ctx);
+        finalize_execution(exec, result);
+        continue;
+      }
 
-        Node &node = node_it->second;
-        ready_set_.erase(task_id);
+      followers.insert(followers.begin(), std::move(exec));
+      followers = settle_memo_hits(std::move(followers));
+      if (followers.empty()) {
+        continue;
+      }
+      std::vector<StageContext *> contexts;
+      for (auto &member : followers) {
+        member.numa_node = placement.numa_node;
+        contexts.push_back(&member.ctx);
+      }
+      auto *batch_stage = dynamic_cast<IBatchableStage *>(followers.front().stage.get());
+      auto results = batch_stage->execute_batch(contexts);
+      for (size_t i = 0; i < followers.size(); ++i) {
+        finalize_execution(
+            followers[i],
+            i < results.size()
+                ? results[i]
+                : Result<void, TaskError>::Err(TaskError::Internal(
+                      "execute_batch returned too few results")));
+      }
+    }
+  }
 
-        auto to_running = node.task.transition_to(TaskState::Running);
-        if (to_running.is_err()) {
-          node.task.error = to_running.error();
-          auto to_failed = node.task.transition_to(TaskState::Failed);
-          if (to_failed.is_ok()) {
-            run_events.push_back({task_id, TaskState::Failed, node.task.progress});
-          }
-        } else {
-          reserve_resources_locked(node.task.resource_demand);
-          node.running = true;
-          node.pause_requested = false;
-          node.pause_deadline.reset();
-          running_set_.insert(task_id);
-
-          ctx.trace_id = node.task.trace_id;
-          ctx.cancel_token = node.task.cancel_token;
-          for (const auto &dep_id : node.task.deps) {
-            auto dep_it = nodes_.find(dep_id);
-            if (dep_it == nodes_.end()) {
-              continue;
-            }
-            for (const auto &[key, value] : dep_it->second.last_outputs) {
-              ctx.inputs[key] = value;
-            }
-          }
+  /// Compute the memo key (outside the lock) and, for a primary execution,
+  /// fill outputs from the memo. Returns true on a hit; the caller then
+  /// finalizes with Ok instead of executing the stage.
+  bool lookup_memo(Execution &exec) {
+    const auto &memo = config_.memoization.memo;
+    if (!memo) {
+      return false;
+    }
+    exec.memo_key = stage_memo_key(*exec.stage, exec.ctx);
+    if (exec.memo_key.empty() || exec.speculative) {
+      return false;
+    }
+    auto outputs = memo->lookup(exec.memo_key);
+    if (!outputs.has_value() || !exec.stage->outputs_reusable(*outputs)) {
+      return false; // A stale hit re-executes and its store() replaces it
+    }
+    exec.ctx.outputs = std::move(*outputs);
+    exec.memo_hit = true;
+    return true;
+  }
 
-          ctx.on_progress = [this, task_id](float p) {
-            this->handle_progress_callback(task_id, p);
-          };
+  /// Finalize batch members served by the memo and return the rest. A leader
+  /// hit hands its CPU slot to the first member of its QoS class that still
+  /// has to run; with none, the slot is released under the leader's class.
+  std::vector<Execution> settle_memo_hits(std::vector<Execution> members) {
+    std::vector<Execution> to_run;
+    std::vector<Execution> hits;
+    for (auto &member : members) {
+      (lookup_memo(member) ? hits : to_run).push_back(std::move(member));
+    }
+    if (!hits.empty()) {
+      auto &leader = hits.front();
+      auto heir = std::find_if(to_run.begin(), to_run.end(),
+                               [&](const Execution &e) { return e.qos == leader.qos; });
+      if (heir != to_run.end()) {
+        heir->reserved.cpu_slots += leader.reserved.cpu_slots;
+        leader.reserved.cpu_slots = 0;
+      }
+    }
+    for (auto &hit : hits) {
+      finalize_execution(hit, Result<void, TaskError>::Ok());
+    }
+    return to_run;
+  }
 
-          stage = node.stage;
-          run_events.push_back({task_id, TaskState::Running, node.task.progress});
-          should_execute = true;
+  /// Ready → Running for a fresh attempt. On an illegal transition the task
+  /// is failed and false is returned.
+  bool begin_attempt_locked(Node &node, std::vector<TaskEvent> &events) {
+    auto to_running = transition_locked(node, TaskState::Running);
+    if (to_running.is_err()) {
+      node.task.error = to_running.error();
+      auto to_failed = transition_locked(node, TaskState::Failed);
+      if (to_failed.is_ok()) {
+        events.push_back(make_event(node.task, TaskState::Failed, node.task.progress));
+      }
+      return false;
+    }
+    node.task.error.reset(); // A new attempt starts clean
+    node.task.attempt++;
+    metrics_.attempts_started++;
+    metrics_.qos_dispatches[qos_index(node.task.qos)]++;
+    node.pause_requested = false;
+    node.pause_deadline.reset();
+    node.hedged = false;
+    node.batched = false;
+    return true;
+  }
+
+  /// Batch key of a Ready batchable node (cached: inputs are fixed once all
+  /// deps succeeded). Empty = not batchable.
+  const std::string &batch_key_locked(const Node &node) const {
+    if (!node.batch_key.has_value()) {
+      StageContext ctx;
+      ctx.trace_id = node.task.trace_id;
+      collect_inputs_locked(node, ctx);
+      node.batch_key = node.batchable->batch_key(ctx);
+    }
+    return *node.batch_key;
+  }
+
+  /// Pull Ready peers sharing the leader's batch key into the same
+  /// execution. Followers skip the CPU slot (they share the leader's worker)
+  /// but reserve RAM/VRAM and must fit the soft budget.
+  std::vector<Execution> gather_batch_locked(Node &lead,
+                                             std::vector<TaskEvent> &events) {
+    std::vector<Execution> followers;
+    const auto &key = batch_key_locked(lead);
+    if (key.empty() || config_.batching.max_batch_size <= 1) {
+      return followers;
+    }
+
+    std::vector<Node *> peers;
+    for (const auto &task_id : ready_set_) {
+      auto it = nodes_.find(task_id);
+      if (it == nodes_.end() || &it->second == &lead) {
+        continue;
+      }
+      Node &peer = it->second;
+      if (peer.task.state == TaskState::Ready && peer.batchable &&
+          batch_key_locked(peer) == key) {
+        peers.push_back(&peer);
+      }
+    }
+    std::sort(peers.begin(), peers.end(), [](const Node *a, const Node *b) {
+      if (a->ready_since != b->ready_since) {
+        return a->ready_since < b->ready_since;
+      }
+      return a->task.task_id < b->task.task_id;
+    });
+
+    for (Node *peer : peers) {
+      if (static_cast<int>(followers.size()) + 1 >= config_.batching.max_batch_size) {
+        break;
+      }
+      ResourceDemand demand = peer->task.resource_demand;
+      demand.cpu_slots = 0;
+      if (!fits_soft_locked(demand)) {
+        continue;
+      }
+      remove_ready_locked(*peer);
+      if (!begin_attempt_locked(*peer, events)) {
+        continue;
+      }
+      peer->batched = true;
+      peer->hedged = true; // Batched attempts are never duplicated
+      followers.push_back(
+          start_execution_locked(*peer, /*speculative=*/false, /*reserve_cpu=*/false));
+      events.push_back(make_event(peer->task, TaskState::Running, peer->task.progress));
+    }
+
+    if (!followers.empty()) {
+      lead.batched = true;
+      lead.hedged = true;
+      metrics_.batches_dispatched++;
+      metrics_.batched_tasks += followers.size() + 1;
+      if (logger_) {
+        logger_->info(lead.task.trace_id, "scheduler", "task_batch_dispatched",
+                      "lead=" + lead.task.task_id + " size=" +
+                          std::to_string(followers.size() + 1) + " key=" + key);
+      }
+    }
+    return followers;
+  }
+
+  /// Linger: hold a batchable task while its group is below max_batch_size
+  /// and it has been Ready for less than max_linger_ms.
+  [[nodiscard]] bool batch_hold_locked(const Node &node, TimePoint now) const {
+    if (!config_.batching.enabled || !node.batchable) {
+      return false;
+    }
+    const auto &key = batch_key_locked(node);
+    if (key.empty()) {
+      return false;
+    }
+    auto it = batch_group_sizes_.find(key);
+    const int size = it == batch_group_sizes_.end() ? 1 : it->second;
+    return size < config_.batching.max_batch_size &&
+           now - node.ready_since <
+               std::chrono::milliseconds(config_.batching.max_linger_ms);
+  }
+
+  /// Enter/leave ready_set_. The per-class and per-batch-key Ready counts
+  /// move with it, so dispatch passes read them instead of recounting.
+  void add_ready_locked(const Node &node) {
+    if (!ready_set_.insert(node.task.task_id).second) {
+      return;
+    }
+    qos_ready_counts_[qos_index(node.task.qos)]++;
+    if (config_.batching.enabled && node.batchable) {
+      const auto &key = batch_key_locked(node);
+      if (!key.empty()) {
+        batch_group_sizes_[key]++;
+      }
+    }
+  }
+
+  void remove_ready_locked(const Node &node) {
+    if (ready_set_.erase(node.task.task_id) == 0) {
+      return;
+    }
+    qos_ready_counts_[qos_index(node.task.qos)]--;
+    if (config_.batching.enabled && node.batchable) {
+      const auto &key = batch_key_locked(node); // Cached by add_ready_locked()
+      auto it = batch_group_sizes_.find(key);
+      if (it != batch_group_sizes_.end() && --it->second == 0) {
+        batch_group_sizes_.erase(it);
+      }
+    }
+  }
+
+  /// Earliest time a lingering batchable task is released.
+  [[nodiscard]] std::optional<TimePoint> next_batch_release_locked() const {
+    if (!config_.batching.enabled) {
+      return std::nullopt;
+    }
+    const auto now = Clock::now();
+    std::optional<TimePoint> earliest;
+    for (const auto &task_id : ready_set_) {
+      auto it = nodes_.find(task_id);
+      if (it == nodes_.end() || it->second.task.state != TaskState::Ready ||
+          !batch_hold_locked(it->second, now)) {
+        continue;
+      }
+      const auto release = it->second.ready_since +
+                           std::chrono::milliseconds(config_.batching.max_linger_ms);
+      if (!earliest.has_value() || release < *earliest) {
+        earliest = release;
+      }
+    }
+    return earliest;
+  }
+
+  /// Register a new live execution on a Running node and build its context.
+  /// Resources are reserved per execution, so a duplicate is budgeted like
+  /// any other running task (CPU hard gate, RAM/VRAM soft gates).
+  Execution start_execution_locked(Node &node, bool speculative,
+                                   bool reserve_cpu = true) {
+    Execution exec;
+    exec.task_id = node.task.task_id;
+    exec.execution_id = ++node.next_execution_id;
+    exec.speculative = speculative;
+    exec.started_at = Clock::now();
+    exec.stage = node.stage;
+    exec.qos = node.task.qos;
+
+    // With hedging enabled every execution gets a child of the task token so
+    // the loser can be canceled without touching the task (or its workflow).
+    // Task-level cancel still reaches it through the parent link.
+    std::shared_ptr<CancelToken> token = node.task.cancel_token;
+    if (config_.hedging.enabled) {
+      token = node.task.cancel_token->create_child();
+    }
+
+    if (!speculative) {
+      node.primary_execution = exec.execution_id;
+      node.attempt_started_at = exec.started_at;
+    }
+    node.executions.emplace(exec.execution_id, token);
+    exec.reserved = node.task.resource_demand;
+    if (!reserve_cpu) {
+      exec.reserved.cpu_slots = 0;
+    }
+    reserve_resources_locked(exec.reserved, node.task.qos);
+    node.running = true;
+    running_set_.insert(node.task.task_id);
+
+    exec.ctx.trace_id = node.task.trace_id;
+    exec.ctx.cancel_token = token;
+    collect_inputs_locked(node, exec.ctx);
+    exec.ctx.on_progress = [this, task_id = node.task.task_id,
+                            execution_id = exec.execution_id](float p) {
+      this->handle_progress_callback(task_id, execution_id, p);
+    };
+    return exec;
+  }
+
+  /// transition_to() plus the counters that has_pending_tasks() and
+  /// metrics() read instead of scanning nodes_.
+  Result<void, TaskError> transition_locked(Node &node, TaskState target) {
+    const bool was_terminal = is_terminal(node.task.state);
+    auto result = node.task.transition_to(target);
+    if (result.is_err() || was_terminal == is_terminal(target)) {
+      return result;
+    }
+    if (was_terminal) {
+      unfinished_tasks_++; // Failed → Queued for a retry
+    } else {
+      unfinished_tasks_--;
+      if (node.retry_at.has_value()) {
+        node.retry_at.reset();
+        retry_waiting_--;
+      }
+    }
+    return result;
+  }
+
+  /// Drop a terminal node with no live executions and its edges.
+  void erase_node_locked(const std::string &task_id) {
+    auto it = nodes_.find(task_id);
+    if (it == nodes_.end()) {
+      return;
+    }
+    for (const auto &dep_id : it->second.task.deps) {
+      auto succ_it = successors_.find(dep_id);
+      if (succ_it == successors_.end()) {
+        continue;
+      }
+      auto &succs = succ_it->second;
+      succs.erase(std::remove(succs.begin(), succs.end(), task_id), succs.end());
+      if (succs.empty()) {
+        successors_.erase(succ_it);
+      }
+    }
+    successors_.erase(task_id);
+    remove_ready_locked(it->second);
+    running_set_.erase(task_id);
+    nodes_.erase(it);
+  }
+
+  void collect_inputs_locked(const Node &node, StageContext &ctx) const {
+    for (const auto &dep_id : node.task.deps) {
+      auto dep_it = nodes_.find(dep_id);
+      if (dep_it == nodes_.end()) {
+        continue;
+      }
+      if (const auto &outputs = dep_it->second.last_outputs) {
+        for (const auto &[key, value] : *outputs) {
+          ctx.inputs[key] = value;
         }
       }
+    }
+    for (const auto &[key, value] : node.task.inputs) {
+      ctx.inputs[key] = value;
+    }
+  }
 
-      dispatch_events(run_events);
-      if (!should_execute) {
-        cv_.notify_all();
+  /// Fill runtime estimate and (unless pinned) RAM/VRAM demand from the
+  /// learned model once the key has enough observations. A resource is only
+  /// overwritten when enough attempts actually reported it.
+  void apply_estimate(TaskDescriptor &task, const std::string &key) const {
+    const auto estimate = config_.estimation.estimator->estimate(key);
+    const int min_samples = config_.estimation.min_samples;
+    if (!estimate.has_value() || estimate->samples < min_samples) {
+      return;
+    }
+    task.estimated_runtime_ms = estimate->runtime_ms_p90;
+    if (task.pin_resource_demand) {
+      return;
+    }
+    const double headroom = config_.estimation.demand_headroom;
+    if (estimate->rss_samples >= min_samples) {
+      task.resource_demand.ram_mb = static_cast<int>(
+          std::ceil(static_cast<double>(estimate->rss_mb_p90) * headroom));
+    }
+    if (estimate->vram_samples >= min_samples) {
+      task.resource_demand.vram_mb = static_cast<int>(
+          std::ceil(static_cast<double>(estimate->vram_mb_p90) * headroom));
+    }
+  }
+
+  /// Measurements of a successful execution, taken outside the lock. Process
+  /// RSS cannot be attributed to one of several concurrent stages, so memory
+  /// is only recorded when the stage reports it.
+  [[nodiscard]] RuntimeObservation observe(const Execution &exec) const {
+    RuntimeObservation obs;
+    obs.runtime_ms = std::chrono::duration<double, std::milli>(
+                         Clock::now() - exec.started_at)
+                         .count();
+    obs.peak_rss_mb = std::max(-1, exec.ctx.reported_peak_rss_mb);
+    obs.vram_mb = std::max(-1, exec.ctx.reported_vram_mb);
+    return obs;
+  }
+
+  [[nodiscard]] bool hedge_eligible_type(TaskType type) const {
+    const auto &types = config_.hedging.task_types;
+    return types.empty() ||
+           std::find(types.begin(), types.end(), type) != types.end();
+  }
+
+  /// Runtime after which a running attempt of `type` counts as a straggler.
+  /// Recomputed by record_runtime_sample_locked(), so dispatch passes only
+  /// look it up.
+  [[nodiscard]] std::optional<std::chrono::nanoseconds>
+  hedge_threshold_locked(TaskType type) const {
+    auto it = hedge_thresholds_.find(type);
+    if (it == hedge_thresholds_.end()) {
+      return std::nullopt;
+    }
+    return it->second;
+  }
+
+  /// config_.hedging.runtime_quantile of `samples`.
+  [[nodiscard]] std::chrono::nanoseconds
+  runtime_quantile(std::vector<std::chrono::nanoseconds> samples) const {
+    const auto rank = static_cast<size_t>(
+        std::ceil(config_.hedging.runtime_quantile *
+                  static_cast<double>(samples.size())));
+    const auto index = std::min(samples.size() - 1, rank == 0 ? 0 : rank - 1);
+    std::nth_element(samples.begin(),
+                     samples.begin() + static_cast<std::ptrdiff_t>(index),
+                     samples.end());
+    return samples[index];
+  }
+
+  [[nodiscard]] bool hedge_candidate_locked(const Node &node) const {
+    return node.task.state == TaskState::Running && !node.hedged &&
+           !node.pause_requested && node.executions.size() == 1 &&
+           hedge_eligible_type(node.task.type);
+  }
+
+  [[nodiscard]] bool hedge_budget_available_locked() const {
+    return static_cast<double>(metrics_.hedges_launched + 1) <=
+           config_.hedging.max_duplicate_ratio *
+               static_cast<double>(metrics_.attempts_started);
+  }
+
+  /// Straggler whose runtime exceeded its TaskType quantile and whose
+  /// duplicate fits the budget. Ready work always wins over hedges because
+  /// workers consult pick_candidate_locked() first.
+  [[nodiscard]] std::optional<std::string>
+  pick_hedge_locked(TimePoint now) const {
+    if (!config_.hedging.enabled || !hedge_budget_available_locked()) {
+      return std::nullopt;
+    }
+
+    std::optional<std::string> best;
+    TimePoint best_started{};
+    for (const auto &task_id : running_set_) {
+      auto it = nodes_.find(task_id);
+      if (it == nodes_.end() || !hedge_candidate_locked(it->second)) {
+        continue;
+      }
+      const auto &node = it->second;
+      const auto threshold = hedge_threshold_locked(node.task.type);
+      if (!threshold.has_value() || now - node.attempt_started_at < *threshold) {
+        continue;
+      }
+      if (!fits_cpu_hard_locked(node.task.resource_demand) ||
+          !fits_soft_locked(node.task.resource_demand) ||
+          !fits_admission_locked(node.task.resource_demand) ||
+          !fits_qos_locked(node.task)) {
+        continue;
+      }
+      if (!best.has_value() || node.attempt_started_at < best_started) {
+        best = task_id;
+        best_started = node.attempt_started_at;
+      }
+    }
+    return best;
+  }
+
+  /// Earliest future moment a running attempt becomes a straggler.
+  [[nodiscard]] std::optional<TimePoint>
+  next_hedge_deadline_locked(TimePoint now) const {
+    if (!config_.hedging.enabled || !hedge_budget_available_locked()) {
+      return std::nullopt;
+    }
+    std::optional<TimePoint> earliest;
+    for (const auto &task_id : running_set_) {
+      auto it = nodes_.find(task_id);
+      if (it == nodes_.end() || !hedge_candidate_locked(it->second)) {
+        continue;
+      }
+      const auto threshold = hedge_threshold_locked(it->second.task.type);
+      if (!threshold.has_value()) {
+        continue;
+      }
+      const auto due = it->second.attempt_started_at +
+                       std::chrono::duration_cast<Clock::duration>(*threshold);
+      // Due-but-blocked hedges are re-evaluated on the next notify.
+      if (due > now && (!earliest.has_value() || due < *earliest)) {
+        earliest = due;
+      }
+    }
+    return earliest;
+  }
+
+  void record_runtime_sample_locked(TaskType type,
+                                    std::chrono::nanoseconds runtime) {
+    auto &samples = runtime_samples_[type];
+    if (samples.size() < kRuntimeSampleWindow) {
+      samples.push_back(runtime);
+    } else {
+      samples[runtime_sample_cursor_[type]++ % kRuntimeSampleWindow] = runtime;
+    }
+    if (config_.hedging.enabled &&
+        static_cast<int>(samples.size()) >= config_.hedging.min_samples) {
+      hedge_thresholds_[type] = runtime_quantile(samples);
+    }
+  }
+
+  /// Block until there is dispatchable work, promoting retries whose backoff
+  /// elapsed. Returns early with promotion events so they are not delayed
+  /// behind a long wait.
+  void wait_for_work_locked(std::unique_lock<std::mutex> &lock,
+                            std::vector<TaskEvent> &events, int worker_node) {
+    while (!stopping_) {
+      const auto now = Clock::now();
+      promote_due_retries_locked(now, events);
+      if (!events.empty() || has_runnable_task_locked(worker_node) ||
+          pick_hedge_locked(now).has_value()) {
+        return;
+      }
+
+      std::optional<TimePoint> wake_at = next_hedge_deadline_locked(now);
+      if (!retry_queue_.empty() &&
+          (!wake_at.has_value() || retry_queue_.begin()->first < *wake_at)) {
+        wake_at = retry_queue_.begin()->first;
+      }
+      for (auto release : {next_locality_release_locked(worker_node),
+                           next_batch_release_locked()}) {
+        if (release.has_value() && (!wake_at.has_value() || *release < *wake_at)) {
+          wake_at = release;
+        }
+      }
+      if (wake_at.has_value()) {
+        cv_.wait_until(lock, *wake_at);
+      } else {
+        cv_.wait(lock);
+      }
+    }
+  }
+
+  void promote_due_retries_locked(TimePoint now,
+                                  std::vector<TaskEvent> &events) {
+    while (!retry_queue_.empty() && retry_queue_.begin()->first <= now) {
+      const std::string task_id = retry_queue_.begin()->second;
+      retry_queue_.erase(retry_queue_.begin());
+
+      auto it = nodes_.find(task_id);
+      if (it == nodes_.end()) {
+        continue;
+      }
+      auto &node = it->second;
+      // Paused/canceled entries are stale; resume() re-arms paused ones.
+      if (node.task.state != TaskState::Queued || !node.retry_at.has_value()) {
         continue;
       }
+      auto ready = transition_locked(node, TaskState::Ready);
+      if (ready.is_ok()) {
+        node.retry_at.reset();
+        retry_waiting_--;
+        node.ready_since = now;
+        add_ready_locked(node);
+        events.push_back(make_event(node.task, TaskState::Ready, node.task.progress));
+      }
+    }
+  }
+
+  /// Failed attempt with a retryable error and attempts left: re-queue with
+  /// backoff instead of failing. Successors stay Queued (no propagation).
+  bool try_schedule_retry_locked(Node &node, const TaskError &err,
+                                 std::vector<TaskEvent> &events) {
+    if (!err.retryable || stopping_) {
+      return false;
+    }
+    const auto policy = resolve_retry_policy(node.task);
+    if (node.task.attempt >= policy.max_attempts) {
+      if (policy.max_attempts > 1) {
+        metrics_.retries_exhausted++;
+      }
+      return false;
+    }
+
+    auto failed = transition_locked(node, TaskState::Failed);
+    if (failed.is_err()) {
+      return false;
+    }
+    auto requeued = transition_locked(node, TaskState::Queued);
+    if (requeued.is_err()) {
+      return false;
+    }
+    node.task.error = err; // Only for the retry Queued event below
 
-      auto result = stage->execute(ctx);
-      finalize_execution(task_id, ctx, result);
+    const auto backoff = retry_backoff(policy, node.task.attempt);
+    if (!node.retry_at.has_value()) {
+      retry_waiting_++;
+    }
+    node.retry_at = Clock::now() + backoff;
+    retry_queue_.emplace(*node.retry_at, node.task.task_id);
+    metrics_.retries_scheduled++;
+    events.push_back(make_event(node.task, TaskState::Queued, node.task.progress));
+    node.task.error.reset(); // Later events of a recovered task carry no error
+
+    if (logger_) {
+      logger_->warn(node.task.trace_id, "scheduler", "task_retry_scheduled",
+                    "task_id=" + node.task.task_id +
+                        " attempt=" + std::to_string(node.task.attempt) +
+                        " max_attempts=" + std::to_string(policy.max_attempts) +
+                        " backoff_ms=" + std::to_string(backoff.count()) +
+                        " error=" + err.internal_message);
     }
+    return true;
   }
 
-  void handle_progress_callback(const std::string &task_id, float progress) {
-    std::vector<StateEvent> immediate_events;
-    std::vector<StateEvent> post_wait_events;
+  void handle_progress_callback(const std::string &task_id, int execution_id,
+                                float progress) {
+    std::vector<TaskEvent> immediate_events;
+    std::vector<TaskEvent> post_wait_events;
     bool should_wait_for_resume = false;
 
     std::unique_lock<std::mutex> lock(mutex_);
@@ -495,17 +1366,22 @@ private:
     }
 
     auto &node = it->second;
+    // Only the primary execution drives progress and pause checkpoints; a
+    // speculative duplicate reports silently until it wins.
+    if (execution_id != node.primary_execution) {
+      return;
+    }
     node.task.set_progress(progress);
     if (node.task.state == TaskState::Running) {
-      immediate_events.push_back({task_id, TaskState::Running, node.task.progress});
+      immediate_events.push_back(make_event(node.task, TaskState::Running, node.task.progress));
     }
 
     if (node.pause_requested && node.task.state == TaskState::Running) {
-      auto paused = node.task.transition_to(TaskState::Paused);
+      auto paused = transition_locked(node, TaskState::Paused);
       if (paused.is_ok()) {
         node.pause_requested = false;
         node.pause_deadline.reset();
-        immediate_events.push_back({task_id, TaskState::Paused, node.task.progress});
+        immediate_events.push_back(make_event(node.task, TaskState::Paused, node.task.progress));
         should_wait_for_resume = true;
         cv_.notify_all();
       }
@@ -531,17 +1407,23 @@ private:
 
     auto current = nodes_.find(task_id);
     if (current != nodes_.end() && current->second.task.state == TaskState::Running) {
-      post_wait_events.push_back(
-          {task_id, TaskState::Running, current->second.task.progress});
+      post_wait_events.push_back(make_event(current->second.task, TaskState::Running, current->second.task.progress));
     }
     lock.unlock();
 
     dispatch_events(post_wait_events);
   }
 
-  void finalize_execution(const std::string &task_id, StageContext &ctx,
+  void finalize_execution(Execution &exec,
                           const Result<void, TaskError> &result) {
-    std::vector<StateEvent> events;
+    std::vector<TaskEvent> events;
+    const std::string &task_id = exec.task_id;
+    std::optional<RuntimeObservation> observation;
+    std::string estimate_key;
+    std::shared_ptr<const StageOutputs> memo_outputs;
+    if (config_.estimation.estimator && result.is_ok() && !exec.memo_hit) {
+      observation = observe(exec);
+    }
 
     {
       std::lock_guard<std::mutex> lock(mutex_);
@@ -551,31 +1433,72 @@ private:
       }
 
       Node &node = it->second;
-      if (node.running) {
+      if (node.executions.erase(exec.execution_id) > 0) {
+        release_resources_locked(exec.reserved, node.task.qos);
+      }
+      const bool others_live = !node.executions.empty();
+      if (!others_live) {
         node.running = false;
         running_set_.erase(task_id);
-        release_resources_locked(node.task.resource_demand);
+      } else if (exec.execution_id == node.primary_execution) {
+        node.primary_execution = node.executions.begin()->first;
       }
 
       if (node.task.state == TaskState::Canceled) {
-        propagate_dependency_canceled_locked(task_id, events);
+        if (!others_live) {
+          propagate_dependency_canceled_locked(task_id, events);
+        }
         cv_.notify_all();
         // Do not overwrite canceled state, even if stage returned success.
-      } else if (result.is_ok()) {
-        auto succeeded = node.task.transition_to(TaskState::Succeeded);
+      } else if (node.task.state == TaskState::Succeeded) {
+        // Hedge loser finishing after the winner: result is discarded.
+      } else if (result.is_ok() &&
+                 (node.task.state == TaskState::Running || !others_live)) {
+        auto succeeded = transition_locked(node, TaskState::Succeeded);
         if (succeeded.is_ok()) {
           node.task.set_progress(1.0F);
-          node.last_outputs = ctx.outputs;
-          events.push_back({task_id, TaskState::Succeeded, 1.0F});
+          node.last_outputs =
+              std::make_shared<const StageOutputs>(std::move(exec.ctx.outputs));
+          node.numa_node = exec.numa_node;
+          if (observation.has_value()) {
+            estimate_key = node.estimate_key;
+          }
+          if (exec.memo_hit) {
+            metrics_.memo_hits++;
+            if (logger_) {
+              logger_->info(node.task.trace_id, "scheduler", "task_memo_hit",
+                            "task_id=" + task_id);
+            }
+          } else {
+            record_runtime_sample_locked(node.task.type,
+                                         Clock::now() - exec.started_at);
+            if (!exec.memo_key.empty()) {
+              memo_outputs = node.last_outputs;
+              metrics_.memo_stores++;
+            }
+          }
+          if (exec.speculative) {
+            metrics_.hedge_wins++;
+          }
+          for (auto &[_, loser] : node.executions) {
+            if (loser) {
+              loser->request_cancel();
+            }
+          }
+          events.push_back(make_event(node.task, TaskState::Succeeded, 1.0F));
+          events.back().outputs = node.last_outputs;
           wake_successors_locked(task_id, events);
         } else {
           node.task.error = succeeded.error();
-          auto failed = node.task.transition_to(TaskState::Failed);
+          auto failed = transition_locked(node, TaskState::Failed);
           if (failed.is_ok()) {
-            events.push_back({task_id, TaskState::Failed, node.task.progress});
+            events.push_back(make_event(node.task, TaskState::Failed, node.task.progress));
           }
           propagate_dependency_canceled_locked(task_id, events);
         }
+      } else if (others_live) {
+        // One racer of a hedged attempt failed (or finished while the primary
+        // is paused); the surviving execution decides the outcome.
       } else {
         const auto &err = result.error();
         node.task.error = err;
@@ -584,27 +1507,36 @@ private:
                                node.task.cancel_token->is_canceled());
 
         if (canceled) {
-          auto to_canceled = node.task.transition_to(TaskState::Canceled);
+          auto to_canceled = transition_locked(node, TaskState::Canceled);
           if (to_canceled.is_ok()) {
-            events.push_back({task_id, TaskState::Canceled, node.task.progress});
+            events.push_back(make_event(node.task, TaskState::Canceled, node.task.progress));
           }
-        } else {
-          auto to_failed = node.task.transition_to(TaskState::Failed);
+          propagate_dependency_canceled_locked(task_id, events);
+        } else if (!try_schedule_retry_locked(node, err, events)) {
+          auto to_failed = transition_locked(node, TaskState::Failed);
           if (to_failed.is_ok()) {
-            events.push_back({task_id, TaskState::Failed, node.task.progress});
+            events.push_back(make_event(node.task, TaskState::Failed, node.task.progress));
           }
+          propagate_dependency_canceled_locked(task_id, events);
         }
-
-        propagate_dependency_canceled_locked(task_id, events);
+      }
+      if (node.forgotten && node.executions.empty() && is_terminal(node.task.state)) {
+        erase_node_locked(task_id);
       }
     }
 
+    if (!estimate_key.empty()) {
+      config_.estimation.estimator->record(estimate_key, *observation);
+    }
+    if (memo_outputs) {
+      config_.memoization.memo->store(exec.memo_key, *memo_outputs);
+    }
     dispatch_events(events);
     cv_.notify_all();
   }
 
   void wake_successors_locked(const std::string &task_id,
-                              std::vector<StateEvent> &events) {
+                              std::vector<TaskEvent> &events) {
     auto succ_it = successors_.find(task_id);
     if (succ_it == successors_.end()) {
       return;
@@ -622,18 +1554,18 @@ private:
 
       succ.unmet_deps--;
       if (succ.unmet_deps == 0) {
-        auto ready = succ.task.transition_to(TaskState::Ready);
+        auto ready = transition_locked(succ, TaskState::Ready);
         if (ready.is_ok()) {
           succ.ready_since = Clock::now();
-          ready_set_.insert(succ_id);
-          events.push_back({succ_id, TaskState::Ready, succ.task.progress});
+          add_ready_locked(succ);
+          events.push_back(make_event(succ.task, TaskState::Ready, succ.task.progress));
         }
       }
     }
   }
 
   void propagate_dependency_canceled_locked(const std::string &root_id,
-                                            std::vector<StateEvent> &events) {
+                                            std::vector<TaskEvent> &events) {
     std::vector<std::string> stack;
     std::unordered_set<std::string> visited;
     stack.push_back(root_id);
@@ -667,7 +1599,7 @@ private:
           node.task.cancel_token->request_cancel();
         }
         if (node.task.state == TaskState::Ready) {
-          ready_set_.erase(succ_id);
+          remove_ready_locked(node);
         }
 
         node.task.error = TaskError(
@@ -677,9 +1609,9 @@ private:
                 {"dependency_task_id", current},
             });
 
-        auto to_canceled = node.task.transition_to(TaskState::Canceled);
+        auto to_canceled = transition_locked(node, TaskState::Canceled);
         if (to_canceled.is_ok()) {
-          events.push_back({succ_id, TaskState::Canceled, node.task.progress});
+          events.push_back(make_event(node.task, TaskState::Canceled, node.task.progress));
         }
 
         stack.push_back(succ_id);
@@ -687,8 +1619,128 @@ private:
     }
   }
 
-  [[nodiscard]] bool has_runnable_task_locked() const {
-    return pick_candidate_locked(/*allow_escape=*/true).has_value();
+  /// Recompute `task_id`'s effective priority and push changes to its
+  /// unfinished ancestors. Incremental: the walk stops at ancestors whose
+  /// effective priority does not change. Terminal tasks withdraw their boost.
+  void refresh_priority_locked(const std::string &task_id) {
+    auto it = nodes_.find(task_id);
+    if (it == nodes_.end()) {
+      return;
+    }
+    std::vector<std::string> stack;
+    recompute_effective_priority(it->second);
+    publish_priority_locked(it->second, stack);
+
+    while (!stack.empty()) {
+      const auto current = stack.back();
+      stack.pop_back();
+      auto node_it = nodes_.find(current);
+      if (node_it != nodes_.end() &&
+          recompute_effective_priority(node_it->second)) {
+        publish_priority_locked(node_it->second, stack);
+      }
+    }
+  }
+
+  static bool recompute_effective_priority(Node &node) {
+    int effective = node.task.priority;
+    for (const auto &[_, inherited] : node.inherited) {
+      effective = std::max(effective, inherited);
+    }
+    const bool changed = effective != node.effective_priority;
+    node.effective_priority = effective;
+    return changed;
+  }
+
+  /// Update this node's contribution on each unfinished dependency; deps
+  /// whose contribution changed are pushed for recomputation.
+  void publish_priority_locked(const Node &node, std::vector<std::string> &stack) {
+    const bool active = !is_terminal(node.task.state);
+    for (const auto &dep_id : node.task.deps) {
+      auto dep_it = nodes_.find(dep_id);
+      if (dep_it == nodes_.end() || is_terminal(dep_it->second.task.state)) {
+        continue;
+      }
+      auto &inherited = dep_it->second.inherited;
+      bool changed = false;
+      if (active) {
+        auto [slot, inserted] =
+            inherited.try_emplace(node.task.task_id, node.effective_priority);
+        changed = inserted || slot->second != node.effective_priority;
+        slot->second = node.effective_priority;
+      } else {
+        changed = inherited.erase(node.task.task_id) > 0;
+      }
+      if (changed) {
+        stack.push_back(dep_id);
+      }
+    }
+  }
+
+  [[nodiscard]] bool has_runnable_task_locked(int worker_node = -1) const {
+    return pick_candidate_locked(/*allow_escape=*/true, worker_node).has_value();
+  }
+
+  /// NUMA node holding most of the task's dependency outputs, or -1 when the
+  /// stage does not ask for locality (or no dependency ran on a known node).
+  [[nodiscard]] int preferred_node_locked(const Node &node) const {
+    if (!locality_enabled_ || !node.stage->prefers_input_locality()) {
+      return -1;
+    }
+    std::map<int, int> votes; // Ordered: ties go to the lowest node id
+    for (const auto &dep_id : node.task.deps) {
+      auto it = nodes_.find(dep_id);
+      if (it != nodes_.end() && it->second.numa_node >= 0) {
+        votes[it->second.numa_node]++;
+      }
+    }
+    int best = -1;
+    int best_votes = 0;
+    for (const auto &[numa_node, count] : votes) {
+      if (count > best_votes) {
+        best = numa_node;
+        best_votes = count;
+      }
+    }
+    return best;
+  }
+
+  /// Delay scheduling: a locality-seeking task is left to workers on its
+  /// preferred node until locality_wait_ms has passed since it became Ready.
+  [[nodiscard]] bool locality_hold_locked(const Node &node, int preferred,
+                                          int worker_node, TimePoint now) const {
+    return worker_node >= 0 && preferred >= 0 && preferred != worker_node &&
+           now - node.ready_since <
+               std::chrono::milliseconds(config_.affinity.locality_wait_ms);
+  }
+
+  /// Earliest time a task held for another node becomes available to
+  /// `worker_node`.
+  [[nodiscard]] std::optional<TimePoint>
+  next_locality_release_locked(int worker_node) const {
+    if (worker_node < 0) {
+      return std::nullopt;
+    }
+    const auto now = Clock::now();
+    std::optional<TimePoint> earliest;
+    for (const auto &task_id : ready_set_) {
+      auto it = nodes_.find(task_id);
+      if (it == nodes_.end()) {
+        continue;
+      }
+      const auto &node = it->second;
+      if (!locality_hold_locked(node, preferred_node_locked(node), worker_node,
+                                now)) {
+        continue;
+      }
+      const auto release =
+          node.ready_since +
+          std::chrono::milliseconds(config_.affinity.locality_wait_ms);
+      if (!earliest.has_value() || release < *earliest) {
+        earliest = release;
+      }
+    }
+    return earliest;
   }
 
   [[nodiscard]] bool fits_cpu_hard_locked(const ResourceDemand &demand) const {
@@ -696,6 +1748,96 @@ private:
            config_.resource_budget.cpu_slots_hard;
   }
 
+  /// Pressure-driven admission gate. Never blocks the only task, so a
+  /// saturated host still makes progress.
+  [[nodiscard]] bool fits_admission_locked(const ResourceDemand &demand) const {
+    if (!config_.admission.monitor || running_set_.empty()) {
+      return true;
+    }
+    if (resource_in_use_.cpu_slots + demand.cpu_slots > admission_cpu_slots_) {
+      return false;
+    }
+    return demand.ram_mb <= 0 || last_pressure_.memory_available_mb < 0 ||
+           last_pressure_.memory_available_mb -
+                   config_.admission.memory_headroom_mb >=
+               demand.ram_mb;
+  }
+
+  static size_t qos_index(QosClass qos) { return static_cast<size_t>(qos); }
+
+  /// QoS gate. Within its reservation a class only needs free slots. Beyond
+  /// it, the class borrows: it stays under its ceiling and leaves the unused
+  /// reservation of every other class with Ready work untouched. A class
+  /// with nothing running is never held by its ceiling, so an oversized task
+  /// still runs.
+  [[nodiscard]] bool fits_qos_locked(const TaskDescriptor &task) const {
+    if (!config_.qos.enabled) {
+      return true;
+    }
+    const size_t c = qos_index(task.qos);
+    const int slots = task.resource_demand.cpu_slots;
+    const int used = qos_cpu_in_use_[c];
+    if (used + slots <= qos_reserved_slots_[c]) {
+      return true;
+    }
+    if (used > 0 && used + slots > qos_max_slots_[c]) {
+      return false;
+    }
+    int held_for_others = 0;
+    for (size_t k = 0; k < kQosClassCount; ++k) {
+      if (k != c && qos_ready_counts_[k] > 0) {
+        held_for_others += std::max(0, qos_reserved_slots_[k] - qos_cpu_in_use_[k]);
+      }
+    }
+    return resource_in_use_.cpu_slots + slots + held_for_others <=
+           config_.resource_budget.cpu_slots_hard;
+  }
+
+  /// Periodically sample the pressure monitor (outside the lock) and adapt
+  /// admitted CPU slots: halve under pressure, recover one slot per calm
+  /// sample.
+  void sampler_loop() {
+    const auto interval =
+        std::chrono::milliseconds(config_.admission.sample_interval_ms);
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+      lock.unlock();
+      const auto pressure = config_.admission.monitor->sample();
+      lock.lock();
+      if (stopping_) {
+        break;
+      }
+      apply_pressure_locked(pressure);
+      cv_.notify_all();
+      cv_.wait_for(lock, interval, [this]() { return stopping_; });
+    }
+  }
+
+  void apply_pressure_locked(const ResourcePressure &pressure) {
+    const auto &policy = config_.admission;
+    const bool high = pressure.cpu_some_avg10 >= policy.cpu_pressure_high ||
+                      pressure.memory_some_avg10 >= policy.memory_pressure_high;
+    const int previous = admission_cpu_slots_;
+    if (high) {
+      admission_cpu_slots_ = std::max(1, admission_cpu_slots_ / 2);
+    } else {
+      admission_cpu_slots_ = std::min(config_.resource_budget.cpu_slots_hard,
+                                      admission_cpu_slots_ + 1);
+    }
+    last_pressure_ = pressure;
+
+    if (admission_cpu_slots_ < previous) {
+      metrics_.admission_throttles++;
+      if (logger_) {
+        logger_->warn("", "scheduler", "admission_throttled",
+                      "cpu_slots=" + std::to_string(admission_cpu_slots_) +
+                          " cpu_psi=" + std::to_string(pressure.cpu_some_avg10) +
+                          " mem_psi=" +
+                          std::to_string(pressure.memory_some_avg10));
+      }
+    }
+  }
+
   [[nodiscard]] bool fits_soft_locked(const ResourceDemand &demand) const {
     const bool ram_ok = config_.resource_budget.ram_soft_mb <= 0 ||
                         resource_in_use_.ram_mb + demand.ram_mb <=
@@ -707,7 +1849,7 @@ private:
   }
 
   [[nodiscard]] std::optional<Candidate>
-  pick_candidate_locked(bool allow_escape) const {
+  pick_candidate_locked(bool allow_escape, int worker_node = -1) const {
     const auto now = Clock::now();
     std::optional<Candidate> best_soft_fit;
     std::optional<Candidate> best_soft_over;
@@ -721,7 +1863,14 @@ private:
       if (node.task.state != TaskState::Ready) {
         continue;
       }
-      if (!fits_cpu_hard_locked(node.task.resource_demand)) {
+      if (!fits_cpu_hard_locked(node.task.resource_demand) ||
+          !fits_admission_locked(node.task.resource_demand) ||
+          !fits_qos_locked(node.task)) {
+        continue;
+      }
+      const int preferred = preferred_node_locked(node);
+      if (locality_hold_locked(node, preferred, worker_node, now) ||
+          batch_hold_locked(node, now)) {
         continue;
       }
 
@@ -731,7 +1880,7 @@ private:
       const auto intervals =
           wait_ms / std::max(1, config_.aging_policy.interval_ms);
       const long long score =
-          static_cast<long long>(node.task.priority) +
+          static_cast<long long>(node.effective_priority) +
           static_cast<long long>(intervals) *
               static_cast<long long>(config_.aging_policy.boost_per_interval);
 
@@ -740,11 +1889,26 @@ private:
       candidate.effective_priority = score;
       candidate.ready_since = node.ready_since;
       candidate.soft_fit = fits_soft_locked(node.task.resource_demand);
+      candidate.preferred_node = preferred;
+      if (node.task.estimated_runtime_ms.has_value()) {
+        candidate.expected_runtime_ms = *node.task.estimated_runtime_ms;
+      }
+      candidate.reserved =
+          config_.qos.enabled &&
+          qos_cpu_in_use_[qos_index(node.task.qos)] <
+              qos_reserved_slots_[qos_index(node.task.qos)];
 
       auto better_than = [](const Candidate &lhs, const Candidate &rhs) {
+        if (lhs.reserved != rhs.reserved) {
+          return lhs.reserved;
+        }
         if (lhs.effective_priority != rhs.effective_priority) {
           return lhs.effective_priority > rhs.effective_priority;
         }
+        // Equal score: shortest expected job first frees workers sooner
+        if (lhs.expected_runtime_ms != rhs.expected_runtime_ms) {
+          return lhs.expected_runtime_ms < rhs.expected_runtime_ms;
+        }
         if (lhs.ready_since != rhs.ready_since) {
           return lhs.ready_since < rhs.ready_since;
         }
@@ -772,13 +1936,16 @@ private:
     return std::nullopt;
   }
 
-  void reserve_resources_locked(const ResourceDemand &demand) {
+  void reserve_resources_locked(const ResourceDemand &demand, QosClass qos) {
+    qos_cpu_in_use_[qos_index(qos)] += demand.cpu_slots;
     resource_in_use_.cpu_slots += demand.cpu_slots;
     resource_in_use_.ram_mb += demand.ram_mb;
     resource_in_use_.vram_mb += demand.vram_mb;
   }
 
-  void release_resources_locked(const ResourceDemand &demand) {
+  void release_resources_locked(const ResourceDemand &demand, QosClass qos) {
+    auto &qos_slots = qos_cpu_in_use_[qos_index(qos)];
+    qos_slots = std::max(0, qos_slots - demand.cpu_slots);
     resource_in_use_.cpu_slots = std::max(0, resource_in_use_.cpu_slots - demand.cpu_slots);
     resource_in_use_.ram_mb = std::max(0, resource_in_use_.ram_mb - demand.ram_mb);
     resource_in_use_.vram_mb =
@@ -818,15 +1985,29 @@ private:
     return false;
   }
 
-  void dispatch_events(const std::vector<StateEvent> &events) {
+  void dispatch_events(const std::vector<TaskEvent> &events) {
     if (events.empty()) {
       return;
     }
 
     std::vector<StateCallback> callbacks;
+    std::vector<TaskEventCallback> task_event_callbacks;
     {
       std::lock_guard<std::mutex> lock(mutex_);
       callbacks = callbacks_;
+      task_event_callbacks = task_event_callbacks_;
+      for (const auto &event : events) {
+        if (is_terminal(event.state)) {
+          refresh_priority_locked(event.task_id); // Withdraw inherited boost
+        }
+        if (event.state == TaskState::Succeeded) {
+          metrics_.tasks_succeeded++;
+        } else if (event.state == TaskState::Failed) {
+          metrics_.tasks_failed++;
+        } else if (event.state == TaskState::Canceled) {
+          metrics_.tasks_canceled++;
+        }
+      }
     }
 
     for (const auto &event : events) {
@@ -835,11 +2016,18 @@ private:
           cb(event.task_id, event.state, event.progress);
         }
       }
+      for (const auto &cb : task_event_callbacks) {
+        if (cb) {
+          cb(event);
+        }
+      }
     }
   }
 
   SchedulerConfig config_;
   std::shared_ptr<ILogger> logger_;
+  std::vector<WorkerPlacement> placement_; // Indexed by worker
+  bool locality_enabled_ = false; // Workers span more than one NUMA node
 
   mutable std::mutex mutex_;
   std::condition_variable cv_;
@@ -848,11 +2036,32 @@ private:
   std::unordered_map<std::string, Node> nodes_;
   std::unordered_map<std::string, std::vector<std::string>> successors_;
   std::unordered_set<std::string> ready_set_;
+  std::array<int, kQosClassCount> qos_ready_counts_{};    // ready_set_ per QosClass
+  std::unordered_map<std::string, int> batch_group_sizes_; // ready_set_ per batch key
   std::unordered_set<std::string> running_set_;
+  std::multimap<TimePoint, std::string> retry_queue_; // retry_at → task_id
+  std::unordered_map<std::string, std::vector<std::string>> trace_tasks_; // For forget()
+  size_t unfinished_tasks_ = 0; // Nodes not yet terminal
+  size_t retry_waiting_ = 0;    // Unfinished nodes backing off before a retry
   ResourceUsage resource_in_use_{};
+  SchedulerMetrics metrics_{};
+  int admission_cpu_slots_ = 0; // <= cpu_slots_hard; shrinks under pressure
+  ResourcePressure last_pressure_{};
+  std::array<int, kQosClassCount> qos_reserved_slots_{}; // From QosPolicy shares
+  std::array<int, kQosClassCount> qos_max_slots_{};
+  std::array<int, kQosClassCount> qos_cpu_in_use_{};
+
+  static constexpr size_t kRuntimeSampleWindow = 128;
+  std::unordered_map<TaskType, std::vector<std::chrono::nanoseconds>>
+      runtime_samples_; // Successful attempt runtimes (ring buffer per type)
+  std::unordered_map<TaskType, size_t> runtime_sample_cursor_;
+  std::unordered_map<TaskType, std::chrono::nanoseconds>
+      hedge_thresholds_; // Straggler cutoff per type, once min_samples exist
 
   std::vector<std::thread> workers_;
+  std::thread sampler_; // Pressure sampling (admission.monitor set)
   std::vector<StateCallback> callbacks_;
+  std::vector<TaskEventCallback> task_event_callbacks_;
 };
 
 } // namespace
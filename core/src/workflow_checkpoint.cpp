@@ -0,0 +1,554 @@
+#include "core/workflow_checkpoint.h"
+
+#include <algorithm>
+#include <any>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <system_error>
+#include <type_traits>
+
+namespace stv::core {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr const char *kMagic = "stv-workflow-manifest";
+constexpr int kFormatVersion = 1;
+constexpr const char *kSuffix = ".manifest";
+
+TaskError checkpoint_error(const std::string &why, const std::string &path) {
+  return TaskError(ErrorCategory::Internal, 3103, false, "Cannot use workflow checkpoint",
+                   why + ": " + path, {{"path", path}});
+}
+
+/// Trace ids become file names; allow only what new_id_string() and the
+/// tests produce.
+bool safe_file_stem(const std::string &text) {
+  if (text.empty() || text.size() > 128 || text[0] == '.') {
+    return false;
+  }
+  for (char c : text) {
+    const bool ok = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+                    (c >= 'A' && c <= 'Z') || c == '-' || c == '_' || c == '.';
+    if (!ok) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// ---- Token encoding ----
+// Tokens are space separated; '%', '=', ',' and control/space bytes are
+// percent-escaped so keys, ids and list items never contain a separator.
+
+constexpr char kHex[] = "0123456789abcdef";
+
+void append_escaped(std::string &out, const std::string &text) {
+  for (unsigned char c : text) {
+    if (c <= 0x20 || c == 0x7f || c == '%' || c == '=' || c == ',') {
+      out += '%';
+      out += kHex[c >> 4];
+      out += kHex[c & 0xF];
+    } else {
+      out += static_cast<char>(c);
+    }
+  }
+}
+
+int hex_digit(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+bool unescape(const std::string &text, std::string &out) {
+  out.clear();
+  out.reserve(text.size());
+  for (size_t i = 0; i < text.size(); ++i) {
+    if (text[i] != '%') {
+      out += text[i];
+      continue;
+    }
+    if (i + 2 >= text.size()) {
+      return false;
+    }
+    const int hi = hex_digit(text[i + 1]);
+    const int lo = hex_digit(text[i + 2]);
+    if (hi < 0 || lo < 0) {
+      return false;
+    }
+    out += static_cast<char>((hi << 4) | lo);
+    i += 2;
+  }
+  return true;
+}
+
+/// Fixed-width hex of the bit pattern: exact and locale independent.
+template <typename T> std::string bits_hex(T value) {
+  static_assert(sizeof(T) == 4 || sizeof(T) == 8);
+  using Bits = std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>;
+  Bits bits = 0;
+  std::memcpy(&bits, &value, sizeof(T));
+  std::string out(sizeof(T) * 2, '0');
+  for (size_t i = out.size(); i-- > 0;) {
+    out[i] = kHex[bits & 0xF];
+    bits >>= 4;
+  }
+  return out;
+}
+
+template <typename T> bool parse_bits_hex(const std::string &text, T &out) {
+  using Bits = std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>;
+  if (text.size() != sizeof(T) * 2) {
+    return false;
+  }
+  Bits bits = 0;
+  for (char c : text) {
+    const int digit = hex_digit(c);
+    if (digit < 0) {
+      return false;
+    }
+    bits = (bits << 4) | static_cast<Bits>(digit);
+  }
+  std::memcpy(&out, &bits, sizeof(T));
+  return true;
+}
+
+bool parse_int64(const std::string &text, int64_t &out) {
+  if (text.empty()) {
+    return false;
+  }
+  char *end = nullptr;
+  errno = 0;
+  const long long value = std::strtoll(text.c_str(), &end, 10);
+  if (errno != 0 || !end || *end != 0) {
+    return false;
+  }
+  out = value;
+  return true;
+}
+
+bool parse_int(const std::string &text, int &out) {
+  int64_t value = 0;
+  if (!parse_int64(text, value) || value < INT32_MIN || value > INT32_MAX) {
+    return false;
+  }
+  out = static_cast<int>(value);
+  return true;
+}
+
+/// `<tag>:<payload>`; false for types without an encoding.
+bool encode_value(const std::any &value, std::string &out) {
+  if (const auto *s = std::any_cast<std::string>(&value)) {
+    out += "s:";
+    append_escaped(out, *s);
+  } else if (const auto *i = std::any_cast<int>(&value)) {
+    out += "i:" + std::to_string(*i);
+  } else if (const auto *l = std::any_cast<int64_t>(&value)) {
+    out += "l:" + std::to_string(*l);
+  } else if (const auto *b = std::any_cast<bool>(&value)) {
+    out += *b ? "b:1" : "b:0";
+  } else if (const auto *f = std::any_cast<float>(&value)) {
+    out += "f:" + bits_hex(*f);
+  } else if (const auto *d = std::any_cast<double>(&value)) {
+    out += "d:" + bits_hex(*d);
+  } else if (const auto *vs = std::any_cast<std::vector<std::string>>(&value)) {
+    out += "S:" + std::to_string(vs->size());
+    for (const auto &item : *vs) {
+      out += ',';
+      append_escaped(out, item);
+    }
+  } else if (const auto *vi = std::any_cast<std::vector<int>>(&value)) {
+    out += "I:" + std::to_string(vi->size());
+    for (int item : *vi) {
+      out += ',' + std::to_string(item);
+    }
+  } else {
+    return false;
+  }
+  return true;
+}
+
+std::vector<std::string> split(const std::string &text, char sep) {
+  std::vector<std::string> parts;
+  size_t start = 0;
+  while (true) {
+    const size_t pos = text.find(sep, start);
+    parts.push_back(text.substr(start, pos - start));
+    if (pos == std::string::npos) {
+      return parts;
+    }
+    start = pos + 1;
+  }
+}
+
+bool decode_value(const std::string &text, std::any &out) {
+  if (text.size() < 2 || text[1] != ':') {
+    return false;
+  }
+  const char tag = text[0];
+  const std::string payload = text.substr(2);
+  switch (tag) {
+  case 's': {
+    std::string s;
+    if (!unescape(payload, s)) {
+      return false;
+    }
+    out = std::move(s);
+    return true;
+  }
+  case 'i': {
+    int i = 0;
+    if (!parse_int(payload, i)) {
+      return false;
+    }
+    out = i;
+    return true;
+  }
+  case 'l': {
+    int64_t l = 0;
+    if (!parse_int64(payload, l)) {
+      return false;
+    }
+    out = l;
+    return true;
+  }
+  case 'b':
+    if (payload != "0" && payload != "1") {
+      return false;
+    }
+    out = payload == "1";
+    return true;
+  case 'f': {
+    float f = 0.0F;
+    if (!parse_bits_hex(payload, f)) {
+      return false;
+    }
+    out = f;
+    return true;
+  }
+  case 'd': {
+    double d = 0.0;
+    if (!parse_bits_hex(payload, d)) {
+      return false;
+    }
+    out = d;
+    return true;
+  }
+  case 'S':
+  case 'I': {
+    const auto parts = split(payload, ',');
+    int count = 0;
+    if (!parse_int(parts[0], count) || count < 0 ||
+        static_cast<size_t>(count) != parts.size() - 1) {
+      return false;
+    }
+    if (tag == 'S') {
+      std::vector<std::string> items(parts.size() - 1);
+      for (size_t i = 1; i < parts.size(); ++i) {
+        if (!unescape(parts[i], items[i - 1])) {
+          return false;
+        }
+      }
+      out = std::move(items);
+    } else {
+      std::vector<int> items(parts.size() - 1);
+      for (size_t i = 1; i < parts.size(); ++i) {
+        if (!parse_int(parts[i], items[i - 1])) {
+          return false;
+        }
+      }
+      out = std::move(items);
+    }
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+/// ` key=value` for every entry; false if any value has no encoding.
+bool append_values(std::string &line, const StageOutputs &values) {
+  for (const auto &[key, value] : values) {
+    line += ' ';
+    append_escaped(line, key);
+    line += '=';
+    if (!encode_value(value, line)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool parse_values(const std::vector<std::string> &tokens, size_t first, StageOutputs &out) {
+  for (size_t i = first; i < tokens.size(); ++i) {
+    const auto eq = tokens[i].find('=');
+    std::string key;
+    std::any value;
+    if (eq == std::string::npos || !unescape(tokens[i].substr(0, eq), key) ||
+        !decode_value(tokens[i].substr(eq + 1), value)) {
+      return false;
+    }
+    out[key] = std::move(value);
+  }
+  return true;
+}
+
+std::string done_line(const std::string &task_id, const StageOutputs &outputs, bool &ok) {
+  std::string line = "done ";
+  append_escaped(line, task_id);
+  ok = append_values(line, outputs);
+  line += '\n';
+  return line;
+}
+
+} // namespace
+
+struct FileWorkflowCheckpointStore::Journal {
+  std::mutex mutex;
+  std::ofstream out;
+};
+
+FileWorkflowCheckpointStore::FileWorkflowCheckpointStore(std::string directory)
+    : directory_(std::move(directory)) {
+  std::error_code ec;
+  fs::create_directories(directory_, ec); // begin() reports a missing directory
+}
+
+FileWorkflowCheckpointStore::~FileWorkflowCheckpointStore() = default;
+
+std::string FileWorkflowCheckpointStore::path_for(const std::string &trace_id) const {
+  return (fs::path(directory_) / (trace_id + kSuffix)).string();
+}
+
+Result<void, TaskError> FileWorkflowCheckpointStore::begin(const WorkflowManifest &manifest) {
+  if (!safe_file_stem(manifest.trace_id)) {
+    return Result<void, TaskError>::Err(
+        checkpoint_error("trace_id is not a safe file name", manifest.trace_id));
+  }
+  const std::string path = path_for(manifest.trace_id);
+
+  std::string text = std::string(kMagic) + ' ' + std::to_string(kFormatVersion) + ' ';
+  append_escaped(text, manifest.trace_id);
+  text += ' ' + std::to_string(manifest.generation) + '\n';
+  for (const auto &task : manifest.tasks) {
+    text += "task ";
+    append_escaped(text, task.task_id);
+    text += ' ';
+    text += to_string(task.type);
+    text += ' ' + std::to_string(task.priority) + ' ' +
+            std::to_string(task.resource_demand.cpu_slots) + ' ' +
+            std::to_string(task.resource_demand.ram_mb) + ' ' +
+            std::to_string(task.resource_demand.vram_mb) +
+            (task.pin_resource_demand ? " 1 " : " 0 ");
+    if (task.deps.empty()) {
+      text += '-';
+    }
+    for (size_t i = 0; i < task.deps.size(); ++i) {
+      if (i > 0) {
+        text += ',';
+      }
+      append_escaped(text, task.deps[i]);
+    }
+    if (!append_values(text, task.inputs)) {
+      return Result<void, TaskError>::Err(
+          checkpoint_error("input of " + task.task_id + " has no encoding", path));
+    }
+    text += '\n';
+  }
+  for (const auto &task : manifest.tasks) {
+    if (task.succeeded) {
+      bool ok = false;
+      const std::string line = done_line(task.task_id, task.outputs, ok);
+      if (ok) {
+        text += line;
+      }
+    }
+  }
+
+  // Readers only ever see a complete header: write aside, then rename.
+  const std::string temp = path + ".tmp";
+  {
+    std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+    out << text;
+    out.flush();
+    if (!out) {
+      return Result<void, TaskError>::Err(checkpoint_error("write failed", temp));
+    }
+  }
+  std::error_code ec;
+  fs::rename(temp, path, ec);
+  if (ec) {
+    fs::remove(temp, ec);
+    return Result<void, TaskError>::Err(checkpoint_error("rename failed", path));
+  }
+
+  auto journal = std::make_shared<Journal>();
+  journal->out.open(path, std::ios::binary | std::ios::app);
+  if (!journal->out) {
+    return Result<void, TaskError>::Err(checkpoint_error("open failed", path));
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  open_[manifest.trace_id] = std::move(journal);
+  return Result<void, TaskError>::Ok();
+}
+
+bool FileWorkflowCheckpointStore::record(const std::string &trace_id,
+                                         const std::string &task_id,
+                                         const StageOutputs &outputs) {
+  std::shared_ptr<Journal> journal;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = open_.find(trace_id);
+    if (it == open_.end()) {
+      return false;
+    }
+    journal = it->second;
+  }
+  bool ok = false;
+  const std::string line = done_line(task_id, outputs, ok);
+  if (!ok) {
+    return false;
+  }
+  // One write + flush per completion. Flushing hands the line to the OS, so
+  // it survives a crash or quit of this process (not a power loss).
+  std::lock_guard<std::mutex> lock(journal->mutex);
+  journal->out.write(line.data(), static_cast<std::streamsize>(line.size()));
+  journal->out.flush();
+  return static_cast<bool>(journal->out);
+}
+
+void FileWorkflowCheckpointStore::finish(const std::string &trace_id, bool keep) {
+  std::shared_ptr<Journal> journal;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = open_.find(trace_id);
+    if (it != open_.end()) {
+      journal = std::move(it->second);
+      open_.erase(it);
+    }
+  }
+  if (journal) {
+    std::lock_guard<std::mutex> lock(journal->mutex);
+    journal->out.close();
+  }
+  if (!keep && safe_file_stem(trace_id)) {
+    std::error_code ec;
+    fs::remove(path_for(trace_id), ec);
+  }
+}
+
+Result<WorkflowManifest, TaskError>
+FileWorkflowCheckpointStore::load(const std::string &trace_id) {
+  using LoadResult = Result<WorkflowManifest, TaskError>;
+  if (!safe_file_stem(trace_id)) {
+    return LoadResult::Err(checkpoint_error("trace_id is not a safe file name", trace_id));
+  }
+  const std::string path = path_for(trace_id);
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return LoadResult::Err(checkpoint_error("no checkpoint", path));
+  }
+  std::ostringstream buffer;
+  buffer << in.rdbuf();
+  const std::string text = buffer.str();
+
+  WorkflowManifest manifest;
+  std::unordered_map<std::string, size_t> index;
+  size_t start = 0;
+  int line_number = 0;
+  while (start < text.size()) {
+    const size_t end = text.find('\n', start);
+    if (end == std::string::npos) {
+      break; // Torn final record: that task re-runs
+    }
+    const auto tokens = split(text.substr(start, end - start), ' ');
+    start = end + 1;
+    ++line_number;
+    auto bad_line = [&] {
+      return LoadResult::Err(
+          checkpoint_error("malformed line " + std::to_string(line_number), path));
+    };
+
+    if (line_number == 1) {
+      if (tokens.size() != 4 || tokens[0] != kMagic ||
+          tokens[1] != std::to_string(kFormatVersion) ||
+          !unescape(tokens[2], manifest.trace_id) ||
+          !parse_int(tokens[3], manifest.generation)) {
+        return bad_line();
+      }
+      continue;
+    }
+    if (tokens[0] == "task" && tokens.size() >= 9) {
+      WorkflowManifest::Task task;
+      int pin = 0;
+      if (!unescape(tokens[1], task.task_id) || !parse_task_type(tokens[2], task.type) ||
+          !parse_int(tokens[3], task.priority) ||
+          !parse_int(tokens[4], task.resource_demand.cpu_slots) ||
+          !parse_int(tokens[5], task.resource_demand.ram_mb) ||
+          !parse_int(tokens[6], task.resource_demand.vram_mb) || !parse_int(tokens[7], pin) ||
+          !parse_values(tokens, 9, task.inputs)) {
+        return bad_line();
+      }
+      task.pin_resource_demand = pin != 0;
+      if (tokens[8] != "-") {
+        for (const auto &dep : split(tokens[8], ',')) {
+          std::string id;
+          if (!unescape(dep, id)) {
+            return bad_line();
+          }
+          task.deps.push_back(std::move(id));
+        }
+      }
+      index[task.task_id] = manifest.tasks.size();
+      manifest.tasks.push_back(std::move(task));
+    } else if (tokens[0] == "done" && tokens.size() >= 2) {
+      std::string id;
+      StageOutputs outputs;
+      if (!unescape(tokens[1], id) || !parse_values(tokens, 2, outputs)) {
+        return bad_line();
+      }
+      auto it = index.find(id);
+      if (it != index.end()) {
+        auto &task = manifest.tasks[it->second];
+        task.succeeded = true;
+        task.outputs = std::move(outputs);
+      }
+    } else {
+      return bad_line();
+    }
+  }
+  if (line_number == 0 || manifest.trace_id != trace_id) {
+    return LoadResult::Err(checkpoint_error("missing or foreign header", path));
+  }
+  return LoadResult::Ok(std::move(manifest));
+}
+
+std::vector<std::string> FileWorkflowCheckpointStore::list() {
+  std::vector<std::string> traces;
+  std::error_code ec;
+  for (fs::directory_iterator it(directory_, ec), end; !ec && it != end; it.increment(ec)) {
+    const auto &path = it->path();
+    if (path.extension() == kSuffix) {
+      traces.push_back(path.stem().string());
+    }
+  }
+  std::sort(traces.begin(), traces.end());
+  return traces;
+}
+
+} // namespace stv::core
@@ -0,0 +1,315 @@
+#include "core/workflow_template.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace stv::core {
+
+namespace {
+
+using PlanResult = Result<std::shared_ptr<const WorkflowPlan>, TaskError>;
+
+TaskError template_error(int line, const std::string &why) {
+  return TaskError(ErrorCategory::Pipeline, 3101, false, "Invalid workflow template",
+                   (line > 0 ? "line " + std::to_string(line) + ": " : std::string()) + why,
+                   {{"line", std::to_string(line)}});
+}
+
+bool parse_non_negative(const std::string &text, int &out) {
+  char *end = nullptr;
+  const long value = std::strtol(text.c_str(), &end, 10);
+  if (text.empty() || !end || *end != 0 || value < 0 || value > 1000000) {
+    return false;
+  }
+  out = static_cast<int>(value);
+  return true;
+}
+
+std::vector<std::string> split(const std::string &text, char sep) {
+  std::vector<std::string> parts;
+  std::string part;
+  std::istringstream in(text);
+  while (std::getline(in, part, sep)) {
+    parts.push_back(part);
+  }
+  return parts;
+}
+
+} // namespace
+
+// ---- Compilation (once per template) ----
+
+PlanResult compile_workflow_template(const std::string &text) {
+  auto plan = std::make_shared<WorkflowPlan>();
+  std::unordered_map<std::string, uint32_t> by_name;
+  std::vector<std::pair<int, std::vector<std::string>>> pending_deps; // line, names
+
+  std::istringstream in(text);
+  std::string line;
+  int line_number = 0;
+  while (std::getline(in, line)) {
+    ++line_number;
+    if (const auto hash = line.find('#'); hash != std::string::npos) {
+      line.resize(hash);
+    }
+    std::istringstream words(line);
+    std::string directive;
+    if (!(words >> directive)) {
+      continue;
+    }
+    if (directive == "workflow") {
+      if (!(words >> plan->name_)) {
+        return PlanResult::Err(template_error(line_number, "workflow needs a name"));
+      }
+      continue;
+    }
+    if (directive != "stage") {
+      return PlanResult::Err(template_error(line_number, "unknown directive: " + directive));
+    }
+
+    WorkflowPlan::Stage stage;
+    std::string type_name;
+    if (!(words >> stage.name >> type_name)) {
+      return PlanResult::Err(template_error(line_number, "expected: stage <name> <TaskType>"));
+    }
+    if (!parse_task_type(type_name, stage.type)) {
+      return PlanResult::Err(template_error(line_number, "unknown task type: " + type_name));
+    }
+    if (by_name.count(stage.name) != 0) {
+      return PlanResult::Err(template_error(line_number, "duplicate stage: " + stage.name));
+    }
+
+    std::vector<std::string> dep_names;
+    std::string option;
+    while (words >> option) {
+      const auto eq = option.find('=');
+      const std::string key = option.substr(0, eq);
+      const std::string value = eq == std::string::npos ? std::string() : option.substr(eq + 1);
+      bool ok = true;
+      if (key == "per_scene" && eq == std::string::npos) {
+        stage.per_scene = true;
+      } else if (key == "pin_demand" && eq == std::string::npos) {
+        stage.pin_demand = true;
+      } else if (key == "workflow_inputs" && eq == std::string::npos) {
+        stage.workflow_inputs = true;
+      } else if (key == "after") {
+        dep_names = split(value, ',');
+        ok = !dep_names.empty() &&
+             std::none_of(dep_names.begin(), dep_names.end(),
+                          [](const std::string &d) { return d.empty(); });
+      } else if (key == "priority") {
+        ok = parse_non_negative(value, stage.priority);
+      } else if (key == "scene_bias") {
+        ok = parse_non_negative(value, stage.scene_bias);
+      } else if (key == "cpu_slots") {
+        ok = parse_non_negative(value, stage.demand.cpu_slots) && stage.demand.cpu_slots > 0;
+      } else if (key == "ram_mb") {
+        ok = parse_non_negative(value, stage.demand.ram_mb);
+      } else if (key == "vram_mb") {
+        ok = parse_non_negative(value, stage.demand.vram_mb);
+      } else {
+        ok = false;
+      }
+      if (!ok) {
+        return PlanResult::Err(template_error(line_number, "invalid option: " + option));
+      }
+    }
+    if (stage.scene_bias > 0 && !stage.per_scene) {
+      return PlanResult::Err(
+          template_error(line_number, "scene_bias needs per_scene: " + stage.name));
+    }
+
+    by_name.emplace(stage.name, static_cast<uint32_t>(plan->stages_.size()));
+    plan->stages_.push_back(std::move(stage));
+    pending_deps.emplace_back(line_number, std::move(dep_names));
+  }
+
+  auto &stages = plan->stages_;
+  if (stages.empty()) {
+    return PlanResult::Err(template_error(0, "template has no stages"));
+  }
+  if (plan->name_.empty()) {
+    plan->name_ = "unnamed";
+  }
+
+  // Resolve dependency names (forward references are allowed).
+  for (size_t i = 0; i < stages.size(); ++i) {
+    for (const auto &dep : pending_deps[i].second) {
+      auto it = by_name.find(dep);
+      if (it == by_name.end()) {
+        return PlanResult::Err(template_error(pending_deps[i].first, "unknown stage: " + dep));
+      }
+      if (it->second == i) {
+        return PlanResult::Err(template_error(pending_deps[i].first, "depends on itself"));
+      }
+      stages[i].deps.push_back(it->second);
+    }
+  }
+
+  // Kahn's algorithm, lowest declaration index first so emission order is
+  // stable and matches the template wherever the DAG allows.
+  std::vector<int> indegree(stages.size(), 0);
+  std::vector<std::vector<uint32_t>> dependents(stages.size());
+  for (uint32_t i = 0; i < stages.size(); ++i) {
+    indegree[i] = static_cast<int>(stages[i].deps.size());
+    for (auto dep : stages[i].deps) {
+      dependents[dep].push_back(i);
+    }
+  }
+  std::vector<uint32_t> order;
+  std::vector<uint32_t> ready;
+  for (uint32_t i = 0; i < stages.size(); ++i) {
+    if (indegree[i] == 0) {
+      ready.push_back(i);
+    }
+  }
+  while (!ready.empty()) {
+    auto next = std::min_element(ready.begin(), ready.end());
+    const uint32_t s = *next;
+    ready.erase(next);
+    order.push_back(s);
+    for (auto d : dependents[s]) {
+      if (--indegree[d] == 0) {
+        ready.push_back(d);
+      }
+    }
+  }
+  if (order.size() != stages.size()) {
+    return PlanResult::Err(template_error(0, "dependency cycle"));
+  }
+
+  // Group: once stages before any per-scene stage (head), per-scene stages,
+  // and once stages that fan in from per-scene stages (tail).
+  for (auto s : order) {
+    auto &stage = stages[s];
+    if (stage.per_scene) {
+      stage.group = WorkflowPlan::Group::Scene;
+    } else {
+      const bool fan_in = std::any_of(stage.deps.begin(), stage.deps.end(), [&](uint32_t d) {
+        return stages[d].group != WorkflowPlan::Group::Head;
+      });
+      stage.group = fan_in ? WorkflowPlan::Group::Tail : WorkflowPlan::Group::Head;
+    }
+    if (stage.per_scene) {
+      for (auto d : stage.deps) {
+        if (stages[d].group == WorkflowPlan::Group::Tail) {
+          return PlanResult::Err(template_error(
+              pending_deps[s].first,
+              "per-scene stage " + stage.name + " cannot follow fan-in stage " + stages[d].name));
+        }
+      }
+    }
+    auto &group = stage.group == WorkflowPlan::Group::Head    ? plan->head_
+                  : stage.group == WorkflowPlan::Group::Scene ? plan->scene_
+                                                              : plan->tail_;
+    stage.slot = static_cast<uint32_t>(group.size());
+    group.push_back(s);
+  }
+
+  return PlanResult::Ok(std::move(plan));
+}
+
+PlanResult load_workflow_template(const std::string &path) {
+  std::ifstream in(path);
+  if (!in) {
+    return PlanResult::Err(
+        TaskError(ErrorCategory::Internal, 3102, false, "Cannot read workflow template",
+                  "open failed: " + path, {{"path", path}}));
+  }
+  std::ostringstream text;
+  text << in.rdbuf();
+  return compile_workflow_template(text.str());
+}
+
+// ---- Instantiation (per workflow) ----
+
+size_t WorkflowPlan::task_index(const Stage &stage, int scene, int scene_count) const {
+  switch (stage.group) {
+  case Group::Head:
+    return stage.slot;
+  case Group::Scene:
+    return head_.size() + static_cast<size_t>(scene) * scene_.size() + stage.slot;
+  case Group::Tail:
+    break;
+  }
+  return head_.size() + static_cast<size_t>(scene_count) * scene_.size() + stage.slot;
+}
+
+std::vector<TaskDescriptor>
+WorkflowPlan::instantiate(const std::string &trace_id, int scene_count,
+                          const std::unordered_map<std::string, std::any> &workflow_inputs) const {
+  const size_t total = task_count(scene_count);
+  std::vector<TaskDescriptor> tasks(total);
+  for (size_t i = 0; i < total; ++i) {
+    auto &id = tasks[i].task_id;
+    id.reserve(trace_id.size() + 8);
+    id.append(trace_id).append(1, '.').append(std::to_string(i));
+  }
+
+  auto stamp = [&](const Stage &stage, int scene) {
+    auto &task = tasks[task_index(stage, scene, scene_count)];
+    task.trace_id = trace_id;
+    task.type = stage.type;
+    task.priority = stage.priority;
+    task.resource_demand = stage.demand;
+    task.pin_resource_demand = stage.pin_demand;
+    if (stage.workflow_inputs) {
+      task.inputs = workflow_inputs;
+    }
+    if (stage.per_scene) {
+      task.priority += std::max(0, stage.scene_bias - scene);
+      task.inputs["scene_index"] = scene;
+    }
+    for (auto d : stage.deps) {
+      const auto &dep = stages_[d];
+      if (dep.per_scene && !stage.per_scene) {
+        for (int s = 0; s < scene_count; ++s) { // Fan-in, scene order
+          task.deps.push_back(tasks[task_index(dep, s, scene_count)].task_id);
+        }
+      } else {
+        task.deps.push_back(tasks[task_index(dep, scene, scene_count)].task_id);
+      }
+    }
+  };
+
+  for (auto s : head_) {
+    stamp(stages_[s], 0);
+  }
+  for (int scene = 0; scene < scene_count; ++scene) {
+    for (auto s : scene_) {
+      stamp(stages_[s], scene);
+    }
+  }
+  for (auto s : tail_) {
+    stamp(stages_[s], 0);
+  }
+  return tasks;
+}
+
+// ---- Built-in template ----
+
+const std::string &default_workflow_template() {
+  // Earlier scenes rank slightly higher (scene_bias) so segments complete in
+  // order; the storyboard outranks everything, the concat runs last.
+  static const std::string kTemplate =
+      "workflow story_to_video\n"
+      "stage storyboard Storyboard priority=100 workflow_inputs\n"
+      "stage image      ImageGen   per_scene after=storyboard priority=50 scene_bias=10\n"
+      "stage tts        TTS        per_scene after=storyboard priority=50 scene_bias=10\n"
+      "stage clip       VideoClip  per_scene after=image      priority=40 scene_bias=10\n"
+      "stage segment    Compose    per_scene after=clip,tts   priority=30 scene_bias=10\n"
+      "stage concat     Concat     after=segment priority=10\n";
+  return kTemplate;
+}
+
+std::shared_ptr<const WorkflowPlan> default_workflow_plan() {
+  static const std::shared_ptr<const WorkflowPlan> plan = [] {
+    auto compiled = compile_workflow_template(default_workflow_template());
+    return compiled.is_ok() ? compiled.value() : nullptr;
+  }();
+  return plan;
+}
+
+} // namespace stv::core
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "core/result.h"
+#include "core/task_error.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace stv::infra {
+
+/// Occupancy snapshot of an ArtifactCache (shared by all processes).
+struct ArtifactCacheStats {
+  uint64_t entries = 0;
+  uint64_t total_bytes = 0;
+  uint64_t max_bytes = 0;
+  uint64_t evictions = 0; // Cumulative, across processes
+};
+
+/// Content-addressed artifact store on local disk (M4), normally under
+/// PathService::cache_dir()/artifacts.
+///
+/// Layout: objects/<k0k1>/<k2k3>/<key><ext> plus tmp/ for staging and an
+/// index file. Keys are 64-char hex SHA-256 digests (see make_key()).
+///
+/// - Publish writes into tmp/ and renames into place, so readers only ever
+///   see complete files.
+/// - The index is a fixed-size hash table in a shared mmap. Lookups take a
+///   shared flock and run concurrently across processes; publish and
+///   eviction take it exclusively.
+/// - Total size is bounded by max_bytes; publish evicts the least recently
+///   used entries. An evicted file stays readable for readers that already
+///   opened it; a reader that loses the race sees a missing file and should
+///   treat it as a miss.
+/// - A missing or corrupt index is rebuilt from objects/ on open.
+///
+/// POSIX only; open() fails on other platforms and callers run uncached.
+class ArtifactCache {
+public:
+  ~ArtifactCache();
+
+  ArtifactCache(const ArtifactCache &) = delete;
+  ArtifactCache &operator=(const ArtifactCache &) = delete;
+
+  /// Open (creating if needed) the cache rooted at `root`. `index_slots`
+  /// only applies when a new index is created.
+  static core::Result<std::shared_ptr<ArtifactCache>, core::TaskError>
+  open(const std::string &root, uint64_t max_bytes, uint32_t index_slots = 16384);
+
+  /// SHA-256 over length-prefixed parts (stage, version, request fields...).
+  [[nodiscard]] static std::string make_key(const std::vector<std::string> &parts);
+
+  /// Path of the cached artifact, marking it recently used.
+  [[nodiscard]] std::optional<std::string> lookup(const std::string &key);
+
+  /// Contents of a cached artifact (small artifacts such as JSON).
+  [[nodiscard]] std::optional<std::string> read(const std::string &key);
+
+  /// Copy `source_path` into the cache; keeps its extension. Returns the
+  /// cached path.
+  core::Result<std::string, core::TaskError>
+  publish_file(const std::string &key, const std::string &source_path);
+
+  /// Move `source_path` into the cache (a rename when it is on the same
+  /// filesystem, e.g. a download staged under staging_dir(); a copy
+  /// otherwise). The source is gone afterwards unless publishing fails.
+  core::Result<std::string, core::TaskError>
+  publish_moved(const std::string &key, const std::string &source_path);
+
+  /// Directory on the cache's filesystem for files that will be passed to
+  /// publish_moved(), such as streamed downloads.
+  [[nodiscard]] std::string staging_dir() const;
+
+  /// Store `bytes` under `key` with `extension` (e.g. ".json").
+  core::Result<std::string, core::TaskError>
+  publish_bytes(const std::string &key, const std::string &bytes,
+                const std::string &extension);
+
+  [[nodiscard]] ArtifactCacheStats stats() const;
+  [[nodiscard]] const std::string &root() const;
+
+private:
+  struct Impl;
+  explicit ArtifactCache(std::unique_ptr<Impl> impl);
+
+  std::unique_ptr<Impl> impl_;
+};
+
+} // namespace stv::infra
@@ -1,21 +1,102 @@
 #pragma once
 
 #include "infra/http_client.h"
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <memory>
 #include <cstdint>
 #include <mutex>
+#include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 // 前向声明（隐藏 curl 实现细节）
 typedef void CURL;
+typedef void CURLM;
+typedef void CURLSH;
 
 namespace stv::infra {
 
+/// HTTP 协议版本策略（M4）
+enum class HttpVersionPolicy {
+    Http1,                // 仅 HTTP/1.1，靠 keep-alive 复用连接
+    Http2,                // https 经 ALPN 协商 HTTP/2，明文 http 退回 HTTP/1.1
+    Http2PriorKnowledge,  // 明文也直接说 HTTP/2（h2c），只对确认支持 h2c 的服务端开启
+};
+
+/// 解析 "1.1" / "2" / "h2c"，无法识别时返回 false 且不改 out
+inline bool parse_http_version(const std::string& text, HttpVersionPolicy& out) {
+    if (text == "1.1") {
+        out = HttpVersionPolicy::Http1;
+    } else if (text == "2") {
+        out = HttpVersionPolicy::Http2;
+    } else if (text == "h2c") {
+        out = HttpVersionPolicy::Http2PriorKnowledge;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/// 并发与 easy handle 复用配置（M4）
+struct CurlPoolOptions {
+    int max_handles = 8;                    // 最大并发传输数（复用的 easy handle 上限）
+    int max_per_host = 0;                   // 单个 scheme://host:port 的并发上限，0=不限
+    std::chrono::milliseconds max_wait{0};  // 排队等待上限，0=不限
+
+    // 连接复用
+    HttpVersionPolicy http_version = HttpVersionPolicy::Http2;
+    bool multiplex = true;                  // HTTP/2 下同 host 的并发请求共用一条连接
+    std::chrono::seconds tcp_keepalive{30}; // TCP keep-alive 空闲探测间隔，0=关闭
+    std::chrono::seconds max_idle{300};     // 空闲连接保留时长，超过后不再复用
+};
+
+/// 连接池统计快照（累计值 + gauge）
+struct CurlPoolStats {
+    uint64_t requests = 0;       // 已开始传输的请求
+    uint64_t waited = 0;         // 其中需要排队的请求
+    uint64_t wait_timeouts = 0;  // 排队超过 max_wait 被拒绝的请求
+    uint64_t wait_us_total = 0;  // 排队耗时合计（微秒）
+    uint64_t wait_us_max = 0;
+    int handles = 0;             // 已创建的 easy handle
+    int in_use = 0;              // 正在传输的请求（gauge）
+    int queued = 0;              // 排队中的请求（gauge）
+
+    // 连接复用（按完成的传输计）
+    uint64_t connections_new = 0;     // 新建了连接的传输
+    uint64_t connections_reused = 0;  // 复用已有连接的传输
+    uint64_t http2_transfers = 0;     // 以 HTTP/2 完成的传输
+
+    /// 连接复用率，尚无完成的传输时为 0
+    double reuse_rate() const {
+        const uint64_t total = connections_new + connections_reused;
+        return total == 0 ? 0.0 : static_cast<double>(connections_reused) / total;
+    }
+};
+
 /// 基于 libcurl 的真实 HTTP Client 实现
 /// 支持：超时、取消、错误分类、POST/GET
+///
+/// 异步引擎（M4）：一个 I/O 线程用 curl_multi 驱动全部传输，
+/// execute_async() 只把请求交给该线程就返回，完成时在 I/O 线程上回调。
+/// 同步 execute() 是 execute_async() 加等待的薄封装。
+/// - 并发：max_handles 个传输同时进行，其余按 FIFO 排队（排队时间计入
+///   pool_stats()）；easy handle 结束后回收复用，连接缓存由 multi handle
+///   统一持有，DNS 与 TLS session 经 share handle 共享。
+/// - 连接复用：连接缓存容量等于 max_handles，空闲 max_idle 内的连接保持可用，
+///   并开启 TCP keep-alive；HTTP/2 连接上的并发请求多路复用同一条连接。
+/// - 取消：CancelToken 触发后唤醒 I/O 线程，立即从 multi handle 移除该传输
+///   并回调 Canceled 错误，不必等下一次数据到达。
+/// - 流式下载：request.response_sink 非空时 2xx 响应体逐块写入 sink，
+///   不在内存里拼接；下载进度经 request.on_download_progress 回调。
+/// - 流式上传：request.body_source 非空时 POST/PUT 请求体经 read callback
+///   按块读出，大小未知时走 chunked；上传进度经 request.on_upload_progress 回调。
 class CurlHttpClient : public IHttpClient {
 public:
     CurlHttpClient();
+    explicit CurlHttpClient(CurlPoolOptions options);
     ~CurlHttpClient() override;
 
     // 禁止拷贝（CURL handle 不可拷贝）
@@ -26,21 +107,59 @@ public:
         const HttpRequest& request,
         std::shared_ptr<stv::core::CancelToken> cancel_token = nullptr
     ) override;
+    void execute_async(
+        const HttpRequest& request,
+        std::shared_ptr<stv::core::CancelToken> cancel_token,
+        ResponseCallback callback
+    ) override;
     bool cancel(const std::string& request_id) override;
 
+    CurlPoolStats pool_stats() const;
+
 private:
-    CURL* curl_;  // libcurl handle（单实例，非线程安全）
-    std::mutex curl_mutex_;
+    struct Transfer;  // 一次请求在 I/O 线程上的全部状态
+
+    CurlPoolOptions options_;
+    CURLM* multi_ = nullptr;
+    CURLSH* share_ = nullptr;  // 仅 I/O 线程使用，无需加锁
+    std::thread io_thread_;
+
+    // 提交队列与取消通知（任意线程 → I/O 线程）
+    std::mutex submit_mutex_;
+    std::deque<std::unique_ptr<Transfer>> submitted_;
+    std::vector<uint64_t> cancel_requests_;
+    bool stopping_ = false;
+    std::atomic<uint64_t> next_transfer_id_{1};
+
+    // 以下仅 I/O 线程访问
+    std::deque<Transfer*> waiting_;
+    std::unordered_map<uint64_t, std::unique_ptr<Transfer>> transfers_;
+    std::unordered_map<std::string, int> host_in_use_;
+    int active_ = 0;
+    std::vector<CURL*> idle_;  // LIFO：最近用过的 handle 先复用
+
+    mutable std::mutex stats_mutex_;
+    CurlPoolStats stats_;
+
     std::mutex in_flight_mutex_;
     std::unordered_map<std::string, std::weak_ptr<stv::core::CancelToken>> in_flight_requests_;
 
     // 辅助方法
     HttpErrorCode classify_curl_error(int curl_code) const;
-    void setup_request(const HttpRequest& request);
-    HttpResponse parse_response(const std::string& response_buffer, long http_code, int64_t elapsed_ms);
+    void io_loop();
+    void admit_waiting();
+    bool start_transfer(Transfer& transfer);
+    void record_connection(CURL* easy);
+    void finish_transfer(uint64_t id,
+                         stv::core::Result<HttpResponse, stv::core::TaskError> result);
+    stv::core::Result<HttpResponse, stv::core::TaskError> build_result(
+        Transfer& transfer, int curl_code) const;
+    static std::string host_key(const std::string& url);
 
     // CURL 回调函数（静态）
     static size_t write_callback(char* ptr, size_t size, size_t nmemb, void* userdata);
+    static size_t read_callback(char* buffer, size_t size, size_t nitems, void* userdata);
+    static int seek_callback(void* userdata, long long offset, int origin);
     static int progress_callback(void* clientp, long long dltotal, long long dlnow,
                                   long long ultotal, long long ulnow);
 };
@@ -7,6 +7,7 @@
 #include <map>
 #include <memory>
 #include <chrono>
+#include <cstdint>
 #include <functional>
 
 namespace stv::infra {
@@ -19,6 +20,43 @@ enum class HttpMethod {
     DELETE
 };
 
+// 响应体接收端（M4）：大响应（图片、视频）逐块写出，不在内存里拼成整串。
+// 只接收 2xx 响应的 body；其余状态码的 body 仍进 HttpResponse::body 供排查。
+// 回调在 HTTP 实现的 I/O 线程上执行。重试会对同一个 sink 重新 begin()，
+// 实现须在 begin() 里丢弃上一次尝试写入的数据。
+class IResponseSink {
+public:
+    virtual ~IResponseSink() = default;
+
+    // 第一块数据前调用；content_length 未知时为 -1
+    virtual stv::core::Result<void, stv::core::TaskError> begin(int64_t content_length) = 0;
+    // 返回 false 中止传输（磁盘写满、超出上限、调用方不再需要）
+    virtual bool write(const char* data, size_t size) = 0;
+    // 传输成功后调用，返回错误则整个请求失败
+    virtual stv::core::Result<void, stv::core::TaskError> finish() = 0;
+    // begin() 之后传输失败或取消时调用，用于清理半成品
+    virtual void abort() {}
+    // write() 返回 false 的原因
+    virtual std::string last_error() const { return {}; }
+};
+
+// 请求体来源（M4）：大上传（参考图、对齐音频、成片）按块读出交给传输层，
+// 不整块读进 std::string。read()/rewind() 在 HTTP 实现的 I/O 线程上调用。
+class IRequestBody {
+public:
+    virtual ~IRequestBody() = default;
+
+    // 总字节数；-1 表示未知（HTTP/1.1 下走 chunked 上传）
+    virtual int64_t size() const = 0;
+    // 回到开头：每次传输（含重试、重定向重发）开始前调用；false 表示不能重读
+    virtual bool rewind() = 0;
+    // 读至多 max 字节；返回实际字节数，0=读完，-1=出错（原因见 last_error()）
+    virtual int64_t read(char* buffer, size_t max) = 0;
+    // 请求未显式设置 Content-Type 时使用（multipart 需带 boundary），空=不设置
+    virtual std::string content_type() const { return {}; }
+    virtual std::string last_error() const { return {}; }
+};
+
 // HTTP 请求
 struct HttpRequest {
     HttpMethod method;
@@ -28,6 +66,17 @@ struct HttpRequest {
     std::string body;
     std::string trace_id;  // 可观测性：贯穿请求链路
     std::chrono::milliseconds timeout{30000};  // 默认 30s
+
+    // 流式下载（M4）：设置后 2xx 响应体写入 sink，HttpResponse::body 为空。
+    // 不支持 sink 的实现（mock）把响应体照常放在 body 里。
+    std::shared_ptr<IResponseSink> response_sink;
+    // 下载进度（已收字节，总字节；未知时 total=0），在 I/O 线程上回调
+    std::function<void(uint64_t received, uint64_t total)> on_download_progress;
+
+    // 流式上传（M4）：设置后代替 body 作为 POST/PUT 请求体
+    std::shared_ptr<IRequestBody> body_source;
+    // 上传进度（已发字节，总字节；未知时 total=0），在 I/O 线程上回调
+    std::function<void(uint64_t sent, uint64_t total)> on_upload_progress;
 };
 
 // HTTP 响应
@@ -48,6 +97,8 @@ enum class HttpErrorCode {
     CLIENT_ERROR = 1005,     // 4xx 客户端错误（除 429）
     RATE_LIMIT = 1006,       // 429 限流
     PARSE_ERROR = 1007,      // 响应解析失败（如 JSON 格式错误）
+    SINK_ERROR = 1008,       // 响应体接收端失败（磁盘写满、超出内存上限）
+    SOURCE_ERROR = 1009,     // 请求体来源读取失败或无法重读
     UNKNOWN = 1999
 };
 
@@ -95,9 +146,18 @@ public:
         std::shared_ptr<stv::core::CancelToken> cancel_token = nullptr
     ) = 0;
 
-    // TODO（可选，M3 异步调度时扩展）：
-    // using ResponseCallback = std::function<void(stv::core::Result<HttpResponse, TaskError>)>;
-    // virtual void execute_async(const HttpRequest& req, ResponseCallback callback) = 0;
+    // 异步接口（M4）：立即返回，请求结束（成功/失败/取消）时恰好回调一次。
+    // 回调可能在实现的 I/O 线程上执行，应尽快返回，且不能在其中调用同步 execute。
+    // 默认实现在调用线程上同步执行后回调，供 mock 与装饰器使用。
+    using ResponseCallback =
+        std::function<void(stv::core::Result<HttpResponse, stv::core::TaskError>)>;
+    virtual void execute_async(
+        const HttpRequest& request,
+        std::shared_ptr<stv::core::CancelToken> cancel_token,
+        ResponseCallback callback
+    ) {
+        callback(execute(request, std::move(cancel_token)));
+    }
 };
 
 // 重试策略配置
@@ -125,18 +185,33 @@ public:
         RetryPolicy policy = {},
         std::shared_ptr<stv::core::ILogger> logger = nullptr
     );
+    ~RetryableHttpClient() override;
+
+    RetryableHttpClient(const RetryableHttpClient&) = delete;
+    RetryableHttpClient& operator=(const RetryableHttpClient&) = delete;
 
     stv::core::Result<HttpResponse, stv::core::TaskError> execute(
         const HttpRequest& request,
         std::shared_ptr<stv::core::CancelToken> cancel_token = nullptr
     ) override;
 
+    // 转发给 inner 的 execute_async，立即返回；退避等待交给内部定时线程（首次重试时启动），
+    // 不占用调用线程或 inner 的 I/O 线程。析构时尚在退避的请求以 CANCELED 回调
+    void execute_async(
+        const HttpRequest& request,
+        std::shared_ptr<stv::core::CancelToken> cancel_token,
+        ResponseCallback callback
+    ) override;
+
     bool cancel(const std::string& request_id) override;
 
 private:
+    class AsyncState;  // 异步重试的共享状态与退避定时器
+
     std::shared_ptr<IHttpClient> inner_;
     RetryPolicy policy_;
     std::shared_ptr<stv::core::ILogger> logger_;
+    std::shared_ptr<AsyncState> async_;
 };
 
 } // namespace stv::infra
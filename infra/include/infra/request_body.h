@@ -0,0 +1,155 @@
+#pragma once
+
+#include "infra/http_client.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace stv::infra {
+
+/// 内存中的请求体，不拷贝：data 须在请求结束前保持有效（例如调用方的 mmap 区域）
+class BufferRequestBody : public IRequestBody {
+public:
+    BufferRequestBody(const char* data, size_t size, std::string content_type = {});
+    /// 持有一份字符串（小字段、测试）
+    explicit BufferRequestBody(std::string data, std::string content_type = {});
+
+    BufferRequestBody(const BufferRequestBody&) = delete;
+    BufferRequestBody& operator=(const BufferRequestBody&) = delete;
+
+    int64_t size() const override { return static_cast<int64_t>(size_); }
+    bool rewind() override;
+    int64_t read(char* buffer, size_t max) override;
+    std::string content_type() const override { return content_type_; }
+
+private:
+    std::string owned_;
+    const char* data_;
+    size_t size_;
+    size_t offset_ = 0;
+    std::string content_type_;
+};
+
+/// 整个文件作为请求体（M4）
+///
+/// POSIX 上 mmap 只读映射并按顺序读；已发送的部分 madvise(DONTNEED) 归还，
+/// 常驻内存只有一个窗口，与文件大小无关。其他平台退回带缓冲的顺序读。
+class FileRequestBody : public IRequestBody {
+public:
+    static stv::core::Result<std::shared_ptr<FileRequestBody>, stv::core::TaskError>
+    open(const std::string& path, std::string content_type = {});
+    ~FileRequestBody() override;
+
+    FileRequestBody(const FileRequestBody&) = delete;
+    FileRequestBody& operator=(const FileRequestBody&) = delete;
+
+    int64_t size() const override { return static_cast<int64_t>(size_); }
+    bool rewind() override;
+    int64_t read(char* buffer, size_t max) override;
+    std::string content_type() const override { return content_type_; }
+    std::string last_error() const override { return error_; }
+
+    const std::string& path() const { return path_; }
+
+private:
+    FileRequestBody(std::string path, std::string content_type);
+
+    std::string path_;
+    std::string content_type_;
+    uint64_t size_ = 0;
+    uint64_t offset_ = 0;
+    std::string error_;
+#ifndef _WIN32
+    const char* mapping_ = nullptr;
+    uint64_t released_ = 0;  // [0, released_) 已归还给内核
+#else
+    std::FILE* file_ = nullptr;
+#endif
+};
+
+/// 从文件描述符按偏移 pread（M4）：管道以外的 fd 都可重读。fd 由调用方持有和关闭。
+class FdRequestBody : public IRequestBody {
+public:
+    /// size<0 时取 fstat 的大小；读取从 start_offset 开始
+    FdRequestBody(int fd, int64_t size = -1, int64_t start_offset = 0,
+                  std::string content_type = {});
+
+    int64_t size() const override { return size_; }
+    bool rewind() override;
+    int64_t read(char* buffer, size_t max) override;
+    std::string content_type() const override { return content_type_; }
+    std::string last_error() const override { return error_; }
+
+private:
+    int fd_;
+    int64_t size_;
+    int64_t start_offset_;
+    int64_t offset_ = 0;
+    std::string content_type_;
+    std::string error_;
+};
+
+/// 由调用方回调产生数据（边编码边上传）
+class CallbackRequestBody : public IRequestBody {
+public:
+    /// 同 IRequestBody::read 的约定：返回字节数，0=结束，-1=出错
+    using ReadFn = std::function<int64_t(char* buffer, size_t max)>;
+    /// 回到开头；为空表示不能重读（只允许第一次传输）
+    using RewindFn = std::function<bool()>;
+
+    CallbackRequestBody(ReadFn read, int64_t size = -1, RewindFn rewind = nullptr,
+                        std::string content_type = {});
+
+    int64_t size() const override { return size_; }
+    bool rewind() override;
+    int64_t read(char* buffer, size_t max) override;
+    std::string content_type() const override { return content_type_; }
+    std::string last_error() const override { return "read callback failed"; }
+
+private:
+    ReadFn read_;
+    int64_t size_;
+    RewindFn rewind_;
+    std::string content_type_;
+    bool started_ = false;
+};
+
+/// multipart/form-data（RFC 7578），各部分按需读出，文件部分不进内存
+class MultipartRequestBody : public IRequestBody {
+public:
+    MultipartRequestBody();
+
+    void add_field(const std::string& name, const std::string& value);
+    void add_file(const std::string& name, const std::string& filename,
+                  std::shared_ptr<IRequestBody> body,
+                  const std::string& content_type = "application/octet-stream");
+
+    /// 任一部分大小未知时为 -1
+    int64_t size() const override;
+    bool rewind() override;
+    int64_t read(char* buffer, size_t max) override;
+    std::string content_type() const override;
+    std::string last_error() const override { return error_; }
+
+    const std::string& boundary() const { return boundary_; }
+
+private:
+    /// 一段要么是固定文本（分隔符、部分头、字段值），要么是嵌套的请求体
+    struct Segment {
+        std::string text;
+        std::shared_ptr<IRequestBody> body;
+    };
+
+    std::string boundary_;
+    std::vector<Segment> segments_;  // 不含结尾分隔符
+    std::string closing_;
+    size_t segment_ = 0;
+    size_t text_offset_ = 0;
+    std::string error_;
+};
+
+} // namespace stv::infra
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "core/scheduler.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace stv::infra {
+
+/// cgroup v2 limits visible to this process (M4). Unset = unlimited/unknown.
+struct CgroupLimits {
+  std::optional<double> cpu_quota_cores;     // cpu.max quota / period
+  std::optional<int64_t> memory_max_mb;      // memory.max
+  std::optional<int64_t> memory_current_mb;  // memory.current
+};
+
+/// Parse the `some avg10=` value of a PSI file (cpu.pressure, memory.pressure).
+std::optional<double> parse_psi_some_avg10(const std::string &content);
+
+/// Parse cgroup v2 `cpu.max` ("<quota|max> <period>") into cores.
+std::optional<double> parse_cpu_max(const std::string &content);
+
+/// Reads limits and PSI pressure of the process's cgroup v2 directory.
+/// Doubles as the scheduler's admission pressure source. Missing files
+/// (cgroup v1, non-Linux, root cgroup) read as "unlimited, no pressure".
+class CgroupMonitor final : public core::IPressureMonitor {
+public:
+  /// `cgroup_dir` empty = resolve from /proc/self/cgroup under /sys/fs/cgroup.
+  explicit CgroupMonitor(std::string cgroup_dir = {});
+
+  [[nodiscard]] const std::string &cgroup_dir() const { return dir_; }
+  [[nodiscard]] CgroupLimits read_limits() const;
+
+  /// PSI avg10 for cpu/memory; memory_available_mb = memory.max - current
+  /// when a memory limit is set.
+  core::ResourcePressure sample() override;
+
+private:
+  std::string dir_;
+};
+
+/// Derive worker_count, cpu_slots_hard and ram_soft_mb from cgroup limits.
+/// `usable_cpus` should already honor the cpuset (core::allowed_cpus()).
+/// VRAM has no cgroup controller, so vram_soft_mb is left untouched.
+void apply_discovered_budget(const CgroupLimits &limits, int usable_cpus,
+                             core::SchedulerConfig &config);
+
+} // namespace stv::infra
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "infra/http_client.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+
+namespace stv::infra {
+
+/// 响应体写入文件（M4）
+///
+/// 先写 <path>.part，finish() 时 rename 到 path，中途失败不会留下半个文件。
+/// 已知 Content-Length 时预分配磁盘空间：减少碎片，空间不足在第一块数据前就暴露。
+class FileResponseSink : public IResponseSink {
+public:
+    explicit FileResponseSink(std::string path);
+    ~FileResponseSink() override;
+
+    FileResponseSink(const FileResponseSink&) = delete;
+    FileResponseSink& operator=(const FileResponseSink&) = delete;
+
+    stv::core::Result<void, stv::core::TaskError> begin(int64_t content_length) override;
+    bool write(const char* data, size_t size) override;
+    stv::core::Result<void, stv::core::TaskError> finish() override;
+    void abort() override;
+    std::string last_error() const override { return error_; }
+
+    const std::string& path() const { return path_; }
+    uint64_t bytes_written() const { return bytes_written_; }
+
+private:
+    void close_file();
+
+    std::string path_;
+    std::string part_path_;
+    std::FILE* file_ = nullptr;
+    uint64_t bytes_written_ = 0;
+    std::string error_;
+};
+
+/// 响应体留在内存，超过 max_bytes 即中止传输（防止异常响应撑爆内存）
+class MemoryResponseSink : public IResponseSink {
+public:
+    explicit MemoryResponseSink(size_t max_bytes);
+
+    stv::core::Result<void, stv::core::TaskError> begin(int64_t content_length) override;
+    bool write(const char* data, size_t size) override;
+    stv::core::Result<void, stv::core::TaskError> finish() override;
+    std::string last_error() const override { return error_; }
+
+    const std::string& data() const { return data_; }
+    std::string take() { return std::move(data_); }
+
+private:
+    size_t max_bytes_;
+    std::string data_;
+    std::string error_;
+};
+
+/// 数据块直接交给调用方（边下载边解码/转存）；chunk 返回 false 中止传输
+class CallbackResponseSink : public IResponseSink {
+public:
+    using ChunkFn = std::function<bool(const char* data, size_t size)>;
+    using BeginFn = std::function<void(int64_t content_length)>;
+
+    explicit CallbackResponseSink(ChunkFn on_chunk, BeginFn on_begin = nullptr);
+
+    stv::core::Result<void, stv::core::TaskError> begin(int64_t content_length) override;
+    bool write(const char* data, size_t size) override;
+    stv::core::Result<void, stv::core::TaskError> finish() override;
+    std::string last_error() const override { return "consumer rejected chunk"; }
+
+private:
+    ChunkFn on_chunk_;
+    BeginFn on_begin_;
+};
+
+} // namespace stv::infra
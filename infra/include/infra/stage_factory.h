@@ -18,19 +18,40 @@ public:
         const std::string &api_base_url = "http://127.0.0.1:8765")
         : http_client_(std::move(http_client)), api_base_url_(api_base_url) {}
 
+    /// 本地产物缓存，注入到支持缓存的 Stage（可为空 = 不缓存）
+    void set_artifact_cache(std::shared_ptr<ArtifactCache> cache) {
+        artifact_cache_ = std::move(cache);
+    }
+
+    /// 流式合成：片段编码完即追加进会话，Concat 只做封装
+    void set_streaming_compose(bool enabled) { streaming_compose_ = enabled; }
+
     std::shared_ptr<core::IStage> create_stage(core::TaskType type) {
         switch (type) {
-        case core::TaskType::Storyboard:
-            return std::make_shared<StoryboardStage>(http_client_, api_base_url_);
-        case core::TaskType::ImageGen:
-            return std::make_shared<ImageGenStage>(http_client_, api_base_url_);
+        case core::TaskType::Storyboard: {
+            auto stage = std::make_shared<StoryboardStage>(http_client_, api_base_url_);
+            stage->set_artifact_cache(artifact_cache_);
+            return stage;
+        }
+        case core::TaskType::ImageGen: {
+            auto stage = std::make_shared<ImageGenStage>(http_client_, api_base_url_);
+            stage->set_artifact_cache(artifact_cache_);
+            return stage;
+        }
         case core::TaskType::TTS:
             return std::make_shared<TtsStage>(http_client_, api_base_url_);
-        case core::TaskType::Compose:
-            return std::make_shared<ComposeStage>(http_client_, api_base_url_);
+        case core::TaskType::Compose: {
+            auto stage = std::make_shared<ComposeStage>(http_client_, api_base_url_);
+            stage->set_streaming_session(streaming_compose_);
+            return stage;
+        }
         case core::TaskType::VideoClip:
-            // VideoClip 暂不实现（M2 不需要）
-            return nullptr;
+            return std::make_shared<VideoClipStage>(http_client_, api_base_url_);
+        case core::TaskType::Concat: {
+            auto stage = std::make_shared<ConcatStage>(http_client_, api_base_url_);
+            stage->set_streaming_session(streaming_compose_);
+            return stage;
+        }
         }
         return nullptr;
     }
@@ -38,6 +59,8 @@ public:
 private:
     std::shared_ptr<IHttpClient> http_client_;
     std::string api_base_url_;
+    std::shared_ptr<ArtifactCache> artifact_cache_;
+    bool streaming_compose_ = false;
 };
 
 } // namespace stv::infra
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "core/pipeline.h"
+#include "infra/artifact_cache.h"
 #include "infra/http_client.h"
 #include <memory>
 #include <string>
@@ -8,6 +9,8 @@
 namespace stv::infra {
 
 /// StoryboardStage - 调用服务端 /v1/storyboard 生成分镜脚本
+/// 按场景输出 scene_prompt_<i> / scene_narration_<i>，供逐场景任务取用 (M4)
+/// 配置产物缓存后，相同请求的分镜 JSON 从本地缓存读取，不再请求服务端
 class StoryboardStage : public core::IStage {
 public:
   explicit StoryboardStage(
@@ -15,31 +18,75 @@ public:
       const std::string &api_base_url = "http://127.0.0.1:8765");
 
   [[nodiscard]] std::string name() const override { return "StoryboardStage"; }
+  [[nodiscard]] std::string version() const override { return "1"; }
 
   core::Result<void, core::TaskError> execute(core::StageContext &ctx) override;
 
+  /// 本地产物缓存（可为空 = 不缓存）
+  void set_artifact_cache(std::shared_ptr<ArtifactCache> cache) { artifact_cache_ = std::move(cache); }
+
 private:
+  static void publish_outputs(core::StageContext &ctx, const std::string &storyboard_json,
+                              int scene_count);
+
   std::shared_ptr<IHttpClient> http_client_;
   std::string api_base_url_;
+  std::shared_ptr<ArtifactCache> artifact_cache_;
 };
 
 /// ImageGenStage - 调用服务端 /v1/imagegen 生成图像
-class ImageGenStage : public core::IStage {
+/// 同尺寸、同步数的任务可由调度器合批，走 /v1/imagegen/batch 一次推理 (M4)
+/// 无 prompt 输入时使用分镜的 scene_prompt_<scene_index>
+/// 配置产物缓存后先按 (prompt, 尺寸, 步数) 的哈希查本地缓存，命中则不发请求；
+/// 服务端在本机生成的图像会被收入缓存，输出缓存内路径
+class ImageGenStage : public core::IBatchableStage {
 public:
   explicit ImageGenStage(
       std::shared_ptr<IHttpClient> http_client,
       const std::string &api_base_url = "http://127.0.0.1:8765");
 
   [[nodiscard]] std::string name() const override { return "ImageGenStage"; }
+  [[nodiscard]] std::string version() const override { return "1"; }
+
+  /// 服务端 /v1/imagegen/batch 单次请求的上限（ImageGenBatchRequest.items 的 max_length），
+  /// 调度器合出更大的批时按此分块请求
+  static constexpr size_t kMaxBatchItems = 16;
+
+  /// 只对本场景的 prompt 与尺寸/步数做记忆化，其他场景的分镜改动不影响命中
+  [[nodiscard]] std::vector<std::string>
+  memo_inputs(const core::StageContext &ctx) const override;
 
   core::Result<void, core::TaskError> execute(core::StageContext &ctx) override;
 
+  /// "imagegen|<width>x<height>|<steps>"；prompt 为空时返回空（不合批）
+  [[nodiscard]] std::string batch_key(const core::StageContext &ctx) const override;
+
+  std::vector<core::Result<void, core::TaskError>>
+  execute_batch(const std::vector<core::StageContext *> &members) override;
+
+  /// image_path 指向产物缓存内的文件时，文件可能已被淘汰；不存在则不可复用
+  [[nodiscard]] bool
+  outputs_reusable(const std::unordered_map<std::string, std::any> &outputs) const override;
+
+  /// 本地产物缓存（可为空 = 不缓存）
+  void set_artifact_cache(std::shared_ptr<ArtifactCache> cache) { artifact_cache_ = std::move(cache); }
+
 private:
+  /// 产物缓存 key；未配置缓存时为空
+  [[nodiscard]] std::string artifact_key(const core::StageContext &ctx) const;
+
+  /// 把 live 中的成员（不超过 kMaxBatchItems）合成一次批量请求，结果写入 results
+  void post_batch(const std::vector<core::StageContext *> &members,
+                  const std::vector<size_t> &live, const std::vector<std::string> &cache_keys,
+                  std::vector<core::Result<void, core::TaskError>> &results);
+
   std::shared_ptr<IHttpClient> http_client_;
   std::string api_base_url_;
+  std::shared_ptr<ArtifactCache> artifact_cache_;
 };
 
 /// TtsStage - 调用服务端 /v1/tts 生成语音
+/// 无 text 输入时使用分镜的 scene_narration_<scene_index>
 class TtsStage : public core::IStage {
 public:
   explicit TtsStage(
@@ -47,6 +94,11 @@ public:
       const std::string &api_base_url = "http://127.0.0.1:8765");
 
   [[nodiscard]] std::string name() const override { return "TtsStage"; }
+  [[nodiscard]] std::string version() const override { return "1"; }
+
+  /// 只对本场景的旁白与音色/语速做记忆化
+  [[nodiscard]] std::vector<std::string>
+  memo_inputs(const core::StageContext &ctx) const override;
 
   core::Result<void, core::TaskError> execute(core::StageContext &ctx) override;
 
@@ -55,7 +107,28 @@ private:
   std::string api_base_url_;
 };
 
-/// ComposeStage - 调用服务端 /v1/compose 合成最终视频
+/// VideoClipStage - 调用服务端 /v1/videoclip 将单场景图像渲染为短视频片段
+class VideoClipStage : public core::IStage {
+public:
+  explicit VideoClipStage(
+      std::shared_ptr<IHttpClient> http_client,
+      const std::string &api_base_url = "http://127.0.0.1:8765");
+
+  [[nodiscard]] std::string name() const override { return "VideoClipStage"; }
+  [[nodiscard]] std::string version() const override { return "1"; }
+
+  core::Result<void, core::TaskError> execute(core::StageContext &ctx) override;
+
+private:
+  std::shared_ptr<IHttpClient> http_client_;
+  std::string api_base_url_;
+};
+
+/// ComposeStage - 调用服务端 /v1/compose 合成视频
+/// 无 scenes_json 但有 scene_index 输入时，合成单场景片段（clip + 旁白），
+/// 输出 segment_path_<scene_index> 供 ConcatStage 收集
+/// 流式模式 (M4)：片段改走 /v1/compose/session/append，编码完即按场景顺序
+/// 追加进本工作流的合成会话
 class ComposeStage : public core::IStage {
 public:
   explicit ComposeStage(
@@ -63,12 +136,37 @@ public:
       const std::string &api_base_url = "http://127.0.0.1:8765");
 
   [[nodiscard]] std::string name() const override { return "ComposeStage"; }
+  [[nodiscard]] std::string version() const override { return "1"; }
+
+  core::Result<void, core::TaskError> execute(core::StageContext &ctx) override;
+
+  void set_streaming_session(bool enabled) { streaming_session_ = enabled; }
+
+private:
+  std::shared_ptr<IHttpClient> http_client_;
+  std::string api_base_url_;
+  bool streaming_session_ = false;
+};
+
+/// ConcatStage - 调用服务端 /v1/concat 按场景顺序拼接所有片段为最终视频
+/// 流式模式 (M4)：改为 /v1/compose/session/finalize，只封装已追加好的会话流
+class ConcatStage : public core::IStage {
+public:
+  explicit ConcatStage(
+      std::shared_ptr<IHttpClient> http_client,
+      const std::string &api_base_url = "http://127.0.0.1:8765");
+
+  [[nodiscard]] std::string name() const override { return "ConcatStage"; }
+  [[nodiscard]] std::string version() const override { return "1"; }
 
   core::Result<void, core::TaskError> execute(core::StageContext &ctx) override;
 
+  void set_streaming_session(bool enabled) { streaming_session_ = enabled; }
+
 private:
   std::shared_ptr<IHttpClient> http_client_;
   std::string api_base_url_;
+  bool streaming_session_ = false;
 };
 
 } // namespace stv::infra
@@ -0,0 +1,657 @@
+#include "infra/artifact_cache.h"
+#include "core/sha256.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <shared_mutex>
+#include <sstream>
+#include <system_error>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace stv::infra {
+
+namespace fs = std::filesystem;
+using core::Result;
+using core::TaskError;
+
+namespace {
+
+constexpr char kIndexMagic[8] = {'S', 'T', 'V', 'A', 'C', 'I', 'X', '1'};
+constexpr uint32_t kIndexVersion = 1;
+constexpr uint64_t kLoadPercent = 70; // Max live+tombstone share of slots
+
+enum SlotState : uint32_t { kEmpty = 0, kLive = 1, kTombstone = 2 };
+
+/// Index file = header + slot_count slots, shared by every process through
+/// MAP_SHARED. Fields are only written under the exclusive flock, except
+/// clock/last_access, which readers bump atomically under the shared one.
+struct IndexHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t slot_count;
+  uint64_t clock; // Access counter; larger = more recently used
+  uint64_t total_bytes;
+  uint64_t entries;
+  uint64_t tombstones;
+  uint64_t evictions;
+  uint64_t reserved;
+};
+static_assert(sizeof(IndexHeader) == 64, "index header layout");
+
+struct IndexSlot {
+  uint8_t digest[32];
+  uint64_t size;
+  uint64_t last_access;
+  char extension[12]; // NUL-padded, includes the leading dot
+  uint32_t state;
+};
+static_assert(sizeof(IndexSlot) == 64, "index slot layout");
+
+using Digest = std::array<uint8_t, 32>;
+
+TaskError io_error(const std::string &detail) {
+  return TaskError(core::ErrorCategory::Resource, 1, false,
+                   "Artifact cache I/O failed", "ArtifactCache: " + detail);
+}
+
+int hex_value(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
+
+std::optional<Digest> parse_key(const std::string &key) {
+  if (key.size() != 64) {
+    return std::nullopt;
+  }
+  Digest digest{};
+  for (size_t i = 0; i < digest.size(); ++i) {
+    const int hi = hex_value(key[2 * i]);
+    const int lo = hex_value(key[2 * i + 1]);
+    if (hi < 0 || lo < 0) {
+      return std::nullopt;
+    }
+    digest[i] = static_cast<uint8_t>((hi << 4) | lo);
+  }
+  return digest;
+}
+
+std::string to_hex(const uint8_t *digest) {
+  static const char *kHex = "0123456789abcdef";
+  std::string out;
+  out.reserve(64);
+  for (size_t i = 0; i < 32; ++i) {
+    out.push_back(kHex[digest[i] >> 4]);
+    out.push_back(kHex[digest[i] & 0xF]);
+  }
+  return out;
+}
+
+/// ".png", ".json" ... or empty; anything else would escape the layout.
+bool valid_extension(const std::string &ext) {
+  if (ext.empty()) {
+    return true;
+  }
+  if (ext.size() >= sizeof(IndexSlot::extension) || ext[0] != '.' || ext.size() < 2) {
+    return false;
+  }
+  return std::all_of(ext.begin() + 1, ext.end(), [](char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) != 0;
+  });
+}
+
+fs::path object_path(const fs::path &root, const std::string &hex,
+                     const std::string &ext) {
+  return root / "objects" / hex.substr(0, 2) / hex.substr(2, 2) / (hex + ext);
+}
+
+} // namespace
+
+#ifndef _WIN32
+
+struct ArtifactCache::Impl {
+  fs::path root;
+  std::string root_string;
+  uint64_t max_bytes = 0;
+  int fd = -1;
+  void *mapping = nullptr;
+  size_t mapping_size = 0;
+  IndexHeader *header = nullptr;
+  IndexSlot *slots = nullptr;
+
+  // flock excludes other processes only; threads share this fd, so they are
+  // ordered by this mutex first.
+  mutable std::shared_mutex mutex;
+  // A flock belongs to the open file description, not the thread: the first
+  // in-process reader takes LOCK_SH and only the last one releases it.
+  mutable std::mutex flock_mutex;
+  mutable int shared_holders = 0;
+  std::atomic<uint64_t> tmp_counter{0};
+
+  ~Impl() {
+    if (mapping) {
+      ::munmap(mapping, mapping_size);
+    }
+    if (fd >= 0) {
+      ::close(fd);
+    }
+  }
+
+  /// RAII pair of in-process lock + flock.
+  class SharedLock {
+  public:
+    explicit SharedLock(const Impl &impl) : lock_(impl.mutex), impl_(impl) {
+      std::lock_guard<std::mutex> guard(impl_.flock_mutex);
+      if (impl_.shared_holders++ == 0) {
+        ::flock(impl_.fd, LOCK_SH);
+      }
+    }
+    ~SharedLock() {
+      std::lock_guard<std::mutex> guard(impl_.flock_mutex);
+      if (--impl_.shared_holders == 0) {
+        ::flock(impl_.fd, LOCK_UN);
+      }
+    }
+
+  private:
+    std::shared_lock<std::shared_mutex> lock_;
+    const Impl &impl_;
+  };
+
+  class ExclusiveLock {
+  public:
+    explicit ExclusiveLock(const Impl &impl) : lock_(impl.mutex), fd_(impl.fd) {
+      ::flock(fd_, LOCK_EX);
+    }
+    ~ExclusiveLock() { ::flock(fd_, LOCK_UN); }
+
+  private:
+    std::unique_lock<std::shared_mutex> lock_;
+    int fd_;
+  };
+
+  static size_t index_size(uint32_t slot_count) {
+    return sizeof(IndexHeader) + sizeof(IndexSlot) * static_cast<size_t>(slot_count);
+  }
+
+  uint64_t tick() {
+    return __atomic_add_fetch(&header->clock, 1, __ATOMIC_RELAXED);
+  }
+
+  size_t home_slot(const Digest &digest) const {
+    uint64_t h = 0;
+    std::memcpy(&h, digest.data(), sizeof(h));
+    return static_cast<size_t>(h % header->slot_count);
+  }
+
+  /// Live slot holding `digest`, or nullptr.
+  IndexSlot *find(const Digest &digest) const {
+    const size_t count = header->slot_count;
+    size_t pos = home_slot(digest);
+    for (size_t probe = 0; probe < count; ++probe) {
+      IndexSlot &slot = slots[pos];
+      if (slot.state == kEmpty) {
+        return nullptr;
+      }
+      if (slot.state == kLive &&
+          std::memcmp(slot.digest, digest.data(), digest.size()) == 0) {
+        return &slot;
+      }
+      pos = (pos + 1) % count;
+    }
+    return nullptr;
+  }
+
+  /// First free (empty or tombstone) slot on the probe path. Exclusive lock.
+  IndexSlot *free_slot(const Digest &digest) {
+    const size_t count = header->slot_count;
+    size_t pos = home_slot(digest);
+    for (size_t probe = 0; probe < count; ++probe) {
+      IndexSlot &slot = slots[pos];
+      if (slot.state != kLive) {
+        return &slot;
+      }
+      pos = (pos + 1) % count;
+    }
+    return nullptr;
+  }
+
+  std::string extension_of(const IndexSlot &slot) const {
+    return std::string(slot.extension,
+                       strnlen(slot.extension, sizeof(slot.extension)));
+  }
+
+  fs::path path_of(const IndexSlot &slot) const {
+    return object_path(root, to_hex(slot.digest), extension_of(slot));
+  }
+
+  /// Drop a live entry and its file. Exclusive lock.
+  void remove_locked(IndexSlot &slot, bool eviction) {
+    std::error_code ec;
+    fs::remove(path_of(slot), ec);
+    header->total_bytes -= std::min(header->total_bytes, slot.size);
+    header->entries--;
+    header->tombstones++;
+    if (eviction) {
+      header->evictions++;
+    }
+    slot.state = kTombstone;
+  }
+
+  /// Rehash live entries in place, dropping tombstones. Exclusive lock.
+  void compact_locked() {
+    std::vector<IndexSlot> live;
+    live.reserve(static_cast<size_t>(header->entries));
+    for (uint32_t i = 0; i < header->slot_count; ++i) {
+      if (slots[i].state == kLive) {
+        live.push_back(slots[i]);
+      }
+    }
+    std::memset(slots, 0, sizeof(IndexSlot) * header->slot_count);
+    header->tombstones = 0;
+    for (const auto &entry : live) {
+      Digest digest{};
+      std::memcpy(digest.data(), entry.digest, digest.size());
+      *free_slot(digest) = entry;
+    }
+  }
+
+  /// Evict least recently used entries (never `keep`) until the total fits
+  /// max_bytes and at least `free_entries` more slots stay under the load cap.
+  void evict_locked(const IndexSlot *keep, uint64_t free_entries) {
+    const uint64_t entry_cap = header->slot_count * kLoadPercent / 100;
+    auto over = [&]() {
+      return header->total_bytes > max_bytes ||
+             header->entries + free_entries > entry_cap;
+    };
+    if (!over()) {
+      return;
+    }
+    std::vector<IndexSlot *> candidates;
+    for (uint32_t i = 0; i < header->slot_count; ++i) {
+      if (slots[i].state == kLive && &slots[i] != keep) {
+        candidates.push_back(&slots[i]);
+      }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const IndexSlot *a, const IndexSlot *b) {
+                return a->last_access < b->last_access;
+              });
+    for (auto *victim : candidates) {
+      if (!over()) {
+        break;
+      }
+      remove_locked(*victim, /*eviction=*/true);
+    }
+  }
+
+  /// Insert or refresh an entry after its file was renamed into place.
+  /// Exclusive lock.
+  void insert_locked(const Digest &digest, uint64_t size, const std::string &ext) {
+    IndexSlot *slot = find(digest);
+    if (slot) {
+      if (extension_of(*slot) != ext) {
+        std::error_code ec;
+        fs::remove(path_of(*slot), ec); // Same content, older extension
+      }
+      header->total_bytes = header->total_bytes - std::min(header->total_bytes, slot->size);
+    } else {
+      const uint64_t used_cap = header->slot_count * kLoadPercent / 100;
+      evict_locked(nullptr, 1);
+      if (header->entries + header->tombstones + 1 > used_cap) {
+        compact_locked();
+      }
+      slot = free_slot(digest);
+      if (slot->state == kTombstone) {
+        header->tombstones--;
+      }
+      std::memcpy(slot->digest, digest.data(), digest.size());
+      header->entries++;
+    }
+    slot->size = size;
+    std::memset(slot->extension, 0, sizeof(slot->extension));
+    std::memcpy(slot->extension, ext.data(), ext.size());
+    slot->last_access = tick();
+    slot->state = kLive;
+    header->total_bytes += size;
+    evict_locked(slot, 0);
+  }
+
+  void init_header_locked(uint32_t slot_count) {
+    std::memset(mapping, 0, mapping_size);
+    std::memcpy(header->magic, kIndexMagic, sizeof(kIndexMagic));
+    header->version = kIndexVersion;
+    header->slot_count = slot_count;
+  }
+
+  /// Re-index objects/ after the index was lost; older mtime = less recent.
+  void rebuild_locked() {
+    struct Found {
+      Digest digest;
+      uint64_t size;
+      std::string ext;
+      fs::file_time_type mtime;
+    };
+    std::vector<Found> found;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(root / "objects", ec), end;
+         !ec && it != end; it.increment(ec)) {
+      if (!it->is_regular_file(ec)) {
+        continue;
+      }
+      const auto name = it->path().filename().string();
+      const auto digest = parse_key(name.substr(0, 64));
+      const std::string ext = name.size() > 64 ? name.substr(64) : "";
+      if (!digest.has_value() || !valid_extension(ext)) {
+        continue;
+      }
+      found.push_back({*digest, static_cast<uint64_t>(it->file_size(ec)), ext,
+                       it->last_write_time(ec)});
+    }
+    std::sort(found.begin(), found.end(),
+              [](const Found &a, const Found &b) { return a.mtime < b.mtime; });
+    for (const auto &entry : found) {
+      insert_locked(entry.digest, entry.size, entry.ext);
+    }
+  }
+
+  Result<void, TaskError> map_index(const fs::path &index_path, uint32_t slot_count) {
+    fd = ::open(index_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+      return Result<void, TaskError>::Err(
+          io_error("cannot open " + index_path.string() + ": " + std::strerror(errno)));
+    }
+    ExclusiveLock lock(*this);
+
+    struct stat st {};
+    ::fstat(fd, &st);
+    IndexHeader existing{};
+    bool valid = false;
+    if (static_cast<size_t>(st.st_size) >= sizeof(IndexHeader) &&
+        ::pread(fd, &existing, sizeof(existing), 0) ==
+            static_cast<ssize_t>(sizeof(existing))) {
+      valid = std::memcmp(existing.magic, kIndexMagic, sizeof(kIndexMagic)) == 0 &&
+              existing.version == kIndexVersion && existing.slot_count > 0 &&
+              static_cast<size_t>(st.st_size) == index_size(existing.slot_count);
+    }
+    if (valid) {
+      slot_count = existing.slot_count; // Another process chose the size
+    } else if (::ftruncate(fd, static_cast<off_t>(index_size(slot_count))) != 0) {
+      return Result<void, TaskError>::Err(
+          io_error("cannot size index: " + std::string(std::strerror(errno))));
+    }
+
+    mapping_size = index_size(slot_count);
+    mapping = ::mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+      mapping = nullptr;
+      return Result<void, TaskError>::Err(
+          io_error("mmap failed: " + std::string(std::strerror(errno))));
+    }
+    header = static_cast<IndexHeader *>(mapping);
+    slots = reinterpret_cast<IndexSlot *>(static_cast<char *>(mapping) +
+                                          sizeof(IndexHeader));
+    if (!valid) {
+      init_header_locked(slot_count);
+      rebuild_locked();
+    }
+    return Result<void, TaskError>::Ok();
+  }
+
+  /// Stage `write` into tmp/, then rename into place and index it.
+  template <typename WriteFn>
+  Result<std::string, TaskError> publish(const std::string &key,
+                                         const std::string &ext, uint64_t size,
+                                         WriteFn write) {
+    const auto digest = parse_key(key);
+    if (!digest.has_value()) {
+      return Result<std::string, TaskError>::Err(
+          TaskError::Internal("ArtifactCache: key must be 64 lowercase hex chars"));
+    }
+    if (!valid_extension(ext)) {
+      return Result<std::string, TaskError>::Err(
+          TaskError::Internal("ArtifactCache: invalid extension '" + ext + "'"));
+    }
+    if (size > max_bytes) {
+      return Result<std::string, TaskError>::Err(
+          io_error("artifact larger than cache (" + std::to_string(size) + " bytes)"));
+    }
+
+    const fs::path staged =
+        root / "tmp" /
+        (key + "." + std::to_string(::getpid()) + "." +
+         std::to_string(tmp_counter.fetch_add(1)) + ".part");
+    if (!write(staged)) {
+      std::error_code ec;
+      fs::remove(staged, ec);
+      return Result<std::string, TaskError>::Err(io_error("cannot write " + staged.string()));
+    }
+
+    const fs::path target = object_path(root, key, ext);
+    std::error_code ec;
+    ExclusiveLock lock(*this);
+    fs::create_directories(target.parent_path(), ec);
+    fs::rename(staged, target, ec); // Atomic: readers see old or new, never partial
+    if (ec) {
+      fs::remove(staged, ec);
+      return Result<std::string, TaskError>::Err(
+          io_error("cannot publish " + target.string() + ": " + ec.message()));
+    }
+    insert_locked(*digest, size, ext);
+    return Result<std::string, TaskError>::Ok(target.string());
+  }
+};
+
+ArtifactCache::ArtifactCache(std::unique_ptr<Impl> impl) : impl_(std::move(impl)) {}
+
+ArtifactCache::~ArtifactCache() = default;
+
+Result<std::shared_ptr<ArtifactCache>, TaskError>
+ArtifactCache::open(const std::string &root, uint64_t max_bytes, uint32_t index_slots) {
+  using R = Result<std::shared_ptr<ArtifactCache>, TaskError>;
+  if (root.empty() || max_bytes == 0 || index_slots == 0) {
+    return R::Err(TaskError::Internal("ArtifactCache: empty root or zero capacity"));
+  }
+  auto impl = std::make_unique<Impl>();
+  impl->root = fs::path(root);
+  impl->root_string = root;
+  impl->max_bytes = max_bytes;
+
+  std::error_code ec;
+  fs::create_directories(impl->root / "objects", ec);
+  fs::create_directories(impl->root / "tmp", ec);
+  if (ec) {
+    return R::Err(io_error("cannot create " + root + ": " + ec.message()));
+  }
+  auto mapped = impl->map_index(impl->root / "index.bin", index_slots);
+  if (mapped.is_err()) {
+    return R::Err(mapped.error());
+  }
+  return R::Ok(std::shared_ptr<ArtifactCache>(new ArtifactCache(std::move(impl))));
+}
+
+std::optional<std::string> ArtifactCache::lookup(const std::string &key) {
+  const auto digest = parse_key(key);
+  if (!digest.has_value()) {
+    return std::nullopt;
+  }
+  fs::path path;
+  {
+    Impl::SharedLock lock(*impl_);
+    IndexSlot *slot = impl_->find(*digest);
+    if (!slot) {
+      return std::nullopt;
+    }
+    __atomic_store_n(&slot->last_access, impl_->tick(), __ATOMIC_RELAXED);
+    path = impl_->path_of(*slot);
+  }
+  std::error_code ec;
+  if (fs::is_regular_file(path, ec)) {
+    return path.string();
+  }
+
+  // File vanished behind the index (manual cleanup): forget the entry.
+  Impl::ExclusiveLock lock(*impl_);
+  if (IndexSlot *slot = impl_->find(*digest); slot && !fs::exists(impl_->path_of(*slot), ec)) {
+    impl_->remove_locked(*slot, /*eviction=*/false);
+  }
+  return std::nullopt;
+}
+
+std::optional<std::string> ArtifactCache::read(const std::string &key) {
+  const auto path = lookup(key);
+  if (!path.has_value()) {
+    return std::nullopt;
+  }
+  std::ifstream in(*path, std::ios::binary);
+  if (!in) {
+    return std::nullopt; // Evicted between lookup and open
+  }
+  std::ostringstream buffer;
+  buffer << in.rdbuf();
+  return buffer.str();
+}
+
+Result<std::string, TaskError>
+ArtifactCache::publish_file(const std::string &key, const std::string &source_path) {
+  std::error_code ec;
+  const auto size = fs::file_size(source_path, ec);
+  if (ec) {
+    return Result<std::string, TaskError>::Err(
+        io_error("cannot stat " + source_path + ": " + ec.message()));
+  }
+  return impl_->publish(key, fs::path(source_path).extension().string(), size,
+                        [&](const fs::path &staged) {
+                          std::error_code copy_ec;
+                          return fs::copy_file(source_path, staged,
+                                               fs::copy_options::overwrite_existing,
+                                               copy_ec);
+                        });
+}
+
+Result<std::string, TaskError>
+ArtifactCache::publish_moved(const std::string &key, const std::string &source_path) {
+  std::error_code ec;
+  const auto size = fs::file_size(source_path, ec);
+  if (ec) {
+    return Result<std::string, TaskError>::Err(
+        io_error("cannot stat " + source_path + ": " + ec.message()));
+  }
+  return impl_->publish(key, fs::path(source_path).extension().string(), size,
+                        [&](const fs::path &staged) {
+                          std::error_code move_ec;
+                          fs::rename(source_path, staged, move_ec);
+                          if (!move_ec) {
+                            return true;
+                          }
+                          // Different filesystem: copy, then drop the source
+                          if (!fs::copy_file(source_path, staged,
+                                             fs::copy_options::overwrite_existing,
+                                             move_ec)) {
+                            return false;
+                          }
+                          fs::remove(source_path, move_ec);
+                          return true;
+                        });
+}
+
+std::string ArtifactCache::staging_dir() const { return (impl_->root / "tmp").string(); }
+
+Result<std::string, TaskError>
+ArtifactCache::publish_bytes(const std::string &key, const std::string &bytes,
+                             const std::string &extension) {
+  return impl_->publish(key, extension, bytes.size(), [&](const fs::path &staged) {
+    std::ofstream out(staged, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    return static_cast<bool>(out.flush());
+  });
+}
+
+ArtifactCacheStats ArtifactCache::stats() const {
+  Impl::SharedLock lock(*impl_);
+  ArtifactCacheStats stats;
+  stats.entries = impl_->header->entries;
+  stats.total_bytes = impl_->header->total_bytes;
+  stats.max_bytes = impl_->max_bytes;
+  stats.evictions = impl_->header->evictions;
+  return stats;
+}
+
+const std::string &ArtifactCache::root() const { return impl_->root_string; }
+
+#else // _WIN32
+
+struct ArtifactCache::Impl {};
+
+ArtifactCache::ArtifactCache(std::unique_ptr<Impl> impl) : impl_(std::move(impl)) {}
+
+ArtifactCache::~ArtifactCache() = default;
+
+Result<std::shared_ptr<ArtifactCache>, TaskError>
+ArtifactCache::open(const std::string &, uint64_t, uint32_t) {
+  return Result<std::shared_ptr<ArtifactCache>, TaskError>::Err(
+      TaskError::Internal("ArtifactCache: not supported on this platform"));
+}
+
+std::optional<std::string> ArtifactCache::lookup(const std::string &) { return std::nullopt; }
+std::optional<std::string> ArtifactCache::read(const std::string &) { return std::nullopt; }
+
+Result<std::string, TaskError> ArtifactCache::publish_file(const std::string &,
+                                                           const std::string &) {
+  return Result<std::string, TaskError>::Err(
+      TaskError::Internal("ArtifactCache: not supported on this platform"));
+}
+
+Result<std::string, TaskError> ArtifactCache::publish_moved(const std::string &,
+                                                            const std::string &) {
+  return Result<std::string, TaskError>::Err(
+      TaskError::Internal("ArtifactCache: not supported on this platform"));
+}
+
+std::string ArtifactCache::staging_dir() const { return {}; }
+
+Result<std::string, TaskError> ArtifactCache::publish_bytes(const std::string &,
+                                                            const std::string &,
+                                                            const std::string &) {
+  return Result<std::string, TaskError>::Err(
+      TaskError::Internal("ArtifactCache: not supported on this platform"));
+}
+
+ArtifactCacheStats ArtifactCache::stats() const { return {}; }
+
+const std::string &ArtifactCache::root() const {
+  static const std::string empty;
+  return empty;
+}
+
+#endif // _WIN32
+
+std::string ArtifactCache::make_key(const std::vector<std::string> &parts) {
+  core::Sha256 hasher;
+  for (const auto &part : parts) {
+    const uint64_t size = part.size();
+    hasher.update(&size, sizeof(size));
+    hasher.update(part);
+  }
+  return hasher.hex_digest();
+}
+
+} // namespace stv::infra
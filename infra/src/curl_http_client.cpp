@@ -1,7 +1,11 @@
 #include "infra/curl_http_client.h"
 #include "infra/logger.h"
 #include <curl/curl.h>
+#include <algorithm>
+#include <cctype>
 #include <chrono>
+#include <future>
+#include <optional>
 #include <sstream>
 
 namespace stv::infra {
@@ -13,38 +17,190 @@ namespace {
         ~CurlGlobalInit() { curl_global_cleanup(); }
     };
     static CurlGlobalInit g_curl_init;
+
+    bool iequals(const std::string& a, const std::string& b) {
+        return a.size() == b.size() &&
+               std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+                   return std::tolower(static_cast<unsigned char>(x)) ==
+                          std::tolower(static_cast<unsigned char>(y));
+               });
+    }
+
+    // I/O 线程无事可做时的最长休眠；提交、取消和析构都会主动唤醒它
+    constexpr int kIdlePollMs = 1000;
+
+    // 按 Content-Length 预留响应缓冲的上限；更大的 body 应该用 response_sink
+    constexpr curl_off_t kMaxBufferReserve = 64LL * 1024 * 1024;
+
+    using Clock = std::chrono::steady_clock;
 }
 
-CurlHttpClient::CurlHttpClient() {
-    curl_ = curl_easy_init();
-    if (!curl_) {
-        throw std::runtime_error("Failed to initialize CURL");
+struct CurlHttpClient::Transfer {
+    uint64_t id = 0;
+    HttpRequest request;
+    std::shared_ptr<stv::core::CancelToken> cancel_token;
+    ResponseCallback callback;
+    std::string host;
+    Clock::time_point queued_at;
+    Clock::time_point started_at;
+    bool waited = false;  // 提交时没能立即开始传输
+    stv::core::CancelRegistration cancel_registration;
+
+    // 传输开始后有效
+    CURL* easy = nullptr;
+    struct curl_slist* headers = nullptr;
+    std::string response_buffer;
+
+    // 响应体流向：第一块数据到达时按状态码决定进 sink 还是 response_buffer
+    bool body_started = false;
+    bool sink_open = false;
+    std::optional<stv::core::TaskError> sink_error;
+    curl_off_t reported_bytes = -1;  // 上次回调 on_download_progress 时的已收字节
+
+    // 流式上传
+    std::optional<stv::core::TaskError> source_error;
+    curl_off_t reported_upload = -1;
+};
+
+CurlHttpClient::CurlHttpClient() : CurlHttpClient(CurlPoolOptions{}) {}
+
+CurlHttpClient::CurlHttpClient(CurlPoolOptions options) : options_(options) {
+    options_.max_handles = std::max(1, options_.max_handles);
+    options_.max_per_host = std::max(0, options_.max_per_host);
+    const curl_version_info_data* version = curl_version_info(CURLVERSION_NOW);
+    if (!version || !(version->features & CURL_VERSION_HTTP2)) {
+        options_.http_version = HttpVersionPolicy::Http1;  // libcurl 未带 nghttp2
     }
+
+    multi_ = curl_multi_init();
+    share_ = curl_share_init();
+    if (!multi_ || !share_) {
+        if (multi_) {
+            curl_multi_cleanup(multi_);
+        }
+        if (share_) {
+            curl_share_cleanup(share_);
+        }
+        throw std::runtime_error("Failed to initialize CURL multi/share handle");
+    }
+    // 连接缓存由 multi handle 统一持有；DNS 与 TLS session 另经 share 共享
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    // 默认缓存容量随 multi 中的 handle 数浮动，空闲时会缩到 4 条；
+    // 固定为 max_handles，突发过后连接仍然是热的
+    curl_multi_setopt(multi_, CURLMOPT_MAXCONNECTS, static_cast<long>(options_.max_handles));
+    curl_multi_setopt(multi_, CURLMOPT_PIPELINING,
+                      options_.multiplex ? CURLPIPE_MULTIPLEX : CURLPIPE_NOTHING);
+
+    io_thread_ = std::thread([this] { io_loop(); });
 }
 
 CurlHttpClient::~CurlHttpClient() {
-    if (curl_) {
-        curl_easy_cleanup(curl_);
+    {
+        std::lock_guard<std::mutex> lock(submit_mutex_);
+        stopping_ = true;
+    }
+    curl_multi_wakeup(multi_);
+    if (io_thread_.joinable()) {
+        io_thread_.join();
     }
+    // I/O 线程退出前已结束全部传输，handle 都已从 multi 移除
+    for (CURL* handle : idle_) {
+        curl_easy_cleanup(handle);
+    }
+    curl_multi_cleanup(multi_);
+    curl_share_cleanup(share_);
+}
+
+CurlPoolStats CurlHttpClient::pool_stats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return stats_;
 }
 
-// Write callback：接收响应数据
+// Write callback：接收响应数据（2xx 且设置了 sink 时直接写 sink，不经内存）
 size_t CurlHttpClient::write_callback(char* ptr, size_t size, size_t nmemb, void* userdata) {
-    auto* buffer = static_cast<std::string*>(userdata);
-    size_t total_size = size * nmemb;
-    buffer->append(ptr, total_size);
+    auto* transfer = static_cast<Transfer*>(userdata);
+    const size_t total_size = size * nmemb;
+    const auto& sink = transfer->request.response_sink;
+
+    if (!transfer->body_started) {
+        transfer->body_started = true;
+        long http_code = 0;
+        curl_off_t content_length = -1;
+        curl_easy_getinfo(transfer->easy, CURLINFO_RESPONSE_CODE, &http_code);
+        curl_easy_getinfo(transfer->easy, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &content_length);
+        if (sink && http_code >= 200 && http_code < 300) {
+            auto begun = sink->begin(static_cast<int64_t>(content_length));
+            if (begun.is_err()) {
+                transfer->sink_error = begun.error();
+                return 0;  // curl 以 CURLE_WRITE_ERROR 结束传输
+            }
+            transfer->sink_open = true;
+        } else if (content_length > 0) {
+            // 一次分配到位，避免大 body 反复扩容拷贝
+            transfer->response_buffer.reserve(
+                static_cast<size_t>(std::min<curl_off_t>(content_length, kMaxBufferReserve)));
+        }
+    }
+
+    if (transfer->sink_open) {
+        if (!sink->write(ptr, total_size)) {
+            transfer->sink_error = make_http_error(
+                HttpErrorCode::SINK_ERROR, "Failed to save downloaded data.",
+                "Response sink rejected data: " + sink->last_error(), false);
+            return 0;
+        }
+        return total_size;
+    }
+    transfer->response_buffer.append(ptr, total_size);
     return total_size;
 }
 
-// Progress callback：支持取消
+// Read callback：从 body_source 按块读出请求体
+size_t CurlHttpClient::read_callback(char* buffer, size_t size, size_t nitems, void* userdata) {
+    auto* transfer = static_cast<Transfer*>(userdata);
+    if (transfer->cancel_token && transfer->cancel_token->is_canceled()) {
+        return CURL_READFUNC_ABORT;
+    }
+    const auto& source = transfer->request.body_source;
+    const int64_t n = source->read(buffer, size * nitems);
+    if (n < 0) {
+        transfer->source_error = make_http_error(
+            HttpErrorCode::SOURCE_ERROR, "Failed to read upload data.",
+            "Request body source failed: " + source->last_error(), false);
+        return CURL_READFUNC_ABORT;
+    }
+    return static_cast<size_t>(n);
+}
+
+// Seek callback：curl 需要重发请求体（重定向、连接复用失败重试）时只会回到开头
+int CurlHttpClient::seek_callback(void* userdata, long long offset, int origin) {
+    auto* transfer = static_cast<Transfer*>(userdata);
+    if (origin != SEEK_SET || offset != 0 || !transfer->request.body_source->rewind()) {
+        return CURL_SEEKFUNC_CANTSEEK;
+    }
+    return CURL_SEEKFUNC_OK;
+}
+
+// Progress callback：支持取消，并转发上传/下载进度
 int CurlHttpClient::progress_callback(void* clientp, long long dltotal, long long dlnow,
                                        long long ultotal, long long ulnow) {
-    (void)dltotal; (void)dlnow; (void)ultotal; (void)ulnow;  // 避免未使用警告
-
-    auto* cancel_token = static_cast<stv::core::CancelToken*>(clientp);
-    if (cancel_token && cancel_token->is_canceled()) {
+    auto* transfer = static_cast<Transfer*>(clientp);
+    if (transfer->cancel_token && transfer->cancel_token->is_canceled()) {
         return 1;  // 非0返回值会让 curl 中止请求
     }
+    if (transfer->request.on_upload_progress && ulnow > 0 &&
+        ulnow != transfer->reported_upload) {
+        transfer->reported_upload = ulnow;
+        transfer->request.on_upload_progress(static_cast<uint64_t>(ulnow),
+                                             static_cast<uint64_t>(std::max(0LL, ultotal)));
+    }
+    if (transfer->request.on_download_progress && dlnow > 0 &&
+        dlnow != transfer->reported_bytes) {
+        transfer->reported_bytes = dlnow;
+        transfer->request.on_download_progress(static_cast<uint64_t>(dlnow),
+                                               static_cast<uint64_t>(std::max(0LL, dltotal)));
+    }
     return 0;
 }
 
@@ -73,86 +229,467 @@ HttpErrorCode CurlHttpClient::classify_curl_error(int curl_code) const {
     }
 }
 
+// 连接复用按 scheme://host:port 区分，per-host 限流用同一个 key
+std::string CurlHttpClient::host_key(const std::string& url) {
+    const size_t scheme_end = url.find("://");
+    const size_t authority_begin = scheme_end == std::string::npos ? 0 : scheme_end + 3;
+    size_t authority_end = url.find_first_of("/?#", authority_begin);
+    if (authority_end == std::string::npos) {
+        authority_end = url.size();
+    }
+    std::string key = url.substr(0, authority_begin);
+    const size_t at = url.rfind('@', authority_end);
+    const size_t host_begin =
+        (at != std::string::npos && at >= authority_begin) ? at + 1 : authority_begin;
+    key += url.substr(host_begin, authority_end - host_begin);
+    std::transform(key.begin(), key.end(), key.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return key;
+}
+
 stv::core::Result<HttpResponse, stv::core::TaskError> CurlHttpClient::execute(
     const HttpRequest& request,
     std::shared_ptr<stv::core::CancelToken> cancel_token
 ) {
     using Result = stv::core::Result<HttpResponse, stv::core::TaskError>;
-    std::lock_guard<std::mutex> curl_lock(curl_mutex_);
+    // 薄封装：交给 I/O 线程后等待回调
+    auto promise = std::make_shared<std::promise<Result>>();
+    auto future = promise->get_future();
+    execute_async(request, std::move(cancel_token),
+                  [promise](Result result) { promise->set_value(std::move(result)); });
+    return future.get();
+}
 
-    auto effective_cancel_token =
+void CurlHttpClient::execute_async(
+    const HttpRequest& request,
+    std::shared_ptr<stv::core::CancelToken> cancel_token,
+    ResponseCallback callback
+) {
+    auto transfer = std::make_unique<Transfer>();
+    transfer->id = next_transfer_id_.fetch_add(1);
+    transfer->request = request;
+    transfer->cancel_token =
         cancel_token ? std::move(cancel_token) : stv::core::CancelToken::create();
+    transfer->callback = std::move(callback);
+    transfer->host = host_key(request.url);
+    transfer->queued_at = Clock::now();
 
     if (!request.request_id.empty()) {
         std::lock_guard<std::mutex> lock(in_flight_mutex_);
-        in_flight_requests_[request.request_id] = effective_cancel_token;
+        in_flight_requests_[request.request_id] = transfer->cancel_token;
     }
-    const auto unregister_request = [this, request_id = request.request_id](void*) {
-        if (request_id.empty()) {
-            return;
+
+    // 取消回调只投递 id 并唤醒 I/O 线程，移除 handle 由 I/O 线程完成
+    const uint64_t id = transfer->id;
+    transfer->cancel_registration = transfer->cancel_token->on_cancel([this, id] {
+        {
+            std::lock_guard<std::mutex> lock(submit_mutex_);
+            cancel_requests_.push_back(id);
+        }
+        curl_multi_wakeup(multi_);
+    });
+
+    {
+        std::lock_guard<std::mutex> lock(submit_mutex_);
+        if (!stopping_) {
+            submitted_.push_back(std::move(transfer));
         }
+    }
+    if (!transfer) {
+        curl_multi_wakeup(multi_);
+        return;
+    }
+
+    // 客户端正在析构：直接在调用线程上失败
+    transfer->cancel_registration.reset();
+    if (!request.request_id.empty()) {
         std::lock_guard<std::mutex> lock(in_flight_mutex_);
-        in_flight_requests_.erase(request_id);
-    };
-    std::unique_ptr<void, decltype(unregister_request)> in_flight_guard(
-        nullptr, unregister_request);
+        in_flight_requests_.erase(request.request_id);
+    }
+    transfer->callback(stv::core::Result<HttpResponse, stv::core::TaskError>::Err(
+        make_http_error(HttpErrorCode::CANCELED, "Request was canceled.",
+                        "HTTP client is shutting down", false)));
+}
+
+void CurlHttpClient::io_loop() {
+    while (true) {
+        std::deque<std::unique_ptr<Transfer>> submitted;
+        std::vector<uint64_t> cancels;
+        bool stopping = false;
+        {
+            std::lock_guard<std::mutex> lock(submit_mutex_);
+            submitted.swap(submitted_);
+            cancels.swap(cancel_requests_);
+            stopping = stopping_;
+        }
+
+        std::vector<uint64_t> fresh;
+        fresh.reserve(submitted.size());
+        for (auto& transfer : submitted) {
+            fresh.push_back(transfer->id);
+            waiting_.push_back(transfer.get());
+            transfers_.emplace(transfer->id, std::move(transfer));
+        }
+        if (!submitted.empty()) {
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            stats_.queued += static_cast<int>(submitted.size());
+        }
+        if (stopping) {
+            break;
+        }
+
+        for (uint64_t id : cancels) {
+            finish_transfer(id, stv::core::Result<HttpResponse, stv::core::TaskError>::Err(
+                make_http_error(HttpErrorCode::CANCELED, "Request was canceled.",
+                                "Canceled; transfer removed from the curl multi handle",
+                                false)));
+        }
+
+        // 排队超时（FIFO，队首最早到期）
+        const auto now = Clock::now();
+        while (options_.max_wait.count() > 0 && !waiting_.empty() &&
+               now - waiting_.front()->queued_at >= options_.max_wait) {
+            const Transfer* expired = waiting_.front();
+            {
+                std::lock_guard<std::mutex> lock(stats_mutex_);
+                stats_.wait_timeouts++;
+            }
+            finish_transfer(expired->id, stv::core::Result<HttpResponse, stv::core::TaskError>::Err(
+                make_http_error(HttpErrorCode::TIMEOUT,
+                                "Too many concurrent requests. Please try again.",
+                                "Timed out after " + std::to_string(options_.max_wait.count()) +
+                                    "ms waiting for a transfer slot (host=" + expired->host + ")",
+                                true)));
+        }
+
+        admit_waiting();
+        for (uint64_t id : fresh) {
+            auto it = transfers_.find(id);
+            if (it != transfers_.end() && !it->second->easy) {
+                it->second->waited = true;
+            }
+        }
+
+        int running = 0;
+        curl_multi_perform(multi_, &running);
+
+        bool completed = false;
+        int pending_messages = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi_, &pending_messages)) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+            char* priv = nullptr;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &priv);
+            auto* transfer = reinterpret_cast<Transfer*>(priv);
+            const CURLcode code = msg->data.result;  // 移除 handle 后 msg 失效
+            if (code == CURLE_OK) {
+                record_connection(msg->easy_handle);
+            }
+            finish_transfer(transfer->id, build_result(*transfer, code));
+            completed = true;
+        }
+        if (completed) {
+            continue;  // 空出的并发槽立即分给排队的请求
+        }
+
+        int timeout_ms = kIdlePollMs;
+        if (options_.max_wait.count() > 0 && !waiting_.empty()) {
+            const auto until_expiry = std::chrono::duration_cast<std::chrono::milliseconds>(
+                waiting_.front()->queued_at + options_.max_wait - Clock::now());
+            timeout_ms = static_cast<int>(
+                std::clamp<long long>(until_expiry.count() + 1, 0, kIdlePollMs));
+        }
+        curl_multi_poll(multi_, nullptr, 0, timeout_ms, nullptr);
+    }
+
+    std::vector<uint64_t> remaining;
+    remaining.reserve(transfers_.size());
+    for (const auto& entry : transfers_) {
+        remaining.push_back(entry.first);
+    }
+    for (uint64_t id : remaining) {
+        finish_transfer(id, stv::core::Result<HttpResponse, stv::core::TaskError>::Err(
+            make_http_error(HttpErrorCode::CANCELED, "Request was canceled.",
+                            "HTTP client is shutting down", false)));
+    }
+}
+
+void CurlHttpClient::admit_waiting() {
+    std::vector<uint64_t> canceled;
+    std::vector<uint64_t> failed;
+    for (auto it = waiting_.begin(); it != waiting_.end();) {
+        Transfer* transfer = *it;
+        // 令牌可能在注册回调之前就已取消
+        if (transfer->cancel_token->is_canceled()) {
+            canceled.push_back(transfer->id);
+            ++it;
+            continue;
+        }
+        if (active_ >= options_.max_handles) {
+            break;
+        }
+        if (options_.max_per_host > 0) {
+            auto host_it = host_in_use_.find(transfer->host);
+            if (host_it != host_in_use_.end() && host_it->second >= options_.max_per_host) {
+                ++it;
+                continue;
+            }
+        }
+        it = waiting_.erase(it);
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            stats_.queued--;
+        }
+        if (!start_transfer(*transfer)) {
+            failed.push_back(transfer->id);
+        }
+    }
 
-    // 重置 CURL handle（清除上次请求的状态）
-    curl_easy_reset(curl_);
+    for (uint64_t id : canceled) {
+        finish_transfer(id, stv::core::Result<HttpResponse, stv::core::TaskError>::Err(
+            make_http_error(HttpErrorCode::CANCELED, "Request was canceled.",
+                            "Canceled before the transfer started", false)));
+    }
+    for (uint64_t id : failed) {
+        auto it = transfers_.find(id);
+        auto error = it != transfers_.end() && it->second->source_error
+                         ? *it->second->source_error
+                         : make_http_error(HttpErrorCode::UNKNOWN, "Unknown error occurred.",
+                                           "Failed to start CURL transfer", true);
+        finish_transfer(id, stv::core::Result<HttpResponse, stv::core::TaskError>::Err(
+            std::move(error)));
+    }
+}
+
+bool CurlHttpClient::start_transfer(Transfer& transfer) {
+    // 每次传输（含重试）都从请求体开头读
+    const auto& body_source = transfer.request.body_source;
+    if (body_source && !body_source->rewind()) {
+        transfer.source_error = make_http_error(
+            HttpErrorCode::SOURCE_ERROR, "Failed to read upload data.",
+            "Request body source cannot be rewound: " + body_source->last_error(), false);
+        return false;
+    }
+
+    CURL* curl = nullptr;
+    if (!idle_.empty()) {
+        curl = idle_.back();
+        idle_.pop_back();
+    } else {
+        curl = curl_easy_init();
+        if (!curl) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.handles++;
+    }
+    const HttpRequest& request = transfer.request;
+
+    // 重置 CURL handle（清除上次请求的状态；已建立的连接由 multi 保留）
+    curl_easy_reset(curl);
+    curl_easy_setopt(curl, CURLOPT_SHARE, share_);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, &transfer);
+
+    // 连接复用：协议版本、多路复用、keep-alive
+    switch (options_.http_version) {
+        case HttpVersionPolicy::Http1:
+            curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+            break;
+        case HttpVersionPolicy::Http2:
+            curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+            break;
+        case HttpVersionPolicy::Http2PriorKnowledge:
+            curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2_PRIOR_KNOWLEDGE);
+            break;
+    }
+    // 可能走 HTTP/2 时，连接还在握手的请求等它确认能否多路复用，而不是各开一条；
+    // 注定是 HTTP/1.1 的请求不能等，否则会排在同一条连接上串行
+    const bool may_multiplex =
+        options_.http_version == HttpVersionPolicy::Http2PriorKnowledge ||
+        (options_.http_version == HttpVersionPolicy::Http2 &&
+         request.url.rfind("https://", 0) == 0);
+    if (options_.multiplex && may_multiplex) {
+        curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+    }
+    if (options_.tcp_keepalive.count() > 0) {
+        const long keepalive_s = static_cast<long>(options_.tcp_keepalive.count());
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, keepalive_s);
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, keepalive_s);
+    }
+    curl_easy_setopt(curl, CURLOPT_MAXAGE_CONN, static_cast<long>(options_.max_idle.count()));
 
     // 设置 URL
-    curl_easy_setopt(curl_, CURLOPT_URL, request.url.c_str());
+    curl_easy_setopt(curl, CURLOPT_URL, request.url.c_str());
 
-    // 设置超时（毫秒）
+    // 设置超时（毫秒，从开始传输算起，不含排队）
     long timeout_ms = static_cast<long>(request.timeout.count());
-    curl_easy_setopt(curl_, CURLOPT_TIMEOUT_MS, timeout_ms);
-    curl_easy_setopt(curl_, CURLOPT_CONNECTTIMEOUT_MS, timeout_ms / 2);  // 连接超时为总超时的一半
-
-    // 设置请求方法
-    if (request.method == HttpMethod::POST) {
-        curl_easy_setopt(curl_, CURLOPT_POST, 1L);
-        curl_easy_setopt(curl_, CURLOPT_POSTFIELDS, request.body.c_str());
-        curl_easy_setopt(curl_, CURLOPT_POSTFIELDSIZE, request.body.size());
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, timeout_ms);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, timeout_ms / 2);  // 连接超时为总超时的一半
+
+    // 设置请求方法；body_source 代替 body，由 read callback 按块读出
+    const auto& source = request.body_source;
+    if (source && (request.method == HttpMethod::POST || request.method == HttpMethod::PUT)) {
+        const auto size = static_cast<curl_off_t>(source->size());  // -1：chunked
+        if (request.method == HttpMethod::POST) {
+            curl_easy_setopt(curl, CURLOPT_POST, 1L);
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, size);
+        } else {
+            curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
+            curl_easy_setopt(curl, CURLOPT_INFILESIZE_LARGE, size);
+        }
+        curl_easy_setopt(curl, CURLOPT_READFUNCTION, &CurlHttpClient::read_callback);
+        curl_easy_setopt(curl, CURLOPT_READDATA, &transfer);
+        curl_easy_setopt(curl, CURLOPT_SEEKFUNCTION, &CurlHttpClient::seek_callback);
+        curl_easy_setopt(curl, CURLOPT_SEEKDATA, &transfer);
+    } else if (request.method == HttpMethod::POST) {
+        curl_easy_setopt(curl, CURLOPT_POST, 1L);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request.body.c_str());
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(request.body.size()));
+    } else if (request.method == HttpMethod::PUT || request.method == HttpMethod::DELETE) {
+        // 方法名由 CUSTOMREQUEST 覆盖；字符串 body 走 POSTFIELDS，PUT 无 body 时发 Content-Length: 0
+        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST,
+                         request.method == HttpMethod::PUT ? "PUT" : "DELETE");
+        if (request.method == HttpMethod::PUT || !request.body.empty()) {
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request.body.c_str());
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(request.body.size()));
+        }
     } else if (request.method == HttpMethod::GET) {
-        curl_easy_setopt(curl_, CURLOPT_HTTPGET, 1L);
+        curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
     }
-    // TODO: 支持 PUT/DELETE
 
     // 设置请求头
-    struct curl_slist* headers = nullptr;
+    bool has_content_type = false;
     for (const auto& [key, value] : request.headers) {
         std::string header = key + ": " + value;
-        headers = curl_slist_append(headers, header.c_str());
+        transfer.headers = curl_slist_append(transfer.headers, header.c_str());
+        has_content_type = has_content_type || iequals(key, "Content-Type");
     }
-    if (headers) {
-        curl_easy_setopt(curl_, CURLOPT_HTTPHEADER, headers);
+    if (source && !has_content_type && !source->content_type().empty()) {
+        const std::string header = "Content-Type: " + source->content_type();
+        transfer.headers = curl_slist_append(transfer.headers, header.c_str());
+    }
+    if (transfer.headers) {
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, transfer.headers);
     }
 
     // 设置响应数据接收回调
-    std::string response_buffer;
-    curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, &CurlHttpClient::write_callback);
-    curl_easy_setopt(curl_, CURLOPT_WRITEDATA, &response_buffer);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &CurlHttpClient::write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &transfer);
 
-    // 设置取消支持（通过 progress callback）
-    if (effective_cancel_token) {
-        curl_easy_setopt(curl_, CURLOPT_XFERINFOFUNCTION, &CurlHttpClient::progress_callback);
-        curl_easy_setopt(curl_, CURLOPT_XFERINFODATA, effective_cancel_token.get());
-        curl_easy_setopt(curl_, CURLOPT_NOPROGRESS, 0L);  // 启用 progress callback
+    // 取消主要靠 on_cancel 唤醒 I/O 线程移除 handle；progress callback 兜底
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, &CurlHttpClient::progress_callback);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &transfer);
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+
+    transfer.started_at = Clock::now();
+    if (curl_multi_add_handle(multi_, curl) != CURLM_OK) {
+        idle_.push_back(curl);
+        return false;
     }
+    transfer.easy = curl;
+    host_in_use_[transfer.host]++;
+    active_++;
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.requests++;
+    stats_.in_use++;
+    if (transfer.waited) {
+        const auto wait_us = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                transfer.started_at - transfer.queued_at).count());
+        stats_.waited++;
+        stats_.wait_us_total += wait_us;
+        stats_.wait_us_max = std::max(stats_.wait_us_max, wait_us);
+    }
+    return true;
+}
 
-    // 记录开始时间
-    auto start_time = std::chrono::steady_clock::now();
+void CurlHttpClient::record_connection(CURL* easy) {
+    long new_connections = 0;
+    long http_version = 0;
+    curl_easy_getinfo(easy, CURLINFO_NUM_CONNECTS, &new_connections);
+    curl_easy_getinfo(easy, CURLINFO_HTTP_VERSION, &http_version);
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    if (new_connections > 0) {
+        stats_.connections_new++;
+    } else {
+        stats_.connections_reused++;
+    }
+    if (http_version == CURL_HTTP_VERSION_2_0) {
+        stats_.http2_transfers++;
+    }
+}
 
-    // 执行请求
-    CURLcode res = curl_easy_perform(curl_);
+void CurlHttpClient::finish_transfer(
+    uint64_t id, stv::core::Result<HttpResponse, stv::core::TaskError> result) {
+    auto it = transfers_.find(id);
+    if (it == transfers_.end()) {
+        return;  // 已结束（重复的取消通知）
+    }
+    std::unique_ptr<Transfer> transfer = std::move(it->second);
+    transfers_.erase(it);
+
+    if (transfer->easy) {
+        curl_multi_remove_handle(multi_, transfer->easy);
+        idle_.push_back(transfer->easy);
+        active_--;
+        auto host_it = host_in_use_.find(transfer->host);
+        if (host_it != host_in_use_.end() && --host_it->second <= 0) {
+            host_in_use_.erase(host_it);
+        }
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.in_use--;
+    } else {
+        auto waiting_it = std::find(waiting_.begin(), waiting_.end(), transfer.get());
+        if (waiting_it != waiting_.end()) {
+            waiting_.erase(waiting_it);
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            stats_.queued--;
+        }
+    }
+    if (transfer->headers) {
+        curl_slist_free_all(transfer->headers);
+    }
+    if (transfer->sink_open) {
+        transfer->request.response_sink->abort();  // 失败或取消：清理写了一半的数据
+    }
+
+    const auto& request_id = transfer->request.request_id;
+    if (!request_id.empty()) {
+        std::lock_guard<std::mutex> lock(in_flight_mutex_);
+        in_flight_requests_.erase(request_id);
+    }
+
+    // 先注销取消回调（不持有任何锁），再回调调用方
+    transfer->cancel_registration.reset();
+    auto callback = std::move(transfer->callback);
+    transfer.reset();
+    if (callback) {
+        callback(std::move(result));
+    }
+}
+
+stv::core::Result<HttpResponse, stv::core::TaskError> CurlHttpClient::build_result(
+    Transfer& transfer, int curl_code) const {
+    using Result = stv::core::Result<HttpResponse, stv::core::TaskError>;
+    const auto res = static_cast<CURLcode>(curl_code);
 
     // 记录耗时
-    auto end_time = std::chrono::steady_clock::now();
-    auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+    auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        Clock::now() - transfer.started_at).count();
+
+    // body_source 读失败时 curl 只报 CURLE_ABORTED_BY_CALLBACK，原因在 source_error 里
+    if (res != CURLE_OK && transfer.source_error) {
+        return Result::Err(*transfer.source_error);
+    }
 
-    // 清理请求头
-    if (headers) {
-        curl_slist_free_all(headers);
+    // sink 拒收数据时 curl 只报 CURLE_WRITE_ERROR，原因在 sink_error 里
+    if (res == CURLE_WRITE_ERROR && transfer.sink_error) {
+        return Result::Err(*transfer.sink_error);
     }
 
     // 检查请求是否成功
@@ -185,7 +722,7 @@ stv::core::Result<HttpResponse, stv::core::TaskError> CurlHttpClient::execute(
 
     // 获取 HTTP 状态码
     long http_code = 0;
-    curl_easy_getinfo(curl_, CURLINFO_RESPONSE_CODE, &http_code);
+    curl_easy_getinfo(transfer.easy, CURLINFO_RESPONSE_CODE, &http_code);
 
     // 检查 HTTP 状态码
     if (http_code >= 500) {
@@ -220,13 +757,30 @@ stv::core::Result<HttpResponse, stv::core::TaskError> CurlHttpClient::execute(
         );
     }
 
+    // 流式下载：空 body 也要 begin，sink 才会产出（空）文件
+    const auto& sink = transfer.request.response_sink;
+    if (sink && http_code >= 200 && http_code < 300) {
+        if (!transfer.sink_open) {
+            auto begun = sink->begin(0);
+            if (begun.is_err()) {
+                return Result::Err(begun.error());
+            }
+            transfer.sink_open = true;
+        }
+        auto finished = sink->finish();
+        transfer.sink_open = false;
+        if (finished.is_err()) {
+            return Result::Err(finished.error());
+        }
+    }
+
     // 构造成功响应
     HttpResponse response;
     response.status_code = static_cast<int>(http_code);
-    response.body = std::move(response_buffer);
-    response.request_id = request.request_id.empty()
-                              ? request.trace_id + "_resp"
-                              : request.request_id + "_resp";
+    response.body = std::move(transfer.response_buffer);
+    response.request_id = transfer.request.request_id.empty()
+                              ? transfer.request.trace_id + "_resp"
+                              : transfer.request.request_id + "_resp";
     response.elapsed_ms = std::chrono::milliseconds(elapsed_ms);
 
     // TODO: 解析响应头（需要设置 CURLOPT_HEADERFUNCTION）
@@ -2,10 +2,16 @@
 
 namespace stv::infra {
 
-CurlHttpClient::CurlHttpClient() : curl_(nullptr) {}
+struct CurlHttpClient::Transfer {};
+
+CurlHttpClient::CurlHttpClient() : CurlHttpClient(CurlPoolOptions{}) {}
+
+CurlHttpClient::CurlHttpClient(CurlPoolOptions options) : options_(options) {}
 
 CurlHttpClient::~CurlHttpClient() = default;
 
+CurlPoolStats CurlHttpClient::pool_stats() const { return {}; }
+
 size_t CurlHttpClient::write_callback(char *, size_t, size_t, void *) {
   return 0;
 }
@@ -28,6 +34,12 @@ stv::core::Result<HttpResponse, stv::core::TaskError> CurlHttpClient::execute(
                       false));
 }
 
+void CurlHttpClient::execute_async(const HttpRequest &request,
+                                   std::shared_ptr<stv::core::CancelToken> cancel_token,
+                                   ResponseCallback callback) {
+  callback(execute(request, std::move(cancel_token)));
+}
+
 bool CurlHttpClient::cancel(const std::string&) { return false; }
 
 } // namespace stv::infra
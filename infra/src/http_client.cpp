@@ -1,7 +1,11 @@
 #include "infra/http_client.h"
 
+#include <algorithm>
 #include <charconv>
+#include <condition_variable>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 namespace stv::infra {
 
@@ -21,6 +25,30 @@ HttpErrorCode parse_http_error_code(const stv::core::TaskError &error) {
   }
   return static_cast<HttpErrorCode>(parsed);
 }
+
+stv::core::TaskError canceled_error(const std::string &internal_message, int retry_count,
+                                    const std::string &request_id) {
+  auto err = make_http_error(HttpErrorCode::CANCELED, "Request canceled.",
+                             internal_message, false);
+  err.details["retry_count"] = std::to_string(retry_count);
+  err.details["request_id"] = request_id;
+  return err;
+}
+
+stv::core::TaskError null_inner_error(int retry_count, const std::string &request_id) {
+  auto err = make_http_error(HttpErrorCode::UNKNOWN, "Request failed.",
+                             "RetryableHttpClient has null inner client", false);
+  err.details["retry_count"] = std::to_string(retry_count);
+  err.details["request_id"] = request_id;
+  return err;
+}
+
+std::chrono::milliseconds next_backoff(const RetryPolicy &policy,
+                                       std::chrono::milliseconds backoff) {
+  auto next = std::chrono::duration_cast<std::chrono::milliseconds>(
+      backoff * policy.backoff_multiplier);
+  return std::min(next, policy.max_backoff);
+}
 } // namespace
 
 stv::core::TaskError make_http_error(
@@ -48,6 +76,10 @@ stv::core::TaskError make_http_error(
   case HttpErrorCode::PARSE_ERROR:
     category = stv::core::ErrorCategory::Pipeline;
     break;
+  case HttpErrorCode::SINK_ERROR:
+  case HttpErrorCode::SOURCE_ERROR:
+    category = stv::core::ErrorCategory::Resource;
+    break;
   case HttpErrorCode::UNKNOWN:
     category = stv::core::ErrorCategory::Unknown;
     break;
@@ -60,12 +92,188 @@ stv::core::TaskError make_http_error(
                               user_message, internal_message, details);
 }
 
+// ========== 异步重试 ==========
+
+/// 异步路径的共享状态。回调持 weak_ptr：客户端析构后，在途请求的结果原样交付、不再重试。
+/// 退避中的请求挂在 pending_ 上，由定时线程按 sleep_slice 粒度检查到期与取消
+class RetryableHttpClient::AsyncState
+    : public std::enable_shared_from_this<AsyncState> {
+public:
+  using Result = stv::core::Result<HttpResponse, stv::core::TaskError>;
+
+  /// 一次异步请求在多次尝试间的进度
+  struct Operation {
+    HttpRequest request;
+    std::shared_ptr<stv::core::CancelToken> cancel_token;
+    ResponseCallback callback;
+    int retry_count = 0;
+    std::chrono::milliseconds backoff{0};
+  };
+
+  AsyncState(std::shared_ptr<IHttpClient> inner, RetryPolicy policy,
+             std::shared_ptr<stv::core::ILogger> logger)
+      : inner_(std::move(inner)), policy_(std::move(policy)), logger_(std::move(logger)) {}
+
+  ~AsyncState() { stop(); }
+
+  static void start(const std::shared_ptr<AsyncState> &self, std::shared_ptr<Operation> op) {
+    if (op->cancel_token && op->cancel_token->is_canceled()) {
+      op->callback(Result::Err(canceled_error("Cancellation requested before HTTP call",
+                                              op->retry_count, op->request.request_id)));
+      return;
+    }
+    if (!self->inner_) {
+      op->callback(Result::Err(null_inner_error(op->retry_count, op->request.request_id)));
+      return;
+    }
+    std::weak_ptr<AsyncState> weak = self;
+    self->inner_->execute_async(op->request, op->cancel_token, [weak, op](Result result) {
+      if (result.is_ok()) {
+        op->callback(std::move(result));
+        return;
+      }
+      auto error = result.error();
+      error.details["retry_count"] = std::to_string(op->retry_count);
+      if (!op->request.request_id.empty()) {
+        error.details["request_id"] = op->request.request_id;
+      }
+      auto state = weak.lock();
+      if (!state || !state->policy_.should_retry(parse_http_error_code(error)) ||
+          op->retry_count >= state->policy_.max_retries) {
+        op->callback(Result::Err(std::move(error)));
+        return;
+      }
+      state->schedule_retry(op, std::move(error));
+    });
+  }
+
+  /// 停止定时线程；仍在退避的请求以 CANCELED 回调
+  void stop() {
+    std::vector<Pending> abandoned;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+      abandoned.swap(pending_);
+    }
+    cv_.notify_all();
+    if (timer_.joinable() && timer_.get_id() != std::this_thread::get_id()) {
+      timer_.join();
+    }
+    for (auto &entry : abandoned) {
+      entry.op->callback(Result::Err(canceled_error("Client shut down during retry backoff",
+                                                    entry.op->retry_count,
+                                                    entry.op->request.request_id)));
+    }
+  }
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Pending {
+    Clock::time_point due;
+    std::shared_ptr<Operation> op;
+  };
+
+  void schedule_retry(const std::shared_ptr<Operation> &op, stv::core::TaskError error) {
+    if (op->retry_count == 0) {
+      op->backoff = policy_.initial_backoff;
+    }
+    if (logger_) {
+      logger_->warn(op->request.trace_id, "http_client", "retry_scheduled",
+                    "request_id=" + op->request.request_id +
+                        " retry_count=" + std::to_string(op->retry_count + 1) +
+                        " max_retries=" + std::to_string(policy_.max_retries) +
+                        " backoff_ms=" + std::to_string(op->backoff.count()));
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!stopping_) {
+        pending_.push_back({Clock::now() + op->backoff, op});
+        if (!timer_.joinable()) {
+          timer_ = std::thread([this] { run_timer(); });
+        }
+        cv_.notify_all();
+        return;
+      }
+    }
+    op->callback(Result::Err(std::move(error)));
+  }
+
+  void run_timer() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+      if (pending_.empty()) {
+        cv_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+        continue;
+      }
+      const auto now = Clock::now();
+      std::vector<Pending> due;
+      auto split = std::stable_partition(pending_.begin(), pending_.end(), [&](const Pending &p) {
+        return p.due > now && !(p.op->cancel_token && p.op->cancel_token->is_canceled());
+      });
+      std::move(split, pending_.end(), std::back_inserter(due));
+      pending_.erase(split, pending_.end());
+
+      if (!due.empty()) {
+        lock.unlock();
+        for (auto &entry : due) {
+          fire(entry.op);
+        }
+        lock.lock();
+        continue;
+      }
+      auto wake = now + policy_.sleep_slice;
+      for (const auto &entry : pending_) {
+        wake = std::min(wake, entry.due);
+      }
+      cv_.wait_until(lock, wake);
+    }
+  }
+
+  /// 退避结束（或期间被取消）：发起下一次尝试。在定时线程上调用，不持锁
+  void fire(const std::shared_ptr<Operation> &op) {
+    if (op->cancel_token && op->cancel_token->is_canceled()) {
+      op->callback(Result::Err(canceled_error("Cancellation requested during retry backoff",
+                                              op->retry_count, op->request.request_id)));
+      return;
+    }
+    op->backoff = next_backoff(policy_, op->backoff);
+    op->retry_count++;
+    start(shared_from_this(), op);
+  }
+
+  std::shared_ptr<IHttpClient> inner_;
+  RetryPolicy policy_;
+  std::shared_ptr<stv::core::ILogger> logger_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<Pending> pending_;
+  bool stopping_ = false;
+  std::thread timer_; // 首次重试时启动
+};
+
 RetryableHttpClient::RetryableHttpClient(
     std::shared_ptr<IHttpClient> inner,
     RetryPolicy policy,
     std::shared_ptr<stv::core::ILogger> logger)
     : inner_(std::move(inner)), policy_(std::move(policy)),
-      logger_(std::move(logger)) {}
+      logger_(std::move(logger)),
+      async_(std::make_shared<AsyncState>(inner_, policy_, logger_)) {}
+
+RetryableHttpClient::~RetryableHttpClient() { async_->stop(); }
+
+void RetryableHttpClient::execute_async(
+    const HttpRequest &request,
+    std::shared_ptr<stv::core::CancelToken> cancel_token,
+    ResponseCallback callback
+) {
+  auto op = std::make_shared<AsyncState::Operation>();
+  op->request = request;
+  op->cancel_token = std::move(cancel_token);
+  op->callback = std::move(callback);
+  AsyncState::start(async_, std::move(op));
+}
 
 stv::core::Result<HttpResponse, stv::core::TaskError> RetryableHttpClient::execute(
     const HttpRequest &request,
@@ -76,21 +284,13 @@ stv::core::Result<HttpResponse, stv::core::TaskError> RetryableHttpClient::execu
 
   while (true) {
     if (cancel_token && cancel_token->is_canceled()) {
-      auto err = make_http_error(HttpErrorCode::CANCELED, "Request canceled.",
-                                 "Cancellation requested before HTTP call",
-                                 false);
-      err.details["retry_count"] = std::to_string(retry_count);
-      err.details["request_id"] = request.request_id;
-      return stv::core::Result<HttpResponse, stv::core::TaskError>::Err(err);
+      return stv::core::Result<HttpResponse, stv::core::TaskError>::Err(canceled_error(
+          "Cancellation requested before HTTP call", retry_count, request.request_id));
     }
 
     if (!inner_) {
-      auto err = make_http_error(HttpErrorCode::UNKNOWN, "Request failed.",
-                                 "RetryableHttpClient has null inner client",
-                                 false);
-      err.details["retry_count"] = std::to_string(retry_count);
-      err.details["request_id"] = request.request_id;
-      return stv::core::Result<HttpResponse, stv::core::TaskError>::Err(err);
+      return stv::core::Result<HttpResponse, stv::core::TaskError>::Err(
+          null_inner_error(retry_count, request.request_id));
     }
 
     auto result = inner_->execute(request, cancel_token);
@@ -124,20 +324,13 @@ stv::core::Result<HttpResponse, stv::core::TaskError> RetryableHttpClient::execu
     auto sleep_until = std::chrono::steady_clock::now() + backoff;
     while (std::chrono::steady_clock::now() < sleep_until) {
       if (cancel_token && cancel_token->is_canceled()) {
-        auto canceled = make_http_error(
-            HttpErrorCode::CANCELED, "Request canceled.",
-            "Cancellation requested during retry backoff", false);
-        canceled.details["retry_count"] = std::to_string(retry_count);
-        canceled.details["request_id"] = request.request_id;
-        return stv::core::Result<HttpResponse, stv::core::TaskError>::Err(
-            std::move(canceled));
+        return stv::core::Result<HttpResponse, stv::core::TaskError>::Err(canceled_error(
+            "Cancellation requested during retry backoff", retry_count, request.request_id));
       }
       std::this_thread::sleep_for(policy_.sleep_slice);
     }
 
-    auto next_backoff = std::chrono::duration_cast<std::chrono::milliseconds>(
-        backoff * policy_.backoff_multiplier);
-    backoff = std::min(next_backoff, policy_.max_backoff);
+    backoff = next_backoff(policy_, backoff);
     retry_count++;
   }
 }
@@ -0,0 +1,332 @@
+#include "infra/request_body.h"
+#include "core/id.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace stv::infra {
+
+namespace {
+
+#ifndef _WIN32
+// 已发送部分累计到这么多就归还一次页面
+constexpr uint64_t kReleaseWindow = 8ULL * 1024 * 1024;
+#endif
+
+stv::core::TaskError source_error(const std::string& internal_message) {
+    return make_http_error(HttpErrorCode::SOURCE_ERROR, "Failed to read upload data.",
+                           internal_message, false);
+}
+
+/// 表单字段名/文件名里的引号和换行会破坏部分头，按 RFC 7578 转义
+std::string quote_form_value(const std::string& value) {
+    std::string quoted;
+    quoted.reserve(value.size());
+    for (char c : value) {
+        switch (c) {
+            case '"':
+                quoted += "%22";
+                break;
+            case '\r':
+                quoted += "%0D";
+                break;
+            case '\n':
+                quoted += "%0A";
+                break;
+            default:
+                quoted += c;
+        }
+    }
+    return quoted;
+}
+
+}  // namespace
+
+// ========== BufferRequestBody ==========
+
+BufferRequestBody::BufferRequestBody(const char* data, size_t size, std::string content_type)
+    : data_(data), size_(size), content_type_(std::move(content_type)) {}
+
+BufferRequestBody::BufferRequestBody(std::string data, std::string content_type)
+    : owned_(std::move(data)), data_(nullptr), size_(0), content_type_(std::move(content_type)) {
+    data_ = owned_.data();
+    size_ = owned_.size();
+}
+
+bool BufferRequestBody::rewind() {
+    offset_ = 0;
+    return true;
+}
+
+int64_t BufferRequestBody::read(char* buffer, size_t max) {
+    const size_t count = std::min(max, size_ - offset_);
+    std::memcpy(buffer, data_ + offset_, count);
+    offset_ += count;
+    return static_cast<int64_t>(count);
+}
+
+// ========== FileRequestBody ==========
+
+FileRequestBody::FileRequestBody(std::string path, std::string content_type)
+    : path_(std::move(path)), content_type_(std::move(content_type)) {}
+
+#ifndef _WIN32
+
+stv::core::Result<std::shared_ptr<FileRequestBody>, stv::core::TaskError>
+FileRequestBody::open(const std::string& path, std::string content_type) {
+    using R = stv::core::Result<std::shared_ptr<FileRequestBody>, stv::core::TaskError>;
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return R::Err(source_error("cannot open " + path + ": " + std::strerror(errno)));
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        const std::string reason = std::strerror(errno);
+        ::close(fd);
+        return R::Err(source_error("cannot stat " + path + ": " + reason));
+    }
+
+    std::shared_ptr<FileRequestBody> body(new FileRequestBody(path, std::move(content_type)));
+    body->size_ = static_cast<uint64_t>(st.st_size);
+    if (body->size_ > 0) {
+        void* mapping = ::mmap(nullptr, body->size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            const std::string reason = std::strerror(errno);
+            ::close(fd);
+            return R::Err(source_error("cannot mmap " + path + ": " + reason));
+        }
+        ::madvise(mapping, body->size_, MADV_SEQUENTIAL);
+        body->mapping_ = static_cast<const char*>(mapping);
+    }
+    ::close(fd);  // 映射建立后不再需要 fd
+    return R::Ok(std::move(body));
+}
+
+FileRequestBody::~FileRequestBody() {
+    if (mapping_) {
+        ::munmap(const_cast<char*>(mapping_), size_);
+    }
+}
+
+bool FileRequestBody::rewind() {
+    offset_ = 0;
+    released_ = 0;  // 归还过的页面再次访问时按需调回
+    return true;
+}
+
+int64_t FileRequestBody::read(char* buffer, size_t max) {
+    const uint64_t count = std::min<uint64_t>(max, size_ - offset_);
+    std::memcpy(buffer, mapping_ + offset_, count);
+    offset_ += count;
+
+    if (offset_ - released_ >= kReleaseWindow) {
+        const auto page = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+        const uint64_t end = offset_ / page * page;
+        ::madvise(const_cast<char*>(mapping_ + released_), end - released_, MADV_DONTNEED);
+        released_ = end;
+    }
+    return static_cast<int64_t>(count);
+}
+
+#else  // _WIN32
+
+stv::core::Result<std::shared_ptr<FileRequestBody>, stv::core::TaskError>
+FileRequestBody::open(const std::string& path, std::string content_type) {
+    using R = stv::core::Result<std::shared_ptr<FileRequestBody>, stv::core::TaskError>;
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return R::Err(source_error("cannot open " + path + ": " + std::strerror(errno)));
+    }
+    std::shared_ptr<FileRequestBody> body(new FileRequestBody(path, std::move(content_type)));
+    _fseeki64(file, 0, SEEK_END);
+    body->size_ = static_cast<uint64_t>(_ftelli64(file));
+    _fseeki64(file, 0, SEEK_SET);
+    body->file_ = file;
+    return R::Ok(std::move(body));
+}
+
+FileRequestBody::~FileRequestBody() {
+    if (file_) {
+        std::fclose(file_);
+    }
+}
+
+bool FileRequestBody::rewind() {
+    offset_ = 0;
+    return _fseeki64(file_, 0, SEEK_SET) == 0;
+}
+
+int64_t FileRequestBody::read(char* buffer, size_t max) {
+    const size_t count = std::fread(buffer, 1, max, file_);
+    if (count == 0 && std::ferror(file_)) {
+        error_ = "read " + path_ + " failed";
+        return -1;
+    }
+    offset_ += count;
+    return static_cast<int64_t>(count);
+}
+
+#endif  // _WIN32
+
+// ========== FdRequestBody ==========
+
+FdRequestBody::FdRequestBody(int fd, int64_t size, int64_t start_offset,
+                             std::string content_type)
+    : fd_(fd), size_(size), start_offset_(start_offset),
+      content_type_(std::move(content_type)) {
+#ifndef _WIN32
+    struct stat st {};
+    if (size_ < 0 && ::fstat(fd_, &st) == 0 && S_ISREG(st.st_mode)) {
+        size_ = std::max<int64_t>(0, static_cast<int64_t>(st.st_size) - start_offset_);
+    }
+#endif
+}
+
+bool FdRequestBody::rewind() {
+    offset_ = 0;
+    return true;
+}
+
+int64_t FdRequestBody::read(char* buffer, size_t max) {
+#ifndef _WIN32
+    if (size_ >= 0) {
+        max = static_cast<size_t>(std::min<int64_t>(static_cast<int64_t>(max), size_ - offset_));
+        if (max == 0) {
+            return 0;
+        }
+    }
+    ssize_t n = 0;
+    do {
+        n = ::pread(fd_, buffer, max, static_cast<off_t>(start_offset_ + offset_));
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        error_ = std::string("pread failed: ") + std::strerror(errno);
+        return -1;
+    }
+    offset_ += n;
+    return static_cast<int64_t>(n);
+#else
+    (void)buffer;
+    (void)max;
+    error_ = "file descriptor uploads are not supported on this platform";
+    return -1;
+#endif
+}
+
+// ========== CallbackRequestBody ==========
+
+CallbackRequestBody::CallbackRequestBody(ReadFn read, int64_t size, RewindFn rewind,
+                                         std::string content_type)
+    : read_(std::move(read)), size_(size), rewind_(std::move(rewind)),
+      content_type_(std::move(content_type)) {}
+
+bool CallbackRequestBody::rewind() {
+    if (!started_) {
+        started_ = true;  // 第一次传输开始，还在开头
+        return true;
+    }
+    return rewind_ && rewind_();
+}
+
+int64_t CallbackRequestBody::read(char* buffer, size_t max) {
+    return read_ ? read_(buffer, max) : -1;
+}
+
+// ========== MultipartRequestBody ==========
+
+MultipartRequestBody::MultipartRequestBody()
+    : boundary_("stv-" + stv::core::new_id_string()),
+      closing_("--" + boundary_ + "--\r\n") {}
+
+void MultipartRequestBody::add_field(const std::string& name, const std::string& value) {
+    segments_.push_back({"--" + boundary_ + "\r\n" +
+                             "Content-Disposition: form-data; name=\"" +
+                             quote_form_value(name) + "\"\r\n\r\n" + value + "\r\n",
+                         nullptr});
+}
+
+void MultipartRequestBody::add_file(const std::string& name, const std::string& filename,
+                                    std::shared_ptr<IRequestBody> body,
+                                    const std::string& content_type) {
+    segments_.push_back({"--" + boundary_ + "\r\n" +
+                             "Content-Disposition: form-data; name=\"" +
+                             quote_form_value(name) + "\"; filename=\"" +
+                             quote_form_value(filename) + "\"\r\n" +
+                             "Content-Type: " + content_type + "\r\n\r\n",
+                         nullptr});
+    segments_.push_back({{}, std::move(body)});
+    segments_.push_back({"\r\n", nullptr});
+}
+
+int64_t MultipartRequestBody::size() const {
+    int64_t total = static_cast<int64_t>(closing_.size());
+    for (const auto& segment : segments_) {
+        if (segment.body) {
+            const int64_t part = segment.body->size();
+            if (part < 0) {
+                return -1;
+            }
+            total += part;
+        } else {
+            total += static_cast<int64_t>(segment.text.size());
+        }
+    }
+    return total;
+}
+
+bool MultipartRequestBody::rewind() {
+    segment_ = 0;
+    text_offset_ = 0;
+    for (auto& segment : segments_) {
+        if (segment.body && !segment.body->rewind()) {
+            error_ = "part cannot be rewound: " + segment.body->last_error();
+            return false;
+        }
+    }
+    return true;
+}
+
+int64_t MultipartRequestBody::read(char* buffer, size_t max) {
+    size_t written = 0;
+    // 段末尾 segment_ == segments_.size() 指向结尾分隔符
+    while (written < max && segment_ <= segments_.size()) {
+        const bool closing = segment_ == segments_.size();
+        if (!closing && segments_[segment_].body) {
+            const int64_t n = segments_[segment_].body->read(buffer + written, max - written);
+            if (n < 0) {
+                error_ = segments_[segment_].body->last_error();
+                return -1;
+            }
+            if (n == 0) {
+                ++segment_;
+            }
+            written += static_cast<size_t>(n);
+            continue;
+        }
+        const std::string& text = closing ? closing_ : segments_[segment_].text;
+        const size_t count = std::min(max - written, text.size() - text_offset_);
+        std::memcpy(buffer + written, text.data() + text_offset_, count);
+        written += count;
+        text_offset_ += count;
+        if (text_offset_ == text.size()) {
+            ++segment_;
+            text_offset_ = 0;
+        }
+    }
+    return static_cast<int64_t>(written);
+}
+
+std::string MultipartRequestBody::content_type() const {
+    return "multipart/form-data; boundary=" + boundary_;
+}
+
+}  // namespace stv::infra
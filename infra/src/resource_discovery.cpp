@@ -0,0 +1,155 @@
+#include "infra/resource_discovery.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+namespace stv::infra {
+
+namespace {
+
+constexpr const char *kCgroupMount = "/sys/fs/cgroup";
+constexpr int64_t kBytesPerMb = 1024 * 1024;
+
+std::optional<std::string> read_file(const std::string &path) {
+  std::ifstream in(path);
+  if (!in) {
+    return std::nullopt;
+  }
+  std::stringstream buffer;
+  buffer << in.rdbuf();
+  return buffer.str();
+}
+
+std::optional<int64_t> parse_bytes_mb(const std::optional<std::string> &content) {
+  if (!content.has_value()) {
+    return std::nullopt;
+  }
+  std::istringstream in(*content);
+  std::string token;
+  in >> token;
+  if (token.empty() || token == "max") {
+    return std::nullopt;
+  }
+  try {
+    return static_cast<int64_t>(std::stoll(token) / kBytesPerMb);
+  } catch (const std::exception &) {
+    return std::nullopt;
+  }
+}
+
+/// "0::/kubepods/pod.../container" → /sys/fs/cgroup/kubepods/...; falls back
+/// to the mount root (the usual view inside a cgroup namespace).
+std::string resolve_cgroup_dir() {
+  std::ifstream in("/proc/self/cgroup");
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.rfind("0::", 0) != 0) {
+      continue;
+    }
+    const auto path = line.substr(3);
+    if (path.empty() || path == "/") {
+      break;
+    }
+    const std::string candidate = std::string(kCgroupMount) + path;
+    if (std::ifstream(candidate + "/cgroup.controllers")) {
+      return candidate;
+    }
+    break;
+  }
+  return kCgroupMount;
+}
+
+} // namespace
+
+std::optional<double> parse_psi_some_avg10(const std::string &content) {
+  std::istringstream in(content);
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.rfind("some ", 0) != 0) {
+      continue;
+    }
+    const auto pos = line.find("avg10=");
+    if (pos == std::string::npos) {
+      return std::nullopt;
+    }
+    try {
+      return std::stod(line.substr(pos + 6));
+    } catch (const std::exception &) {
+      return std::nullopt;
+    }
+  }
+  return std::nullopt;
+}
+
+std::optional<double> parse_cpu_max(const std::string &content) {
+  std::istringstream in(content);
+  std::string quota;
+  std::string period;
+  in >> quota >> period;
+  if (quota.empty() || quota == "max") {
+    return std::nullopt;
+  }
+  try {
+    const double q = std::stod(quota);
+    const double p = period.empty() ? 100000.0 : std::stod(period);
+    if (q <= 0.0 || p <= 0.0) {
+      return std::nullopt;
+    }
+    return q / p;
+  } catch (const std::exception &) {
+    return std::nullopt;
+  }
+}
+
+CgroupMonitor::CgroupMonitor(std::string cgroup_dir)
+    : dir_(cgroup_dir.empty() ? resolve_cgroup_dir() : std::move(cgroup_dir)) {}
+
+CgroupLimits CgroupMonitor::read_limits() const {
+  CgroupLimits limits;
+  if (auto cpu_max = read_file(dir_ + "/cpu.max")) {
+    limits.cpu_quota_cores = parse_cpu_max(*cpu_max);
+  }
+  limits.memory_max_mb = parse_bytes_mb(read_file(dir_ + "/memory.max"));
+  limits.memory_current_mb = parse_bytes_mb(read_file(dir_ + "/memory.current"));
+  return limits;
+}
+
+core::ResourcePressure CgroupMonitor::sample() {
+  core::ResourcePressure pressure;
+  if (auto cpu = read_file(dir_ + "/cpu.pressure")) {
+    pressure.cpu_some_avg10 = parse_psi_some_avg10(*cpu).value_or(0.0);
+  }
+  if (auto memory = read_file(dir_ + "/memory.pressure")) {
+    pressure.memory_some_avg10 = parse_psi_some_avg10(*memory).value_or(0.0);
+  }
+  const auto limits = read_limits();
+  if (limits.memory_max_mb.has_value()) {
+    pressure.memory_available_mb = std::max<int64_t>(
+        0, *limits.memory_max_mb - limits.memory_current_mb.value_or(0));
+  }
+  return pressure;
+}
+
+void apply_discovered_budget(const CgroupLimits &limits, int usable_cpus,
+                             core::SchedulerConfig &config) {
+  int cpus = std::max(1, usable_cpus);
+  if (limits.cpu_quota_cores.has_value()) {
+    cpus = std::min(
+        cpus, std::max(1, static_cast<int>(std::ceil(*limits.cpu_quota_cores))));
+  }
+  // Same shape as the hardware_concurrency rule, on the container's share.
+  config.worker_count = std::clamp(cpus - 1, 2, 8);
+  config.resource_budget.cpu_slots_hard = std::min(config.worker_count, cpus);
+
+  if (limits.memory_max_mb.has_value()) {
+    const int64_t available = std::max<int64_t>(
+        0, *limits.memory_max_mb - limits.memory_current_mb.value_or(0));
+    config.resource_budget.ram_soft_mb =
+        static_cast<int>(std::max<int64_t>(256, available * 3 / 4));
+  }
+}
+
+} // namespace stv::infra
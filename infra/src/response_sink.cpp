@@ -0,0 +1,150 @@
+#include "infra/response_sink.h"
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <utility>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#endif
+
+namespace stv::infra {
+
+namespace {
+
+using VoidResult = stv::core::Result<void, stv::core::TaskError>;
+
+VoidResult sink_error(const std::string& internal_message) {
+    return VoidResult::Err(make_http_error(HttpErrorCode::SINK_ERROR,
+                                           "Failed to save downloaded data.",
+                                           internal_message, false));
+}
+
+}  // namespace
+
+// ========== FileResponseSink ==========
+
+FileResponseSink::FileResponseSink(std::string path)
+    : path_(std::move(path)), part_path_(path_ + ".part") {}
+
+FileResponseSink::~FileResponseSink() { abort(); }
+
+VoidResult FileResponseSink::begin(int64_t content_length) {
+    abort();  // 重试：丢弃上一次尝试
+    error_.clear();
+    file_ = std::fopen(part_path_.c_str(), "wb");
+    if (!file_) {
+        return sink_error("cannot open " + part_path_ + ": " + std::strerror(errno));
+    }
+#if defined(__linux__)
+    if (content_length > 0) {
+        const int rc = ::posix_fallocate(::fileno(file_), 0, static_cast<off_t>(content_length));
+        // 文件系统不支持预分配时照常写；空间不足则现在就失败
+        if (rc == ENOSPC) {
+            abort();
+            return sink_error("no space for " + std::to_string(content_length) +
+                              " bytes at " + part_path_);
+        }
+    }
+#else
+    (void)content_length;
+#endif
+    return VoidResult::Ok();
+}
+
+bool FileResponseSink::write(const char* data, size_t size) {
+    if (!file_) {
+        error_ = "write before begin";
+        return false;
+    }
+    if (std::fwrite(data, 1, size, file_) != size) {
+        error_ = "write " + part_path_ + " failed: " + std::strerror(errno);
+        return false;
+    }
+    bytes_written_ += size;
+    return true;
+}
+
+VoidResult FileResponseSink::finish() {
+    if (!file_) {
+        return sink_error("finish before begin: " + path_);
+    }
+    const bool flushed = std::fflush(file_) == 0;
+    close_file();
+    if (!flushed) {
+        abort();
+        return sink_error("flush " + part_path_ + " failed: " + std::strerror(errno));
+    }
+    // 预分配多出的尾部（服务端实际发的比 Content-Length 少时）由 curl 报错，走不到这里
+    std::error_code ec;
+    std::filesystem::rename(part_path_, path_, ec);
+    if (ec) {
+        abort();
+        return sink_error("rename " + part_path_ + " failed: " + ec.message());
+    }
+    return VoidResult::Ok();
+}
+
+void FileResponseSink::abort() {
+    close_file();
+    std::error_code ec;
+    std::filesystem::remove(part_path_, ec);
+    bytes_written_ = 0;
+}
+
+void FileResponseSink::close_file() {
+    if (file_) {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+}
+
+// ========== MemoryResponseSink ==========
+
+MemoryResponseSink::MemoryResponseSink(size_t max_bytes) : max_bytes_(max_bytes) {}
+
+VoidResult MemoryResponseSink::begin(int64_t content_length) {
+    data_.clear();
+    error_.clear();
+    if (content_length > 0 && static_cast<uint64_t>(content_length) > max_bytes_) {
+        return sink_error("response of " + std::to_string(content_length) +
+                          " bytes exceeds limit " + std::to_string(max_bytes_));
+    }
+    if (content_length > 0) {
+        data_.reserve(static_cast<size_t>(content_length));
+    }
+    return VoidResult::Ok();
+}
+
+bool MemoryResponseSink::write(const char* data, size_t size) {
+    if (data_.size() + size > max_bytes_) {
+        error_ = "response exceeds limit " + std::to_string(max_bytes_) + " bytes";
+        return false;
+    }
+    data_.append(data, size);
+    return true;
+}
+
+VoidResult MemoryResponseSink::finish() { return VoidResult::Ok(); }
+
+// ========== CallbackResponseSink ==========
+
+CallbackResponseSink::CallbackResponseSink(ChunkFn on_chunk, BeginFn on_begin)
+    : on_chunk_(std::move(on_chunk)), on_begin_(std::move(on_begin)) {}
+
+VoidResult CallbackResponseSink::begin(int64_t content_length) {
+    if (on_begin_) {
+        on_begin_(content_length);
+    }
+    return VoidResult::Ok();
+}
+
+bool CallbackResponseSink::write(const char* data, size_t size) {
+    return on_chunk_ && on_chunk_(data, size);
+}
+
+VoidResult CallbackResponseSink::finish() { return VoidResult::Ok(); }
+
+}  // namespace stv::infra
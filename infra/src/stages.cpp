@@ -1,6 +1,12 @@
 #include "infra/stages.h"
+#include "core/id.h"
 #include "core/task_error.h"
+#include "infra/response_sink.h"
+#include <atomic>
+#include <filesystem>
+#include <future>
 #include <sstream>
+#include <vector>
 #include <regex>
 #include <cstdlib>
 
@@ -36,13 +42,159 @@ float extract_json_float(const std::string &json, const std::string &key) {
     return 0.0f;
 }
 
-/// 生成 UUID（简化版）
+/// 按出现顺序提取数组中每个对象的同名字符串字段（分镜 scenes 的逐场景字段）
+std::vector<std::string> extract_json_strings(const std::string &json, const std::string &key) {
+    std::regex pattern("\"" + key + "\"\\s*:\\s*\"([^\"]*)\"");
+    std::vector<std::string> values;
+    for (std::sregex_iterator it(json.begin(), json.end(), pattern), end; it != end; ++it) {
+        values.push_back((*it)[1].str());
+    }
+    return values;
+}
+
+/// 分镜按场景发布的输入键，如 scene_prompt_2
+std::string scene_key(const std::string &base, const core::StageContext &ctx) {
+    return base + "_" + std::to_string(ctx.get_input<int>("scene_index", 0));
+}
+
+/// 优先取直接输入 key，缺省时回退到分镜的逐场景输入
+std::string input_or_scene(const core::StageContext &ctx, const std::string &key,
+                           const std::string &scene_base) {
+    auto value = ctx.get_input<std::string>(key, "");
+    if (value.empty() && ctx.inputs.count("scene_index") > 0) {
+        value = ctx.get_input<std::string>(scene_key(scene_base, ctx), "");
+    }
+    return value;
+}
+
+/// 生成请求 ID：req-<UUIDv7>，按线程无锁生成，并发工作流下不会重复
 std::string generate_request_id() {
-    static int counter = 0;
-    std::ostringstream oss;
-    oss << "req-" << std::chrono::steady_clock::now().time_since_epoch().count() 
-        << "-" << (++counter);
-    return oss.str();
+    char buffer[4 + stv::core::kIdStringLength + 1] = {'r', 'e', 'q', '-'};
+    stv::core::format_id(stv::core::new_id(), buffer + 4);
+    return std::string(buffer, sizeof(buffer) - 1);
+}
+
+/// 非 200 响应的错误：5xx、429、408 可重试；其余 4xx 是请求本身的问题，重试也不会成功
+core::TaskError http_status_error(int status, const std::string &where) {
+    const bool retryable = status >= 500 || status == 429 || status == 408;
+    return core::TaskError(core::ErrorCategory::Network, status, retryable,
+                           retryable ? "Server error" : "Request rejected",
+                           where + ": HTTP " + std::to_string(status), {});
+}
+
+bool is_remote_url(const std::string &path) {
+    return path.rfind("http://", 0) == 0 || path.rfind("https://", 0) == 0;
+}
+
+/// URL 路径部分的扩展名（去掉 query/fragment），如 ".png"
+std::string url_extension(const std::string &url) {
+    const auto path_end = url.find_first_of("?#");
+    return std::filesystem::path(url.substr(0, path_end)).extension().string();
+}
+
+/// 下载期间工作线程上报进度的间隔
+constexpr std::chrono::milliseconds kDownloadProgressInterval{100};
+
+/// 远端产物流式下载进缓存：响应体经 FileResponseSink 直接写到缓存所在的文件系统，
+/// 再 rename 进缓存，不在内存里持有整个文件。下载进度映射到 [0.9, 1.0)
+core::Result<std::string, core::TaskError>
+download_artifact(IHttpClient &http, ArtifactCache &cache, const std::string &key,
+                  const std::string &url, core::StageContext &ctx) {
+    using R = core::Result<std::string, core::TaskError>;
+    HttpRequest request;
+    request.method = HttpMethod::GET;
+    request.url = url;
+    request.trace_id = ctx.trace_id;
+    request.request_id = generate_request_id();
+    request.timeout = std::chrono::milliseconds(300000); // 视频等大文件
+
+    const auto staged = cache.staging_dir() + "/" + request.request_id + url_extension(url);
+    auto sink = std::make_shared<FileResponseSink>(staged);
+    request.response_sink = sink;
+    // I/O 线程只记下字节数：ctx.on_progress 会进调度器（暂停时在其中等待恢复），
+    // 不能在 I/O 线程上调用，否则所有传输一起停住。由本工作线程轮询上报
+    struct Progress {
+        std::atomic<uint64_t> received{0};
+        std::atomic<uint64_t> total{0};
+    };
+    auto progress = std::make_shared<Progress>();
+    request.on_download_progress = [progress](uint64_t received, uint64_t total) {
+        progress->total.store(total, std::memory_order_relaxed);
+        progress->received.store(received, std::memory_order_relaxed);
+    };
+
+    using HttpResult = core::Result<HttpResponse, core::TaskError>;
+    auto promise = std::make_shared<std::promise<HttpResult>>();
+    auto future = promise->get_future();
+    http.execute_async(request, ctx.cancel_token,
+                       [promise](HttpResult result) { promise->set_value(std::move(result)); });
+
+    // 按 1% 粒度上报，避免每次轮询都进一次调度器锁
+    int reported_percent = -1;
+    auto report = [&]() {
+        const auto total = progress->total.load(std::memory_order_relaxed);
+        if (total == 0 || !ctx.on_progress) {
+            return;
+        }
+        const auto received = progress->received.load(std::memory_order_relaxed);
+        const int percent = static_cast<int>(std::min<uint64_t>(100, received * 100 / total));
+        if (percent != reported_percent) {
+            reported_percent = percent;
+            ctx.on_progress(0.9f + 0.099f * static_cast<float>(percent) / 100.0f);
+        }
+    };
+    while (future.wait_for(kDownloadProgressInterval) != std::future_status::ready) {
+        report();
+    }
+    report();
+    auto result = future.get();
+    if (result.is_err()) {
+        return R::Err(result.error());
+    }
+    const auto &response = result.value();
+    if (response.status_code != 200) {
+        return R::Err(http_status_error(response.status_code, "download " + url));
+    }
+    if (!response.body.empty()) {
+        // 客户端不支持 sink（mock）时 body 仍在内存里，补写一次
+        auto begun = sink->begin(static_cast<int64_t>(response.body.size()));
+        if (begun.is_err()) {
+            return R::Err(begun.error());
+        }
+        if (!sink->write(response.body.data(), response.body.size())) {
+            return R::Err(core::TaskError::Internal("download " + url + ": " + sink->last_error()));
+        }
+        auto finished = sink->finish();
+        if (finished.is_err()) {
+            return R::Err(finished.error());
+        }
+    }
+
+    auto published = cache.publish_moved(key, staged);
+    if (published.is_err()) {
+        std::error_code ec;
+        std::filesystem::remove(staged, ec);
+    }
+    return published;
+}
+
+/// 把服务端生成的文件收入本地产物缓存，返回缓存内路径。
+/// 远端服务返回 URL 时流式下载进缓存；路径不在本机或缓存/下载失败时沿用原路径
+std::string adopt_artifact(ArtifactCache *cache, IHttpClient &http, const std::string &key,
+                           const std::string &path, core::StageContext &ctx) {
+    if (!cache || key.empty()) {
+        return path;
+    }
+    if (is_remote_url(path)) {
+        auto downloaded = download_artifact(http, *cache, key, path, ctx);
+        return downloaded.is_ok() ? downloaded.value() : path;
+    }
+    std::error_code ec;
+    if (!std::filesystem::is_regular_file(path, ec)) {
+        return path;
+    }
+    auto published = cache->publish_file(key, path);
+    return published.is_ok() ? published.value() : path;
 }
 
 } // namespace
@@ -66,6 +218,20 @@ core::Result<void, core::TaskError> StoryboardStage::execute(core::StageContext
                           "Missing story_text", "StoryboardStage: story_text is empty", {}));
     }
 
+    // 相同请求直接复用本地缓存的分镜 JSON，跳过 LLM 调用
+    std::string cache_key;
+    if (artifact_cache_) {
+        std::ostringstream duration;
+        duration << target_duration;
+        cache_key = ArtifactCache::make_key(
+            {name(), version(), story_text, duration.str(), std::to_string(scene_count)});
+        if (auto cached = artifact_cache_->read(cache_key)) {
+            publish_outputs(ctx, *cached, scene_count);
+            ctx.on_progress(1.0f);
+            return core::Result<void, core::TaskError>::Ok();
+        }
+    }
+
     // 构造请求
     HttpRequest request;
     request.method = HttpMethod::POST;
@@ -94,26 +260,42 @@ core::Result<void, core::TaskError> StoryboardStage::execute(core::StageContext
         return core::Result<void, core::TaskError>::Err(result.error());
     }
 
-    auto response = result.value();
+    const auto &response = result.value();
     if (response.status_code != 200) {
         return core::Result<void, core::TaskError>::Err(
-            core::TaskError(core::ErrorCategory::Network, response.status_code, true,
-                          "Server error", "StoryboardStage: HTTP " + std::to_string(response.status_code), {}));
+            http_status_error(response.status_code, "StoryboardStage"));
     }
 
     // 解析响应（简化）
     ctx.on_progress(0.8f);
-    
+    if (!cache_key.empty()) {
+        (void)artifact_cache_->publish_bytes(cache_key, response.body, ".json"); // 尽力而为
+    }
+    publish_outputs(ctx, response.body, scene_count);
+
+    ctx.on_progress(1.0f);
+    return core::Result<void, core::TaskError>::Ok();
+}
+
+void StoryboardStage::publish_outputs(core::StageContext &ctx, const std::string &storyboard_json,
+                                      int scene_count) {
     // 提取 scenes 数组（这里简化处理，只提取总时长）
-    auto total_duration = extract_json_float(response.body, "total_duration");
-    
+    auto total_duration = extract_json_float(storyboard_json, "total_duration");
+
     // 输出：storyboard_json（原始 JSON）
-    ctx.set_output<std::string>("storyboard_json", response.body);
+    ctx.set_output<std::string>("storyboard_json", storyboard_json);
     ctx.set_output<float>("total_duration", total_duration);
     ctx.set_output<int>("scene_count", scene_count);
 
-    ctx.on_progress(1.0f);
-    return core::Result<void, core::TaskError>::Ok();
+    // 逐场景输出：只有被修改的场景其下游任务的记忆化 key 会变化
+    const auto prompts = extract_json_strings(storyboard_json, "visual_description");
+    const auto narrations = extract_json_strings(storyboard_json, "narration");
+    for (size_t i = 0; i < prompts.size(); ++i) {
+        ctx.set_output<std::string>("scene_prompt_" + std::to_string(i), prompts[i]);
+    }
+    for (size_t i = 0; i < narrations.size(); ++i) {
+        ctx.set_output<std::string>("scene_narration_" + std::to_string(i), narrations[i]);
+    }
 }
 
 // ========== ImageGenStage ==========
@@ -124,8 +306,8 @@ ImageGenStage::ImageGenStage(
     : http_client_(std::move(http_client)), api_base_url_(api_base_url) {}
 
 core::Result<void, core::TaskError> ImageGenStage::execute(core::StageContext &ctx) {
-    // 输入：prompt, width, height, num_inference_steps
-    auto prompt = ctx.get_input<std::string>("prompt", "");
+    // 输入：prompt（或 scene_prompt_<scene_index>）, width, height, num_inference_steps
+    auto prompt = input_or_scene(ctx, "prompt", "scene_prompt");
     auto width = ctx.get_input<int>("width", 512);
     auto height = ctx.get_input<int>("height", 512);
     auto steps = ctx.get_input<int>("num_inference_steps", 20);
@@ -136,6 +318,15 @@ core::Result<void, core::TaskError> ImageGenStage::execute(core::StageContext &c
                           "Missing prompt", "ImageGenStage: prompt is empty", {}));
     }
 
+    const auto cache_key = artifact_key(ctx);
+    if (!cache_key.empty()) {
+        if (auto cached = artifact_cache_->lookup(cache_key)) {
+            ctx.set_output<std::string>("image_path", *cached);
+            ctx.on_progress(1.0f);
+            return core::Result<void, core::TaskError>::Ok();
+        }
+    }
+
     HttpRequest request;
     request.method = HttpMethod::POST;
     request.url = api_base_url_ + "/v1/imagegen";
@@ -162,11 +353,10 @@ core::Result<void, core::TaskError> ImageGenStage::execute(core::StageContext &c
         return core::Result<void, core::TaskError>::Err(result.error());
     }
 
-    auto response = result.value();
+    const auto &response = result.value();
     if (response.status_code != 200) {
         return core::Result<void, core::TaskError>::Err(
-            core::TaskError(core::ErrorCategory::Network, response.status_code, true,
-                          "Server error", "ImageGenStage: HTTP " + std::to_string(response.status_code), {}));
+            http_status_error(response.status_code, "ImageGenStage"));
     }
 
     ctx.on_progress(0.9f);
@@ -179,11 +369,190 @@ core::Result<void, core::TaskError> ImageGenStage::execute(core::StageContext &c
                           "Invalid response", "ImageGenStage: missing image_path in response", {}));
     }
 
-    ctx.set_output<std::string>("image_path", image_path);
+    ctx.set_output<std::string>("image_path",
+                                adopt_artifact(artifact_cache_.get(), *http_client_, cache_key,
+                                               image_path, ctx));
     ctx.on_progress(1.0f);
     return core::Result<void, core::TaskError>::Ok();
 }
 
+std::string ImageGenStage::artifact_key(const core::StageContext &ctx) const {
+    if (!artifact_cache_) {
+        return "";
+    }
+    return ArtifactCache::make_key({name(), version(), input_or_scene(ctx, "prompt", "scene_prompt"),
+                                    std::to_string(ctx.get_input<int>("width", 512)),
+                                    std::to_string(ctx.get_input<int>("height", 512)),
+                                    std::to_string(ctx.get_input<int>("num_inference_steps", 20))});
+}
+
+bool ImageGenStage::outputs_reusable(
+    const std::unordered_map<std::string, std::any> &outputs) const {
+    if (!artifact_cache_) {
+        return true;
+    }
+    const auto it = outputs.find("image_path");
+    const auto *path = it == outputs.end() ? nullptr : std::any_cast<std::string>(&it->second);
+    // 只有缓存里的文件会被淘汰；服务端路径与远端 URL 不归本地管理
+    if (!path || path->rfind(artifact_cache_->root(), 0) != 0) {
+        return true;
+    }
+    std::error_code ec;
+    return std::filesystem::is_regular_file(*path, ec);
+}
+
+std::vector<std::string> ImageGenStage::memo_inputs(const core::StageContext &ctx) const {
+    return {"prompt", scene_key("scene_prompt", ctx), "scene_index",
+            "width", "height", "num_inference_steps"};
+}
+
+std::string ImageGenStage::batch_key(const core::StageContext &ctx) const {
+    if (input_or_scene(ctx, "prompt", "scene_prompt").empty()) {
+        return "";
+    }
+    std::ostringstream key;
+    key << "imagegen|" << ctx.get_input<int>("width", 512) << "x"
+        << ctx.get_input<int>("height", 512) << "|"
+        << ctx.get_input<int>("num_inference_steps", 20);
+    return key.str();
+}
+
+std::vector<core::Result<void, core::TaskError>>
+ImageGenStage::execute_batch(const std::vector<core::StageContext *> &members) {
+    using R = core::Result<void, core::TaskError>;
+    std::vector<R> results(members.size(), R::Ok());
+    if (members.empty()) {
+        return results;
+    }
+
+    // 已取消的成员不进请求；合并 token 仅在所有在批成员都取消时才触发，
+    // 单个成员取消不会中断其余成员的推理
+    // 本地缓存命中的成员同样不进请求
+    std::vector<size_t> live;
+    std::vector<std::string> cache_keys(members.size());
+    for (size_t i = 0; i < members.size(); ++i) {
+        auto &token = members[i]->cancel_token;
+        if (token && token->is_canceled()) {
+            results[i] = R::Err(core::TaskError::Canceled());
+            continue;
+        }
+        cache_keys[i] = artifact_key(*members[i]);
+        if (!cache_keys[i].empty()) {
+            if (auto cached = artifact_cache_->lookup(cache_keys[i])) {
+                members[i]->set_output<std::string>("image_path", *cached);
+                members[i]->on_progress(1.0f);
+                continue;
+            }
+        }
+        live.push_back(i);
+    }
+    if (live.empty()) {
+        return results;
+    }
+    // 服务端单次请求最多 kMaxBatchItems 项，超出的按块分多次请求
+    for (size_t begin = 0; begin < live.size(); begin += kMaxBatchItems) {
+        const std::vector<size_t> chunk(
+            live.begin() + static_cast<std::ptrdiff_t>(begin),
+            live.begin() + static_cast<std::ptrdiff_t>(std::min(live.size(), begin + kMaxBatchItems)));
+        if (chunk.size() == 1) {
+            results[chunk.front()] = execute(*members[chunk.front()]);
+            continue;
+        }
+        post_batch(members, chunk, cache_keys, results);
+    }
+
+    // 在批期间被取消的成员以 Canceled 结束，即便服务端已返回结果
+    for (size_t i : live) {
+        auto &token = members[i]->cancel_token;
+        if (token && token->is_canceled()) {
+            results[i] = R::Err(core::TaskError::Canceled());
+        }
+    }
+    return results;
+}
+
+void ImageGenStage::post_batch(const std::vector<core::StageContext *> &members,
+                               const std::vector<size_t> &live,
+                               const std::vector<std::string> &cache_keys,
+                               std::vector<core::Result<void, core::TaskError>> &results) {
+    using R = core::Result<void, core::TaskError>;
+    auto combined = core::CancelToken::create();
+    auto remaining = std::make_shared<std::atomic<size_t>>(live.size());
+    std::vector<core::CancelRegistration> member_links; // 请求结束即注销
+    for (size_t i : live) {
+        if (auto &token = members[i]->cancel_token) {
+            member_links.push_back(token->on_cancel([combined, remaining] {
+                if (remaining->fetch_sub(1) == 1) {
+                    combined->request_cancel();
+                }
+            }));
+        }
+    }
+
+    const auto &lead = *members[live.front()];
+    HttpRequest request;
+    request.method = HttpMethod::POST;
+    request.url = api_base_url_ + "/v1/imagegen/batch";
+    request.trace_id = lead.trace_id;
+    request.request_id = generate_request_id();
+    request.headers["Content-Type"] = "application/json";
+    request.timeout = std::chrono::milliseconds(120000 * static_cast<int>(live.size()));
+
+    std::ostringstream body;
+    body << "{"
+         << "\"trace_id\":\"" << lead.trace_id << "\","
+         << "\"request_id\":\"" << request.request_id << "\","
+         << "\"items\":[";
+    for (size_t n = 0; n < live.size(); ++n) {
+        const auto &ctx = *members[live[n]];
+        body << (n == 0 ? "" : ",") << "{"
+             << "\"trace_id\":\"" << ctx.trace_id << "\","
+             << "\"request_id\":\"" << request.request_id << "-" << n << "\","
+             << "\"prompt\":\"" << input_or_scene(ctx, "prompt", "scene_prompt") << "\","
+             << "\"width\":" << ctx.get_input<int>("width", 512) << ","
+             << "\"height\":" << ctx.get_input<int>("height", 512) << ","
+             << "\"num_inference_steps\":" << ctx.get_input<int>("num_inference_steps", 20)
+             << "}";
+    }
+    body << "]}";
+    request.body = body.str();
+
+    for (size_t i : live) {
+        members[i]->on_progress(0.2f);
+    }
+    auto result = http_client_->execute(request, combined);
+
+    auto fail_live = [&](const core::TaskError &error) {
+        for (size_t i : live) {
+            results[i] = R::Err(error);
+        }
+    };
+    if (result.is_err()) {
+        fail_live(result.error());
+    } else if (result.value().status_code != 200) {
+        fail_live(http_status_error(result.value().status_code, "ImageGenStage: batch"));
+    } else {
+        // results 与 items 顺序一致，按出现顺序取 image_path
+        static const std::regex path_pattern("\"image_path\"\\s*:\\s*\"([^\"]*)\"");
+        const auto &response_body = result.value().body;
+        auto it = std::sregex_iterator(response_body.begin(), response_body.end(), path_pattern);
+        for (size_t i : live) {
+            if (it == std::sregex_iterator()) {
+                results[i] = R::Err(core::TaskError(
+                    core::ErrorCategory::Pipeline, 2, false, "Invalid response",
+                    "ImageGenStage: batch response has fewer image_path than items", {}));
+                continue;
+            }
+            members[i]->set_output<std::string>(
+                "image_path", adopt_artifact(artifact_cache_.get(), *http_client_, cache_keys[i],
+                                            (*it)[1].str(), *members[i]));
+            members[i]->on_progress(1.0f);
+            ++it;
+        }
+    }
+
+}
+
 // ========== TtsStage ==========
 
 TtsStage::TtsStage(
@@ -192,8 +561,8 @@ TtsStage::TtsStage(
     : http_client_(std::move(http_client)), api_base_url_(api_base_url) {}
 
 core::Result<void, core::TaskError> TtsStage::execute(core::StageContext &ctx) {
-    // 输入：text, voice, speed
-    auto text = ctx.get_input<std::string>("text", "");
+    // 输入：text（或 scene_narration_<scene_index>）, voice, speed
+    auto text = input_or_scene(ctx, "text", "scene_narration");
     auto voice = ctx.get_input<std::string>("voice", "default");
     auto speed = ctx.get_input<float>("speed", 1.0f);
 
@@ -228,11 +597,10 @@ core::Result<void, core::TaskError> TtsStage::execute(core::StageContext &ctx) {
         return core::Result<void, core::TaskError>::Err(result.error());
     }
 
-    auto response = result.value();
+    const auto &response = result.value();
     if (response.status_code != 200) {
         return core::Result<void, core::TaskError>::Err(
-            core::TaskError(core::ErrorCategory::Network, response.status_code, true,
-                          "Server error", "TtsStage: HTTP " + std::to_string(response.status_code), {}));
+            http_status_error(response.status_code, "TtsStage"));
     }
 
     ctx.on_progress(0.9f);
@@ -252,6 +620,74 @@ core::Result<void, core::TaskError> TtsStage::execute(core::StageContext &ctx) {
     return core::Result<void, core::TaskError>::Ok();
 }
 
+std::vector<std::string> TtsStage::memo_inputs(const core::StageContext &ctx) const {
+    return {"text", scene_key("scene_narration", ctx), "scene_index", "voice", "speed"};
+}
+
+// ========== VideoClipStage ==========
+
+VideoClipStage::VideoClipStage(
+    std::shared_ptr<IHttpClient> http_client,
+    const std::string &api_base_url)
+    : http_client_(std::move(http_client)), api_base_url_(api_base_url) {}
+
+core::Result<void, core::TaskError> VideoClipStage::execute(core::StageContext &ctx) {
+    // 输入：image_path（来自 ImageGen），clip_duration
+    auto image_path = ctx.get_input<std::string>("image_path", "");
+    auto clip_duration = ctx.get_input<float>("clip_duration", 4.0f);
+
+    if (image_path.empty()) {
+        return core::Result<void, core::TaskError>::Err(
+            core::TaskError(core::ErrorCategory::Pipeline, 1, false,
+                          "Missing image", "VideoClipStage: image_path is empty", {}));
+    }
+
+    HttpRequest request;
+    request.method = HttpMethod::POST;
+    request.url = api_base_url_ + "/v1/videoclip";
+    request.trace_id = ctx.trace_id;
+    request.request_id = generate_request_id();
+    request.headers["Content-Type"] = "application/json";
+    request.timeout = std::chrono::milliseconds(120000);
+
+    std::ostringstream body;
+    body << "{"
+         << "\"trace_id\":\"" << ctx.trace_id << "\","
+         << "\"request_id\":\"" << request.request_id << "\","
+         << "\"image_path\":\"" << image_path << "\","
+         << "\"duration_seconds\":" << clip_duration << ","
+         << "\"fps\":24"
+         << "}";
+    request.body = body.str();
+
+    ctx.on_progress(0.2f);
+    auto result = http_client_->execute(request, ctx.cancel_token);
+
+    if (result.is_err()) {
+        return core::Result<void, core::TaskError>::Err(result.error());
+    }
+
+    const auto &response = result.value();
+    if (response.status_code != 200) {
+        return core::Result<void, core::TaskError>::Err(
+            http_status_error(response.status_code, "VideoClipStage"));
+    }
+
+    ctx.on_progress(0.9f);
+
+    auto clip_path = extract_json_string(response.body, "clip_path");
+    if (clip_path.empty()) {
+        return core::Result<void, core::TaskError>::Err(
+            core::TaskError(core::ErrorCategory::Pipeline, 2, false,
+                          "Invalid response", "VideoClipStage: missing clip_path in response", {}));
+    }
+
+    ctx.set_output<std::string>("clip_path", clip_path);
+    ctx.set_output<std::string>("image_path", image_path); // 供片段合成回退使用
+    ctx.on_progress(1.0f);
+    return core::Result<void, core::TaskError>::Ok();
+}
+
 // ========== ComposeStage ==========
 
 ComposeStage::ComposeStage(
@@ -264,6 +700,26 @@ core::Result<void, core::TaskError> ComposeStage::execute(core::StageContext &ct
     auto scenes_json = ctx.get_input<std::string>("scenes_json", "");
     auto output_path = ctx.get_input<std::string>("output_path", "/tmp/output.mp4");
 
+    // 片段模式：由上游 VideoClip / TTS 的输出拼出单场景
+    const int scene_index = ctx.get_input<int>("scene_index", -1);
+    const bool segment_mode = scenes_json.empty() && scene_index >= 0;
+    if (segment_mode) {
+        std::ostringstream scene;
+        scene << "{"
+              << "\"scene_number\":" << (scene_index + 1) << ","
+              << "\"image_path\":\"" << ctx.get_input<std::string>("image_path", "") << "\","
+              << "\"clip_path\":\"" << ctx.get_input<std::string>("clip_path", "") << "\","
+              << "\"audio_path\":\"" << ctx.get_input<std::string>("audio_path", "") << "\","
+              << "\"duration_seconds\":" << ctx.get_input<float>("duration_seconds", 4.0f)
+              << "}";
+        scenes_json = streaming_session_ ? scene.str() : "[" + scene.str() + "]";
+        output_path = ctx.get_input<std::string>(
+            "output_path", "/tmp/stv_segment_" + ctx.trace_id + "_" +
+                               std::to_string(scene_index) + ".mp4");
+    }
+    // 流式模式：片段直接追加进本工作流的合成会话（session_id = trace_id）
+    const bool append_to_session = segment_mode && streaming_session_;
+
     if (scenes_json.empty()) {
         return core::Result<void, core::TaskError>::Err(
             core::TaskError(core::ErrorCategory::Pipeline, 1, false,
@@ -272,7 +728,7 @@ core::Result<void, core::TaskError> ComposeStage::execute(core::StageContext &ct
 
     HttpRequest request;
     request.method = HttpMethod::POST;
-    request.url = api_base_url_ + "/v1/compose";
+    request.url = api_base_url_ + (append_to_session ? "/v1/compose/session/append" : "/v1/compose");
     request.trace_id = ctx.trace_id;
     request.request_id = generate_request_id();
     request.headers["Content-Type"] = "application/json";
@@ -281,9 +737,15 @@ core::Result<void, core::TaskError> ComposeStage::execute(core::StageContext &ct
     std::ostringstream body;
     body << "{"
          << "\"trace_id\":\"" << ctx.trace_id << "\","
-         << "\"request_id\":\"" << request.request_id << "\","
-         << "\"scenes\":" << scenes_json << ","
-         << "\"output_path\":\"" << output_path << "\","
+         << "\"request_id\":\"" << request.request_id << "\",";
+    if (append_to_session) {
+        body << "\"session_id\":\"" << ctx.trace_id << "\","
+             << "\"scene_index\":" << scene_index << ","
+             << "\"scene\":" << scenes_json << ",";
+    } else {
+        body << "\"scenes\":" << scenes_json << ",";
+    }
+    body << "\"output_path\":\"" << output_path << "\","
          << "\"fps\":24"
          << "}";
     request.body = body.str();
@@ -295,11 +757,10 @@ core::Result<void, core::TaskError> ComposeStage::execute(core::StageContext &ct
         return core::Result<void, core::TaskError>::Err(result.error());
     }
 
-    auto response = result.value();
+    const auto &response = result.value();
     if (response.status_code != 200) {
         return core::Result<void, core::TaskError>::Err(
-            core::TaskError(core::ErrorCategory::Network, response.status_code, true,
-                          "Server error", "ComposeStage: HTTP " + std::to_string(response.status_code), {}));
+            http_status_error(response.status_code, "ComposeStage"));
     }
 
     ctx.on_progress(0.9f);
@@ -313,6 +774,92 @@ core::Result<void, core::TaskError> ComposeStage::execute(core::StageContext &ct
                           "Invalid response", "ComposeStage: missing video_path in response", {}));
     }
 
+    ctx.set_output<std::string>("video_path", video_path);
+    ctx.set_output<float>("duration_seconds", duration);
+    if (scene_index >= 0) {
+        // 各片段键名不同，Concat 合并依赖输出时不会互相覆盖
+        ctx.set_output<std::string>("segment_path_" + std::to_string(scene_index), video_path);
+    }
+    ctx.on_progress(1.0f);
+    return core::Result<void, core::TaskError>::Ok();
+}
+
+// ========== ConcatStage ==========
+
+ConcatStage::ConcatStage(
+    std::shared_ptr<IHttpClient> http_client,
+    const std::string &api_base_url)
+    : http_client_(std::move(http_client)), api_base_url_(api_base_url) {}
+
+core::Result<void, core::TaskError> ConcatStage::execute(core::StageContext &ctx) {
+    // 输入：segment_path_0..N-1（按场景顺序），output_path
+    std::vector<std::string> segments;
+    for (int i = 0;; ++i) {
+        auto path = ctx.get_input<std::string>("segment_path_" + std::to_string(i), "");
+        if (path.empty()) {
+            break;
+        }
+        segments.push_back(std::move(path));
+    }
+    auto output_path = ctx.get_input<std::string>(
+        "output_path", "/tmp/stv_output_" + ctx.trace_id + ".mp4");
+
+    if (segments.empty()) {
+        return core::Result<void, core::TaskError>::Err(
+            core::TaskError(core::ErrorCategory::Pipeline, 1, false,
+                          "Missing segments", "ConcatStage: no segment_path_* inputs", {}));
+    }
+
+    // 流式模式：片段已在会话流中，只需补齐缺失片段并封装；
+    // segments 仍全部带上，未经会话（如命中记忆化）的片段由服务端补追加
+    HttpRequest request;
+    request.method = HttpMethod::POST;
+    request.url = api_base_url_ +
+                  (streaming_session_ ? "/v1/compose/session/finalize" : "/v1/concat");
+    request.trace_id = ctx.trace_id;
+    request.request_id = generate_request_id();
+    request.headers["Content-Type"] = "application/json";
+    request.timeout = std::chrono::milliseconds(300000);
+
+    std::ostringstream body;
+    body << "{"
+         << "\"trace_id\":\"" << ctx.trace_id << "\","
+         << "\"request_id\":\"" << request.request_id << "\",";
+    if (streaming_session_) {
+        body << "\"session_id\":\"" << ctx.trace_id << "\",";
+    }
+    body << "\"segments\":[";
+    for (size_t i = 0; i < segments.size(); ++i) {
+        body << (i == 0 ? "" : ",") << "\"" << segments[i] << "\"";
+    }
+    body << "],"
+         << "\"output_path\":\"" << output_path << "\""
+         << "}";
+    request.body = body.str();
+
+    ctx.on_progress(0.2f);
+    auto result = http_client_->execute(request, ctx.cancel_token);
+
+    if (result.is_err()) {
+        return core::Result<void, core::TaskError>::Err(result.error());
+    }
+
+    const auto &response = result.value();
+    if (response.status_code != 200) {
+        return core::Result<void, core::TaskError>::Err(
+            http_status_error(response.status_code, "ConcatStage"));
+    }
+
+    ctx.on_progress(0.9f);
+
+    auto video_path = extract_json_string(response.body, "video_path");
+    auto duration = extract_json_float(response.body, "duration_seconds");
+    if (video_path.empty()) {
+        return core::Result<void, core::TaskError>::Err(
+            core::TaskError(core::ErrorCategory::Pipeline, 2, false,
+                          "Invalid response", "ConcatStage: missing video_path in response", {}));
+    }
+
     ctx.set_output<std::string>("video_path", video_path);
     ctx.set_output<float>("duration_seconds", duration);
     ctx.on_progress(1.0f);
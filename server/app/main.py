@@ -18,16 +18,22 @@ from schemas import (
     HealthResponse, ErrorResponse,
     StoryboardRequest, StoryboardResponse,
     ImageGenRequest, ImageGenResponse,
+    ImageGenBatchRequest, ImageGenBatchResponse,
     TtsRequest, TtsResponse,
     ComposeRequest, ComposeResponse,
+    VideoClipRequest, VideoClipResponse,
+    ConcatRequest,
+    ComposeSegmentRequest, ComposeFinalizeRequest,
     CancelResponse
 )
+from services.compose_session import ComposeSessionRegistry
 from services.task_registry import TaskRegistry
 from providers.base import BaseProvider
 from providers.mock import MockProvider
 
 # 全局状态
 task_registry = TaskRegistry()
+compose_sessions = ComposeSessionRegistry()
 provider: BaseProvider = None
 fault_inject_rate = 0.0
 
@@ -160,6 +166,27 @@ async def generate_image(request: ImageGenRequest):
         raise
 
 
+@app.post("/v1/imagegen/batch", response_model=ImageGenBatchResponse)
+async def generate_images(request: ImageGenBatchRequest):
+    """批量生成图像"""
+    if not provider:
+        raise HTTPException(status_code=503, detail="Provider not initialized")
+    
+    task_registry.register(request.trace_id, request.request_id, "imagegen_batch")
+    
+    try:
+        results = await provider.generate_images(request)
+        task_registry.complete(request.request_id)
+        return ImageGenBatchResponse(
+            request_id=request.request_id,
+            trace_id=request.trace_id,
+            results=results,
+        )
+    except Exception as e:
+        task_registry.fail(request.request_id, str(e))
+        raise
+
+
 @app.post("/v1/tts", response_model=TtsResponse)
 async def generate_speech(request: TtsRequest):
     """生成语音"""
@@ -194,6 +221,90 @@ async def compose_video(request: ComposeRequest):
         raise
 
 
+@app.post("/v1/videoclip", response_model=VideoClipResponse)
+async def render_clip(request: VideoClipRequest):
+    """单场景图像转视频片段"""
+    if not provider:
+        raise HTTPException(status_code=503, detail="Provider not initialized")
+    
+    task_registry.register(request.trace_id, request.request_id, "videoclip")
+    
+    try:
+        result = await provider.render_clip(request)
+        task_registry.complete(request.request_id)
+        return result
+    except Exception as e:
+        task_registry.fail(request.request_id, str(e))
+        raise
+
+
+@app.post("/v1/concat", response_model=ComposeResponse)
+async def concat_videos(request: ConcatRequest):
+    """按场景顺序拼接片段"""
+    if not provider:
+        raise HTTPException(status_code=503, detail="Provider not initialized")
+    
+    task_registry.register(request.trace_id, request.request_id, "concat")
+    
+    try:
+        result = await provider.concat_videos(request)
+        task_registry.complete(request.request_id)
+        return result
+    except Exception as e:
+        task_registry.fail(request.request_id, str(e))
+        raise
+
+
+@app.post("/v1/compose/session/append", response_model=ComposeResponse)
+async def compose_session_append(request: ComposeSegmentRequest):
+    """流式合成：合成单场景片段，并按场景顺序追加进会话流"""
+    if not provider:
+        raise HTTPException(status_code=503, detail="Provider not initialized")
+    
+    task_registry.register(request.trace_id, request.request_id, "compose_segment")
+    
+    try:
+        result = await provider.compose_video(ComposeRequest(
+            trace_id=request.trace_id,
+            request_id=request.request_id,
+            scenes=[request.scene],
+            output_path=request.output_path,
+            fps=request.fps,
+        ))
+        await compose_sessions.open(request.session_id).add_segment(
+            request.scene_index, result.video_path)
+        task_registry.complete(request.request_id)
+        return result
+    except Exception as e:
+        task_registry.fail(request.request_id, str(e))
+        raise
+
+
+@app.post("/v1/compose/session/finalize", response_model=ComposeResponse)
+async def compose_session_finalize(request: ComposeFinalizeRequest):
+    """流式合成：补齐缺失片段，封装成品并关闭会话"""
+    task_registry.register(request.trace_id, request.request_id, "compose_finalize")
+    
+    try:
+        output_path = Path(request.output_path)
+        await compose_sessions.open(request.session_id).finalize(request.segments, output_path)
+        compose_sessions.close(request.session_id)
+        task_registry.complete(request.request_id)
+        return ComposeResponse(
+            request_id=request.request_id,
+            trace_id=request.trace_id,
+            video_path=str(output_path),
+            duration_seconds=0.0,  # 封装不重新探测时长
+            size_bytes=output_path.stat().st_size if output_path.exists() else 0,
+        )
+    except ValueError as e:
+        task_registry.fail(request.request_id, str(e))
+        raise HTTPException(status_code=409, detail=str(e))
+    except Exception as e:
+        task_registry.fail(request.request_id, str(e))
+        raise
+
+
 @app.post("/v1/cancel/{request_id}", response_model=CancelResponse)
 async def cancel_task(request_id: str):
     """取消任务"""
@@ -1,15 +1,41 @@
 """
 Provider 基类 - 定义所有 AI 服务的统一接口
 """
+import asyncio
+import os
+import tempfile
 from abc import ABC, abstractmethod
+from pathlib import Path
+from typing import List
 from schemas import (
     StoryboardRequest, StoryboardResponse,
     ImageGenRequest, ImageGenResponse,
+    ImageGenBatchRequest,
     TtsRequest, TtsResponse,
-    ComposeRequest, ComposeResponse
+    ComposeRequest, ComposeResponse,
+    VideoClipRequest, VideoClipResponse,
+    ConcatRequest
 )
 
 
+async def run_ffmpeg(args: List[str], output_path: Path, timeout: float = 120) -> None:
+    """运行 FFmpeg；FFmpeg 缺失或失败时创建空文件作为后备（与 mock 合成一致）"""
+    output_path.parent.mkdir(parents=True, exist_ok=True)
+    try:
+        proc = await asyncio.create_subprocess_exec(
+            "ffmpeg", "-y", *args, str(output_path),
+            stdout=asyncio.subprocess.DEVNULL,
+            stderr=asyncio.subprocess.PIPE,
+        )
+        _, stderr = await asyncio.wait_for(proc.communicate(), timeout=timeout)
+        if proc.returncode != 0:
+            print(f"FFmpeg error: {stderr.decode(errors='replace')[-500:]}")
+            output_path.touch()
+    except FileNotFoundError:
+        print("FFmpeg not found, creating empty file")
+        output_path.touch()
+
+
 class BaseProvider(ABC):
     """AI 服务 Provider 基类"""
     
@@ -23,6 +49,10 @@ class BaseProvider(ABC):
         """生成图像"""
         pass
     
+    async def generate_images(self, request: ImageGenBatchRequest) -> List[ImageGenResponse]:
+        """批量生成图像（默认逐个生成；GPU provider 可覆盖为单次批推理）"""
+        return [await self.generate_image(item) for item in request.items]
+    
     @abstractmethod
     async def generate_speech(self, request: TtsRequest) -> TtsResponse:
         """生成语音"""
@@ -33,6 +63,45 @@ class BaseProvider(ABC):
         """合成视频"""
         pass
     
+    async def render_clip(self, request: VideoClipRequest) -> VideoClipResponse:
+        """单场景图像 → 视频片段（默认：静帧循环编码）"""
+        output_dir = Path(os.getenv("STV_OUTPUT_DIR", "/tmp/stv-output"))
+        clip_path = output_dir / f"clip_{request.request_id}.mp4"
+        await run_ffmpeg(
+            ["-loop", "1", "-i", request.image_path,
+             "-t", str(request.duration_seconds), "-r", str(request.fps),
+             "-c:v", "libx264", "-pix_fmt", "yuv420p"],
+            clip_path,
+        )
+        return VideoClipResponse(
+            request_id=request.request_id,
+            trace_id=request.trace_id,
+            clip_path=str(clip_path),
+            duration_seconds=request.duration_seconds,
+        )
+    
+    async def concat_videos(self, request: ConcatRequest) -> ComposeResponse:
+        """按顺序无重编码拼接片段（FFmpeg concat demuxer）"""
+        output_path = Path(request.output_path)
+        with tempfile.NamedTemporaryFile("w", suffix=".txt", delete=False) as listing:
+            for segment in request.segments:
+                listing.write(f"file '{segment}'\n")
+        try:
+            await run_ffmpeg(
+                ["-f", "concat", "-safe", "0", "-i", listing.name, "-c", "copy"],
+                output_path,
+                timeout=300,
+            )
+        finally:
+            os.unlink(listing.name)
+        return ComposeResponse(
+            request_id=request.request_id,
+            trace_id=request.trace_id,
+            video_path=str(output_path),
+            duration_seconds=0.0,  # 拼接不重新探测时长
+            size_bytes=output_path.stat().st_size if output_path.exists() else 0,
+        )
+    
     async def cancel_task(self, request_id: str) -> bool:
         """取消任务（可选实现）"""
         return False
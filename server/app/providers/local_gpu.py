@@ -8,10 +8,12 @@ import os
 from pathlib import Path
 from datetime import datetime
 import random
+from typing import Dict, List, Tuple
 from providers.base import BaseProvider
 from schemas import (
     StoryboardRequest, StoryboardResponse, Scene,
     ImageGenRequest, ImageGenResponse,
+    ImageGenBatchRequest,
     TtsRequest, TtsResponse,
     ComposeRequest, ComposeResponse
 )
@@ -178,30 +180,82 @@ class LocalGpuProvider(BaseProvider):
                         generator=generator,
                     )
                 
-                image = result.images[0]
-                
-                # 保存图像
-                timestamp = datetime.now().strftime("%Y%m%d_%H%M%S")
-                filename = f"sd_image_{request.request_id}_{timestamp}.png"
-                image_path = self.output_dir / filename
-                image.save(image_path)
-                
-                print(f"✓ Image generated: {image_path}")
-                
-                return ImageGenResponse(
-                    request_id=request.request_id,
-                    trace_id=request.trace_id,
-                    image_path=str(image_path),
-                    width=request.width,
-                    height=request.height,
-                    seed=seed
-                )
+                return self._save_sd_image(request, result.images[0], seed)
                 
             except Exception as e:
                 print(f"✗ SD inference failed: {e}")
                 print("  Falling back to mock generation")
                 return await self._generate_image_mock(request)
     
+    async def generate_images(self, request: ImageGenBatchRequest) -> List[ImageGenResponse]:
+        """批量生成：同尺寸/步数/引导系数的条目合并为一次 SD 调用，结果按条目顺序返回"""
+        async with self._gpu_lock:  # 整批占用 GPU 一次
+            if self._sd_pipe is None:
+                await self._load_sd_model()
+            
+            if self._sd_pipe is None:
+                return [await self._generate_image_mock(item) for item in request.items]
+            
+            # 调用方通常已按批键分好组；这里仍按管线参数分组，防止混合尺寸
+            groups: Dict[Tuple[int, int, int, float], List[int]] = {}
+            for index, item in enumerate(request.items):
+                key = (item.width, item.height, item.num_inference_steps, item.guidance_scale)
+                groups.setdefault(key, []).append(index)
+            
+            results: List[ImageGenResponse] = [None] * len(request.items)
+            for (width, height, steps, guidance), indices in groups.items():
+                items = [request.items[i] for i in indices]
+                try:
+                    import torch
+                    
+                    # 每个条目独立的 generator，与单张生成时同一 seed 的结果一致
+                    seeds = [item.seed if item.seed is not None else random.randint(0, 2**32-1)
+                             for item in items]
+                    generators = [torch.Generator(device="cuda").manual_seed(seed) for seed in seeds]
+                    negative = [item.negative_prompt or "" for item in items]
+                    
+                    print(f"Generating {len(items)} images in one batch ({width}x{height}, {steps} steps)...")
+                    
+                    with torch.no_grad():
+                        result = self._sd_pipe(
+                            prompt=[item.prompt for item in items],
+                            negative_prompt=negative if any(negative) else None,
+                            width=width,
+                            height=height,
+                            num_inference_steps=steps,
+                            guidance_scale=guidance,
+                            generator=generators,
+                        )
+                    
+                    for slot, item, image, seed in zip(indices, items, result.images, seeds):
+                        results[slot] = self._save_sd_image(item, image, seed)
+                
+                except Exception as e:
+                    print(f"✗ SD batch inference failed: {e}")
+                    print("  Falling back to mock generation")
+                    for slot, item in zip(indices, items):
+                        results[slot] = await self._generate_image_mock(item)
+            
+            return results
+    
+    def _save_sd_image(self, request: ImageGenRequest, image, seed: int) -> ImageGenResponse:
+        """保存 SD 输出图像并构造响应"""
+        timestamp = datetime.now().strftime("%Y%m%d_%H%M%S")
+        filename = f"sd_image_{request.request_id}_{timestamp}.png"
+        image_path = self.output_dir / filename
+        image.save(image_path)
+        
+        print(f"✓ Image generated: {image_path}")
+        
+        return ImageGenResponse(
+            request_id=request.request_id,
+            trace_id=request.trace_id,
+            image_path=str(image_path),
+            width=request.width,
+            height=request.height,
+            seed=seed
+        )
+    
     async def _generate_image_mock(self, request: ImageGenRequest) -> ImageGenResponse:
         """后备：生成模拟图像"""
         from PIL import Image, ImageDraw, ImageFont
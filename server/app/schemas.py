@@ -79,6 +79,20 @@ class ImageGenResponse(BaseModel):
     seed: int = Field(..., description="实际使用的随机种子")
 
 
+class ImageGenBatchRequest(BaseModel):
+    """批量图像生成请求（同尺寸/步数的多个 prompt 合并为一次推理）"""
+    trace_id: str
+    request_id: str
+    items: List[ImageGenRequest] = Field(..., min_length=1, max_length=16)
+
+
+class ImageGenBatchResponse(BaseModel):
+    """批量图像生成响应（results 与 items 顺序一致）"""
+    request_id: str
+    trace_id: str
+    results: List[ImageGenResponse]
+
+
 # ========== Text-to-Speech ==========
 
 class TtsRequest(BaseModel):
@@ -106,6 +120,7 @@ class SceneAsset(BaseModel):
     """场景资源"""
     scene_number: int
     image_path: str = Field(..., description="图像路径")
+    clip_path: Optional[str] = Field("", description="场景视频片段路径（非空时优先于 image_path）")
     audio_path: str = Field(..., description="音频路径")
     duration_seconds: float = Field(..., description="场景时长")
 
@@ -130,6 +145,53 @@ class ComposeResponse(BaseModel):
     size_bytes: int = Field(..., description="文件大小（字节）")
 
 
+# ========== Video Clip / Concat ==========
+
+class VideoClipRequest(BaseModel):
+    """单场景图像转视频片段请求"""
+    trace_id: str
+    request_id: str
+    image_path: str = Field(..., description="场景图像路径")
+    duration_seconds: float = Field(4.0, description="片段时长（秒）", gt=0, le=60)
+    fps: int = Field(24, description="帧率", ge=1, le=60)
+
+
+class VideoClipResponse(BaseModel):
+    """单场景视频片段响应"""
+    request_id: str
+    trace_id: str
+    clip_path: str = Field(..., description="生成的片段路径")
+    duration_seconds: float
+
+
+class ConcatRequest(BaseModel):
+    """片段拼接请求（segments 按播放顺序）"""
+    trace_id: str
+    request_id: str
+    segments: List[str] = Field(..., min_length=1, description="片段视频路径列表")
+    output_path: str = Field(..., description="输出视频路径（绝对路径）")
+
+
+class ComposeSegmentRequest(BaseModel):
+    """流式合成：合成单场景片段并追加到会话（session_id 通常为 trace_id）"""
+    trace_id: str
+    request_id: str
+    session_id: str = Field(..., min_length=1, description="合成会话 ID")
+    scene_index: int = Field(..., ge=0, description="场景序号（从 0 开始，决定追加顺序）")
+    scene: SceneAsset
+    output_path: str = Field(..., description="片段输出路径（绝对路径）")
+    fps: int = Field(24, description="帧率", ge=1, le=60)
+
+
+class ComposeFinalizeRequest(BaseModel):
+    """流式合成：结束会话并输出成品（segments 用于补齐未经会话的片段）"""
+    trace_id: str
+    request_id: str
+    session_id: str = Field(..., min_length=1, description="合成会话 ID")
+    segments: List[str] = Field(..., min_length=1, description="全部片段路径（按播放顺序）")
+    output_path: str = Field(..., description="输出视频路径（绝对路径）")
+
+
 # ========== Cancellation ==========
 
 class CancelResponse(BaseModel):
@@ -0,0 +1,101 @@
+"""
+流式合成会话 - 片段一到就按场景顺序追加进成品流
+
+每个工作流（session_id = trace_id）一个会话：场景片段编码完成后立即转为
+MPEG-TS 并按场景顺序追加到会话流文件（乱序到达的片段先挂起，等前序场景
+到齐再追加）。finalize 只需补齐缺失片段并把 TS 流无重编码封装为 MP4，
+因此最后一张图落地后的耗时只剩尾部片段 + 一次流拷贝。
+"""
+import asyncio
+import os
+import time
+from pathlib import Path
+from typing import Dict, List, Optional
+
+from providers.base import run_ffmpeg
+
+
+class ComposeSession:
+    """单个工作流的流式合成状态"""
+
+    def __init__(self, session_id: str, work_dir: Path):
+        self.session_id = session_id
+        self.work_dir = work_dir
+        self.stream_path = work_dir / "stream.ts"
+        self.next_index = 0  # 下一个待追加的场景
+        self.pending: Dict[int, str] = {}  # 乱序到达、等待前序场景的片段
+        self.lock = asyncio.Lock()
+        self.touched_at = time.monotonic()
+
+    async def add_segment(self, scene_index: int, segment_path: str) -> None:
+        """登记场景片段，并追加所有已连续的片段"""
+        async with self.lock:
+            self.touched_at = time.monotonic()
+            if scene_index >= self.next_index:
+                self.pending.setdefault(scene_index, segment_path)
+            await self._drain()
+
+    async def finalize(self, segments: List[str], output_path: Path) -> None:
+        """补齐未追加的片段（如客户端命中缓存未经过会话），封装成品"""
+        async with self.lock:
+            for index, path in enumerate(segments):
+                if index >= self.next_index:
+                    self.pending.setdefault(index, path)
+            await self._drain()
+            if self.next_index < len(segments):
+                raise ValueError(
+                    f"compose session {self.session_id}: missing segment {self.next_index}")
+            await run_ffmpeg(
+                ["-i", str(self.stream_path), "-c", "copy", "-bsf:a", "aac_adtstoasc"],
+                output_path,
+                timeout=300,
+            )
+
+    async def _drain(self) -> None:
+        while self.next_index in self.pending:
+            segment = self.pending.pop(self.next_index)
+            part = self.work_dir / f"{self.next_index}.ts"
+            await run_ffmpeg(
+                ["-i", segment, "-c", "copy", "-bsf:v", "h264_mp4toannexb", "-f", "mpegts"],
+                part,
+            )
+            # TS 可按字节直接拼接
+            with open(self.stream_path, "ab") as stream, open(part, "rb") as chunk:
+                stream.write(chunk.read())
+            part.unlink(missing_ok=True)
+            self.next_index += 1
+
+
+class ComposeSessionRegistry:
+    """会话表；首个片段到达时自动打开，finalize 后关闭，闲置超时清理"""
+
+    def __init__(self, idle_timeout_s: float = 3600):
+        self._sessions: Dict[str, ComposeSession] = {}
+        self._idle_timeout_s = idle_timeout_s
+        self._root = Path(os.getenv("STV_OUTPUT_DIR", "/tmp/stv-output")) / "sessions"
+
+    def open(self, session_id: str) -> ComposeSession:
+        self._sweep()
+        session = self._sessions.get(session_id)
+        if session is None:
+            work_dir = self._root / session_id
+            work_dir.mkdir(parents=True, exist_ok=True)
+            session = ComposeSession(session_id, work_dir)
+            self._sessions[session_id] = session
+        return session
+
+    def close(self, session_id: str) -> None:
+        session: Optional[ComposeSession] = self._sessions.pop(session_id, None)
+        if session is not None:
+            session.stream_path.unlink(missing_ok=True)
+            try:
+                session.work_dir.rmdir()
+            except OSError:
+                pass
+
+    def _sweep(self) -> None:
+        now = time.monotonic()
+        expired = [sid for sid, s in self._sessions.items()
+                   if now - s.touched_at > self._idle_timeout_s and not s.lock.locked()]
+        for sid in expired:
+            self.close(sid)
@@ -1,22 +1,34 @@
 #include <gtest/gtest.h>
 
 #include "core/cancel_token.h"
+#include "core/scheduler.h"
+#include "infra/artifact_cache.h"
 #include "infra/curl_http_client.h"
 #include "infra/http_client.h"
+#include "infra/request_body.h"
+#include "infra/response_sink.h"
+#include "infra/stages.h"
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
 #include <cerrno>
 #include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <thread>
+#include <vector>
 
 using namespace stv::infra;
 using namespace stv::core;
@@ -64,6 +76,7 @@ private:
     uint16_t port_ = 0;
     std::atomic<bool> stop_{false};
     std::thread worker_;
+    std::vector<std::thread> clients_;  // One per connection (accept thread only)
     std::string start_error_;
 
     void start() {
@@ -97,7 +110,7 @@ private:
         }
         port_ = ntohs(addr.sin_port);
 
-        if (::listen(listen_fd_, 16) < 0) {
+        if (::listen(listen_fd_, SOMAXCONN) < 0) {
             start_error_ = std::string("listen() failed: ") + std::strerror(errno);
             ::close(listen_fd_);
             listen_fd_ = -1;
@@ -117,6 +130,10 @@ private:
         if (worker_.joinable()) {
             worker_.join();
         }
+        for (auto& client : clients_) {
+            client.join();
+        }
+        clients_.clear();
     }
 
     static bool send_all(int fd, const std::string& data) {
@@ -139,13 +156,14 @@ private:
     void send_response(int client_fd,
                        int status,
                        const std::string& body,
-                       const std::string& request_id = "local-req") {
+                       const std::string& request_id = "local-req",
+                       bool keep_alive = false) {
         std::ostringstream response;
         response << "HTTP/1.1 " << status << ' ' << reason_phrase(status) << "\r\n";
         response << "Content-Type: application/json\r\n";
         response << "Content-Length: " << body.size() << "\r\n";
         response << "X-Request-ID: " << request_id << "\r\n";
-        response << "Connection: close\r\n\r\n";
+        response << "Connection: " << (keep_alive ? "keep-alive" : "close") << "\r\n\r\n";
         response << body;
         (void)send_all(client_fd, response.str());
     }
@@ -174,13 +192,20 @@ private:
         }
     }
 
+    // Paths under /keepalive/ answer like their suffix but keep the
+    // connection open for the next request.
     void handle_client(int client_fd) {
+        while (handle_request(client_fd)) {
+        }
+    }
+
+    bool handle_request(int client_fd) {
         std::string raw_request;
         char buffer[4096];
         while (raw_request.find("\r\n\r\n") == std::string::npos) {
             const ssize_t n = ::recv(client_fd, buffer, sizeof(buffer), 0);
             if (n <= 0) {
-                return;
+                return false;
             }
             raw_request.append(buffer, static_cast<size_t>(n));
         }
@@ -203,6 +228,10 @@ private:
             std::istringstream line_stream(request_line);
             line_stream >> method >> path >> version;
         }
+        const bool keep_alive = starts_with(path, "/keepalive/");
+        if (keep_alive) {
+            path = path.substr(std::strlen("/keepalive"));
+        }
 
         size_t content_length = 0;
         const std::string content_length_tag = "Content-Length:";
@@ -217,6 +246,34 @@ private:
             content_length = static_cast<size_t>(std::stoul(value));
         }
 
+        if (headers.find("Expect: 100-continue") != std::string::npos) {
+            (void)send_all(client_fd, "HTTP/1.1 100 Continue\r\n\r\n");
+        }
+
+        // Counts and checksums the body without keeping it, for large uploads
+        if (method == "POST" && path == "/upload") {
+            uint64_t received = body.size();
+            uint64_t sum = 0;
+            for (unsigned char c : body) {
+                sum += c;
+            }
+            while (received < content_length) {
+                const ssize_t n = ::recv(client_fd, buffer, sizeof(buffer), 0);
+                if (n <= 0) {
+                    return false;
+                }
+                for (ssize_t i = 0; i < n; ++i) {
+                    sum += static_cast<unsigned char>(buffer[i]);
+                }
+                received += static_cast<uint64_t>(n);
+            }
+            send_response(client_fd, 200,
+                          "{\"received\":" + std::to_string(received) +
+                              ",\"sum\":" + std::to_string(sum) + "}",
+                          "local-upload", keep_alive);
+            return keep_alive;
+        }
+
         while (body.size() < content_length) {
             const ssize_t n = ::recv(client_fd, buffer, sizeof(buffer), 0);
             if (n <= 0) {
@@ -226,13 +283,18 @@ private:
         }
 
         if (method == "GET" && path == "/get") {
-            send_response(client_fd, 200, R"({"ok":true})", "local-get");
-            return;
+            send_response(client_fd, 200, R"({"ok":true})", "local-get", keep_alive);
+            return keep_alive;
         }
 
         if (method == "POST" && path == "/post") {
-            send_response(client_fd, 200, body.empty() ? R"({"ok":true})" : body, "local-post");
-            return;
+            send_response(client_fd, 200, body.empty() ? R"({"ok":true})" : body, "local-post", keep_alive);
+            return keep_alive;
+        }
+
+        if (path == "/echo") {
+            send_response(client_fd, 200, method + " " + body, "local-echo", keep_alive);
+            return keep_alive;
         }
 
         if (starts_with(path, "/delay/")) {
@@ -244,13 +306,31 @@ private:
                 delay_ms = 0;
             }
             std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
-            send_response(client_fd, 200, R"({"delayed":true})", "local-delay");
-            return;
+            send_response(client_fd, 200, R"({"delayed":true})", "local-delay", keep_alive);
+            return keep_alive;
+        }
+
+        if (starts_with(path, "/bytes/")) {
+            const size_t count = static_cast<size_t>(std::stoul(path.substr(std::strlen("/bytes/"))));
+            std::string payload(count, '\0');
+            for (size_t i = 0; i < count; ++i) {
+                payload[i] = static_cast<char>('a' + i % 26);
+            }
+            send_response(client_fd, 200, payload, "local-bytes", keep_alive);
+            return keep_alive;
         }
 
-        if (path == "/slow-stream") {
+        // An image generator that hands back a URL the client must download
+        if (method == "POST" && path == "/v1/imagegen") {
+            send_response(client_fd, 200,
+                          "{\"image_path\":\"" + base_url() + "/slow-stream?name=img.png\"}",
+                          "local-imagegen", keep_alive);
+            return keep_alive;
+        }
+
+        if (starts_with(path, "/slow-stream")) {
             send_slow_stream(client_fd);
-            return;
+            return false;
         }
 
         if (starts_with(path, "/status/")) {
@@ -261,11 +341,12 @@ private:
             } catch (...) {
                 status_code = 500;
             }
-            send_response(client_fd, status_code, R"({"status":"custom"})", "local-status");
-            return;
+            send_response(client_fd, status_code, R"({"status":"custom"})", "local-status", keep_alive);
+            return keep_alive;
         }
 
-        send_response(client_fd, 404, R"({"error":"not found"})", "local-404");
+        send_response(client_fd, 404, R"({"error":"not found"})", "local-404", keep_alive);
+        return keep_alive;
     }
 
     void run_loop() {
@@ -285,8 +366,10 @@ private:
                 continue;
             }
 
-            handle_client(client_fd);
-            ::close(client_fd);
+            clients_.emplace_back([this, client_fd] {
+                handle_client(client_fd);
+                ::close(client_fd);
+            });
         }
     }
 };
@@ -340,6 +423,41 @@ TEST_F(CurlHttpClientTest, PostRequest) {
     EXPECT_NE(result.value().body.find("test"), std::string::npos);
 }
 
+TEST_F(CurlHttpClientTest, PutAndDeleteSendMethodAndBody) {
+    CurlHttpClient client;
+
+    HttpRequest request;
+    request.url = server_.base_url() + "/echo";
+    request.headers["Content-Type"] = "application/json";
+    request.trace_id = "test-put-delete";
+    request.timeout = 3s;
+
+    request.method = HttpMethod::PUT;
+    request.body = R"({"name":"scene"})";
+    auto put = client.execute(request);
+    ASSERT_TRUE(put.is_ok()) << put.error().internal_message;
+    EXPECT_EQ(put.value().body, R"(PUT {"name":"scene"})");
+
+    request.method = HttpMethod::DELETE;
+    request.body.clear();
+    auto del = client.execute(request);
+    ASSERT_TRUE(del.is_ok()) << del.error().internal_message;
+    EXPECT_EQ(del.value().body, "DELETE ");
+
+    request.method = HttpMethod::DELETE;
+    request.body = R"({"ids":[1,2]})";
+    auto del_with_body = client.execute(request);
+    ASSERT_TRUE(del_with_body.is_ok()) << del_with_body.error().internal_message;
+    EXPECT_EQ(del_with_body.value().body, R"(DELETE {"ids":[1,2]})");
+
+    // Pooled handles are reset between requests: a GET after DELETE stays a GET.
+    request.method = HttpMethod::GET;
+    request.body.clear();
+    auto get = client.execute(request);
+    ASSERT_TRUE(get.is_ok()) << get.error().internal_message;
+    EXPECT_EQ(get.value().body, "GET ");
+}
+
 TEST_F(CurlHttpClientTest, Timeout) {
     CurlHttpClient client;
 
@@ -447,6 +565,495 @@ TEST_F(CurlHttpClientTest, WithRetryDecorator) {
     EXPECT_GE(elapsed.count(), 250);
 }
 
+HttpRequest make_delay_request(const std::string& base_url, int delay_ms, int index) {
+    HttpRequest request;
+    request.method = HttpMethod::GET;
+    request.url = base_url + "/delay/" + std::to_string(delay_ms);
+    request.trace_id = "test-pool";
+    request.request_id = "req-pool-" + std::to_string(index);
+    request.timeout = 3s;
+    return request;
+}
+
+TEST_F(CurlHttpClientTest, PooledRequestsRunConcurrently) {
+    CurlPoolOptions options;
+    options.max_handles = 4;
+    CurlHttpClient client(options);
+
+    std::atomic<int> ok{0};
+    std::vector<std::thread> threads;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&, i] {
+            if (client.execute(make_delay_request(server_.base_url(), 300, i)).is_ok()) {
+                ok.fetch_add(1);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    EXPECT_EQ(ok.load(), 4);
+    EXPECT_LT(elapsed.count(), 900);  // Serialized would take >= 1200ms
+    const auto stats = client.pool_stats();
+    EXPECT_EQ(stats.requests, 4U);
+    EXPECT_EQ(stats.waited, 0U);
+    EXPECT_EQ(stats.handles, 4);
+    EXPECT_EQ(stats.in_use, 0);
+}
+
+TEST_F(CurlHttpClientTest, PoolLimitsQueueAndMeasureWait) {
+    CurlPoolOptions options;
+    options.max_handles = 4;
+    options.max_per_host = 1;
+    CurlHttpClient client(options);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 2; ++i) {
+        threads.emplace_back([&, i] {
+            EXPECT_TRUE(client.execute(make_delay_request(server_.base_url(), 200, i)).is_ok());
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    const auto stats = client.pool_stats();
+    EXPECT_EQ(stats.requests, 2U);
+    EXPECT_EQ(stats.waited, 1U);
+    EXPECT_GE(stats.wait_us_max, 100000U);
+    EXPECT_EQ(stats.handles, 1);  // The queued request reused the returned handle
+}
+
+TEST_F(CurlHttpClientTest, PoolWaitTimeoutIsRetryable) {
+    CurlPoolOptions options;
+    options.max_handles = 1;
+    options.max_wait = 50ms;
+    CurlHttpClient client(options);
+
+    std::thread holder([&] {
+        EXPECT_TRUE(client.execute(make_delay_request(server_.base_url(), 400, 0)).is_ok());
+    });
+    while (client.pool_stats().in_use == 0) {
+        std::this_thread::sleep_for(2ms);
+    }
+    auto result = client.execute(make_delay_request(server_.base_url(), 0, 1));
+    holder.join();
+
+    ASSERT_TRUE(result.is_err());
+    EXPECT_EQ(result.error().category, ErrorCategory::Timeout);
+    EXPECT_TRUE(result.error().retryable);
+    EXPECT_EQ(client.pool_stats().wait_timeouts, 1U);
+}
+
+TEST_F(CurlHttpClientTest, AsyncReturnsImmediatelyAndCallsBackOnce) {
+    CurlHttpClient client;
+    std::promise<Result<HttpResponse, TaskError>> done;
+    std::atomic<int> calls{0};
+
+    const auto start = std::chrono::steady_clock::now();
+    client.execute_async(make_delay_request(server_.base_url(), 300, 0), nullptr,
+                         [&](Result<HttpResponse, TaskError> result) {
+                             calls.fetch_add(1);
+                             done.set_value(std::move(result));
+                         });
+    const auto submit_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+    EXPECT_LT(submit_ms.count(), 100);
+
+    auto result = done.get_future().get();
+    ASSERT_TRUE(result.is_ok()) << result.error().internal_message;
+    EXPECT_EQ(result.value().status_code, 200);
+    std::this_thread::sleep_for(50ms);
+    EXPECT_EQ(calls.load(), 1);
+}
+
+TEST_F(CurlHttpClientTest, AsyncRunsHundredsOfTransfersConcurrently) {
+    CurlPoolOptions options;
+    options.max_handles = 1000;
+    CurlHttpClient client(options);
+    constexpr int kTransfers = 300;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    int finished = 0;
+    int succeeded = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kTransfers; ++i) {
+        client.execute_async(make_delay_request(server_.base_url(), 300, i), nullptr,
+                             [&](Result<HttpResponse, TaskError> result) {
+                                 std::lock_guard<std::mutex> lock(mutex);
+                                 finished++;
+                                 succeeded += result.is_ok() ? 1 : 0;
+                                 cv.notify_all();
+                             });
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ASSERT_TRUE(cv.wait_for(lock, 10s, [&] { return finished == kTransfers; }));
+    }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    EXPECT_EQ(succeeded, kTransfers);
+    EXPECT_LT(elapsed.count(), 3000);  // One I/O thread, all transfers overlapped
+    EXPECT_EQ(client.pool_stats().in_use, 0);
+}
+
+TEST_F(CurlHttpClientTest, AsyncCancelRemovesIdleTransferImmediately) {
+    CurlHttpClient client;
+    auto cancel_token = CancelToken::create();
+    std::promise<Result<HttpResponse, TaskError>> done;
+
+    client.execute_async(make_delay_request(server_.base_url(), 1000, 0), cancel_token,
+                         [&](Result<HttpResponse, TaskError> result) {
+                             done.set_value(std::move(result));
+                         });
+    std::this_thread::sleep_for(100ms);  // Connected, server silent
+    const auto cancel_at = std::chrono::steady_clock::now();
+    cancel_token->request_cancel();
+    auto result = done.get_future().get();
+    const auto latency = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - cancel_at);
+
+    ASSERT_TRUE(result.is_err());
+    EXPECT_EQ(result.error().category, ErrorCategory::Canceled);
+    EXPECT_LT(latency.count(), 100);  // No wait for curl's next progress tick
+    EXPECT_EQ(client.pool_stats().in_use, 0);
+}
+
+TEST_F(CurlHttpClientTest, KeepAliveConnectionIsReused) {
+    CurlHttpClient client;
+
+    for (int i = 0; i < 3; ++i) {
+        auto request = make_delay_request(server_.base_url() + "/keepalive", 0, i);
+        ASSERT_TRUE(client.execute(request).is_ok());
+    }
+
+    const auto stats = client.pool_stats();
+    EXPECT_EQ(stats.connections_new, 1U);
+    EXPECT_EQ(stats.connections_reused, 2U);
+    EXPECT_NEAR(stats.reuse_rate(), 2.0 / 3.0, 1e-9);
+    EXPECT_EQ(stats.http2_transfers, 0U);  // Plain http stays on HTTP/1.1
+}
+
+TEST_F(CurlHttpClientTest, ConnectionsStayWarmAfterBurst) {
+    CurlPoolOptions options;
+    options.max_handles = 8;
+    CurlHttpClient client(options);
+
+    // Two bursts of 8 concurrent requests: the second burst must find all
+    // eight connections from the first still cached.
+    for (int round = 0; round < 2; ++round) {
+        std::vector<std::future<bool>> results;
+        for (int i = 0; i < 8; ++i) {
+            auto done = std::make_shared<std::promise<bool>>();
+            results.push_back(done->get_future());
+            client.execute_async(
+                make_delay_request(server_.base_url() + "/keepalive", 200, i), nullptr,
+                [done](Result<HttpResponse, TaskError> result) {
+                    done->set_value(result.is_ok());
+                });
+        }
+        for (auto& result : results) {
+            EXPECT_TRUE(result.get());
+        }
+    }
+
+    const auto stats = client.pool_stats();
+    EXPECT_EQ(stats.connections_new, 8U);
+    EXPECT_EQ(stats.connections_reused, 8U);
+}
+
+TEST_F(CurlHttpClientTest, FileSinkStreamsBodyToDiskWithProgress) {
+    CurlHttpClient client;
+    const auto path = std::filesystem::temp_directory_path() /
+                      ("stv_sink_" + std::to_string(::getpid()) + ".bin");
+    constexpr size_t kSize = 4 * 1024 * 1024;
+
+    HttpRequest request = make_delay_request(server_.base_url(), 0, 0);
+    request.url = server_.base_url() + "/bytes/" + std::to_string(kSize);
+    auto sink = std::make_shared<FileResponseSink>(path.string());
+    request.response_sink = sink;
+    uint64_t last_received = 0;
+    uint64_t last_total = 0;
+    int progress_calls = 0;
+    request.on_download_progress = [&](uint64_t received, uint64_t total) {
+        EXPECT_GE(received, last_received);
+        last_received = received;
+        last_total = total;
+        ++progress_calls;
+    };
+
+    auto result = client.execute(request);
+
+    ASSERT_TRUE(result.is_ok()) << result.error().internal_message;
+    EXPECT_TRUE(result.value().body.empty());  // Never buffered in memory
+    EXPECT_EQ(sink->bytes_written(), kSize);
+    ASSERT_TRUE(std::filesystem::exists(path));
+    EXPECT_EQ(std::filesystem::file_size(path), kSize);
+    EXPECT_FALSE(std::filesystem::exists(path.string() + ".part"));
+    std::ifstream in(path, std::ios::binary);
+    std::string head(26, '\0');
+    in.read(&head[0], 26);
+    EXPECT_EQ(head, "abcdefghijklmnopqrstuvwxyz");
+    EXPECT_GT(progress_calls, 0);
+    EXPECT_EQ(last_received, kSize);
+    EXPECT_EQ(last_total, kSize);
+    std::filesystem::remove(path);
+}
+
+TEST_F(CurlHttpClientTest, MemorySinkOverLimitFailsWithoutRetry) {
+    CurlHttpClient client;
+    HttpRequest request = make_delay_request(server_.base_url(), 0, 0);
+    request.url = server_.base_url() + "/bytes/4096";
+    request.response_sink = std::make_shared<MemoryResponseSink>(1024);
+
+    auto result = client.execute(request);
+
+    ASSERT_TRUE(result.is_err());
+    EXPECT_EQ(result.error().code, static_cast<int>(HttpErrorCode::SINK_ERROR));
+    EXPECT_FALSE(result.error().retryable);
+
+    auto sink = std::make_shared<MemoryResponseSink>(8192);
+    request.response_sink = sink;
+    ASSERT_TRUE(client.execute(request).is_ok());
+    EXPECT_EQ(sink->data().size(), 4096U);
+}
+
+TEST_F(CurlHttpClientTest, ErrorStatusLeavesFileSinkUntouched) {
+    CurlHttpClient client;
+    const auto path = std::filesystem::temp_directory_path() /
+                      ("stv_sink_err_" + std::to_string(::getpid()) + ".bin");
+    HttpRequest request = make_delay_request(server_.base_url(), 0, 0);
+    request.url = server_.base_url() + "/status/404";
+    request.response_sink = std::make_shared<FileResponseSink>(path.string());
+
+    auto result = client.execute(request);
+
+    ASSERT_TRUE(result.is_err());
+    EXPECT_EQ(result.error().code, static_cast<int>(HttpErrorCode::CLIENT_ERROR));
+    EXPECT_FALSE(std::filesystem::exists(path));
+    EXPECT_FALSE(std::filesystem::exists(path.string() + ".part"));
+}
+
+// Current resident set (VmRSS), not the lifetime peak: a peak left by an
+// earlier test would hide growth during the upload.
+long current_rss_kb() {
+    std::ifstream statm("/proc/self/statm");
+    long size_pages = 0;
+    long resident_pages = 0;
+    statm >> size_pages >> resident_pages;
+    return resident_pages * (::sysconf(_SC_PAGESIZE) / 1024);
+}
+
+HttpRequest make_upload_request(const std::string& base_url, const std::string& path) {
+    HttpRequest request;
+    request.method = HttpMethod::POST;
+    request.url = base_url + path;
+    request.trace_id = "test-upload";
+    request.request_id = "req-upload";
+    request.timeout = 20s;
+    return request;
+}
+
+TEST_F(CurlHttpClientTest, FileBodyUploadsWithoutGrowingRss) {
+    const auto path = std::filesystem::temp_directory_path() /
+                      ("stv_upload_" + std::to_string(::getpid()) + ".bin");
+    constexpr size_t kChunk = 1 << 20;
+    constexpr size_t kChunks = 128;
+    uint64_t expected_sum = 0;
+    {
+        std::ofstream out(path, std::ios::binary);
+        std::string chunk(kChunk, '\0');
+        for (size_t i = 0; i < kChunk; ++i) {
+            chunk[i] = static_cast<char>(i * 7);
+            expected_sum += static_cast<unsigned char>(chunk[i]);
+        }
+        for (size_t i = 0; i < kChunks; ++i) {
+            out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        }
+        expected_sum *= kChunks;
+    }
+    auto body = FileRequestBody::open(path.string(), "video/mp4");
+    ASSERT_TRUE(body.is_ok()) << body.error().internal_message;
+
+    CurlHttpClient client;
+    HttpRequest request = make_upload_request(server_.base_url(), "/upload");
+    request.body_source = body.value();
+    uint64_t last_sent = 0;
+    const long rss_before = current_rss_kb();
+    ASSERT_GT(rss_before, 0);
+    long rss_peak = rss_before;
+    request.on_upload_progress = [&](uint64_t sent, uint64_t) {
+        last_sent = sent;
+        rss_peak = std::max(rss_peak, current_rss_kb());
+    };
+
+    auto result = client.execute(request);
+    const long rss_growth_mb = (rss_peak - rss_before) / 1024;
+    std::filesystem::remove(path);
+
+    ASSERT_TRUE(result.is_ok()) << result.error().internal_message;
+    EXPECT_EQ(result.value().body, "{\"received\":" + std::to_string(kChunk * kChunks) +
+                                       ",\"sum\":" + std::to_string(expected_sum) + "}");
+    EXPECT_EQ(last_sent, kChunk * kChunks);
+    EXPECT_LT(rss_growth_mb, 32);  // 128 MiB went through
+}
+
+TEST_F(CurlHttpClientTest, MultipartBodyStreamsFieldsAndFiles) {
+    auto multipart = std::make_shared<MultipartRequestBody>();
+    multipart->add_field("project_id", "p-1");
+    multipart->add_file("video", "final \"cut\".mp4",
+                        std::make_shared<BufferRequestBody>(std::string("VIDEO-BYTES")),
+                        "video/mp4");
+
+    CurlHttpClient client;
+    HttpRequest request = make_upload_request(server_.base_url(), "/post");
+    request.body_source = multipart;
+
+    auto result = client.execute(request);
+
+    ASSERT_TRUE(result.is_ok()) << result.error().internal_message;
+    const std::string& boundary = multipart->boundary();
+    const std::string expected =
+        "--" + boundary + "\r\n"
+        "Content-Disposition: form-data; name=\"project_id\"\r\n\r\n"
+        "p-1\r\n"
+        "--" + boundary + "\r\n"
+        "Content-Disposition: form-data; name=\"video\"; filename=\"final %22cut%22.mp4\"\r\n"
+        "Content-Type: video/mp4\r\n\r\n"
+        "VIDEO-BYTES\r\n"
+        "--" + boundary + "--\r\n";
+    EXPECT_EQ(result.value().body, expected);
+    EXPECT_EQ(multipart->size(), static_cast<int64_t>(expected.size()));
+    EXPECT_EQ(multipart->content_type(), "multipart/form-data; boundary=" + boundary);
+}
+
+TEST_F(CurlHttpClientTest, BodySourceReadErrorFailsWithoutRetry) {
+    int reads = 0;
+    auto source = std::make_shared<CallbackRequestBody>(
+        [&](char* buffer, size_t max) -> int64_t {
+            if (++reads > 1) {
+                return -1;
+            }
+            std::memset(buffer, 'x', max);
+            return static_cast<int64_t>(max);
+        },
+        1 << 20);
+
+    CurlHttpClient client;
+    HttpRequest request = make_upload_request(server_.base_url(), "/upload");
+    request.body_source = source;
+
+    auto result = client.execute(request);
+
+    ASSERT_TRUE(result.is_err());
+    EXPECT_EQ(result.error().code, static_cast<int>(HttpErrorCode::SOURCE_ERROR));
+    EXPECT_FALSE(result.error().retryable);
+    // A callback source without a rewind function cannot be sent twice
+    auto again = client.execute(request);
+    ASSERT_TRUE(again.is_err());
+    EXPECT_EQ(again.error().code, static_cast<int>(HttpErrorCode::SOURCE_ERROR));
+}
+
+TEST_F(CurlHttpClientTest, CancelStopsUploadMidBody) {
+    auto cancel_token = CancelToken::create();
+    uint64_t produced = 0;
+    auto source = std::make_shared<CallbackRequestBody>(
+        [&](char* buffer, size_t max) -> int64_t {
+            produced += max;
+            if (produced > (4u << 20)) {
+                cancel_token->request_cancel();
+            }
+            std::memset(buffer, 'x', max);
+            return static_cast<int64_t>(max);
+        },
+        int64_t{1} << 34);  // 16 GiB, never sent in full
+
+    CurlHttpClient client;
+    HttpRequest request = make_upload_request(server_.base_url(), "/upload");
+    request.body_source = source;
+
+    auto result = client.execute(request, cancel_token);
+
+    ASSERT_TRUE(result.is_err());
+    EXPECT_EQ(result.error().category, ErrorCategory::Canceled);
+    EXPECT_LT(produced, uint64_t{64} << 20);
+}
+
+TEST_F(CurlHttpClientTest, PausingDownloadingTaskLeavesOtherTransfersRunning) {
+    const auto root = std::filesystem::temp_directory_path() /
+                      ("stv_pause_download_" + std::to_string(::getpid()));
+    std::filesystem::remove_all(root);
+    auto opened = ArtifactCache::open(root.string(), 64ULL << 20);
+    ASSERT_TRUE(opened.is_ok()) << opened.error().internal_message;
+    auto cache = opened.value();
+
+    auto client = std::make_shared<CurlHttpClient>();
+    auto stage = std::make_shared<ImageGenStage>(client, server_.base_url());
+    stage->set_artifact_cache(cache);
+
+    SchedulerConfig cfg;
+    cfg.worker_count = 1;
+    cfg.resource_budget.cpu_slots_hard = 1;
+    cfg.pause_policy.checkpoint_timeout_ms = 10000;
+    auto scheduler = create_thread_pool_scheduler(cfg, nullptr);
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool paused = false;
+    float progress = 0.0f;
+    scheduler->on_state_change([&](const std::string&, TaskState state, float value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        paused = paused || state == TaskState::Paused;
+        progress = std::max(progress, value);
+        cv.notify_all();
+    });
+
+    TaskDescriptor task;
+    task.task_id = "download";
+    task.trace_id = "trace";
+    task.type = TaskType::ImageGen;
+    task.cancel_token = CancelToken::create();
+    task.inputs["prompt"] = std::string("a lighthouse");
+    ASSERT_TRUE(scheduler->submit(task, stage).is_ok());
+
+    // Pause once the download reports progress (past the 0.9 mark).
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ASSERT_TRUE(cv.wait_for(lock, 5s, [&] { return progress > 0.9f; }));
+    }
+    ASSERT_TRUE(scheduler->pause("download").is_ok());
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ASSERT_TRUE(cv.wait_for(lock, 5s, [&] { return paused; }));
+    }
+
+    // The paused worker must not hold up the client's I/O thread.
+    auto promise = std::make_shared<std::promise<bool>>();
+    auto other = promise->get_future();
+    HttpRequest request = make_delay_request(server_.base_url(), 0, 0);
+    request.url = server_.base_url() + "/get";
+    client->execute_async(request, nullptr, [promise](auto result) {
+        promise->set_value(result.is_ok() && result.value().status_code == 200);
+    });
+    const bool other_finished = other.wait_for(3s) == std::future_status::ready;
+
+    ASSERT_TRUE(scheduler->cancel("download").is_ok());
+    const auto idle_deadline = std::chrono::steady_clock::now() + 10s;
+    while (scheduler->has_pending_tasks() && std::chrono::steady_clock::now() < idle_deadline) {
+        std::this_thread::sleep_for(10ms);
+    }
+    EXPECT_TRUE(other_finished);
+    if (other_finished) {
+        EXPECT_TRUE(other.get());
+    }
+    std::filesystem::remove_all(root);
+}
+
 #else
 
 TEST(CurlHttpClientTest, CurlDisabledAtBuildTime) {
@@ -4,6 +4,9 @@
 #include "infra/http_client.h"
 
 #include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
 #include <thread>
 #include <vector>
 
@@ -53,6 +56,46 @@ public:
     bool cancel(const std::string&) override { return true; }
 };
 
+// Holds every execute_async callback until the test completes it, like a transfer in flight.
+class DeferredHttpClient : public IHttpClient {
+public:
+    Result<HttpResponse, TaskError> execute(
+        const HttpRequest&,
+        std::shared_ptr<CancelToken>) override {
+        return Result<HttpResponse, TaskError>::Err(
+            make_http_error(HttpErrorCode::UNKNOWN, "unused", "sync path not expected", false));
+    }
+
+    void execute_async(const HttpRequest&, std::shared_ptr<CancelToken>,
+                       ResponseCallback callback) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(std::move(callback));
+        cv.notify_all();
+    }
+
+    bool cancel(const std::string&) override { return true; }
+
+    bool wait_for_calls(size_t count, std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return cv.wait_for(lock, timeout, [&] { return pending.size() >= count; });
+    }
+
+    ResponseCallback take(size_t index) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return std::move(pending.at(index));
+    }
+
+    size_t calls() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return pending.size();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<ResponseCallback> pending;
+};
+
 }  // namespace
 
 TEST(RetryableHttpClientTest, SuccessOnFirstAttempt) {
@@ -205,3 +248,73 @@ TEST(RetryableHttpClientTest, NullCancelToken) {
     ASSERT_TRUE(result.is_ok());
     EXPECT_EQ(mock_client->call_count, 2);
 }
+
+TEST(RetryableHttpClientTest, ExecuteAsyncReturnsBeforeTransferCompletes) {
+    auto inner = std::make_shared<DeferredHttpClient>();
+
+    RetryPolicy policy;
+    policy.max_retries = 3;
+    policy.initial_backoff = 200ms;
+    policy.sleep_slice = 5ms;
+
+    RetryableHttpClient client(inner, policy);
+    std::promise<Result<HttpResponse, TaskError>> done;
+    auto future = done.get_future();
+    client.execute_async(make_request(), CancelToken::create(),
+                         [&done](Result<HttpResponse, TaskError> result) {
+                             done.set_value(std::move(result));
+                         });
+
+    ASSERT_EQ(inner->calls(), 1u);
+    EXPECT_EQ(future.wait_for(0ms), std::future_status::timeout);
+
+    // Failing the first attempt must not block the completing (I/O) thread on the backoff.
+    const auto before = std::chrono::steady_clock::now();
+    inner->take(0)(Result<HttpResponse, TaskError>::Err(
+        make_http_error(HttpErrorCode::NETWORK_ERROR, "mock error", "mock internal", true)));
+    EXPECT_LT(std::chrono::steady_clock::now() - before, 100ms);
+    EXPECT_EQ(inner->calls(), 1u);
+    EXPECT_EQ(future.wait_for(0ms), std::future_status::timeout);
+
+    ASSERT_TRUE(inner->wait_for_calls(2, 2s));
+    HttpResponse response{};
+    response.status_code = 200;
+    response.body = "success";
+    inner->take(1)(Result<HttpResponse, TaskError>::Ok(response));
+
+    ASSERT_EQ(future.wait_for(2s), std::future_status::ready);
+    auto result = future.get();
+    ASSERT_TRUE(result.is_ok());
+    EXPECT_EQ(result.value().body, "success");
+    EXPECT_EQ(inner->calls(), 2u);
+}
+
+TEST(RetryableHttpClientTest, ExecuteAsyncCanceledDuringBackoff) {
+    auto inner = std::make_shared<DeferredHttpClient>();
+
+    RetryPolicy policy;
+    policy.max_retries = 3;
+    policy.initial_backoff = 400ms;
+    policy.sleep_slice = 10ms;
+
+    RetryableHttpClient client(inner, policy);
+    auto cancel_token = CancelToken::create();
+    std::promise<Result<HttpResponse, TaskError>> done;
+    auto future = done.get_future();
+    client.execute_async(make_request(), cancel_token,
+                         [&done](Result<HttpResponse, TaskError> result) {
+                             done.set_value(std::move(result));
+                         });
+
+    inner->take(0)(Result<HttpResponse, TaskError>::Err(
+        make_http_error(HttpErrorCode::NETWORK_ERROR, "mock error", "mock internal", true)));
+    const auto start = std::chrono::steady_clock::now();
+    cancel_token->request_cancel();
+
+    ASSERT_EQ(future.wait_for(2s), std::future_status::ready);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 350ms);
+    auto result = future.get();
+    ASSERT_TRUE(result.is_err());
+    EXPECT_EQ(result.error().category, ErrorCategory::Canceled);
+    EXPECT_EQ(inner->calls(), 1u);
+}
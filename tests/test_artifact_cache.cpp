@@ -0,0 +1,346 @@
+#include "infra/artifact_cache.h"
+#include "infra/stages.h"
+
+#include <gtest/gtest.h>
+
+#include <any>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace stv::infra;
+namespace fs = std::filesystem;
+
+namespace {
+
+class ArtifactCacheTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    root_ = fs::temp_directory_path() /
+            ("stv_artifact_cache_" + std::to_string(::getpid()) + "_" +
+             ::testing::UnitTest::GetInstance()->current_test_info()->name());
+    fs::remove_all(root_);
+  }
+  void TearDown() override { fs::remove_all(root_); }
+
+  std::shared_ptr<ArtifactCache> open(uint64_t max_bytes = 1 << 20) {
+    auto cache = ArtifactCache::open(root_.string(), max_bytes, 64);
+    EXPECT_TRUE(cache.is_ok());
+    return cache.is_ok() ? cache.value() : nullptr;
+  }
+
+  static std::string key(const std::string &name) {
+    return ArtifactCache::make_key({name});
+  }
+
+  fs::path root_;
+};
+
+/// Returns a fixed image path and counts requests.
+class CountingHttpClient : public IHttpClient {
+public:
+  explicit CountingHttpClient(std::string image_path) : image_path_(std::move(image_path)) {}
+
+  stv::core::Result<HttpResponse, stv::core::TaskError>
+  execute(const HttpRequest &, std::shared_ptr<stv::core::CancelToken>) override {
+    ++calls;
+    HttpResponse response{};
+    response.status_code = 200;
+    response.body = "{\"image_path\":\"" + image_path_ + "\"}";
+    return stv::core::Result<HttpResponse, stv::core::TaskError>::Ok(response);
+  }
+
+  bool cancel(const std::string &) override { return true; }
+
+  int calls = 0;
+
+private:
+  std::string image_path_;
+};
+
+} // namespace
+
+TEST_F(ArtifactCacheTest, PublishesAtomicallyAndLooksUpByKey) {
+  auto cache = open();
+  ASSERT_TRUE(cache);
+  EXPECT_FALSE(cache->lookup(key("a")).has_value());
+
+  auto published = cache->publish_bytes(key("a"), "{\"scenes\":[]}", ".json");
+  ASSERT_TRUE(published.is_ok());
+  const fs::path path(published.value());
+  EXPECT_EQ(path.extension(), ".json");
+  EXPECT_EQ(path.parent_path().parent_path().parent_path(), root_ / "objects");
+
+  auto found = cache->lookup(key("a"));
+  ASSERT_TRUE(found.has_value());
+  EXPECT_EQ(*found, published.value());
+  EXPECT_EQ(cache->read(key("a")).value_or(""), "{\"scenes\":[]}");
+  EXPECT_TRUE(fs::is_empty(root_ / "tmp")); // Staging file was renamed away
+
+  EXPECT_TRUE(cache->publish_bytes("not-a-key", "x", "").is_err());
+  EXPECT_TRUE(cache->publish_bytes(key("b"), "x", "/../x").is_err());
+  EXPECT_EQ(cache->stats().entries, 1U);
+}
+
+TEST_F(ArtifactCacheTest, EvictsLeastRecentlyUsedOverByteBudget) {
+  auto cache = open(100);
+  ASSERT_TRUE(cache);
+  const std::string blob(40, 'x');
+  ASSERT_TRUE(cache->publish_bytes(key("a"), blob, ".bin").is_ok());
+  auto b_path = cache->publish_bytes(key("b"), blob, ".bin");
+  ASSERT_TRUE(b_path.is_ok());
+  ASSERT_TRUE(cache->lookup(key("a")).has_value()); // a is now more recent than b
+  ASSERT_TRUE(cache->publish_bytes(key("c"), blob, ".bin").is_ok());
+
+  EXPECT_TRUE(cache->lookup(key("a")).has_value());
+  EXPECT_FALSE(cache->lookup(key("b")).has_value());
+  EXPECT_TRUE(cache->lookup(key("c")).has_value());
+  EXPECT_FALSE(fs::exists(b_path.value()));
+  const auto stats = cache->stats();
+  EXPECT_EQ(stats.total_bytes, 80U);
+  EXPECT_EQ(stats.evictions, 1U);
+
+  EXPECT_TRUE(cache->publish_bytes(key("huge"), std::string(101, 'x'), "").is_err());
+}
+
+TEST_F(ArtifactCacheTest, InstancesShareIndexAndRebuildWhenItIsLost) {
+  auto writer = open();
+  auto reader = open();
+  ASSERT_TRUE(writer && reader);
+  ASSERT_TRUE(writer->publish_bytes(key("shared"), "payload", ".txt").is_ok());
+  EXPECT_EQ(reader->read(key("shared")).value_or(""), "payload");
+  EXPECT_EQ(reader->stats().entries, 1U);
+
+  writer.reset();
+  reader.reset();
+  fs::remove(root_ / "index.bin");
+  auto reopened = open();
+  ASSERT_TRUE(reopened);
+  EXPECT_EQ(reopened->read(key("shared")).value_or(""), "payload");
+  EXPECT_EQ(reopened->stats().total_bytes, 7U);
+}
+
+TEST_F(ArtifactCacheTest, ConcurrentProcessesKeepIndexConsistent) {
+  ASSERT_TRUE(open(4096)); // Create the index before forking
+  constexpr int kPerProcess = 60;
+  const pid_t child = ::fork();
+  ASSERT_GE(child, 0);
+  const std::string who = child == 0 ? "child" : "parent";
+  {
+    auto cache = ArtifactCache::open(root_.string(), 4096, 64);
+    if (cache.is_err()) {
+      if (child == 0) {
+        ::_exit(1);
+      }
+      FAIL() << "open failed";
+    }
+    for (int i = 0; i < kPerProcess; ++i) {
+      (void)cache.value()->publish_bytes(key(who + std::to_string(i)),
+                                         std::string(100, 'x'), ".bin");
+      (void)cache.value()->lookup(key(who + std::to_string(i / 2)));
+    }
+  }
+  if (child == 0) {
+    ::_exit(0);
+  }
+  int status = 0;
+  ASSERT_EQ(::waitpid(child, &status, 0), child);
+  ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+  auto cache = open(4096);
+  ASSERT_TRUE(cache);
+  uint64_t files = 0;
+  uint64_t bytes = 0;
+  for (const auto &entry : fs::recursive_directory_iterator(root_ / "objects")) {
+    if (entry.is_regular_file()) {
+      ++files;
+      bytes += entry.file_size();
+    }
+  }
+  const auto stats = cache->stats();
+  EXPECT_EQ(stats.entries, files);
+  EXPECT_EQ(stats.total_bytes, bytes);
+  EXPECT_LE(stats.total_bytes, 4096U);
+  EXPECT_EQ(stats.evictions, 2U * kPerProcess - files);
+}
+
+TEST_F(ArtifactCacheTest, OverlappingReadersKeepSharedLockAgainstOtherProcess) {
+  auto cache = open();
+  ASSERT_TRUE(cache);
+  ASSERT_TRUE(cache->publish_bytes(key("pinned"), "payload", ".txt").is_ok());
+
+  // The child behaves like a writer in another process: under the exclusive
+  // flock it blanks the slot table for a moment, then restores it. Readers
+  // here only scan slots under the shared flock, so they must never see the
+  // blank table, even when one reader finishes while another is mid-scan.
+  const pid_t child = ::fork();
+  ASSERT_GE(child, 0);
+  if (child == 0) {
+    const int fd = ::open((root_ / "index.bin").c_str(), O_RDWR);
+    if (fd < 0) {
+      ::_exit(1);
+    }
+    constexpr off_t kHeaderBytes = 64; // Slots follow the fixed header
+    const auto size = static_cast<size_t>(fs::file_size(root_ / "index.bin"));
+    std::string saved(size - kHeaderBytes, '\0');
+    const std::string blank(saved.size(), '\0');
+    for (int i = 0; i < 300; ++i) {
+      ::flock(fd, LOCK_EX);
+      const bool ok =
+          ::pread(fd, saved.data(), saved.size(), kHeaderBytes) ==
+              static_cast<ssize_t>(saved.size()) &&
+          ::pwrite(fd, blank.data(), blank.size(), kHeaderBytes) ==
+              static_cast<ssize_t>(blank.size());
+      ::usleep(200);
+      (void)::pwrite(fd, saved.data(), saved.size(), kHeaderBytes);
+      ::flock(fd, LOCK_UN);
+      if (!ok) {
+        ::_exit(1);
+      }
+      ::usleep(50);
+    }
+    ::_exit(0);
+  }
+
+  std::atomic<bool> done{false};
+  std::atomic<int> misses{0};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t) {
+    readers.emplace_back([&]() {
+      while (!done.load()) {
+        if (!cache->lookup(key("pinned")).has_value()) {
+          misses.fetch_add(1);
+        }
+      }
+    });
+  }
+  int status = 0;
+  const pid_t waited = ::waitpid(child, &status, 0);
+  done = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  ASSERT_EQ(waited, child);
+  ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  EXPECT_EQ(misses.load(), 0);
+  EXPECT_EQ(cache->read(key("pinned")).value_or(""), "payload");
+}
+
+TEST_F(ArtifactCacheTest, ImageGenStageServesRepeatRequestsFromCache) {
+  fs::create_directories(root_);
+  const auto generated = root_ / "server_output.png";
+  std::ofstream(generated) << "png-bytes";
+
+  auto cache = open();
+  ASSERT_TRUE(cache);
+  auto http = std::make_shared<CountingHttpClient>(generated.string());
+  ImageGenStage stage(http, "http://unused");
+  stage.set_artifact_cache(cache);
+
+  auto run = [&]() {
+    stv::core::StageContext ctx;
+    ctx.trace_id = "trace";
+    ctx.cancel_token = stv::core::CancelToken::create();
+    ctx.on_progress = [](float) {};
+    ctx.inputs["prompt"] = std::string("a lighthouse at dusk");
+    EXPECT_TRUE(stage.execute(ctx).is_ok());
+    return std::any_cast<std::string>(ctx.outputs.at("image_path"));
+  };
+
+  const auto first = run();
+  EXPECT_EQ(http->calls, 1);
+  EXPECT_EQ(first.rfind(root_.string(), 0), 0U) << first; // Adopted into the cache
+  fs::remove(generated);
+
+  EXPECT_EQ(run(), first);
+  EXPECT_EQ(http->calls, 1); // No network call on a hit
+}
+
+TEST_F(ArtifactCacheTest, ImageGenStageRejectsRecordedPathAfterEviction) {
+  auto cache = open();
+  ASSERT_TRUE(cache);
+  const auto published = cache->publish_bytes(key("img"), "png-bytes", ".png");
+  ASSERT_TRUE(published.is_ok());
+  const std::string object = published.value();
+  ImageGenStage stage(std::make_shared<CountingHttpClient>(""), "http://unused");
+  stage.set_artifact_cache(cache);
+
+  const std::unordered_map<std::string, std::any> cached{{"image_path", object}};
+  const std::unordered_map<std::string, std::any> remote{
+      {"image_path", std::string("http://remote.example/out/img.png")}};
+  EXPECT_TRUE(stage.outputs_reusable(cached));
+  EXPECT_TRUE(stage.outputs_reusable(remote));
+
+  fs::remove(object); // As evict_locked() does
+  EXPECT_FALSE(stage.outputs_reusable(cached));
+  EXPECT_TRUE(stage.outputs_reusable(remote)); // Not the cache's to evict
+}
+
+namespace {
+
+/// Answers imagegen with a remote URL and serves that URL through the
+/// request's response sink, as CurlHttpClient does.
+class RemoteImageHttpClient : public IHttpClient {
+public:
+  stv::core::Result<HttpResponse, stv::core::TaskError>
+  execute(const HttpRequest &request, std::shared_ptr<stv::core::CancelToken>) override {
+    HttpResponse response{};
+    response.status_code = 200;
+    if (request.method == HttpMethod::POST) {
+      response.body = "{\"image_path\":\"http://remote.example/out/img.png?sig=1\"}";
+    } else {
+      ++downloads;
+      const std::string payload = "remote-png-bytes";
+      EXPECT_TRUE(request.response_sink);
+      EXPECT_TRUE(request.response_sink->begin(static_cast<int64_t>(payload.size())).is_ok());
+      EXPECT_TRUE(request.response_sink->write(payload.data(), payload.size()));
+      request.on_download_progress(payload.size(), payload.size());
+      EXPECT_TRUE(request.response_sink->finish().is_ok());
+    }
+    return stv::core::Result<HttpResponse, stv::core::TaskError>::Ok(response);
+  }
+
+  bool cancel(const std::string &) override { return true; }
+
+  int downloads = 0;
+};
+
+} // namespace
+
+TEST_F(ArtifactCacheTest, ImageGenStageStreamsRemoteImageIntoCache) {
+  auto cache = open();
+  ASSERT_TRUE(cache);
+  auto http = std::make_shared<RemoteImageHttpClient>();
+  ImageGenStage stage(http, "http://unused");
+  stage.set_artifact_cache(cache);
+
+  std::vector<float> progress;
+  stv::core::StageContext ctx;
+  ctx.trace_id = "trace";
+  ctx.cancel_token = stv::core::CancelToken::create();
+  ctx.on_progress = [&](float p) { progress.push_back(p); };
+  ctx.inputs["prompt"] = std::string("a lighthouse at dusk");
+  ASSERT_TRUE(stage.execute(ctx).is_ok());
+
+  const auto path = std::any_cast<std::string>(ctx.outputs.at("image_path"));
+  EXPECT_EQ(path.rfind((root_ / "objects").string(), 0), 0U) << path;
+  EXPECT_EQ(fs::path(path).extension(), ".png"); // Query string dropped
+  std::ifstream in(path);
+  std::string contents;
+  std::getline(in, contents);
+  EXPECT_EQ(contents, "remote-png-bytes");
+  EXPECT_EQ(http->downloads, 1);
+  EXPECT_TRUE(fs::is_empty(root_ / "tmp")); // Download was moved, not copied
+  ASSERT_GE(progress.size(), 2U);
+  EXPECT_GT(progress[progress.size() - 2], 0.9f); // Download progress before completion
+  EXPECT_FLOAT_EQ(progress.back(), 1.0f);
+}
@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+
+#include "batch/batch_runner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+using namespace stv::batch;
+using namespace stv::core;
+
+namespace {
+
+/// Succeeds after a short sleep and tracks how many workflows run at once.
+class ConcurrencyProbe {
+public:
+  void enter(const std::string &trace_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (++running_[trace_id] == 1) {
+      max_workflows_ = std::max(max_workflows_, static_cast<int>(active_.size()) + 1);
+      active_.insert(trace_id);
+    }
+  }
+  void leave(const std::string &trace_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--running_[trace_id] == 0) {
+      active_.erase(trace_id);
+    }
+  }
+  int max_workflows() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return max_workflows_;
+  }
+
+private:
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, int> running_;
+  std::unordered_set<std::string> active_;
+  int max_workflows_ = 0;
+};
+
+class ProbeStage : public IStage {
+public:
+  explicit ProbeStage(std::shared_ptr<ConcurrencyProbe> probe) : probe_(std::move(probe)) {}
+  std::string name() const override { return "ProbeStage"; }
+  Result<void, TaskError> execute(StageContext &ctx) override {
+    probe_->enter(ctx.trace_id);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    probe_->leave(ctx.trace_id);
+    return Result<void, TaskError>::Ok();
+  }
+
+private:
+  std::shared_ptr<ConcurrencyProbe> probe_;
+};
+
+} // namespace
+
+TEST(BatchRequestParsing, ReadsFieldsAndUnescapesStrings) {
+  auto parsed = parse_request_line(
+      R"({"request_id":"r-1","story_text":"A \"cat\"\n猫","style":"anime",)"
+      R"("scene_count":3,"class":"interactive","tags":["x",{"y":1}]})",
+      1);
+  ASSERT_TRUE(parsed.is_ok());
+  const auto &request = parsed.value();
+  EXPECT_EQ(request.request_id, "r-1");
+  EXPECT_EQ(request.story_text, "A \"cat\"\n\xE7\x8C\xAB");
+  EXPECT_EQ(request.style, "anime");
+  EXPECT_EQ(request.scene_count, 3);
+  EXPECT_EQ(request.workflow_class, WorkflowClass::Interactive);
+}
+
+TEST(BatchRequestParsing, FallsBackToBodyAndLineNumber) {
+  auto parsed = parse_request_line(R"({"title":"t","body":"story"})", 7);
+  ASSERT_TRUE(parsed.is_ok());
+  EXPECT_EQ(parsed.value().request_id, "line-7");
+  EXPECT_EQ(parsed.value().story_text, "story");
+  EXPECT_EQ(parsed.value().workflow_class, WorkflowClass::Batch);
+
+  EXPECT_TRUE(parse_request_line(R"({"title":"no story"})", 1).is_err());
+  EXPECT_TRUE(parse_request_line(R"({"body":"x","scene_count":0})", 1).is_err());
+  EXPECT_TRUE(parse_request_line(R"({"body":"x")", 1).is_err());
+}
+
+TEST(BatchLatencySummary, NearestRankPercentiles) {
+  std::vector<int64_t> samples;
+  for (int i = 100; i >= 1; --i) {
+    samples.push_back(i);
+  }
+  samples.push_back(-1); // Unfinished, skipped
+  const auto summary = summarize_latencies(samples);
+  EXPECT_EQ(summary.p50, 50);
+  EXPECT_EQ(summary.p95, 95);
+  EXPECT_EQ(summary.p99, 99);
+  EXPECT_EQ(summary.max, 100);
+  EXPECT_DOUBLE_EQ(summary.mean, 50.5);
+}
+
+TEST(BatchRunner, RunsAllRequestsWithinConcurrencyLimit) {
+  SchedulerConfig config;
+  config.worker_count = 4;
+  auto scheduler = std::shared_ptr<IScheduler>(
+      create_thread_pool_scheduler(config, nullptr).release());
+  auto probe = std::make_shared<ConcurrencyProbe>();
+
+  BatchOptions options;
+  options.concurrency = 2;
+  options.default_scene_count = 2;
+  BatchRunner runner(scheduler, nullptr, options);
+  runner.set_stage_factory([probe](TaskType) { return std::make_shared<ProbeStage>(probe); });
+
+  std::vector<BatchRequest> requests(8);
+  for (size_t i = 0; i < requests.size(); ++i) {
+    requests[i].request_id = "r" + std::to_string(i);
+    requests[i].story_text = "story " + std::to_string(i);
+  }
+  const auto results = runner.run(requests);
+
+  ASSERT_EQ(results.size(), requests.size());
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].request_id, requests[i].request_id);
+    EXPECT_TRUE(results[i].success) << results[i].error;
+    EXPECT_GE(results[i].latency_ms, results[i].queue_ms);
+  }
+  EXPECT_LE(probe->max_workflows(), 2);
+
+  const auto &report = runner.report();
+  EXPECT_EQ(report.succeeded, 8);
+  EXPECT_EQ(report.failed, 0);
+  EXPECT_EQ(report.admission.admitted, 8U);
+  EXPECT_EQ(report.scheduler.tasks_succeeded, 8U * 10U);
+
+  std::ostringstream results_out;
+  write_results_jsonl(results_out, results);
+  const auto lines = results_out.str();
+  EXPECT_EQ(std::count(lines.begin(), lines.end(), '\n'), 8);
+  std::ostringstream report_out;
+  write_report_json(report_out, report);
+  EXPECT_NE(report_out.str().find("\"succeeded\":8"), std::string::npos);
+}
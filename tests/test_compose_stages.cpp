@@ -0,0 +1,82 @@
+#include "infra/stages.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using namespace stv::infra;
+
+namespace {
+
+/// Records requests and answers with a fixed video path.
+class RecordingHttpClient : public IHttpClient {
+public:
+  stv::core::Result<HttpResponse, stv::core::TaskError>
+  execute(const HttpRequest &request, std::shared_ptr<stv::core::CancelToken>) override {
+    requests.push_back(request);
+    HttpResponse response{};
+    response.status_code = 200;
+    response.body = "{\"video_path\":\"/tmp/out.mp4\"}";
+    return stv::core::Result<HttpResponse, stv::core::TaskError>::Ok(response);
+  }
+
+  bool cancel(const std::string &) override { return true; }
+
+  std::vector<HttpRequest> requests;
+};
+
+stv::core::StageContext segment_context() {
+  stv::core::StageContext ctx;
+  ctx.trace_id = "trace-1";
+  ctx.on_progress = [](float) {};
+  ctx.inputs["scene_index"] = 1;
+  ctx.inputs["image_path"] = std::string("/tmp/img1.png");
+  ctx.inputs["audio_path"] = std::string("/tmp/tts1.wav");
+  return ctx;
+}
+
+} // namespace
+
+TEST(ComposeStagesTest, SegmentComposeUsesPerSceneEndpointByDefault) {
+  auto http = std::make_shared<RecordingHttpClient>();
+  ComposeStage stage(http, "http://api");
+  auto ctx = segment_context();
+
+  ASSERT_TRUE(stage.execute(ctx).is_ok());
+  ASSERT_EQ(http->requests.size(), 1u);
+  EXPECT_EQ(http->requests[0].url, "http://api/v1/compose");
+  EXPECT_NE(http->requests[0].body.find("\"scenes\":[{"), std::string::npos);
+  EXPECT_EQ(std::any_cast<std::string>(ctx.outputs.at("segment_path_1")), "/tmp/out.mp4");
+}
+
+TEST(ComposeStagesTest, StreamingSessionAppendsSegmentsAndFinalizes) {
+  auto http = std::make_shared<RecordingHttpClient>();
+  ComposeStage compose(http, "http://api");
+  compose.set_streaming_session(true);
+  auto ctx = segment_context();
+
+  ASSERT_TRUE(compose.execute(ctx).is_ok());
+  ASSERT_EQ(http->requests.size(), 1u);
+  const auto &append = http->requests[0];
+  EXPECT_EQ(append.url, "http://api/v1/compose/session/append");
+  EXPECT_NE(append.body.find("\"session_id\":\"trace-1\""), std::string::npos);
+  EXPECT_NE(append.body.find("\"scene_index\":1"), std::string::npos);
+  EXPECT_NE(append.body.find("\"scene\":{\"scene_number\":2"), std::string::npos);
+  EXPECT_EQ(std::any_cast<std::string>(ctx.outputs.at("segment_path_1")), "/tmp/out.mp4");
+
+  ConcatStage concat(http, "http://api");
+  concat.set_streaming_session(true);
+  stv::core::StageContext concat_ctx;
+  concat_ctx.trace_id = "trace-1";
+  concat_ctx.on_progress = [](float) {};
+  concat_ctx.inputs["segment_path_0"] = std::string("/tmp/seg0.mp4");
+  concat_ctx.inputs["segment_path_1"] = std::string("/tmp/seg1.mp4");
+
+  ASSERT_TRUE(concat.execute(concat_ctx).is_ok());
+  ASSERT_EQ(http->requests.size(), 2u);
+  const auto &finalize = http->requests[1];
+  EXPECT_EQ(finalize.url, "http://api/v1/compose/session/finalize");
+  EXPECT_NE(finalize.body.find("\"session_id\":\"trace-1\""), std::string::npos);
+  EXPECT_NE(finalize.body.find("\"/tmp/seg0.mp4\",\"/tmp/seg1.mp4\""), std::string::npos);
+}
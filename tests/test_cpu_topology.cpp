@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+
+#include "core/cpu_topology.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace stv::core;
+
+TEST(CpuTopology, ParsesCpuList) {
+  EXPECT_EQ(parse_cpu_list("0-3,8,10-11\n"),
+            (std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+  EXPECT_EQ(parse_cpu_list("5, 2,2,4-3"), (std::vector<int>{2, 5}));
+  EXPECT_EQ(parse_cpu_list("x,1-y,7"), (std::vector<int>{7}));
+  EXPECT_TRUE(parse_cpu_list("").empty());
+}
+
+TEST(CpuTopology, DetectReportsOnlyAllowedCpus) {
+  const auto allowed = allowed_cpus();
+  ASSERT_FALSE(allowed.empty());
+  ASSERT_TRUE(std::is_sorted(allowed.begin(), allowed.end()));
+
+  const auto topology = CpuTopology::detect();
+  ASSERT_FALSE(topology.nodes.empty());
+  const auto cpus = topology.all_cpus();
+  ASSERT_FALSE(cpus.empty());
+  for (int cpu : cpus) {
+    EXPECT_TRUE(std::binary_search(allowed.begin(), allowed.end(), cpu));
+    EXPECT_GE(topology.node_of(cpu), 0);
+  }
+}
+
+TEST(CpuTopology, RestrictDropsEmptyNodes) {
+  CpuTopology topology;
+  topology.nodes = {NumaNode{0, {0, 1, 2, 3}}, NumaNode{1, {4, 5, 6, 7}}};
+
+  const auto restricted = topology.restricted_to({6, 2, 3});
+  ASSERT_EQ(restricted.nodes.size(), 2U);
+  EXPECT_EQ(restricted.nodes[0].cpus, (std::vector<int>{2, 3}));
+  EXPECT_EQ(restricted.nodes[1].cpus, (std::vector<int>{6}));
+
+  const auto single = topology.restricted_to({5});
+  ASSERT_EQ(single.nodes.size(), 1U);
+  EXPECT_EQ(single.nodes[0].id, 1);
+  EXPECT_EQ(single.node_of(5), 1);
+  EXPECT_EQ(single.node_of(0), -1);
+
+  EXPECT_EQ(topology.restricted_to({}).all_cpus().size(), 8U);
+}
+
+TEST(CpuTopology, PinCurrentThread) {
+  const auto allowed = allowed_cpus();
+  ASSERT_FALSE(allowed.empty());
+  const int cpu = allowed.front();
+#ifdef __linux__
+  ASSERT_TRUE(pin_current_thread({cpu}));
+  EXPECT_EQ(current_cpu(), cpu);
+  ASSERT_TRUE(pin_current_thread(allowed)); // Restore the full mask
+#else
+  EXPECT_FALSE(pin_current_thread({cpu}));
+#endif
+  EXPECT_FALSE(pin_current_thread({}));
+}
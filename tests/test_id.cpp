@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+
+#include "core/id.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+using namespace stv::core;
+
+TEST(Id, CarriesVersionVariantAndTimestamp) {
+  const auto before = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count());
+  const Id128 id = new_id();
+
+  EXPECT_EQ((id.hi >> 12) & 0xF, 7u);
+  EXPECT_EQ(id.lo >> 62, 2u);
+  EXPECT_GE(id.unix_ms(), before);
+  EXPECT_LT(id.unix_ms(), before + 60000);
+
+  const std::string text = to_string(id);
+  ASSERT_EQ(text.size(), kIdStringLength);
+  EXPECT_EQ(text[14], '7');
+  EXPECT_EQ(text[8], '-');
+  EXPECT_EQ(text[23], '-');
+}
+
+TEST(Id, FormatAndParseRoundTrip) {
+  const Id128 id{0x0123456789abcdefULL, 0xfedcba9876543210ULL};
+  char buffer[kIdStringLength + 1];
+  format_id(id, buffer);
+  EXPECT_STREQ(buffer, "01234567-89ab-cdef-fedc-ba9876543210");
+
+  Id128 parsed;
+  ASSERT_TRUE(parse_id("01234567-89AB-CDEF-FEDC-BA9876543210", parsed));
+  EXPECT_EQ(parsed, id);
+
+  EXPECT_FALSE(parse_id("01234567-89ab-cdef-fedc-ba987654321", parsed));
+  EXPECT_FALSE(parse_id("01234567089ab-cdef-fedc-ba9876543210", parsed));
+  EXPECT_FALSE(parse_id("0123456g-89ab-cdef-fedc-ba9876543210", parsed));
+}
+
+TEST(Id, StrictlyIncreasingWithinThread) {
+  Id128 previous = new_id();
+  std::string previous_text = to_string(previous);
+  for (int i = 0; i < 20000; ++i) {
+    const Id128 next = new_id();
+    const std::string next_text = to_string(next);
+    ASSERT_TRUE(previous < next);
+    ASSERT_LT(previous_text, next_text); // Text sorts like the binary form
+    previous = next;
+    previous_text = next_text;
+  }
+}
+
+TEST(Id, UniqueAcrossThreads) {
+  constexpr int kThreads = 8;
+  constexpr int kPerThread = 5000;
+  std::vector<std::vector<Id128>> ids(kThreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&ids, t] {
+      ids[t].reserve(kPerThread);
+      for (int i = 0; i < kPerThread; ++i) {
+        ids[t].push_back(new_id());
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  std::unordered_set<Id128, Id128Hash> seen;
+  for (const auto &batch : ids) {
+    seen.insert(batch.begin(), batch.end());
+  }
+  EXPECT_EQ(seen.size(), static_cast<size_t>(kThreads * kPerThread));
+}
@@ -0,0 +1,99 @@
+#include "infra/stages.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace stv::infra;
+
+namespace {
+
+/// Answers /v1/imagegen/batch with one image_path per item (or a fixed
+/// status), rejecting oversized batches with 422 as the server does.
+class BatchHttpClient : public IHttpClient {
+public:
+  stv::core::Result<HttpResponse, stv::core::TaskError>
+  execute(const HttpRequest &request, std::shared_ptr<stv::core::CancelToken>) override {
+    HttpResponse response{};
+    size_t items = 0;
+    for (size_t pos = request.body.find("\"prompt\""); pos != std::string::npos;
+         pos = request.body.find("\"prompt\"", pos + 1)) {
+      ++items;
+    }
+    item_counts.push_back(items);
+    response.status_code = status != 200                         ? status
+                           : items > ImageGenStage::kMaxBatchItems ? 422
+                                                                   : 200;
+    if (response.status_code == 200) {
+      response.body = "{\"results\":[";
+      for (size_t i = 0; i < items; ++i) {
+        response.body += (i == 0 ? "" : ",");
+        response.body += "{\"image_path\":\"/tmp/img" + std::to_string(i) + ".png\"}";
+      }
+      response.body += "]}";
+    }
+    return stv::core::Result<HttpResponse, stv::core::TaskError>::Ok(response);
+  }
+
+  bool cancel(const std::string &) override { return true; }
+
+  int status = 200;
+  std::vector<size_t> item_counts;
+};
+
+std::vector<stv::core::StageContext> make_members(size_t count) {
+  std::vector<stv::core::StageContext> members(count);
+  for (size_t i = 0; i < count; ++i) {
+    members[i].trace_id = "trace";
+    members[i].cancel_token = stv::core::CancelToken::create();
+    members[i].on_progress = [](float) {};
+    members[i].inputs["prompt"] = "scene " + std::to_string(i);
+  }
+  return members;
+}
+
+std::vector<stv::core::StageContext *> pointers(std::vector<stv::core::StageContext> &members) {
+  std::vector<stv::core::StageContext *> out;
+  for (auto &member : members) {
+    out.push_back(&member);
+  }
+  return out;
+}
+
+} // namespace
+
+TEST(ImageGenStageTest, BatchesLargerThanServerLimitAreSplit) {
+  auto http = std::make_shared<BatchHttpClient>();
+  ImageGenStage stage(http, "http://api");
+  auto members = make_members(ImageGenStage::kMaxBatchItems + 5);
+
+  const auto results = stage.execute_batch(pointers(members));
+
+  ASSERT_EQ(results.size(), members.size());
+  for (const auto &result : results) {
+    EXPECT_TRUE(result.is_ok());
+  }
+  EXPECT_EQ(http->item_counts, (std::vector<size_t>{ImageGenStage::kMaxBatchItems, 5}));
+  EXPECT_EQ(std::any_cast<std::string>(members.back().outputs.at("image_path")),
+            "/tmp/img4.png");
+}
+
+TEST(ImageGenStageTest, ClientErrorsAreNotRetryable) {
+  auto http = std::make_shared<BatchHttpClient>();
+  ImageGenStage stage(http, "http://api");
+  auto members = make_members(2);
+
+  http->status = 422;
+  for (const auto &result : stage.execute_batch(pointers(members))) {
+    ASSERT_TRUE(result.is_err());
+    EXPECT_FALSE(result.error().retryable);
+  }
+
+  http->status = 503;
+  for (const auto &result : stage.execute_batch(pointers(members))) {
+    ASSERT_TRUE(result.is_err());
+    EXPECT_TRUE(result.error().retryable);
+  }
+}
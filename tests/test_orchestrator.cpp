@@ -2,12 +2,22 @@
 
 #include "core/orchestrator.h"
 
+#include <algorithm>
+#include <any>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include <unistd.h>
+
 using namespace stv::core;
 
 namespace {
@@ -28,6 +38,7 @@ public:
 
     known_tasks.emplace(task.task_id, task.state);
     submitted_task_ids.push_back(task.task_id);
+    submitted_tasks.push_back(task);
     return Result<void, TaskError>::Ok();
   }
 
@@ -57,9 +68,16 @@ public:
 
   [[nodiscard]] bool has_pending_tasks() const override { return false; }
 
+  void emit(const std::string &task_id, TaskState state, float progress = 1.0f) {
+    for (auto &cb : callbacks) {
+      cb(task_id, state, progress);
+    }
+  }
+
   int submit_calls = 0;
   int cancel_calls = 0;
   std::vector<std::string> submitted_task_ids;
+  std::vector<TaskDescriptor> submitted_tasks;
   std::vector<std::string> canceled_task_ids;
 
 private:
@@ -89,5 +107,501 @@ TEST(WorkflowEngine, StartWorkflowReturnsTraceOnSuccess) {
   ASSERT_TRUE(start.is_ok());
   ASSERT_FALSE(start.value().empty());
   ASSERT_EQ(scheduler->cancel_calls, 0);
-  ASSERT_EQ(scheduler->submit_calls, 4); // 1 storyboard + 2 image + 1 compose
+  ASSERT_EQ(scheduler->submit_calls, 10); // 1 storyboard + 2 x 4 scene tasks + 1 concat
+}
+
+TEST(WorkflowEngine, BuildsPerSceneDag) {
+  auto scheduler = std::make_shared<RecordingScheduler>();
+  WorkflowEngine engine(scheduler, nullptr);
+  ASSERT_TRUE(engine.start_workflow("story", "style", 3).is_ok());
+
+  const auto &tasks = scheduler->submitted_tasks;
+  ASSERT_EQ(tasks.size(), 14U);
+  std::unordered_map<std::string, const TaskDescriptor *> by_id;
+  for (const auto &task : tasks) {
+    by_id[task.task_id] = &task;
+  }
+  auto scene_of = [](const TaskDescriptor &task) {
+    auto it = task.inputs.find("scene_index");
+    return it == task.inputs.end() ? -1 : std::any_cast<int>(it->second);
+  };
+
+  const auto &storyboard = tasks.front();
+  ASSERT_EQ(storyboard.type, TaskType::Storyboard);
+  ASSERT_TRUE(storyboard.deps.empty());
+
+  const auto &concat = tasks.back();
+  ASSERT_EQ(concat.type, TaskType::Concat);
+  ASSERT_EQ(concat.deps.size(), 3U);
+
+  for (size_t s = 0; s < concat.deps.size(); ++s) {
+    // Segment compose ← {VideoClip ← ImageGen, TTS}, all for the same scene.
+    const auto &segment = *by_id.at(concat.deps[s]);
+    ASSERT_EQ(segment.type, TaskType::Compose);
+    ASSERT_EQ(scene_of(segment), static_cast<int>(s));
+    ASSERT_EQ(segment.deps.size(), 2U);
+
+    const auto &clip = *by_id.at(segment.deps[0]);
+    const auto &tts = *by_id.at(segment.deps[1]);
+    ASSERT_EQ(clip.type, TaskType::VideoClip);
+    ASSERT_EQ(tts.type, TaskType::TTS);
+    ASSERT_EQ(tts.deps, std::vector<std::string>{storyboard.task_id});
+    ASSERT_EQ(scene_of(clip), static_cast<int>(s));
+    ASSERT_EQ(scene_of(tts), static_cast<int>(s));
+
+    ASSERT_EQ(clip.deps.size(), 1U);
+    const auto &image = *by_id.at(clip.deps[0]);
+    ASSERT_EQ(image.type, TaskType::ImageGen);
+    ASSERT_EQ(image.deps, std::vector<std::string>{storyboard.task_id});
+    ASSERT_EQ(scene_of(image), static_cast<int>(s));
+  }
+}
+
+TEST(WorkflowEngine, CompletesAndRetiresWorkflowOnSuccess) {
+  auto scheduler = std::make_shared<RecordingScheduler>();
+  WorkflowEngine engine(scheduler, nullptr);
+  int completions = 0;
+  bool succeeded = false;
+  engine.on_completion([&](const std::string &, bool success, const std::string &) {
+    ++completions;
+    succeeded = success;
+  });
+
+  auto start = engine.start_workflow("story", "style", 2);
+  ASSERT_TRUE(start.is_ok());
+  const auto task_ids = scheduler->submitted_task_ids;
+  ASSERT_EQ(task_ids.size(), 10U);
+
+  for (size_t i = 0; i + 1 < task_ids.size(); ++i) {
+    scheduler->emit(task_ids[i], TaskState::Running, 0.5f);
+    scheduler->emit(task_ids[i], TaskState::Succeeded);
+  }
+  ASSERT_EQ(completions, 0);
+  scheduler->emit(task_ids.back(), TaskState::Succeeded);
+  ASSERT_EQ(completions, 1);
+  ASSERT_TRUE(succeeded);
+
+  // Retired: late events are ignored and the trace is no longer cancelable.
+  scheduler->emit(task_ids.back(), TaskState::Succeeded);
+  ASSERT_EQ(completions, 1);
+  ASSERT_TRUE(engine.cancel_workflow(start.value()).is_err());
+}
+
+TEST(WorkflowEngine, FailedWorkflowCompletesOnceAllTasksAreTerminal) {
+  auto scheduler = std::make_shared<RecordingScheduler>();
+  WorkflowEngine engine(scheduler, nullptr);
+  int completions = 0;
+  bool succeeded = true;
+  engine.on_completion([&](const std::string &, bool success, const std::string &) {
+    ++completions;
+    succeeded = success;
+  });
+
+  auto start = engine.start_workflow("story", "style", 2);
+  ASSERT_TRUE(start.is_ok());
+  const auto task_ids = scheduler->submitted_task_ids;
+
+  scheduler->emit(task_ids[0], TaskState::Failed);
+  ASSERT_EQ(completions, 0); // Descendants still settling
+  for (size_t i = 1; i < task_ids.size(); ++i) {
+    scheduler->emit(task_ids[i], TaskState::Canceled);
+  }
+  ASSERT_EQ(completions, 1);
+  ASSERT_FALSE(succeeded);
+}
+
+namespace {
+
+class QuickStage : public IStage {
+public:
+  std::string name() const override { return "QuickStage"; }
+
+  Result<void, TaskError> execute(StageContext &ctx) override {
+    for (int i = 0; i < 3; ++i) {
+      if (ctx.cancel_token && ctx.cancel_token->is_canceled()) {
+        return Result<void, TaskError>::Err(TaskError::Canceled());
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+      ctx.on_progress(static_cast<float>(i + 1) / 3.0f);
+    }
+    return Result<void, TaskError>::Ok();
+  }
+};
+
+} // namespace
+
+TEST(WorkflowEngine, ConcurrentStartCancelAndFinishStress) {
+  SchedulerConfig cfg;
+  cfg.worker_count = 4;
+  cfg.resource_budget.cpu_slots_hard = 4;
+  std::shared_ptr<IScheduler> scheduler = create_thread_pool_scheduler(cfg, nullptr);
+  auto engine = std::make_shared<WorkflowEngine>(scheduler, nullptr);
+  engine->set_stage_factory([](TaskType) { return std::make_shared<QuickStage>(); });
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::unordered_map<std::string, int> completions;
+  std::atomic<int> progress_events{0};
+  engine->on_completion([&](const std::string &trace_id, bool, const std::string &) {
+    // Notify under the lock: the test body may destroy cv once it wakes.
+    std::lock_guard<std::mutex> lock(mutex);
+    completions[trace_id]++;
+    cv.notify_all();
+  });
+  engine->on_progress([&](const std::string &, const std::string &, TaskState, float) {
+    progress_events.fetch_add(1);
+  });
+
+  constexpr int kThreads = 8;
+  constexpr int kPerThread = 25;
+  std::vector<std::thread> threads;
+  std::atomic<int> started{0};
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      std::vector<std::string> mine;
+      for (int i = 0; i < kPerThread; ++i) {
+        auto start = engine->start_workflow("story", "style", 2);
+        ASSERT_TRUE(start.is_ok());
+        started.fetch_add(1);
+        mine.push_back(start.value());
+        if ((i + t) % 3 == 0) {
+          // May already be finished (and retired); both outcomes are fine.
+          (void)engine->cancel_workflow(mine.back());
+        }
+      }
+      (void)engine->cancel_workflow(mine.front());
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(started.load(), kThreads * kPerThread);
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    ASSERT_TRUE(cv.wait_for(lock, std::chrono::seconds(30), [&]() {
+      return completions.size() == static_cast<size_t>(kThreads * kPerThread);
+    }));
+    for (const auto &[trace_id, count] : completions) {
+      ASSERT_EQ(count, 1) << trace_id;
+    }
+  }
+  ASSERT_GT(progress_events.load(), 0);
+
+  // Every workflow is retired.
+  for (const auto &[trace_id, count] : completions) {
+    ASSERT_TRUE(engine->cancel_workflow(trace_id).is_err());
+  }
+}
+
+TEST(WorkflowEngine, MemoizedRerenderOnlyRunsEditedSceneChain) {
+  SchedulerConfig cfg;
+  cfg.worker_count = 4;
+  cfg.resource_budget.cpu_slots_hard = 4;
+  cfg.memoization.memo = std::make_shared<InMemoryStageMemo>();
+  std::shared_ptr<IScheduler> scheduler = create_thread_pool_scheduler(cfg, nullptr);
+  WorkflowEngine engine(scheduler, nullptr); // Default mock stages
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  int completions = 0;
+  engine.on_completion([&](const std::string &, bool success, const std::string &) {
+    EXPECT_TRUE(success);
+    std::lock_guard<std::mutex> lock(mutex);
+    ++completions;
+    cv.notify_all();
+  });
+  auto render = [&](const std::string &story) {
+    const int target = completions + 1;
+    ASSERT_TRUE(engine.start_workflow(story, "style", 3).is_ok());
+    std::unique_lock<std::mutex> lock(mutex);
+    ASSERT_TRUE(cv.wait_for(lock, std::chrono::seconds(20),
+                            [&]() { return completions == target; }));
+  };
+  constexpr uint64_t kTasks = 1 + 3 * 4 + 1;
+
+  render("scene one\nscene two\nscene three");
+  auto m = scheduler->metrics();
+  EXPECT_EQ(m.memo_hits, 0U);
+  EXPECT_EQ(m.memo_stores, kTasks);
+
+  // Unchanged story: every task is satisfied from the memo.
+  render("scene one\nscene two\nscene three");
+  m = scheduler->metrics();
+  EXPECT_EQ(m.memo_hits, kTasks);
+  EXPECT_EQ(m.memo_stores, kTasks);
+
+  // One edited scene: storyboard, that scene's 4 tasks and concat re-run.
+  render("scene one\nscene 2 (edited)\nscene three");
+  m = scheduler->metrics();
+  EXPECT_EQ(m.memo_stores, kTasks + 6);
+  EXPECT_EQ(m.memo_hits, kTasks + (kTasks - 6));
+}
+
+namespace {
+
+std::string trace_of(const RecordingScheduler &scheduler, size_t index) {
+  return scheduler.submitted_tasks.at(index).trace_id;
+}
+
+void finish_tasks(RecordingScheduler &scheduler, size_t begin, size_t end) {
+  const auto task_ids = scheduler.submitted_task_ids;
+  for (size_t i = begin; i < end; ++i) {
+    scheduler.emit(task_ids[i], TaskState::Succeeded);
+  }
+}
+
+} // namespace
+
+TEST(WorkflowAdmission, QueuesBeyondWorkflowCapAndAdmitsHigherClassFirst) {
+  auto scheduler = std::make_shared<RecordingScheduler>();
+  WorkflowAdmissionPolicy policy;
+  policy.max_active_workflows = 1;
+  WorkflowEngine engine(scheduler, nullptr, policy);
+
+  auto first = engine.start_workflow("a", "style", 2);
+  auto batch = engine.start_workflow("b", "style", 2, WorkflowClass::Batch);
+  auto interactive = engine.start_workflow("c", "style", 2, WorkflowClass::Interactive);
+  ASSERT_TRUE(first.is_ok() && batch.is_ok() && interactive.is_ok());
+  ASSERT_EQ(scheduler->submit_calls, 10); // Only the first workflow runs
+
+  auto metrics = engine.admission_metrics();
+  EXPECT_EQ(metrics.active_workflows, 1);
+  EXPECT_EQ(metrics.active_tasks, 10);
+  EXPECT_EQ(metrics.queued, 2U);
+  EXPECT_EQ(metrics.pending[static_cast<size_t>(WorkflowClass::Interactive)], 1);
+  EXPECT_EQ(metrics.pending[static_cast<size_t>(WorkflowClass::Batch)], 1);
+
+  finish_tasks(*scheduler, 0, 10);
+  ASSERT_EQ(scheduler->submit_calls, 20);
+  EXPECT_EQ(trace_of(*scheduler, 10), interactive.value());
+
+  finish_tasks(*scheduler, 10, 20);
+  ASSERT_EQ(scheduler->submit_calls, 30);
+  EXPECT_EQ(trace_of(*scheduler, 20), batch.value());
+
+  metrics = engine.admission_metrics();
+  EXPECT_EQ(metrics.admitted, 3U);
+  EXPECT_EQ(metrics.pending[static_cast<size_t>(WorkflowClass::Batch)], 0);
+}
+
+TEST(WorkflowAdmission, TaskCapAdmitsAsTasksFinish) {
+  auto scheduler = std::make_shared<RecordingScheduler>();
+  WorkflowAdmissionPolicy policy;
+  policy.max_active_tasks = 15;
+  WorkflowEngine engine(scheduler, nullptr, policy);
+
+  ASSERT_TRUE(engine.start_workflow("a", "style", 2).is_ok()); // 10 tasks
+  ASSERT_TRUE(engine.start_workflow("b", "style", 2).is_ok());
+  ASSERT_EQ(scheduler->submit_calls, 10);
+
+  finish_tasks(*scheduler, 0, 4);
+  ASSERT_EQ(scheduler->submit_calls, 10); // 6 + 10 > 15
+  finish_tasks(*scheduler, 4, 5);
+  ASSERT_EQ(scheduler->submit_calls, 20);
+  EXPECT_EQ(engine.admission_metrics().active_tasks, 15);
+}
+
+TEST(WorkflowAdmission, RejectsWhenPendingQueueIsFull) {
+  auto scheduler = std::make_shared<RecordingScheduler>();
+  WorkflowAdmissionPolicy policy;
+  policy.max_active_workflows = 1;
+  policy.max_pending = 1;
+  WorkflowEngine engine(scheduler, nullptr, policy);
+
+  ASSERT_TRUE(engine.start_workflow("a", "style", 2).is_ok());
+  ASSERT_TRUE(engine.start_workflow("b", "style", 2).is_ok());
+  auto rejected = engine.start_workflow("c", "style", 2);
+  ASSERT_TRUE(rejected.is_err());
+  EXPECT_EQ(rejected.error().category, ErrorCategory::Resource);
+  EXPECT_TRUE(rejected.error().retryable);
+  EXPECT_EQ(engine.admission_metrics().rejected, 1U);
+}
+
+TEST(WorkflowAdmission, CancelingPendingWorkflowCompletesWithoutSubmitting) {
+  auto scheduler = std::make_shared<RecordingScheduler>();
+  WorkflowAdmissionPolicy policy;
+  policy.max_active_workflows = 1;
+  WorkflowEngine engine(scheduler, nullptr, policy);
+  std::vector<std::pair<std::string, bool>> completions;
+  engine.on_completion([&](const std::string &trace_id, bool success, const std::string &) {
+    completions.emplace_back(trace_id, success);
+  });
+
+  ASSERT_TRUE(engine.start_workflow("a", "style", 2).is_ok());
+  auto pending = engine.start_workflow("b", "style", 2);
+  ASSERT_TRUE(pending.is_ok());
+  ASSERT_TRUE(engine.cancel_workflow(pending.value()).is_ok());
+  ASSERT_EQ(completions.size(), 1U);
+  EXPECT_EQ(completions[0], std::make_pair(pending.value(), false));
+
+  finish_tasks(*scheduler, 0, 10);
+  EXPECT_EQ(scheduler->submit_calls, 10);
+  EXPECT_EQ(engine.admission_metrics().active_workflows, 0);
+}
+
+TEST(WorkflowAdmission, BlockModeWaitsForCapacity) {
+  auto scheduler = std::make_shared<RecordingScheduler>();
+  WorkflowAdmissionPolicy policy;
+  policy.max_active_workflows = 1;
+  policy.max_pending = 0;
+  policy.on_full = WorkflowAdmissionPolicy::OnFull::Block;
+  WorkflowEngine engine(scheduler, nullptr, policy);
+
+  ASSERT_TRUE(engine.start_workflow("a", "style", 2).is_ok());
+  std::atomic<bool> returned{false};
+  std::thread blocked([&] {
+    EXPECT_TRUE(engine.start_workflow("b", "style", 2).is_ok());
+    returned = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(returned.load());
+
+  finish_tasks(*scheduler, 0, 10);
+  blocked.join();
+  EXPECT_TRUE(returned.load());
+  EXPECT_EQ(scheduler->submit_calls, 20);
+  EXPECT_GE(engine.admission_metrics().queue_wait_ms_max, 40U);
+}
+
+TEST(WorkflowEngine, StartsWorkflowsFromConfiguredPlan) {
+  auto scheduler = std::make_shared<RecordingScheduler>();
+  WorkflowEngine engine(scheduler, nullptr);
+  auto plan = compile_workflow_template("workflow narrated\n"
+                                        "stage board Storyboard workflow_inputs\n"
+                                        "stage voice TTS per_scene after=board\n"
+                                        "stage join Concat after=voice\n");
+  ASSERT_TRUE(plan.is_ok());
+  engine.set_workflow_plan(plan.value());
+
+  ASSERT_TRUE(engine.start_workflow("story", "style", 5).is_ok());
+  const auto &tasks = scheduler->submitted_tasks;
+  ASSERT_EQ(tasks.size(), 7U);
+  EXPECT_EQ(std::any_cast<int>(tasks.front().inputs.at("scene_count")), 5);
+  EXPECT_EQ(tasks.back().deps.size(), 5U);
+  for (const auto &task : tasks) {
+    EXPECT_NE(task.cancel_token, nullptr);
+  }
+}
+
+namespace {
+
+/// Publishes "<Type>_<scene>" and remembers which inputs each type saw.
+/// Compose fails while fail_compose is set.
+class CheckpointedStage : public IStage {
+public:
+  struct Log {
+    std::mutex mutex;
+    std::unordered_map<std::string, int> runs; // By type
+    std::vector<std::vector<std::string>> concat_inputs;
+    std::atomic<bool> fail_compose{true};
+    std::atomic<bool> tts_evicted{false}; // Recorded TTS outputs are gone
+  };
+
+  CheckpointedStage(TaskType type, std::shared_ptr<Log> log)
+      : type_(type), log_(std::move(log)) {}
+
+  std::string name() const override { return "CheckpointedStage"; }
+
+  bool outputs_reusable(const std::unordered_map<std::string, std::any> &) const override {
+    return !(type_ == TaskType::TTS && log_->tts_evicted.load());
+  }
+
+  Result<void, TaskError> execute(StageContext &ctx) override {
+    const std::string type = to_string(type_);
+    {
+      std::lock_guard<std::mutex> lock(log_->mutex);
+      log_->runs[type]++;
+      if (type_ == TaskType::Concat) {
+        std::vector<std::string> keys;
+        for (const auto &[key, _] : ctx.inputs) {
+          keys.push_back(key);
+        }
+        log_->concat_inputs.push_back(std::move(keys));
+      }
+    }
+    if (type_ == TaskType::Compose && log_->fail_compose.load()) {
+      return Result<void, TaskError>::Err(TaskError::Pipeline("injected compose failure"));
+    }
+    ctx.set_output(type + "_" + std::to_string(ctx.get_input<int>("scene_index", -1)),
+                   std::string("done"));
+    if (type_ == TaskType::Concat) {
+      ctx.set_output("video_path", "/renders/" + ctx.trace_id + ".mp4");
+    }
+    return Result<void, TaskError>::Ok();
+  }
+
+private:
+  TaskType type_;
+  std::shared_ptr<Log> log_;
+};
+
+} // namespace
+
+TEST(WorkflowEngine, ResumesOnlyUnfinishedTasksFromCheckpoint) {
+  const auto dir = std::filesystem::temp_directory_path() /
+                   ("stv_orchestrator_resume_" + std::to_string(::getpid()));
+  std::filesystem::remove_all(dir);
+  auto store = std::make_shared<FileWorkflowCheckpointStore>(dir.string());
+
+  SchedulerConfig cfg;
+  cfg.worker_count = 2;
+  cfg.resource_budget.cpu_slots_hard = 2;
+  std::shared_ptr<IScheduler> scheduler = create_thread_pool_scheduler(cfg, nullptr);
+  WorkflowEngine engine(scheduler, nullptr);
+  engine.set_checkpoint_store(store);
+  auto log = std::make_shared<CheckpointedStage::Log>();
+  engine.set_stage_factory(
+      [log](TaskType type) { return std::make_shared<CheckpointedStage>(type, log); });
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<bool> outcomes;
+  std::vector<std::string> output_paths;
+  engine.on_completion([&](const std::string &, bool success, const std::string &output_path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    outcomes.push_back(success);
+    output_paths.push_back(output_path);
+    cv.notify_all();
+  });
+  auto wait_for = [&](size_t count) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return cv.wait_for(lock, std::chrono::seconds(10),
+                       [&] { return outcomes.size() == count; });
+  };
+
+  auto start = engine.start_workflow("story", "style", 2);
+  ASSERT_TRUE(start.is_ok());
+  const std::string trace_id = start.value();
+  ASSERT_TRUE(wait_for(1));
+  EXPECT_FALSE(outcomes[0]);
+  EXPECT_EQ(store->list(), std::vector<std::string>{trace_id});
+
+  log->fail_compose = false;
+  log->tts_evicted = true;
+  ASSERT_TRUE(engine.resume_workflow(trace_id).is_ok());
+  ASSERT_TRUE(wait_for(2));
+  EXPECT_TRUE(outcomes[1]);
+  // The resumed sink (submitted as "<id>.r1") reports the real video.
+  EXPECT_EQ(output_paths[0], "");
+  EXPECT_EQ(output_paths[1], "/renders/" + trace_id + ".mp4");
+
+  // Storyboard, images and clips ran once; compose re-ran, and so did TTS
+  // because its recorded outputs are no longer reusable.
+  EXPECT_EQ(log->runs["Storyboard"], 1);
+  EXPECT_EQ(log->runs["ImageGen"], 2);
+  EXPECT_EQ(log->runs["TTS"], 4);
+  EXPECT_EQ(log->runs["VideoClip"], 2);
+  EXPECT_EQ(log->runs["Compose"], 4);
+  EXPECT_EQ(log->runs["Concat"], 1);
+  ASSERT_EQ(log->concat_inputs.size(), 1U);
+  const auto &inputs = log->concat_inputs[0];
+  for (const std::string key : {"Compose_0", "Compose_1"}) {
+    EXPECT_NE(std::find(inputs.begin(), inputs.end(), key), inputs.end()) << key;
+  }
+
+  // A succeeded workflow leaves no manifest behind.
+  EXPECT_TRUE(store->list().empty());
+  EXPECT_TRUE(engine.resume_workflow(trace_id).is_err());
+  std::filesystem::remove_all(dir);
 }
@@ -0,0 +1,108 @@
+#include "infra/resource_discovery.h"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace fs = std::filesystem;
+using stv::infra::CgroupLimits;
+using stv::infra::CgroupMonitor;
+
+namespace {
+
+class FakeCgroupDir {
+public:
+  FakeCgroupDir()
+      : dir_(fs::temp_directory_path() /
+             ("stv_cgroup_test_" + std::to_string(::testing::UnitTest::GetInstance()
+                                                      ->random_seed()) +
+              "_" + ::testing::UnitTest::GetInstance()->current_test_info()->name())) {
+    fs::create_directories(dir_);
+  }
+  ~FakeCgroupDir() {
+    std::error_code ec;
+    fs::remove_all(dir_, ec);
+  }
+
+  void write(const std::string &name, const std::string &content) const {
+    std::ofstream(dir_ / name) << content;
+  }
+  [[nodiscard]] std::string path() const { return dir_.string(); }
+
+private:
+  fs::path dir_;
+};
+
+} // namespace
+
+TEST(ResourceDiscoveryTest, ParsesCpuMaxAndPsi) {
+  EXPECT_DOUBLE_EQ(*stv::infra::parse_cpu_max("150000 100000\n"), 1.5);
+  EXPECT_FALSE(stv::infra::parse_cpu_max("max 100000\n").has_value());
+  EXPECT_FALSE(stv::infra::parse_cpu_max("").has_value());
+
+  const std::string psi = "some avg10=12.50 avg60=3.00 avg300=1.00 total=1234\n"
+                          "full avg10=4.00 avg60=1.00 avg300=0.50 total=99\n";
+  EXPECT_DOUBLE_EQ(*stv::infra::parse_psi_some_avg10(psi), 12.5);
+  EXPECT_FALSE(stv::infra::parse_psi_some_avg10("garbage").has_value());
+}
+
+TEST(ResourceDiscoveryTest, ReadsLimitsAndPressureFromCgroupDir) {
+  FakeCgroupDir cgroup;
+  cgroup.write("cpu.max", "250000 100000\n");
+  cgroup.write("memory.max", std::to_string(4096LL * 1024 * 1024) + "\n");
+  cgroup.write("memory.current", std::to_string(1024LL * 1024 * 1024) + "\n");
+  cgroup.write("cpu.pressure", "some avg10=70.00 avg60=0 avg300=0 total=0\n");
+  cgroup.write("memory.pressure",
+               "some avg10=2.25 avg60=0 avg300=0 total=0\n"
+               "full avg10=1.00 avg60=0 avg300=0 total=0\n");
+
+  CgroupMonitor monitor(cgroup.path());
+  const auto limits = monitor.read_limits();
+  ASSERT_TRUE(limits.cpu_quota_cores.has_value());
+  EXPECT_DOUBLE_EQ(*limits.cpu_quota_cores, 2.5);
+  EXPECT_EQ(limits.memory_max_mb.value_or(0), 4096);
+  EXPECT_EQ(limits.memory_current_mb.value_or(0), 1024);
+
+  const auto pressure = monitor.sample();
+  EXPECT_DOUBLE_EQ(pressure.cpu_some_avg10, 70.0);
+  EXPECT_DOUBLE_EQ(pressure.memory_some_avg10, 2.25);
+  EXPECT_EQ(pressure.memory_available_mb, 3072);
+}
+
+TEST(ResourceDiscoveryTest, MissingFilesMeanUnlimited) {
+  FakeCgroupDir cgroup;
+  cgroup.write("cpu.max", "max 100000\n");
+  cgroup.write("memory.max", "max\n");
+
+  CgroupMonitor monitor(cgroup.path());
+  const auto limits = monitor.read_limits();
+  EXPECT_FALSE(limits.cpu_quota_cores.has_value());
+  EXPECT_FALSE(limits.memory_max_mb.has_value());
+
+  const auto pressure = monitor.sample();
+  EXPECT_DOUBLE_EQ(pressure.cpu_some_avg10, 0.0);
+  EXPECT_EQ(pressure.memory_available_mb, -1);
+}
+
+TEST(ResourceDiscoveryTest, DerivesBudgetFromQuotaAndMemoryLimit) {
+  stv::core::SchedulerConfig cfg;
+  CgroupLimits limits;
+  limits.cpu_quota_cores = 2.5;
+  limits.memory_max_mb = 4096;
+  limits.memory_current_mb = 1024;
+
+  stv::infra::apply_discovered_budget(limits, 64, cfg);
+  EXPECT_EQ(cfg.worker_count, 2);
+  EXPECT_EQ(cfg.resource_budget.cpu_slots_hard, 2);
+  EXPECT_EQ(cfg.resource_budget.ram_soft_mb, 2304);
+  EXPECT_EQ(cfg.resource_budget.vram_soft_mb, 7680);
+
+  // No quota: the cpuset-aware CPU count drives the worker count.
+  stv::core::SchedulerConfig unlimited;
+  stv::infra::apply_discovered_budget(CgroupLimits{}, 6, unlimited);
+  EXPECT_EQ(unlimited.worker_count, 5);
+  EXPECT_EQ(unlimited.resource_budget.cpu_slots_hard, 5);
+  EXPECT_EQ(unlimited.resource_budget.ram_soft_mb, 2048);
+}
@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+
+#include "core/runtime_estimator.h"
+
+#include <any>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+
+using namespace stv::core;
+namespace fs = std::filesystem;
+
+TEST(RuntimeEstimator, KeyUsesTypeStageAndFeatureInputs) {
+  RuntimeEstimator estimator;
+  std::unordered_map<std::string, std::any> inputs{
+      {"width", 1024},
+      {"height", 768},
+      {"num_inference_steps", 30},
+      {"prompt", std::string("ignored: not a feature")},
+  };
+  EXPECT_EQ(estimator.make_key(TaskType::ImageGen, "ImageGenStage", inputs),
+            "ImageGen|ImageGenStage|width=1024,height=768,num_inference_steps=30");
+  EXPECT_EQ(estimator.make_key(TaskType::Compose, "Compose", {}), "Compose|Compose|");
+
+  estimator.set_feature_keys({"prompt"});
+  EXPECT_EQ(estimator.make_key(TaskType::ImageGen, "S", inputs),
+            "ImageGen|S|prompt=ignored: not a feature");
+}
+
+TEST(RuntimeEstimator, TracksEwmaAndQuantiles) {
+  RuntimeEstimator estimator({}, /*alpha=*/0.5, /*window=*/10);
+  EXPECT_FALSE(estimator.estimate("k").has_value());
+
+  for (int i = 1; i <= 10; ++i) {
+    estimator.record("k", RuntimeObservation{i * 100.0, i * 10, i});
+  }
+  auto estimate = estimator.estimate("k");
+  ASSERT_TRUE(estimate.has_value());
+  EXPECT_EQ(estimate->samples, 10);
+  EXPECT_DOUBLE_EQ(estimate->runtime_ms_p50, 500.0);
+  EXPECT_DOUBLE_EQ(estimate->runtime_ms_p90, 900.0);
+  EXPECT_EQ(estimate->rss_mb_p90, 90);
+  EXPECT_EQ(estimate->vram_mb_p90, 9);
+  EXPECT_GT(estimate->runtime_ms_ewma, 800.0); // Recent samples dominate
+
+  // The window slides; the total sample count keeps growing.
+  for (int i = 0; i < 10; ++i) {
+    estimator.record("k", RuntimeObservation{50.0, 1, 0});
+  }
+  estimate = estimator.estimate("k");
+  EXPECT_EQ(estimate->samples, 20);
+  EXPECT_DOUBLE_EQ(estimate->runtime_ms_p90, 50.0);
+}
+
+TEST(RuntimeEstimator, ResourceQuantilesOnlyUseMeasuredSamples) {
+  RuntimeEstimator estimator;
+  estimator.record("k", RuntimeObservation{100.0, -1, -1});
+  estimator.record("k", RuntimeObservation{100.0, -1, 800});
+  estimator.record("k", RuntimeObservation{100.0, -1, 600});
+  const auto estimate = estimator.estimate("k");
+  ASSERT_TRUE(estimate.has_value());
+  EXPECT_EQ(estimate->samples, 3);
+  EXPECT_EQ(estimate->rss_samples, 0);
+  EXPECT_EQ(estimate->rss_mb_p90, 0);
+  EXPECT_EQ(estimate->vram_samples, 2);
+  EXPECT_EQ(estimate->vram_mb_p90, 800);
+}
+
+TEST(RuntimeEstimator, SaveAndLoadRoundTrip) {
+  const auto path = fs::temp_directory_path() / "stv_estimator_test" / "model.tsv";
+  fs::remove_all(path.parent_path());
+  {
+    RuntimeEstimator estimator(path.string());
+    estimator.record("ImageGen|S|width=512", RuntimeObservation{120.0, 64, 900});
+    estimator.record("ImageGen|S|width=512", RuntimeObservation{180.0, 80, 1100});
+    ASSERT_TRUE(estimator.save().is_ok());
+  }
+  ASSERT_TRUE(fs::exists(path));
+
+  RuntimeEstimator reloaded(path.string());
+  ASSERT_TRUE(reloaded.load().is_ok());
+  const auto estimate = reloaded.estimate("ImageGen|S|width=512");
+  ASSERT_TRUE(estimate.has_value());
+  EXPECT_EQ(estimate->samples, 2);
+  EXPECT_DOUBLE_EQ(estimate->runtime_ms_p90, 180.0);
+  EXPECT_EQ(estimate->vram_mb_p90, 1100);
+
+  // Unversioned models measured RSS as process growth: keep runtimes only.
+  {
+    std::ofstream legacy(path, std::ios::trunc);
+    legacy << "ImageGen|S|width=512\t2\t150\t120,64,900;180,80,1100\n";
+  }
+  ASSERT_TRUE(reloaded.load().is_ok());
+  const auto legacy_estimate = reloaded.estimate("ImageGen|S|width=512");
+  ASSERT_TRUE(legacy_estimate.has_value());
+  EXPECT_DOUBLE_EQ(legacy_estimate->runtime_ms_p90, 180.0);
+  EXPECT_EQ(legacy_estimate->rss_samples, 0);
+  EXPECT_EQ(legacy_estimate->vram_samples, 0);
+
+  RuntimeEstimator missing((path.parent_path() / "absent.tsv").string());
+  EXPECT_TRUE(missing.load().is_ok());
+  fs::remove_all(path.parent_path());
+}
@@ -197,3 +197,52 @@ TEST(Scheduler, NoPendingAfterCompletion) {
   scheduler->tick();
   ASSERT_FALSE(scheduler->has_pending_tasks());
 }
+
+TEST(Scheduler, SucceededEventCarriesOutputs) {
+  auto scheduler = create_simple_scheduler();
+  auto stage = std::make_shared<CountingStage>();
+
+  TaskDescriptor task;
+  task.task_id = "ev-001";
+  task.trace_id = "trace-7";
+  task.type = TaskType::ImageGen;
+
+  std::vector<TaskEvent> events;
+  scheduler->on_task_event([&](const TaskEvent &event) { events.push_back(event); });
+
+  ASSERT_TRUE(scheduler->submit(std::move(task), stage).is_ok());
+  scheduler->tick();
+
+  ASSERT_FALSE(events.empty());
+  const auto &done = events.back();
+  ASSERT_EQ(done.state, TaskState::Succeeded);
+  EXPECT_EQ(done.trace_id, "trace-7");
+  EXPECT_EQ(done.attempt, 1);
+  ASSERT_TRUE(done.outputs);
+  ASSERT_EQ(done.outputs->count("result"), 1u);
+  EXPECT_EQ(std::any_cast<std::string>(done.outputs->at("result")), "done");
+  for (size_t i = 0; i + 1 < events.size(); ++i) {
+    EXPECT_FALSE(events[i].outputs);
+  }
+}
+
+TEST(Scheduler, FailedEventCarriesError) {
+  auto scheduler = create_simple_scheduler();
+  auto stage = std::make_shared<FailingStage>();
+
+  TaskDescriptor task;
+  task.task_id = "ev-002";
+  task.trace_id = "trace-8";
+  task.type = TaskType::Compose;
+
+  std::vector<TaskEvent> events;
+  scheduler->on_task_event([&](const TaskEvent &event) { events.push_back(event); });
+
+  ASSERT_TRUE(scheduler->submit(std::move(task), stage).is_ok());
+  scheduler->tick();
+
+  ASSERT_FALSE(events.empty());
+  ASSERT_EQ(events.back().state, TaskState::Failed);
+  ASSERT_TRUE(events.back().error.has_value());
+  EXPECT_FALSE(events.back().outputs);
+}
@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+
+#include "core/sha256.h"
+#include "core/stage_memo.h"
+
+#include <any>
+#include <string>
+#include <vector>
+
+using namespace stv::core;
+
+namespace {
+
+class VersionedStage : public IStage {
+public:
+  explicit VersionedStage(std::string version, std::vector<std::string> keys = {})
+      : version_(std::move(version)), keys_(std::move(keys)) {}
+
+  std::string name() const override { return "VersionedStage"; }
+  std::string version() const override { return version_; }
+  std::vector<std::string> memo_inputs(const StageContext &) const override {
+    return keys_;
+  }
+  Result<void, TaskError> execute(StageContext &) override {
+    return Result<void, TaskError>::Ok();
+  }
+
+private:
+  std::string version_;
+  std::vector<std::string> keys_;
+};
+
+StageContext make_ctx(std::unordered_map<std::string, std::any> inputs) {
+  StageContext ctx;
+  ctx.inputs = std::move(inputs);
+  return ctx;
+}
+
+} // namespace
+
+TEST(Sha256, MatchesKnownVectors) {
+  EXPECT_EQ(sha256_hex(""),
+            "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+  EXPECT_EQ(sha256_hex("abc"),
+            "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+  // Two-block message (padding crosses the 56-byte boundary).
+  EXPECT_EQ(sha256_hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+            "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+
+  Sha256 incremental;
+  incremental.update("ab");
+  incremental.update("c");
+  EXPECT_EQ(incremental.hex_digest(), sha256_hex("abc"));
+}
+
+TEST(StageMemoKey, DependsOnVersionAndHashedInputsOnly) {
+  const auto ctx = make_ctx({{"prompt", std::string("a cat")}, {"steps", 20}});
+  const auto key = stage_memo_key(VersionedStage("1"), ctx);
+  ASSERT_EQ(key.size(), 64U);
+  EXPECT_EQ(key, stage_memo_key(VersionedStage("1"), ctx));
+  EXPECT_NE(key, stage_memo_key(VersionedStage("2"), ctx));
+  EXPECT_NE(key, stage_memo_key(VersionedStage("1"),
+                                make_ctx({{"prompt", std::string("a dog")},
+                                          {"steps", 20}})));
+  // Same value, different type.
+  EXPECT_NE(key, stage_memo_key(VersionedStage("1"),
+                                make_ctx({{"prompt", std::string("a cat")},
+                                          {"steps", 20.0}})));
+
+  // Narrowed inputs ignore everything else.
+  VersionedStage narrow("1", {"prompt"});
+  EXPECT_EQ(stage_memo_key(narrow, ctx),
+            stage_memo_key(narrow, make_ctx({{"prompt", std::string("a cat")},
+                                             {"steps", 50},
+                                             {"other_scene", std::string("x")}})));
+}
+
+TEST(StageMemoKey, EmptyWhenNotMemoizable) {
+  EXPECT_TRUE(stage_memo_key(VersionedStage(""), make_ctx({})).empty());
+  struct Opaque {};
+  EXPECT_TRUE(
+      stage_memo_key(VersionedStage("1"), make_ctx({{"blob", Opaque{}}})).empty());
+  // An unhashable input outside the narrowed set does not matter.
+  EXPECT_FALSE(stage_memo_key(VersionedStage("1", {"prompt"}),
+                              make_ctx({{"blob", Opaque{}}}))
+                   .empty());
+}
+
+TEST(InMemoryStageMemo, EvictsLeastRecentlyUsed) {
+  InMemoryStageMemo memo(2);
+  memo.store("a", {{"path", std::string("/a")}});
+  memo.store("b", {{"path", std::string("/b")}});
+  ASSERT_TRUE(memo.lookup("a").has_value()); // a is now most recent
+  memo.store("c", {{"path", std::string("/c")}});
+
+  EXPECT_EQ(memo.size(), 2U);
+  EXPECT_FALSE(memo.lookup("b").has_value());
+  auto a = memo.lookup("a");
+  ASSERT_TRUE(a.has_value());
+  EXPECT_EQ(std::any_cast<std::string>(a->at("path")), "/a");
+  EXPECT_TRUE(memo.lookup("c").has_value());
+}
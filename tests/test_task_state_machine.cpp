@@ -3,6 +3,11 @@
 #include "core/cancel_token.h"
 #include "core/task.h"
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
 using namespace stv::core;
 
 // ============================================================
@@ -308,7 +313,7 @@ TEST(CancelToken, BasicCancelFlow) {
 TEST(CancelToken, IdempotentCancel) {
   auto token = CancelToken::create();
   int callback_count = 0;
-  token->on_cancel([&]() { callback_count++; });
+  auto registration = token->on_cancel([&]() { callback_count++; });
 
   token->request_cancel();
   token->request_cancel(); // Should not invoke callback again
@@ -318,7 +323,7 @@ TEST(CancelToken, IdempotentCancel) {
 TEST(CancelToken, CallbackInvokedOnCancel) {
   auto token = CancelToken::create();
   bool called = false;
-  token->on_cancel([&]() { called = true; });
+  auto registration = token->on_cancel([&]() { called = true; });
 
   ASSERT_FALSE(called);
   token->request_cancel();
@@ -330,7 +335,7 @@ TEST(CancelToken, CallbackInvokedImmediatelyIfAlreadyCanceled) {
   token->request_cancel();
 
   bool called = false;
-  token->on_cancel([&]() { called = true; });
+  auto registration = token->on_cancel([&]() { called = true; });
   ASSERT_TRUE(called); // Invoked immediately
 }
 
@@ -341,3 +346,115 @@ TEST(CancelToken, ThrowIfCanceled) {
   token->request_cancel();
   ASSERT_THROW(token->throw_if_canceled(), std::runtime_error);
 }
+
+TEST(CancelToken, DestroyedRegistrationIsNotInvoked) {
+  auto token = CancelToken::create();
+  int kept = 0;
+  int dropped = 0;
+  auto registration = token->on_cancel([&]() { kept++; });
+  {
+    auto temporary = token->on_cancel([&]() { dropped++; });
+    ASSERT_TRUE(temporary.active());
+  }
+  auto reset_early = token->on_cancel([&]() { dropped++; });
+  reset_early.reset();
+  ASSERT_FALSE(reset_early.active());
+
+  token->request_cancel();
+  ASSERT_EQ(kept, 1);
+  ASSERT_EQ(dropped, 0);
+  ASSERT_FALSE(registration.active()); // Fired
+}
+
+TEST(CancelToken, ParentCancelReachesChildren) {
+  auto parent = CancelToken::create();
+  auto child = parent->create_child();
+  auto grandchild = child->create_child();
+
+  parent->request_cancel();
+  ASSERT_TRUE(child->is_canceled());
+  ASSERT_TRUE(grandchild->is_canceled());
+
+  // Children of an already-canceled token start canceled.
+  ASSERT_TRUE(parent->create_child()->is_canceled());
+}
+
+TEST(CancelToken, ChildCancelsIndependently) {
+  auto parent = CancelToken::create();
+  auto first = parent->create_child();
+  auto second = parent->create_child();
+
+  first->request_cancel();
+  ASSERT_TRUE(first->is_canceled());
+  ASSERT_FALSE(second->is_canceled());
+  ASSERT_FALSE(parent->is_canceled());
+
+  // A destroyed child unlinks itself; canceling the parent afterwards is safe.
+  first.reset();
+  parent->request_cancel();
+  ASSERT_TRUE(second->is_canceled());
+}
+
+TEST(CancelToken, ConcurrentRegisterDeregisterAndCancel) {
+  auto token = CancelToken::create();
+  std::atomic<int> fired{0};
+  std::atomic<int> kept{0};
+  std::vector<std::thread> threads;
+  std::vector<std::vector<CancelRegistration>> held(4);
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < 2000; ++i) {
+        auto registration = token->on_cancel([&]() { fired++; });
+        if (i % 100 == 0) {
+          kept++;
+          held[t].push_back(std::move(registration));
+        }
+      }
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  token->request_cancel();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // Every kept registration fires exactly once; transient ones that were
+  // still alive at cancel time (or registered after it) may fire too.
+  ASSERT_GE(fired.load(), kept.load());
+  int held_active = 0;
+  for (auto &per_thread : held) {
+    for (auto &registration : per_thread) {
+      held_active += registration.active() ? 1 : 0;
+    }
+  }
+  ASSERT_EQ(held_active, 0);
+}
+
+TEST(CancelToken, CallbacksHeldByPrunerRunBeforeCancelReturns) {
+  // A registration that triggers a prune detaches the list for a moment;
+  // request_cancel() landing then must still run every callback itself.
+  int short_rounds = 0;
+  for (int round = 0; round < 300; ++round) {
+    auto token = CancelToken::create();
+    std::atomic<int> fired{0};
+    std::vector<CancelRegistration> kept;
+    for (int i = 0; i < 8; ++i) {
+      kept.push_back(token->on_cancel([&]() { fired++; }));
+    }
+    std::atomic<int> registered{0};
+    std::thread churn([&]() {
+      while (!token->is_canceled()) {
+        auto transient = token->on_cancel([]() {}); // Dropped at once
+        registered++;
+      }
+    });
+    while (registered.load() < 20 + round % 16) {
+      std::this_thread::yield();
+    }
+    token->request_cancel();
+    short_rounds += fired.load() == 8 ? 0 : 1;
+    churn.join();
+    ASSERT_EQ(fired.load(), 8);
+  }
+  EXPECT_EQ(short_rounds, 0);
+}
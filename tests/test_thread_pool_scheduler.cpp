@@ -1,9 +1,11 @@
 #include <gtest/gtest.h>
 
+#include "core/cpu_topology.h"
 #include "core/pipeline.h"
 #include "core/scheduler.h"
 
 #include <algorithm>
+#include <any>
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
@@ -12,6 +14,7 @@
 #include <mutex>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -510,3 +513,1129 @@ TEST(ThreadPoolScheduler, ConcurrentCancelPauseResumeNoDeadlock) {
   ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(5)));
   ASSERT_FALSE(scheduler->has_pending_tasks());
 }
+
+TEST(ThreadPoolScheduler, ForgetDropsFinishedTasksOfTrace) {
+  auto scheduler = create_thread_pool_scheduler(make_config(), nullptr);
+  auto head = make_task("head");
+  auto tail = make_task("tail");
+  tail.deps = {"head"};
+  auto other = make_task("other");
+  other.trace_id = "other-trace";
+  ASSERT_TRUE(scheduler->submit(std::move(head), std::make_shared<FixedWorkStage>(1, 1))
+                  .is_ok());
+  ASSERT_TRUE(scheduler->submit(std::move(tail), std::make_shared<FixedWorkStage>(1, 1))
+                  .is_ok());
+  ASSERT_TRUE(scheduler->submit(std::move(other), std::make_shared<FixedWorkStage>(1, 1))
+                  .is_ok());
+  ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(2)));
+
+  scheduler->forget("trace");
+  scheduler->forget("no-such-trace");
+
+  // Forgotten ids are unknown again; the other trace is untouched.
+  auto late = make_task("late");
+  late.deps = {"head"};
+  ASSERT_TRUE(scheduler->submit(std::move(late), std::make_shared<FixedWorkStage>(1, 1))
+                  .is_err());
+  ASSERT_TRUE(scheduler->submit(make_task("tail"), std::make_shared<FixedWorkStage>(1, 1))
+                  .is_ok());
+  auto after_other = make_task("after-other");
+  after_other.deps = {"other"};
+  ASSERT_TRUE(scheduler
+                  ->submit(std::move(after_other), std::make_shared<FixedWorkStage>(1, 1))
+                  .is_ok());
+  ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(2)));
+  ASSERT_FALSE(scheduler->has_pending_tasks());
+  ASSERT_EQ(scheduler->metrics().tasks_succeeded, 5U);
+}
+
+namespace {
+
+class MemoizedStage : public IStage {
+public:
+  MemoizedStage(std::atomic<int> *executions, std::atomic<bool> *reusable)
+      : executions_(executions), reusable_(reusable) {}
+
+  std::string name() const override { return "MemoizedStage"; }
+  std::string version() const override { return "1"; }
+  std::vector<std::string> memo_inputs(const StageContext &) const override {
+    return {"prompt"};
+  }
+  bool outputs_reusable(const std::unordered_map<std::string, std::any> &) const override {
+    return reusable_->load();
+  }
+
+  Result<void, TaskError> execute(StageContext &ctx) override {
+    executions_->fetch_add(1);
+    ctx.set_output("image_path", std::string("/cache/image.png"));
+    return Result<void, TaskError>::Ok();
+  }
+
+private:
+  std::atomic<int> *executions_;
+  std::atomic<bool> *reusable_;
+};
+
+} // namespace
+
+TEST(ThreadPoolScheduler, MemoHitWithUnreusableOutputsReExecutes) {
+  auto cfg = make_config();
+  cfg.memoization.memo = std::make_shared<InMemoryStageMemo>();
+  auto scheduler = create_thread_pool_scheduler(cfg, nullptr);
+  std::atomic<int> executions{0};
+  std::atomic<bool> reusable{true};
+  auto run = [&](const std::string &id) {
+    auto task = make_task(id);
+    task.inputs["prompt"] = std::string("lighthouse");
+    ASSERT_TRUE(scheduler->submit(std::move(task),
+                                  std::make_shared<MemoizedStage>(&executions, &reusable))
+                    .is_ok());
+    ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(2)));
+  };
+
+  run("first");
+  run("second");
+  EXPECT_EQ(executions.load(), 1);
+  EXPECT_EQ(scheduler->metrics().memo_hits, 1U);
+
+  // The memoized file was evicted: the lookup is ignored and the stage runs.
+  reusable = false;
+  run("third");
+  EXPECT_EQ(executions.load(), 2);
+  const auto m = scheduler->metrics();
+  EXPECT_EQ(m.memo_hits, 1U);
+  EXPECT_EQ(m.memo_stores, 2U);
+  EXPECT_EQ(m.tasks_succeeded, 3U);
+}
+
+TEST(ThreadPoolScheduler, RetryableFailureIsRetriedWithBackoff) {
+  auto cfg = make_config();
+  cfg.retry.default_policy.max_attempts = 3;
+  cfg.retry.default_policy.initial_backoff_ms = 30;
+  cfg.retry.default_policy.backoff_multiplier = 2.0;
+  auto scheduler = create_thread_pool_scheduler(cfg, nullptr);
+
+  std::mutex events_mutex;
+  std::vector<TaskEvent> events;
+  scheduler->on_task_event([&](const TaskEvent &event) {
+    std::lock_guard<std::mutex> lock(events_mutex);
+    events.push_back(event);
+  });
+
+  std::atomic<int> calls{0};
+  std::vector<Clock::time_point> call_times(3);
+  auto flaky = std::make_shared<LambdaStage>([&](StageContext &) {
+    const int n = calls.fetch_add(1);
+    call_times[static_cast<size_t>(std::min(n, 2))] = Clock::now();
+    if (n < 2) {
+      return Result<void, TaskError>::Err(TaskError(
+          ErrorCategory::Network, 1004, true, "Server error", "HTTP 503"));
+    }
+    return Result<void, TaskError>::Ok();
+  });
+
+  auto head = make_task("flaky", 10);
+  auto tail = make_task("tail", 10);
+  tail.deps = {"flaky"};
+  ASSERT_TRUE(scheduler->submit(std::move(head), flaky).is_ok());
+  ASSERT_TRUE(
+      scheduler->submit(std::move(tail), std::make_shared<FixedWorkStage>(1, 1))
+          .is_ok());
+
+  ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(4)));
+  ASSERT_EQ(calls.load(), 3);
+  // Second backoff doubles the first.
+  ASSERT_GE(call_times[1] - call_times[0], std::chrono::milliseconds(30));
+  ASSERT_GE(call_times[2] - call_times[1], std::chrono::milliseconds(60));
+
+  std::lock_guard<std::mutex> lock(events_mutex);
+  int requeues = 0;
+  bool tail_succeeded = false;
+  for (const auto &event : events) {
+    ASSERT_NE(event.state, TaskState::Failed);
+    if (event.task_id == "flaky" && event.state == TaskState::Queued) {
+      ++requeues;
+      ASSERT_TRUE(event.error.has_value());
+      ASSERT_EQ(event.attempt, requeues);
+    }
+    if (event.task_id == "flaky" && event.state == TaskState::Succeeded) {
+      ASSERT_EQ(event.attempt, 3);
+    }
+    if (event.task_id == "tail" && event.state == TaskState::Succeeded) {
+      tail_succeeded = true;
+    }
+  }
+  ASSERT_EQ(requeues, 2);
+  ASSERT_TRUE(tail_succeeded);
+
+  const auto m = scheduler->metrics();
+  ASSERT_EQ(m.retries_scheduled, 2U);
+  ASSERT_EQ(m.attempts_started, 4U);
+  ASSERT_EQ(m.tasks_succeeded, 2U);
+  ASSERT_EQ(m.tasks_failed, 0U);
+}
+
+TEST(ThreadPoolScheduler, RecoveredTaskEventsCarryNoStaleError) {
+  auto cfg = make_config();
+  cfg.retry.default_policy.max_attempts = 2;
+  cfg.retry.default_policy.initial_backoff_ms = 5;
+  auto scheduler = create_thread_pool_scheduler(cfg, nullptr);
+
+  std::mutex events_mutex;
+  std::vector<TaskEvent> events;
+  scheduler->on_task_event([&](const TaskEvent &event) {
+    std::lock_guard<std::mutex> lock(events_mutex);
+    events.push_back(event);
+  });
+
+  std::atomic<int> calls{0};
+  auto flaky = std::make_shared<LambdaStage>([&](StageContext &) {
+    if (calls.fetch_add(1) == 0) {
+      return Result<void, TaskError>::Err(TaskError(
+          ErrorCategory::Network, 1004, true, "Server error", "HTTP 503"));
+    }
+    return Result<void, TaskError>::Ok();
+  });
+  ASSERT_TRUE(scheduler->submit(make_task("flaky", 10), flaky).is_ok());
+  ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(4)));
+  ASSERT_EQ(calls.load(), 2);
+
+  // Only the retry Queued event reports the failure; the second attempt
+  // starts clean and its Succeeded event must not look like an error.
+  std::lock_guard<std::mutex> lock(events_mutex);
+  bool requeued = false;
+  bool succeeded = false;
+  for (const auto &event : events) {
+    if (event.state == TaskState::Queued && event.attempt == 1) {
+      requeued = true;
+      ASSERT_TRUE(event.error.has_value());
+      continue;
+    }
+    if (event.attempt == 2) {
+      ASSERT_FALSE(event.error.has_value()) << to_string(event.state);
+    }
+    if (event.state == TaskState::Succeeded) {
+      succeeded = true;
+    }
+  }
+  ASSERT_TRUE(requeued);
+  ASSERT_TRUE(succeeded);
+}
+
+TEST(ThreadPoolScheduler, RetryBudgetExhaustedFailsAndCancelsSuccessors) {
+  auto cfg = make_config();
+  cfg.retry.per_type[TaskType::ImageGen].max_attempts = 2;
+  cfg.retry.per_type[TaskType::ImageGen].initial_backoff_ms = 5;
+  auto scheduler = create_thread_pool_scheduler(cfg, nullptr);
+
+  EventLog log;
+  scheduler->on_state_change([&](const std::string &task_id, TaskState state, float) {
+    log.push(task_id, state);
+  });
+
+  std::atomic<int> calls{0};
+  auto always_fails = std::make_shared<LambdaStage>([&](StageContext &) {
+    calls.fetch_add(1);
+    return Result<void, TaskError>::Err(
+        TaskError(ErrorCategory::Network, 1004, true, "Server error", "HTTP 503"));
+  });
+
+  auto head = make_task("doomed", 10);
+  auto tail = make_task("after-doomed", 10);
+  tail.deps = {"doomed"};
+  ASSERT_TRUE(scheduler->submit(std::move(head), always_fails).is_ok());
+  ASSERT_TRUE(
+      scheduler->submit(std::move(tail), std::make_shared<FixedWorkStage>(1, 1))
+          .is_ok());
+
+  ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(4)));
+  ASSERT_EQ(calls.load(), 2);
+  ASSERT_TRUE(log.has_event("doomed", TaskState::Failed));
+  ASSERT_TRUE(log.has_event("after-doomed", TaskState::Canceled));
+  ASSERT_EQ(scheduler->metrics().retries_exhausted, 1U);
+}
+
+TEST(ThreadPoolScheduler, NonRetryableErrorAndPerTaskPolicy) {
+  auto cfg = make_config();
+  cfg.retry.default_policy.max_attempts = 5;
+  cfg.retry.default_policy.initial_backoff_ms = 1;
+  auto scheduler = create_thread_pool_scheduler(cfg, nullptr);
+
+  std::atomic<int> fatal_calls{0};
+  auto fatal = std::make_shared<LambdaStage>([&](StageContext &) {
+    fatal_calls.fetch_add(1);
+    return Result<void, TaskError>::Err(TaskError::Pipeline("bad input"));
+  });
+
+  std::atomic<int> capped_calls{0};
+  auto capped = std::make_shared<LambdaStage>([&](StageContext &) {
+    capped_calls.fetch_add(1);
+    return Result<void, TaskError>::Err(
+        TaskError(ErrorCategory::Network, 1002, true, "Timeout", "timeout"));
+  });
+
+  auto a = make_task("fatal", 10);
+  auto b = make_task("capped", 10);
+  b.retry_policy = TaskRetryPolicy{};
+  b.retry_policy->max_attempts = 2;
+  b.retry_policy->initial_backoff_ms = 1;
+  ASSERT_TRUE(scheduler->submit(std::move(a), fatal).is_ok());
+  ASSERT_TRUE(scheduler->submit(std::move(b), capped).is_ok());
+
+  ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(4)));
+  ASSERT_EQ(fatal_calls.load(), 1);
+  ASSERT_EQ(capped_calls.load(), 2);
+}
+
+TEST(ThreadPoolScheduler, CancelDuringRetryBackoff) {
+  auto cfg = make_config();
+  cfg.retry.default_policy.max_attempts = 3;
+  cfg.retry.default_policy.initial_backoff_ms = 2000;
+  auto scheduler = create_thread_pool_scheduler(cfg, nullptr);
+
+  EventLog log;
+  scheduler->on_state_change([&](const std::string &task_id, TaskState state, float) {
+    log.push(task_id, state);
+  });
+
+  std::atomic<int> calls{0};
+  auto flaky = std::make_shared<LambdaStage>([&](StageContext &) {
+    calls.fetch_add(1);
+    return Result<void, TaskError>::Err(
+        TaskError(ErrorCategory::Network, 1004, true, "Server error", "HTTP 503"));
+  });
+  ASSERT_TRUE(scheduler->submit(make_task("backoff", 10), flaky).is_ok());
+
+  const auto deadline = Clock::now() + std::chrono::seconds(2);
+  while (Clock::now() < deadline && !log.has_event("backoff", TaskState::Queued)) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  ASSERT_TRUE(log.has_event("backoff", TaskState::Queued));
+  ASSERT_EQ(scheduler->metrics().retry_waiting, 1);
+
+  ASSERT_TRUE(scheduler->cancel("backoff").is_ok());
+  ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::milliseconds(500)));
+  ASSERT_EQ(calls.load(), 1);
+  ASSERT_EQ(scheduler->metrics().retry_waiting, 0);
+}
+
+TEST(ThreadPoolScheduler, HedgedDuplicateWinsAndLoserIsCanceled) {
+  auto cfg = make_config();
+  cfg.worker_count = 3;
+  cfg.resource_budget.cpu_slots_hard = 3;
+  cfg.hedging.enabled = true;
+  cfg.hedging.min_samples = 5;
+  cfg.hedging.max_duplicate_ratio = 1.0;
+  auto scheduler = create_thread_pool_scheduler(cfg, nullptr);
+
+  // Warm up ImageGen runtime stats with ~10ms runs.
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_TRUE(scheduler
+                    ->submit(make_task("warm" + std::to_string(i)),
+                             std::make_shared<FixedWorkStage>(1, 10))
+                    .is_ok());
+  }
+  ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(2)));
+
+  std::atomic<int> executions{0};
+  std::atomic<bool> loser_saw_cancel{false};
+  auto straggler = std::make_shared<LambdaStage>([&](StageContext &ctx) {
+    if (executions.fetch_add(1) == 0) {
+      // First execution hangs until canceled.
+      const auto deadline = Clock::now() + std::chrono::seconds(3);
+      while (Clock::now() < deadline) {
+        if (ctx.cancel_token->is_canceled()) {
+          loser_saw_cancel.store(true);
+          return Result<void, TaskError>::Err(TaskError::Canceled());
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      }
+      ctx.set_output("winner", std::string("primary"));
+      return Result<void, TaskError>::Ok();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ctx.set_output("winner", std::string("duplicate"));
+    return Result<void, TaskError>::Ok();
+  });
+
+  std::string observed_winner;
+  auto consumer = std::make_shared<LambdaStage>([&](StageContext &ctx) {
+    observed_winner = ctx.get_input<std::string>("winner");
+    return Result<void, TaskError>::Ok();
+  });
+
+  auto slow = make_task("slow");
+  auto shared_token = slow.cancel_token;
+  auto after = make_task("after-slow");
+  after.type = TaskType::Compose;
+  after.deps = {"slow"};
+  after.cancel_token = shared_token; // Workflow-style shared token
+
+  const auto started = Clock::now();
+  ASSERT_TRUE(scheduler->submit(std::move(slow), straggler).is_ok());
+  ASSERT_TRUE(scheduler->submit(std::move(after), consumer).is_ok());
+  ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(2)));
+
+  ASSERT_LT(Clock::now() - started, std::chrono::milliseconds(1500));
+  ASSERT_EQ(observed_winner, "duplicate");
+  ASSERT_FALSE(shared_token->is_canceled());
+
+  const auto loser_deadline = Clock::now() + std::chrono::seconds(1);
+  while (Clock::now() < loser_deadline && !loser_saw_cancel.load()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  ASSERT_TRUE(loser_saw_cancel.load());
+
+  const auto m = scheduler->metrics();
+  ASSERT_EQ(m.hedges_launched, 1U);
+  ASSERT_EQ(m.hedge_wins, 1U);
+}
+
+TEST(ThreadPoolScheduler, HedgingRespectsVramSoftBudget) {
+  auto cfg = make_config();
+  cfg.worker_count = 3;
+  cfg.resource_budget.cpu_slots_hard = 3;
+  cfg.resource_budget.vram_soft_mb = 100;
+  cfg.hedging.enabled = true;
+  cfg.hedging.min_samples = 3;
+  cfg.hedging.max_duplicate_ratio = 1.0;
+  auto scheduler = create_thread_pool_scheduler(cfg, nullptr);
+
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(scheduler
+                    ->submit(make_task("w" + std::to_string(i)),
+                             std::make_shared<FixedWorkStage>(1, 5))
+                    .is_ok());
+  }
+  ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(2)));
+
+  // A straggler holding 80MB of a 100MB VRAM lane cannot be duplicated.
+  std::atomic<int> executions{0};
+  auto slow_stage = std::make_shared<LambdaStage>([&](StageContext &) {
+    executions.fetch_add(1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    return Result<void, TaskError>::Ok();
+  });
+  auto heavy = make_task("vram-heavy");
+  heavy.resource_demand.vram_mb = 80;
+  ASSERT_TRUE(scheduler->submit(std::move(heavy), slow_stage).is_ok());
+  ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(2)));
+  ASSERT_EQ(executions.load(), 1);
+  ASSERT_EQ(scheduler->metrics().hedges_launched, 0U);
+}
+
+TEST(ThreadPoolScheduler, AffinityPinsWorkersToCpuSet) {
+  const auto allowed = allowed_cpus();
+  ASSERT_FALSE(allowed.empty());
+  const int cpu = allowed.back();
+
+  auto cfg = make_config();
+  cfg.affinity.enabled = true;
+  cfg.affinity.cpu_set = {cpu};
+  cfg.affinity.numa_grouping = false;
+  auto scheduler = create_thread_pool_scheduler(cfg, nullptr);
+
+  std::mutex mutex;
+  std::vector<int> observed;
+  auto stage = std::make_shared<LambdaStage>([&](StageContext &) {
+    std::lock_guard<std::mutex> lock(mutex);
+    observed.push_back(current_cpu());
+    return Result<void, TaskError>::Ok();
+  });
+  for (int i = 0; i < 6; ++i) {
+    ASSERT_TRUE(
+        scheduler->submit(make_task("pin" + std::to_string(i)), stage).is_ok());
+  }
+  ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(2)));
+
+  ASSERT_EQ(observed.size(), 6U);
+#ifdef __linux__
+  for (int seen : observed) {
+    ASSERT_EQ(seen, cpu);
+  }
+#endif
+}
+
+TEST(ThreadPoolScheduler, LocalitySeekingStageRunsOnProducerNode) {
+  // Two synthetic NUMA nodes sharing one real CPU: one worker per node.
+  const int cpu = allowed_cpus().front();
+  CpuTopology topology;
+  topology.nodes = {NumaNode{0, {cpu}}, NumaNode{1, {cpu}}};
+
+  auto cfg = make_config();
+  cfg.affinity.enabled = true;
+  cfg.affinity.topology = topology;
+  cfg.affinity.locality_wait_ms = 2000;
+  auto scheduler = create_thread_pool_scheduler(cfg, nullptr);
+
+  class LocalityStage : public LambdaStage {
+  public:
+    using LambdaStage::LambdaStage;
+    bool prefers_input_locality() const override { return true; }
+  };
+
+  std::mutex mutex;
+  std::unordered_map<std::string, std::thread::id> ran_on;
+  auto record = [&](const std::string &id) {
+    return [&, id](StageContext &) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      std::lock_guard<std::mutex> lock(mutex);
+      ran_on[id] = std::this_thread::get_id();
+      return Result<void, TaskError>::Ok();
+    };
+  };
+
+  constexpr int kChains = 4;
+  for (int i = 0; i < kChains; ++i) {
+    const auto producer = "p" + std::to_string(i);
+    const auto consumer = "c" + std::to_string(i);
+    auto consumer_task = make_task(consumer);
+    consumer_task.deps = {producer};
+    ASSERT_TRUE(scheduler
+                    ->submit(make_task(producer),
+                             std::make_shared<LambdaStage>(record(producer)))
+                    .is_ok());
+    ASSERT_TRUE(scheduler
+                    ->submit(std::move(consumer_task),
+                             std::make_shared<LocalityStage>(record(consumer)))
+                    .is_ok());
+  }
+  ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(5)));
+
+  std::lock_guard<std::mutex> lock(mutex);
+  for (int i = 0; i < kChains; ++i) {
+    ASSERT_EQ(ran_on.at("c" + std::to_string(i)),
+              ran_on.at("p" + std::to_string(i)));
+  }
+  ASSERT_EQ(scheduler->metrics().locality_remote_dispatches, 0U);
+}
+
+namespace {
+
+// One worker kept busy while a low-priority dependency, three mid-priority
+// tasks and an urgent dependent queue up behind it.
+void submit_inheritance_scenario(IScheduler *scheduler, int urgent_priority) {
+  ASSERT_TRUE(scheduler
+                  ->submit(make_task("busy", 1000),
+                           std::make_shared<FixedWorkStage>(1, 80))
+                  .is_ok());
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ASSERT_TRUE(scheduler
+                  ->submit(make_task("dep", 0),
+                           std::make_shared<FixedWorkStage>(1, 5))
+                  .is_ok());
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(scheduler
+                    ->submit(make_task("mid" + std::to_string(i), 50),
+                             std::make_shared<FixedWorkStage>(1, 5))
+                    .is_ok());
+  }
+  auto urgent = make_task("urgent", urgent_priority);
+  urgent.deps = {"dep"};
+  ASSERT_TRUE(scheduler
+                  ->submit(std::move(urgent),
+                           std::make_shared<FixedWorkStage>(1, 5))
+                  .is_ok());
+}
+
+SchedulerConfig make_single_worker_config() {
+  auto cfg = make_config();
+  cfg.worker_count = 1;
+  cfg.resource_budget.cpu_slots_hard = 1;
+  cfg.aging_policy.interval_ms = 60000; // Keep aging out of the ordering
+  return cfg;
+}
+
+} // namespace
+
+TEST(ThreadPoolScheduler, PriorityInheritanceRunsBoostedDependencyFirst) {
+  auto scheduler =
+      create_thread_pool_scheduler(make_single_worker_config(), nullptr);
+  EventLog log;
+  scheduler->on_state_change([&](const std::string &task_id, TaskState state,
+                                 float) { log.push(task_id, state); });
+
+  submit_inheritance_scenario(scheduler.get(), 0);
+  // Boosting the dependent after submit is inherited by its dependency.
+  ASSERT_TRUE(scheduler->set_priority("urgent", 100).is_ok());
+  ASSERT_TRUE(scheduler->set_priority("missing", 1).is_err());
+  ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(3)));
+
+  const int dep_running = log.first_index("dep", TaskState::Running);
+  ASSERT_GE(dep_running, 0);
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_LT(dep_running,
+              log.first_index("mid" + std::to_string(i), TaskState::Running));
+  }
+  ASSERT_LT(log.first_index("urgent", TaskState::Running),
+            log.first_index("mid0", TaskState::Running));
+}
+
+TEST(ThreadPoolScheduler, PriorityInheritanceWithdrawnOnCancel) {
+  auto scheduler =
+      create_thread_pool_scheduler(make_single_worker_config(), nullptr);
+  EventLog log;
+  scheduler->on_state_change([&](const std::string &task_id, TaskState state,
+                                 float) { log.push(task_id, state); });
+
+  submit_inheritance_scenario(scheduler.get(), 100);
+  ASSERT_TRUE(scheduler->cancel("urgent").is_ok());
+  ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(3)));
+
+  const int dep_running = log.first_index("dep", TaskState::Running);
+  ASSERT_GE(dep_running, 0);
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_GT(dep_running,
+              log.first_index("mid" + std::to_string(i), TaskState::Running));
+  }
+}
+
+namespace {
+
+class FakePressureMonitor : public IPressureMonitor {
+public:
+  ResourcePressure sample() override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pressure_;
+  }
+  void set(ResourcePressure pressure) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pressure_ = pressure;
+  }
+
+private:
+  std::mutex mutex_;
+  ResourcePressure pressure_{};
+};
+
+bool wait_for(const std::function<bool()> &pred, std::chrono::milliseconds timeout) {
+  const auto deadline = Clock::now() + timeout;
+  while (Clock::now() < deadline) {
+    if (pred()) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  return pred();
+}
+
+} // namespace
+
+TEST(ThreadPoolScheduler, PressureThrottlesAdmissionAndRecovers) {
+  auto monitor = std::make_shared<FakePressureMonitor>();
+  ResourcePressure high;
+  high.cpu_some_avg10 = 90.0;
+  monitor->set(high);
+
+  auto cfg = make_config();
+  cfg.worker_count = 4;
+  cfg.resource_budget.cpu_slots_hard = 4;
+  cfg.admission.monitor = monitor;
+  cfg.admission.sample_interval_ms = 10;
+  auto scheduler = create_thread_pool_scheduler(cfg, nullptr);
+
+  ASSERT_TRUE(wait_for([&]() { return scheduler->metrics().admission_cpu_slots == 1; },
+                       std::chrono::seconds(2)));
+  ASSERT_GE(scheduler->metrics().admission_throttles, 2U);
+
+  std::atomic<int> running{0};
+  std::atomic<int> max_running{0};
+  for (int i = 0; i < 6; ++i) {
+    ASSERT_TRUE(scheduler
+                    ->submit(make_task("hot" + std::to_string(i)),
+                             std::make_shared<FixedWorkStage>(
+                                 2, 10, true, true, &running, &max_running))
+                    .is_ok());
+  }
+  ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(3)));
+  ASSERT_EQ(max_running.load(), 1);
+
+  monitor->set(ResourcePressure{});
+  ASSERT_TRUE(wait_for([&]() { return scheduler->metrics().admission_cpu_slots == 4; },
+                       std::chrono::seconds(2)));
+  max_running = 0;
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(scheduler
+                    ->submit(make_task("calm" + std::to_string(i)),
+                             std::make_shared<FixedWorkStage>(
+                                 3, 20, true, true, &running, &max_running))
+                    .is_ok());
+  }
+  ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(3)));
+  ASSERT_GT(max_running.load(), 1);
+}
+
+TEST(ThreadPoolScheduler, LowAvailableMemoryHoldsRamHeavyTasks) {
+  auto monitor = std::make_shared<FakePressureMonitor>();
+  ResourcePressure tight;
+  tight.memory_available_mb = 600;
+  monitor->set(tight);
+
+  auto cfg = make_config();
+  cfg.admission.monitor = monitor;
+  cfg.admission.sample_interval_ms = 10;
+  cfg.admission.memory_headroom_mb = 256;
+  auto scheduler = create_thread_pool_scheduler(cfg, nullptr);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  std::atomic<int> running{0};
+  std::atomic<int> max_running{0};
+  for (int i = 0; i < 3; ++i) {
+    auto task = make_task("ram" + std::to_string(i));
+    task.resource_demand.ram_mb = 512; // 600 - 256 headroom < 512
+    ASSERT_TRUE(scheduler
+                    ->submit(std::move(task),
+                             std::make_shared<FixedWorkStage>(
+                                 2, 10, true, true, &running, &max_running))
+                    .is_ok());
+  }
+  ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(3)));
+  ASSERT_EQ(max_running.load(), 1);
+}
+
+TEST(ThreadPoolScheduler, EstimatorLearnsDemandPerInputClass) {
+  auto estimator = std::make_shared<RuntimeEstimator>();
+  auto cfg = make_config();
+  cfg.resource_budget.vram_soft_mb = 2000;
+  cfg.estimation.estimator = estimator;
+  cfg.estimation.min_samples = 3;
+  auto scheduler = create_thread_pool_scheduler(cfg, nullptr);
+
+  std::atomic<int> running{0};
+  std::atomic<int> max_running{0};
+  auto make_stage = [&]() {
+    return std::make_shared<LambdaStage>([&](StageContext &ctx) {
+      FixedWorkStage work(2, 15, false, true, &running, &max_running);
+      auto result = work.execute(ctx);
+      // Large renders report ~1 GB of VRAM, small ones nothing.
+      ctx.reported_vram_mb = ctx.get_input<int>("width") >= 1024 ? 1000 : 0;
+      return result;
+    });
+  };
+  auto make_render = [](const std::string &id, int width) {
+    auto task = make_task(id);
+    task.inputs["width"] = width;
+    return task;
+  };
+
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(scheduler->submit(make_render("warm" + std::to_string(i), 1024),
+                                  make_stage())
+                    .is_ok());
+    ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(2)));
+  }
+  const auto key = estimator->make_key(TaskType::ImageGen, "LambdaStage",
+                                       {{"width", 1024}});
+  ASSERT_EQ(estimator->estimate(key)->samples, 3);
+
+  // Learned 1000 MB × 1.25 headroom per large render: two exceed the 2000 MB
+  // soft VRAM lane, so they serialize.
+  max_running = 0;
+  ASSERT_TRUE(scheduler->submit(make_render("big0", 1024), make_stage()).is_ok());
+  ASSERT_TRUE(scheduler->submit(make_render("big1", 1024), make_stage()).is_ok());
+  ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(2)));
+  ASSERT_EQ(max_running.load(), 1);
+
+  // Pinned demand opts out of the model. Each pinned render waits for its
+  // peer so the overlap does not depend on how fast the second dispatch is.
+  max_running = 0;
+  auto overlapping_stage = [&]() {
+    return std::make_shared<LambdaStage>([&](StageContext &) {
+      const int now = running.fetch_add(1) + 1;
+      int observed = max_running.load();
+      while (observed < now && !max_running.compare_exchange_weak(observed, now)) {
+      }
+      wait_for([&]() { return max_running.load() >= 2; }, std::chrono::seconds(1));
+      running.fetch_sub(1);
+      return Result<void, TaskError>::Ok();
+    });
+  };
+  for (int i = 0; i < 2; ++i) {
+    auto task = make_render("pinned" + std::to_string(i), 1024);
+    task.pin_resource_demand = true;
+    ASSERT_TRUE(scheduler->submit(std::move(task), overlapping_stage()).is_ok());
+  }
+  ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(2)));
+  ASSERT_EQ(max_running.load(), 2);
+}
+
+TEST(ThreadPoolScheduler, EstimatorKeepsDemandThatWasNeverReported) {
+  auto estimator = std::make_shared<RuntimeEstimator>();
+  auto cfg = make_config();
+  cfg.resource_budget.ram_soft_mb = 300; // Room for one default 256 MB demand
+  cfg.estimation.estimator = estimator;
+  cfg.estimation.min_samples = 3;
+  auto scheduler = create_thread_pool_scheduler(cfg, nullptr);
+
+  std::atomic<int> running{0};
+  std::atomic<int> max_running{0};
+  auto make_stage = [&]() {
+    return std::make_shared<FixedWorkStage>(2, 15, false, true, &running,
+                                            &max_running);
+  };
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(scheduler->submit(make_task("warm" + std::to_string(i)), make_stage())
+                    .is_ok());
+    ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(2)));
+  }
+  const auto estimate = estimator->estimate(
+      estimator->make_key(TaskType::ImageGen, "FixedWorkStage", {}));
+  ASSERT_TRUE(estimate.has_value());
+  ASSERT_EQ(estimate->samples, 3);
+  ASSERT_EQ(estimate->rss_samples, 0);
+  ASSERT_EQ(estimate->vram_samples, 0);
+
+  // Nothing reported RAM, so both keep the 256 MB default and serialize.
+  max_running = 0;
+  ASSERT_TRUE(scheduler->submit(make_task("a"), make_stage()).is_ok());
+  ASSERT_TRUE(scheduler->submit(make_task("b"), make_stage()).is_ok());
+  ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(2)));
+  ASSERT_EQ(max_running.load(), 1);
+}
+
+TEST(ThreadPoolScheduler, EstimatedRuntimeBreaksPriorityTies) {
+  auto estimator = std::make_shared<RuntimeEstimator>();
+  auto cfg = make_config();
+  cfg.worker_count = 1;
+  cfg.resource_budget.cpu_slots_hard = 1;
+  cfg.aging_policy.interval_ms = 10000; // Keep scores equal
+  cfg.estimation.estimator = estimator;
+  cfg.estimation.min_samples = 2;
+  auto scheduler = create_thread_pool_scheduler(cfg, nullptr);
+
+  std::mutex order_mutex;
+  std::vector<int> order; // Widths in execution order
+  auto stage = std::make_shared<LambdaStage>([&](StageContext &ctx) {
+    const int width = ctx.get_input<int>("width");
+    std::this_thread::sleep_for(std::chrono::milliseconds(width / 16));
+    std::lock_guard<std::mutex> lock(order_mutex);
+    order.push_back(width);
+    return Result<void, TaskError>::Ok();
+  });
+  auto make_render = [](const std::string &id, int width) {
+    auto task = make_task(id);
+    task.inputs["width"] = width;
+    return task;
+  };
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_TRUE(scheduler->submit(make_render("ws" + std::to_string(i), 1024), stage)
+                    .is_ok());
+    ASSERT_TRUE(scheduler->submit(make_render("wf" + std::to_string(i), 64), stage)
+                    .is_ok());
+    ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(2)));
+  }
+
+  // Hold the only worker, queue the slow render first, then release.
+  std::atomic<bool> release{false};
+  auto gate = std::make_shared<LambdaStage>([&](StageContext &) {
+    while (!release.load()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return Result<void, TaskError>::Ok();
+  });
+  ASSERT_TRUE(scheduler->submit(make_task("gate", 100), gate).is_ok());
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  ASSERT_TRUE(scheduler->submit(make_render("slow", 1024), stage).is_ok());
+  ASSERT_TRUE(scheduler->submit(make_render("fast", 64), stage).is_ok());
+  release = true;
+  ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(2)));
+
+  std::lock_guard<std::mutex> lock(order_mutex);
+  ASSERT_GE(order.size(), 2U);
+  EXPECT_EQ(order[order.size() - 2], 64); // "fast" overtakes "slow"
+  EXPECT_EQ(order.back(), 1024);
+}
+
+namespace {
+
+/// Batchable stage keyed on the "size" input. Records each batch's size;
+/// a batch holds until `release` is set (or 2s) so tests can act mid-batch.
+class FakeBatchStage : public IBatchableStage {
+public:
+  std::string name() const override { return "FakeBatchStage"; }
+
+  Result<void, TaskError> execute(StageContext &ctx) override {
+    std::vector<StageContext *> one{&ctx};
+    return execute_batch(one).front();
+  }
+
+  std::string batch_key(const StageContext &ctx) const override {
+    return ctx.get_input<std::string>("size", "");
+  }
+
+  std::vector<Result<void, TaskError>>
+  execute_batch(const std::vector<StageContext *> &members) override {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      batch_sizes.push_back(static_cast<int>(members.size()));
+    }
+    started.store(true);
+    const auto deadline = Clock::now() + std::chrono::seconds(2);
+    while (hold.load() && !release.load() && Clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    std::vector<Result<void, TaskError>> results;
+    for (auto *ctx : members) {
+      if (ctx->cancel_token->is_canceled()) {
+        results.push_back(Result<void, TaskError>::Err(TaskError::Canceled()));
+      } else {
+        results.push_back(Result<void, TaskError>::Ok());
+      }
+    }
+    return results;
+  }
+
+  std::vector<int> sizes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return batch_sizes;
+  }
+
+  std::atomic<bool> hold{false};
+  std::atomic<bool> started{false};
+  std::atomic<bool> release{false};
+
+private:
+  std::mutex mutex;
+  std::vector<int> batch_sizes;
+};
+
+TaskDescriptor make_sized_task(const std::string &id, const std::string &size) {
+  auto task = make_task(id);
+  task.inputs["size"] = size;
+  return task;
+}
+
+} // namespace
+
+TEST(ThreadPoolScheduler, BatchesReadyTasksSharingKey) {
+  auto cfg = make_single_worker_config();
+  cfg.batching.enabled = true;
+  cfg.batching.max_batch_size = 3;
+  cfg.batching.max_linger_ms = 150;
+  auto scheduler = create_thread_pool_scheduler(cfg, nullptr);
+  auto stage = std::make_shared<FakeBatchStage>();
+
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(scheduler->submit(make_sized_task("s" + std::to_string(i), "512"), stage)
+                    .is_ok());
+  }
+  ASSERT_TRUE(scheduler->submit(make_sized_task("l0", "1024"), stage).is_ok());
+  ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(2)));
+
+  // One full batch of three; the leftover 512 task and the lone 1024 task
+  // run alone once their linger expires.
+  auto sizes = stage->sizes();
+  std::sort(sizes.begin(), sizes.end());
+  ASSERT_EQ(sizes, (std::vector<int>{1, 1, 3}));
+
+  const auto m = scheduler->metrics();
+  ASSERT_EQ(m.batches_dispatched, 1U);
+  ASSERT_EQ(m.batched_tasks, 3U);
+  ASSERT_EQ(m.tasks_succeeded, 5U);
+}
+
+TEST(ThreadPoolScheduler, CancelingOneBatchMemberKeepsOthers) {
+  auto cfg = make_single_worker_config();
+  cfg.batching.enabled = true;
+  cfg.batching.max_batch_size = 3;
+  cfg.batching.max_linger_ms = 500;
+  auto scheduler = create_thread_pool_scheduler(cfg, nullptr);
+  EventLog log;
+  scheduler->on_state_change([&](const std::string &task_id, TaskState state, float) {
+    log.push(task_id, state);
+  });
+  auto stage = std::make_shared<FakeBatchStage>();
+  stage->hold = true;
+
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(scheduler->submit(make_sized_task("b" + std::to_string(i), "512"), stage)
+                    .is_ok());
+  }
+  const auto deadline = Clock::now() + std::chrono::seconds(1);
+  while (!stage->started.load() && Clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  ASSERT_TRUE(stage->started.load());
+
+  ASSERT_TRUE(scheduler->pause("b1").is_err()); // Batched attempts cannot pause
+  ASSERT_TRUE(scheduler->cancel("b1").is_ok());
+  stage->release = true;
+  ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(2)));
+
+  ASSERT_EQ(stage->sizes(), (std::vector<int>{3}));
+  ASSERT_TRUE(log.has_event("b0", TaskState::Succeeded));
+  ASSERT_TRUE(log.has_event("b1", TaskState::Canceled));
+  ASSERT_FALSE(log.has_event("b1", TaskState::Succeeded));
+  ASSERT_TRUE(log.has_event("b2", TaskState::Succeeded));
+}
+
+namespace {
+
+/// FakeBatchStage made memoizable on its "prompt" and "size" inputs.
+class MemoBatchStage : public FakeBatchStage {
+public:
+  std::string version() const override { return "1"; }
+  std::vector<std::string> memo_inputs(const StageContext &) const override {
+    return {"prompt", "size"};
+  }
+};
+
+} // namespace
+
+TEST(ThreadPoolScheduler, MemoHitLeaderReturnsCpuSlotToItsOwnQosClass) {
+  auto cfg = make_config();
+  cfg.worker_count = 1;
+  cfg.resource_budget.cpu_slots_hard = 2;
+  cfg.qos.enabled = true;
+  cfg.batching.enabled = true;
+  cfg.batching.max_batch_size = 2;
+  cfg.batching.max_linger_ms = 150;
+  cfg.memoization.memo = std::make_shared<InMemoryStageMemo>();
+  auto scheduler = create_thread_pool_scheduler(cfg, nullptr);
+  auto stage = std::make_shared<MemoBatchStage>();
+  auto make_member = [](const std::string &id, const std::string &prompt, QosClass qos,
+                        int priority) {
+    auto task = make_sized_task(id, "512");
+    task.inputs["prompt"] = prompt;
+    task.qos = qos;
+    task.priority = priority;
+    return task;
+  };
+
+  // Memoize the leader's outputs first.
+  ASSERT_TRUE(scheduler->submit(make_member("warm", "a", QosClass::Interactive, 0), stage)
+                  .is_ok());
+  ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(2)));
+
+  // The interactive leader hits the memo; the batch-class follower runs.
+  ASSERT_TRUE(scheduler->submit(make_member("lead", "a", QosClass::Interactive, 10), stage)
+                  .is_ok());
+  ASSERT_TRUE(scheduler->submit(make_member("follow", "b", QosClass::Batch, 0), stage)
+                  .is_ok());
+  ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(2)));
+
+  const auto m = scheduler->metrics();
+  ASSERT_EQ(m.batches_dispatched, 1U);
+  ASSERT_EQ(m.memo_hits, 1U);
+  ASSERT_EQ(m.tasks_succeeded, 3U);
+  for (size_t c = 0; c < kQosClassCount; ++c) {
+    EXPECT_EQ(m.qos_cpu_slots[c], 0) << to_string(static_cast<QosClass>(c));
+  }
+}
+
+TEST(ThreadPoolScheduler, QosKeepsCapacityForInteractiveUnderBatchBacklog) {
+  auto cfg = make_config();
+  cfg.worker_count = 4;
+  cfg.resource_budget.cpu_slots_hard = 4;
+  cfg.qos.enabled = true; // Defaults: batch may borrow up to 3 of 4 slots
+  auto scheduler = create_thread_pool_scheduler(cfg, nullptr);
+  EventLog log;
+  scheduler->on_state_change([&](const std::string &task_id, TaskState state, float) {
+    log.push(task_id, state);
+  });
+
+  std::atomic<int> batch_running{0};
+  std::atomic<int> batch_max_running{0};
+  for (int i = 0; i < 9; ++i) {
+    auto t = make_task("batch" + std::to_string(i), 50); // Outranks interactive
+    t.qos = QosClass::Batch;
+    ASSERT_TRUE(scheduler
+                    ->submit(std::move(t), std::make_shared<FixedWorkStage>(
+                                               4, 20, true, true, &batch_running,
+                                               &batch_max_running))
+                    .is_ok());
+  }
+  ASSERT_TRUE(wait_for([&]() { return batch_running.load() == 3; },
+                       std::chrono::seconds(1)));
+
+  auto urgent = make_task("interactive", 0);
+  urgent.qos = QosClass::Interactive;
+  ASSERT_TRUE(scheduler
+                  ->submit(std::move(urgent), std::make_shared<FixedWorkStage>(1, 5))
+                  .is_ok());
+  ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(4)));
+
+  // The idle slot held back from batch took the interactive task at once,
+  // ahead of the batch tasks still queued.
+  ASSERT_EQ(batch_max_running.load(), 3);
+  ASSERT_LT(log.first_index("interactive", TaskState::Succeeded),
+            log.first_index("batch8", TaskState::Running));
+  const auto m = scheduler->metrics();
+  ASSERT_EQ(m.qos_dispatches[static_cast<size_t>(QosClass::Batch)], 9U);
+  ASSERT_EQ(m.qos_dispatches[static_cast<size_t>(QosClass::Interactive)], 1U);
+  ASSERT_EQ(m.qos_cpu_slots[static_cast<size_t>(QosClass::Batch)], 0);
+}
+
+TEST(ThreadPoolScheduler, QosBorrowsIdleReservationsAndReturnsThem) {
+  auto cfg = make_config();
+  cfg.worker_count = 4;
+  cfg.resource_budget.cpu_slots_hard = 4;
+  cfg.qos.enabled = true;
+  cfg.qos.min_cpu_share = {0.5, 0.0, 0.0}; // Two slots reserved for interactive
+  cfg.qos.max_cpu_share = {1.0, 1.0, 1.0};
+  auto scheduler = create_thread_pool_scheduler(cfg, nullptr);
+
+  // Nothing interactive is waiting, so standard work borrows every slot.
+  std::atomic<int> running{0};
+  std::atomic<int> max_running{0};
+  std::atomic<bool> release{false};
+  auto hold = [&](StageContext &) {
+    const int now = running.fetch_add(1) + 1;
+    int observed = max_running.load();
+    while (observed < now && !max_running.compare_exchange_weak(observed, now)) {
+    }
+    while (!release.load()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    running.fetch_sub(1);
+    return Result<void, TaskError>::Ok();
+  };
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(scheduler->submit(make_task("std" + std::to_string(i)),
+                                  std::make_shared<LambdaStage>(hold))
+                    .is_ok());
+  }
+  ASSERT_TRUE(wait_for([&]() { return running.load() == 4; }, std::chrono::seconds(1)));
+
+  // Once interactive work is Ready, freed slots go back to its reservation
+  // before any more standard work runs, regardless of priority. Each late
+  // standard task samples the gauge under the scheduler lock when it starts;
+  // Running callbacks fire outside the lock and may be logged out of order.
+  std::mutex seen_mutex;
+  std::vector<int> interactive_seen;
+  std::atomic<int> late_done{0};
+  auto *sched = scheduler.get();
+  auto late = [&](StageContext &) {
+    const int slots = sched->metrics().qos_cpu_slots[static_cast<size_t>(QosClass::Interactive)];
+    {
+      std::lock_guard<std::mutex> lock(seen_mutex);
+      interactive_seen.push_back(slots);
+    }
+    late_done.fetch_add(1);
+    return Result<void, TaskError>::Ok();
+  };
+  auto interactive = [&](StageContext &) {
+    // Hold the reservation until the late standard work has sampled it.
+    wait_for([&]() { return late_done.load() == 2; }, std::chrono::seconds(2));
+    return Result<void, TaskError>::Ok();
+  };
+  for (int i = 0; i < 2; ++i) {
+    auto t = make_task("late_std" + std::to_string(i), 100);
+    ASSERT_TRUE(scheduler->submit(std::move(t), std::make_shared<LambdaStage>(late)).is_ok());
+  }
+  for (int i = 0; i < 2; ++i) {
+    auto t = make_task("ui" + std::to_string(i));
+    t.qos = QosClass::Interactive;
+    ASSERT_TRUE(
+        scheduler->submit(std::move(t), std::make_shared<LambdaStage>(interactive)).is_ok());
+  }
+  release = true;
+  ASSERT_TRUE(wait_until_idle(scheduler.get(), std::chrono::seconds(4)));
+
+  ASSERT_EQ(max_running.load(), 4);
+  std::lock_guard<std::mutex> lock(seen_mutex);
+  ASSERT_EQ(interactive_seen.size(), 2u);
+  for (int slots : interactive_seen) {
+    EXPECT_EQ(slots, 2);
+  }
+}
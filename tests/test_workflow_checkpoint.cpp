@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+
+#include "core/workflow_checkpoint.h"
+
+#include <any>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace stv::core;
+namespace fs = std::filesystem;
+
+namespace {
+
+class CheckpointStoreTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    root_ = fs::temp_directory_path() /
+            ("stv_checkpoint_" + std::to_string(::getpid()) + "_" +
+             ::testing::UnitTest::GetInstance()->current_test_info()->name());
+    fs::remove_all(root_);
+  }
+  void TearDown() override { fs::remove_all(root_); }
+
+  static WorkflowManifest two_task_manifest(const std::string &trace_id) {
+    WorkflowManifest manifest;
+    manifest.trace_id = trace_id;
+    WorkflowManifest::Task storyboard;
+    storyboard.task_id = trace_id + ".0";
+    storyboard.type = TaskType::Storyboard;
+    storyboard.priority = 100;
+    storyboard.inputs = {{"story_text", std::string("a story, with = and %\n")},
+                         {"scene_count", 2}};
+    WorkflowManifest::Task concat;
+    concat.task_id = trace_id + ".1";
+    concat.type = TaskType::Concat;
+    concat.priority = 10;
+    concat.resource_demand = ResourceDemand{2, 512, 1024};
+    concat.pin_resource_demand = true;
+    concat.deps = {storyboard.task_id};
+    manifest.tasks = {storyboard, concat};
+    return manifest;
+  }
+
+  fs::path root_;
+};
+
+} // namespace
+
+TEST_F(CheckpointStoreTest, RoundTripsDagAndRecordedOutputs) {
+  FileWorkflowCheckpointStore store(root_.string());
+  ASSERT_TRUE(store.begin(two_task_manifest("wf-a")).is_ok());
+
+  const StageOutputs outputs{
+      {"path", std::string("/tmp/a b/c.png")},
+      {"duration", 4.25F},
+      {"ratio", 0.1},
+      {"big", int64_t{1} << 40},
+      {"ok", true},
+      {"scenes", std::vector<std::string>{"one", "", "t,w=o"}},
+      {"ids", std::vector<int>{3, -1}},
+  };
+  EXPECT_TRUE(store.record("wf-a", "wf-a.0", outputs));
+  EXPECT_FALSE(store.record("wf-unknown", "x.0", outputs));
+
+  auto loaded = store.load("wf-a");
+  ASSERT_TRUE(loaded.is_ok());
+  const auto &manifest = loaded.value();
+  ASSERT_EQ(manifest.tasks.size(), 2U);
+
+  const auto &storyboard = manifest.tasks[0];
+  EXPECT_TRUE(storyboard.succeeded);
+  EXPECT_EQ(std::any_cast<std::string>(storyboard.inputs.at("story_text")),
+            "a story, with = and %\n");
+  EXPECT_EQ(std::any_cast<int>(storyboard.inputs.at("scene_count")), 2);
+  EXPECT_EQ(std::any_cast<std::string>(storyboard.outputs.at("path")), "/tmp/a b/c.png");
+  EXPECT_EQ(std::any_cast<float>(storyboard.outputs.at("duration")), 4.25F);
+  EXPECT_EQ(std::any_cast<double>(storyboard.outputs.at("ratio")), 0.1);
+  EXPECT_EQ(std::any_cast<int64_t>(storyboard.outputs.at("big")), int64_t{1} << 40);
+  EXPECT_TRUE(std::any_cast<bool>(storyboard.outputs.at("ok")));
+  EXPECT_EQ(std::any_cast<std::vector<std::string>>(storyboard.outputs.at("scenes")),
+            (std::vector<std::string>{"one", "", "t,w=o"}));
+  EXPECT_EQ(std::any_cast<std::vector<int>>(storyboard.outputs.at("ids")),
+            (std::vector<int>{3, -1}));
+
+  const auto &concat = manifest.tasks[1];
+  EXPECT_FALSE(concat.succeeded);
+  EXPECT_EQ(concat.type, TaskType::Concat);
+  EXPECT_EQ(concat.deps, std::vector<std::string>{"wf-a.0"});
+  EXPECT_EQ(concat.resource_demand.vram_mb, 1024);
+  EXPECT_TRUE(concat.pin_resource_demand);
+}
+
+TEST_F(CheckpointStoreTest, IgnoresTornRecordAndUnencodableOutputs) {
+  FileWorkflowCheckpointStore store(root_.string());
+  ASSERT_TRUE(store.begin(two_task_manifest("wf-b")).is_ok());
+
+  struct Opaque {};
+  EXPECT_FALSE(store.record("wf-b", "wf-b.0", {{"handle", Opaque{}}}));
+  store.finish("wf-b", true);
+  {
+    // A crash mid-write leaves a record without its newline.
+    std::ofstream out(root_ / "wf-b.manifest", std::ios::app);
+    out << "done wf-b.1 path=s:/tmp/half";
+  }
+
+  auto loaded = store.load("wf-b");
+  ASSERT_TRUE(loaded.is_ok());
+  EXPECT_FALSE(loaded.value().tasks[0].succeeded);
+  EXPECT_FALSE(loaded.value().tasks[1].succeeded);
+  EXPECT_EQ(store.list(), std::vector<std::string>{"wf-b"});
+}
+
+TEST_F(CheckpointStoreTest, FinishDeletesUnlessKeptAndRejectsUnsafeIds) {
+  FileWorkflowCheckpointStore store(root_.string());
+  ASSERT_TRUE(store.begin(two_task_manifest("wf-c")).is_ok());
+  ASSERT_TRUE(store.begin(two_task_manifest("wf-d")).is_ok());
+  store.finish("wf-c", false);
+  store.finish("wf-d", true);
+  EXPECT_EQ(store.list(), std::vector<std::string>{"wf-d"});
+  EXPECT_TRUE(store.load("wf-c").is_err());
+  EXPECT_FALSE(store.record("wf-d", "wf-d.0", {})); // Closed
+
+  auto unsafe = two_task_manifest("../escape");
+  EXPECT_TRUE(store.begin(unsafe).is_err());
+  EXPECT_TRUE(store.load("../escape").is_err());
+}
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+
+#include "core/workflow_template.h"
+
+#include <any>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace stv::core;
+
+namespace {
+
+std::shared_ptr<const WorkflowPlan> compile(const std::string &text) {
+  auto plan = compile_workflow_template(text);
+  EXPECT_TRUE(plan.is_ok()) << (plan.is_err() ? plan.error().internal_message : "");
+  return plan.is_ok() ? plan.value() : nullptr;
+}
+
+std::string compile_error(const std::string &text) {
+  auto plan = compile_workflow_template(text);
+  return plan.is_err() ? plan.error().internal_message : std::string("compiled");
+}
+
+int scene_of(const TaskDescriptor &task) {
+  auto it = task.inputs.find("scene_index");
+  return it == task.inputs.end() ? -1 : std::any_cast<int>(it->second);
+}
+
+} // namespace
+
+TEST(WorkflowTemplate, DefaultPlanMatchesPerSceneDag) {
+  const auto plan = default_workflow_plan();
+  ASSERT_NE(plan, nullptr);
+  EXPECT_EQ(plan->name(), "story_to_video");
+  EXPECT_EQ(plan->task_count(3), 14U);
+
+  const auto tasks = plan->instantiate("trace", 3, {{"story_text", std::string("s")}});
+  ASSERT_EQ(tasks.size(), 14U);
+  EXPECT_EQ(tasks.front().type, TaskType::Storyboard);
+  EXPECT_EQ(tasks.front().priority, 100);
+  EXPECT_EQ(std::any_cast<std::string>(tasks.front().inputs.at("story_text")), "s");
+  EXPECT_EQ(tasks.front().task_id, "trace.0");
+
+  // Scene-major emission: image, tts, clip, segment for each scene.
+  const std::vector<TaskType> scene_types{TaskType::ImageGen, TaskType::TTS,
+                                          TaskType::VideoClip, TaskType::Compose};
+  for (int scene = 0; scene < 3; ++scene) {
+    for (size_t k = 0; k < scene_types.size(); ++k) {
+      const auto &task = tasks[1 + static_cast<size_t>(scene) * 4 + k];
+      EXPECT_EQ(task.type, scene_types[k]);
+      EXPECT_EQ(scene_of(task), scene);
+      EXPECT_EQ(task.trace_id, "trace");
+    }
+    // Old hard-coded priorities: 50/50/40/30 + max(0, 10 - scene).
+    EXPECT_EQ(tasks[1 + static_cast<size_t>(scene) * 4].priority, 60 - scene);
+    EXPECT_EQ(tasks[4 + static_cast<size_t>(scene) * 4].priority, 40 - scene);
+  }
+  const auto &concat = tasks.back();
+  EXPECT_EQ(concat.type, TaskType::Concat);
+  EXPECT_EQ(concat.deps,
+            (std::vector<std::string>{tasks[4].task_id, tasks[8].task_id, tasks[12].task_id}));
+}
+
+TEST(WorkflowTemplate, CustomStagesFanOutAndCarryDemand) {
+  const auto plan = compile(R"(
+    # Upscale each image before animating it; forward reference to "up".
+    workflow upscaled
+    stage board Storyboard workflow_inputs
+    stage img   ImageGen per_scene after=board priority=5 scene_bias=2
+    stage clip  VideoClip per_scene after=up
+    stage up    ImageGen per_scene after=img vram_mb=4096 cpu_slots=2 pin_demand
+    stage final Concat after=clip
+  )");
+  ASSERT_NE(plan, nullptr);
+  const auto tasks = plan->instantiate("t", 2, {});
+  ASSERT_EQ(tasks.size(), 8U);
+
+  // Topological within a scene: img, up, clip.
+  EXPECT_EQ(tasks[1].type, TaskType::ImageGen);
+  EXPECT_EQ(tasks[2].resource_demand.vram_mb, 4096);
+  EXPECT_EQ(tasks[2].resource_demand.cpu_slots, 2);
+  EXPECT_TRUE(tasks[2].pin_resource_demand);
+  EXPECT_EQ(tasks[2].deps, std::vector<std::string>{tasks[1].task_id});
+  EXPECT_EQ(tasks[3].type, TaskType::VideoClip);
+  EXPECT_EQ(tasks[6].deps, std::vector<std::string>{tasks[5].task_id}); // Same scene
+  EXPECT_EQ(tasks[1].priority, 7);
+  EXPECT_EQ(tasks[4].priority, 6);
+  EXPECT_EQ(tasks[4].deps, std::vector<std::string>{tasks[0].task_id});
+  EXPECT_EQ(tasks[7].deps, (std::vector<std::string>{tasks[3].task_id, tasks[6].task_id}));
+}
+
+TEST(WorkflowTemplate, RejectsInvalidTemplates) {
+  EXPECT_NE(compile_error("stage a Bogus").find("unknown task type"), std::string::npos);
+  EXPECT_NE(compile_error("stage a TTS after=b").find("unknown stage: b"), std::string::npos);
+  EXPECT_NE(compile_error("stage a TTS\nstage a TTS").find("line 2"), std::string::npos);
+  EXPECT_NE(compile_error("stage a TTS after=b\nstage b TTS after=a").find("cycle"),
+            std::string::npos);
+  EXPECT_NE(compile_error("stage a TTS scene_bias=3").find("needs per_scene"),
+            std::string::npos);
+  EXPECT_NE(compile_error("stage a TTS per_scene\nstage b Concat after=a\n"
+                          "stage c TTS per_scene after=b")
+                .find("cannot follow fan-in"),
+            std::string::npos);
+  EXPECT_NE(compile_error("stage a TTS priority=-1").find("invalid option"), std::string::npos);
+  EXPECT_NE(compile_error("# nothing\n").find("no stages"), std::string::npos);
+}